@@ -298,6 +298,11 @@ void OBSStudioAPI::obs_frontend_replay_buffer_save()
 	QMetaObject::invokeMethod(main, "ReplayBufferSave");
 }
 
+void OBSStudioAPI::obs_frontend_replay_buffer_save_window(double start_sec, double end_sec)
+{
+	QMetaObject::invokeMethod(main, "ReplayBufferSaveWindow", Q_ARG(double, start_sec), Q_ARG(double, end_sec));
+}
+
 void OBSStudioAPI::obs_frontend_replay_buffer_stop()
 {
 	QMetaObject::invokeMethod(main, "StopReplayBuffer");
@@ -289,6 +289,12 @@ void obs_frontend_replay_buffer_save(void)
 		c->obs_frontend_replay_buffer_save();
 }
 
+void obs_frontend_replay_buffer_save_window(double start_sec, double end_sec)
+{
+	if (callbacks_valid())
+		c->obs_frontend_replay_buffer_save_window(start_sec, end_sec);
+}
+
 void obs_frontend_replay_buffer_stop(void)
 {
 	if (callbacks_valid())
@@ -191,6 +191,7 @@ EXPORT bool obs_frontend_recording_add_chapter(const char *name);
 
 EXPORT void obs_frontend_replay_buffer_start(void);
 EXPORT void obs_frontend_replay_buffer_save(void);
+EXPORT void obs_frontend_replay_buffer_save_window(double start_sec, double end_sec);
 EXPORT void obs_frontend_replay_buffer_stop(void);
 EXPORT bool obs_frontend_replay_buffer_active(void);
 
@@ -523,10 +523,14 @@ OBSBasicSettings::OBSBasicSettings(QWidget *parent)
 	HookWidget(ui->colorRange,           COMBO_CHANGED,  ADV_CHANGED);
 	HookWidget(ui->sdrWhiteLevel,        SCROLL_CHANGED, ADV_CHANGED);
 	HookWidget(ui->hdrNominalPeakLevel,  SCROLL_CHANGED, ADV_CHANGED);
+	HookWidget(ui->parallelSourceTicks,  CHECK_CHANGED,  ADV_CHANGED);
+	HookWidget(ui->sceneItemCulling,     CHECK_CHANGED,  ADV_CHANGED);
+	HookWidget(ui->parallelVideoInputs,  CHECK_CHANGED,  ADV_CHANGED);
 	HookWidget(ui->disableOSXVSync,      CHECK_CHANGED,  ADV_CHANGED);
 	HookWidget(ui->resetOSXVSync,        CHECK_CHANGED,  ADV_CHANGED);
 	if (obs_audio_monitoring_available())
 		HookWidget(ui->monitoringDevice,     COMBO_CHANGED,  ADV_CHANGED);
+	HookWidget(ui->threadedAudioEncoders, CHECK_CHANGED,  ADV_CHANGED);
 #ifdef _WIN32
 	HookWidget(ui->disableAudioDucking,  CHECK_CHANGED,  ADV_CHANGED);
 #endif
@@ -551,6 +555,7 @@ OBSBasicSettings::OBSBasicSettings(QWidget *parent)
 	HookWidget(ui->enableLowLatencyMode, CHECK_CHANGED,  ADV_CHANGED);
 	HookWidget(ui->hotkeyFocusType,      COMBO_CHANGED,  ADV_CHANGED);
 	HookWidget(ui->autoRemux,            CHECK_CHANGED,  ADV_CHANGED);
+	HookWidget(ui->muxSharedMemory,      CHECK_CHANGED,  ADV_CHANGED);
 	HookWidget(ui->dynBitrate,           CHECK_CHANGED,  ADV_CHANGED);
 	/* clang-format on */
 
@@ -2503,6 +2508,9 @@ void OBSBasicSettings::LoadAdvancedSettings()
 	const char *videoColorRange = config_get_string(main->Config(), "Video", "ColorRange");
 	uint32_t sdrWhiteLevel = (uint32_t)config_get_uint(main->Config(), "Video", "SdrWhiteLevel");
 	uint32_t hdrNominalPeakLevel = (uint32_t)config_get_uint(main->Config(), "Video", "HdrNominalPeakLevel");
+	bool parallelSourceTicks = config_get_bool(main->Config(), "Video", "ParallelSourceTicks");
+	bool sceneItemCulling = config_get_bool(main->Config(), "Video", "SceneItemCulling");
+	bool parallelVideoInputs = config_get_bool(main->Config(), "Video", "ParallelVideoInputs");
 
 	QString monDevName;
 	QString monDevId;
@@ -2510,6 +2518,7 @@ void OBSBasicSettings::LoadAdvancedSettings()
 		monDevName = config_get_string(main->Config(), "Audio", "MonitoringDeviceName");
 		monDevId = config_get_string(main->Config(), "Audio", "MonitoringDeviceId");
 	}
+	bool threadedAudioEncoders = config_get_bool(main->Config(), "Audio", "ThreadedAudioEncoders");
 	bool enableDelay = config_get_bool(main->Config(), "Output", "DelayEnable");
 	int delaySec = config_get_int(main->Config(), "Output", "DelaySec");
 	bool preserveDelay = config_get_bool(main->Config(), "Output", "DelayPreserve");
@@ -2525,6 +2534,7 @@ void OBSBasicSettings::LoadAdvancedSettings()
 	int rbTime = config_get_int(main->Config(), "AdvOut", "RecRBTime");
 	int rbSize = config_get_int(main->Config(), "AdvOut", "RecRBSize");
 	bool autoRemux = config_get_bool(main->Config(), "Video", "AutoRemux");
+	bool muxSharedMemory = config_get_bool(main->Config(), "Output", "MuxSharedMemory");
 	const char *hotkeyFocusType = config_get_string(App()->GetUserConfig(), "General", "HotkeyFocusType");
 	bool dynBitrate = config_get_bool(main->Config(), "Output", "DynamicBitrate");
 	const char *ipFamily = config_get_string(main->Config(), "Output", "IPFamily");
@@ -2556,6 +2566,7 @@ void OBSBasicSettings::LoadAdvancedSettings()
 	ui->streamDelayPreserve->setChecked(preserveDelay);
 	ui->streamDelayEnable->setChecked(enableDelay);
 	ui->autoRemux->setChecked(autoRemux);
+	ui->muxSharedMemory->setChecked(muxSharedMemory);
 	ui->dynBitrate->setChecked(dynBitrate);
 
 	SetComboByValue(ui->colorFormat, videoColorFormat);
@@ -2563,6 +2574,10 @@ void OBSBasicSettings::LoadAdvancedSettings()
 	SetComboByValue(ui->colorRange, videoColorRange);
 	ui->sdrWhiteLevel->setValue(sdrWhiteLevel);
 	ui->hdrNominalPeakLevel->setValue(hdrNominalPeakLevel);
+	ui->parallelSourceTicks->setChecked(parallelSourceTicks);
+	ui->sceneItemCulling->setChecked(sceneItemCulling);
+	ui->parallelVideoInputs->setChecked(parallelVideoInputs);
+	ui->threadedAudioEncoders->setChecked(threadedAudioEncoders);
 
 	SetComboByValue(ui->ipFamily, ipFamily);
 	if (!SetComboByValue(ui->bindToIP, bindIP))
@@ -3167,10 +3182,14 @@ void OBSBasicSettings::SaveAdvancedSettings()
 	SaveComboData(ui->colorRange, "Video", "ColorRange");
 	SaveSpinBox(ui->sdrWhiteLevel, "Video", "SdrWhiteLevel");
 	SaveSpinBox(ui->hdrNominalPeakLevel, "Video", "HdrNominalPeakLevel");
+	SaveCheckBox(ui->parallelSourceTicks, "Video", "ParallelSourceTicks");
+	SaveCheckBox(ui->sceneItemCulling, "Video", "SceneItemCulling");
+	SaveCheckBox(ui->parallelVideoInputs, "Video", "ParallelVideoInputs");
 	if (obs_audio_monitoring_available()) {
 		SaveCombo(ui->monitoringDevice, "Audio", "MonitoringDeviceName");
 		SaveComboData(ui->monitoringDevice, "Audio", "MonitoringDeviceId");
 	}
+	SaveCheckBox(ui->threadedAudioEncoders, "Audio", "ThreadedAudioEncoders");
 
 #ifdef _WIN32
 	if (WidgetChanged(ui->disableAudioDucking)) {
@@ -3196,6 +3215,7 @@ void OBSBasicSettings::SaveAdvancedSettings()
 	SaveComboData(ui->bindToIP, "Output", "BindIP");
 	SaveComboData(ui->ipFamily, "Output", "IPFamily");
 	SaveCheckBox(ui->autoRemux, "Video", "AutoRemux");
+	SaveCheckBox(ui->muxSharedMemory, "Output", "MuxSharedMemory");
 	SaveCheckBox(ui->dynBitrate, "Output", "DynamicBitrate");
 
 	if (obs_audio_monitoring_available()) {
@@ -3209,6 +3229,9 @@ void OBSBasicSettings::SaveAdvancedSettings()
 			     QT_TO_UTF8(ui->monitoringDevice->currentText()), QT_TO_UTF8(newDevice));
 		}
 	}
+
+	/* only applies to audio encoders started after this */
+	obs_set_threaded_audio_encoders(ui->threadedAudioEncoders->isChecked());
 }
 
 static inline const char *OutputModeFromIdx(int idx)
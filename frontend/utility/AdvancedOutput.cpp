@@ -394,6 +394,7 @@ inline void AdvancedOutput::SetupRecording()
 	}
 
 	obs_data_set_string(settings, "path", path);
+	SetupMuxSharedMemory(settings);
 	obs_output_update(fileOutput, settings);
 	if (replayBuffer)
 		obs_output_update(replayBuffer, settings);
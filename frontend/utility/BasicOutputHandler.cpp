@@ -13,6 +13,9 @@
 
 using namespace std;
 
+/* size of the ffmpeg-mux packet ring when Output/MuxSharedMemory is set */
+#define MUX_SHARED_MEMORY_MB 64
+
 extern bool EncoderAvailable(const char *encoder);
 
 volatile bool streaming_active = false;
@@ -419,6 +422,14 @@ void BasicOutputHandler::SetupAutoRemux(const char *&container)
 		container = "mkv";
 }
 
+/* the ffmpeg_muxer outputs send packets to ffmpeg-mux through a pipe unless
+ * shared_memory_mb is set, which is opt-in while the ring is new */
+void BasicOutputHandler::SetupMuxSharedMemory(obs_data_t *settings)
+{
+	bool sharedMemory = config_get_bool(main->Config(), "Output", "MuxSharedMemory");
+	obs_data_set_int(settings, "shared_memory_mb", sharedMemory ? MUX_SHARED_MEMORY_MB : 0);
+}
+
 std::string BasicOutputHandler::GetRecordingFilename(const char *path, const char *container, bool noSpace,
 						     bool overwrite, const char *format, bool ffmpeg)
 {
@@ -97,6 +97,7 @@ struct BasicOutputHandler {
 
 protected:
 	void SetupAutoRemux(const char *&container);
+	void SetupMuxSharedMemory(obs_data_t *settings);
 	std::string GetRecordingFilename(const char *path, const char *container, bool noSpace, bool overwrite,
 					 const char *format, bool ffmpeg);
 
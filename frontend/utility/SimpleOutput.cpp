@@ -835,6 +835,8 @@ bool SimpleOutput::ConfigureRecording(bool updateReplayBuffer)
 		obs_data_set_string(settings, "muxer_settings", mux);
 	}
 
+	SetupMuxSharedMemory(settings);
+
 	if (updateReplayBuffer)
 		obs_output_update(replayBuffer, settings);
 	else
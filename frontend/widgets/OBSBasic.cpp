@@ -820,11 +820,15 @@ bool OBSBasic::InitBasicConfigDefaults()
 	config_set_default_string(activeConfiguration, "Video", "ColorRange", "Partial");
 	config_set_default_uint(activeConfiguration, "Video", "SdrWhiteLevel", 300);
 	config_set_default_uint(activeConfiguration, "Video", "HdrNominalPeakLevel", 1000);
+	config_set_default_bool(activeConfiguration, "Video", "ParallelSourceTicks", false);
+	config_set_default_bool(activeConfiguration, "Video", "SceneItemCulling", false);
+	config_set_default_bool(activeConfiguration, "Video", "ParallelVideoInputs", false);
 
 	config_set_default_string(activeConfiguration, "Audio", "MonitoringDeviceId", "default");
 	config_set_default_string(activeConfiguration, "Audio", "MonitoringDeviceName",
 				  Str("Basic.Settings.Advanced.Audio.MonitoringDevice"
 				      ".Default"));
+	config_set_default_bool(activeConfiguration, "Audio", "ThreadedAudioEncoders", false);
 	config_set_default_uint(activeConfiguration, "Audio", "SampleRate", 48000);
 	config_set_default_string(activeConfiguration, "Audio", "ChannelSetup", "Stereo");
 	config_set_default_double(activeConfiguration, "Audio", "MeterDecayRate", VOLUME_METER_DECAY_FAST);
@@ -985,6 +989,8 @@ void OBSBasic::OBSInit()
 		blog(LOG_INFO, "Audio monitoring device:\n\tname: %s\n\tid: %s", device_name, device_id);
 	}
 
+	obs_set_threaded_audio_encoders(config_get_bool(activeConfiguration, "Audio", "ThreadedAudioEncoders"));
+
 	InitOBSCallbacks();
 	InitHotkeys();
 	ui->preview->Init();
@@ -1588,6 +1594,10 @@ int OBSBasic::ResetVideo()
 		const float hdr_nominal_peak_level =
 			(float)config_get_uint(activeConfiguration, "Video", "HdrNominalPeakLevel");
 		obs_set_video_levels(sdr_white_level, hdr_nominal_peak_level);
+		obs_set_parallel_source_ticks(config_get_bool(activeConfiguration, "Video", "ParallelSourceTicks"));
+		obs_set_scene_item_culling(config_get_bool(activeConfiguration, "Video", "SceneItemCulling"));
+		video_output_set_parallel_inputs(obs_get_video(),
+						 config_get_bool(activeConfiguration, "Video", "ParallelVideoInputs"));
 		OBSBasicStats::InitializeValues();
 		OBSProjector::UpdateMultiviewProjectors();
 
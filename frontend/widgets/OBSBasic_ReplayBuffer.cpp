@@ -153,6 +153,21 @@ void OBSBasic::ReplayBufferSave()
 	calldata_free(&cd);
 }
 
+void OBSBasic::ReplayBufferSaveWindow(double startSec, double endSec)
+{
+	if (!outputHandler || !outputHandler->replayBuffer)
+		return;
+	if (!outputHandler->ReplayBufferActive())
+		return;
+
+	calldata_t cd = {0};
+	calldata_set_float(&cd, "start_sec", startSec);
+	calldata_set_float(&cd, "end_sec", endSec);
+	proc_handler_t *ph = obs_output_get_proc_handler(outputHandler->replayBuffer);
+	proc_handler_call(ph, "save_window", &cd);
+	calldata_free(&cd);
+}
+
 void OBSBasic::ReplayBufferSaved()
 {
 	if (!outputHandler || !outputHandler->replayBuffer)
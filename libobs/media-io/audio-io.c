@@ -26,6 +26,7 @@
 #include "../util/util_uint64.h"
 
 #include "audio-io.h"
+#include "audio-kernels.h"
 #include "audio-resampler.h"
 
 #ifdef _WIN32
@@ -142,17 +143,10 @@ static inline void clamp_audio_output(struct audio_output *audio, size_t bytes)
 
 		for (size_t plane = 0; plane < audio->planes; plane++) {
 			float *mix_data = mix->buffer[plane];
-			float *mix_end = &mix_data[float_size];
 			/* Unclamped mix is copied directly. */
 			memcpy(mix->buffer_unclamped[plane], mix_data, bytes);
 
-			while (mix_data < mix_end) {
-				float val = *mix_data;
-				val = (val == val) ? val : 0.0f;
-				val = (val > 1.0f) ? 1.0f : val;
-				val = (val < -1.0f) ? -1.0f : val;
-				*(mix_data++) = val;
-			}
+			audio_kernels->clamp(mix_data, float_size);
 		}
 	}
 }
@@ -358,6 +352,8 @@ int audio_output_open(audio_t **audio, struct audio_output_info *info)
 	if (!valid_audio_params(info))
 		return AUDIO_OUTPUT_INVALIDPARAM;
 
+	audio_kernels_init();
+
 	out = bzalloc(sizeof(struct audio_output));
 	if (!out)
 		goto fail0;
@@ -0,0 +1,186 @@
+#include "audio-kernels.h"
+#include "../util/base.h"
+#include "../util/sse-intrin.h"
+
+/* ------------------------------------------------------------------------- */
+/* scalar                                                                    */
+
+static void mix_scalar(float *dst, const float *src, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		dst[i] += src[i];
+}
+
+static void gain_scalar(float *dst, float gain, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		dst[i] *= gain;
+}
+
+static void gain_ramp_scalar(float *dst, const float *gain, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		dst[i] *= gain[i];
+}
+
+static void clamp_scalar(float *dst, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		float val = dst[i];
+		val = (val == val) ? val : 0.0f;
+		val = (val > 1.0f) ? 1.0f : val;
+		val = (val < -1.0f) ? -1.0f : val;
+		dst[i] = val;
+	}
+}
+
+const struct audio_kernels audio_kernels_scalar = {
+	.name = "scalar",
+	.mix = mix_scalar,
+	.gain = gain_scalar,
+	.gain_ramp = gain_ramp_scalar,
+	.clamp = clamp_scalar,
+};
+
+/* ------------------------------------------------------------------------- */
+/* SSE2 (NEON through SIMDe on ARM)                                          */
+
+static void mix_sse2(float *dst, const float *src, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_loadu_ps(src + i)));
+
+	mix_scalar(dst + i, src + i, count - i);
+}
+
+static void gain_sse2(float *dst, float gain, size_t count)
+{
+	const __m128 gain_val = _mm_set1_ps(gain);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(dst + i), gain_val));
+
+	gain_scalar(dst + i, gain, count - i);
+}
+
+static void gain_ramp_sse2(float *dst, const float *gain, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(dst + i), _mm_loadu_ps(gain + i)));
+
+	gain_ramp_scalar(dst + i, gain + i, count - i);
+}
+
+static void clamp_sse2(float *dst, size_t count)
+{
+	const __m128 min_val = _mm_set1_ps(-1.0f);
+	const __m128 max_val = _mm_set1_ps(1.0f);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 val = _mm_loadu_ps(dst + i);
+		val = _mm_and_ps(val, _mm_cmpeq_ps(val, val));
+		val = _mm_min_ps(_mm_max_ps(val, min_val), max_val);
+		_mm_storeu_ps(dst + i, val);
+	}
+
+	clamp_scalar(dst + i, count - i);
+}
+
+const struct audio_kernels audio_kernels_sse2 = {
+#if defined(__aarch64__) || defined(_M_ARM64) || defined(_M_ARM64EC)
+	.name = "NEON",
+#else
+	.name = "SSE2",
+#endif
+	.mix = mix_sse2,
+	.gain = gain_sse2,
+	.gain_ramp = gain_ramp_sse2,
+	.clamp = clamp_sse2,
+};
+
+/* ------------------------------------------------------------------------- */
+/* AVX2                                                                      */
+
+#ifdef AUDIO_KERNELS_AVX2
+AVX2_FUNC static void mix_avx2(float *dst, const float *src, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8)
+		_mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_loadu_ps(src + i)));
+
+	mix_scalar(dst + i, src + i, count - i);
+}
+
+AVX2_FUNC static void gain_avx2(float *dst, float gain, size_t count)
+{
+	const __m256 gain_val = _mm256_set1_ps(gain);
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8)
+		_mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(dst + i), gain_val));
+
+	gain_scalar(dst + i, gain, count - i);
+}
+
+AVX2_FUNC static void gain_ramp_avx2(float *dst, const float *gain, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8)
+		_mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(dst + i), _mm256_loadu_ps(gain + i)));
+
+	gain_ramp_scalar(dst + i, gain + i, count - i);
+}
+
+AVX2_FUNC static void clamp_avx2(float *dst, size_t count)
+{
+	const __m256 min_val = _mm256_set1_ps(-1.0f);
+	const __m256 max_val = _mm256_set1_ps(1.0f);
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 val = _mm256_loadu_ps(dst + i);
+		val = _mm256_and_ps(val, _mm256_cmp_ps(val, val, _CMP_EQ_OQ));
+		val = _mm256_min_ps(_mm256_max_ps(val, min_val), max_val);
+		_mm256_storeu_ps(dst + i, val);
+	}
+
+	clamp_scalar(dst + i, count - i);
+}
+
+const struct audio_kernels audio_kernels_avx2 = {
+	.name = "AVX2",
+	.mix = mix_avx2,
+	.gain = gain_avx2,
+	.gain_ramp = gain_ramp_avx2,
+	.clamp = clamp_avx2,
+};
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+const struct audio_kernels *audio_kernels = &audio_kernels_scalar;
+
+void audio_kernels_init(void)
+{
+	static bool initialized = false;
+	if (initialized)
+		return;
+
+	audio_kernels = &audio_kernels_sse2;
+
+#ifdef AUDIO_KERNELS_AVX2
+	if (cpu_has_avx2())
+		audio_kernels = &audio_kernels_avx2;
+#endif
+
+	blog(LOG_INFO, "Audio mixing kernels: %s", audio_kernels->name);
+	initialized = true;
+}
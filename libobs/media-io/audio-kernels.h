@@ -0,0 +1,46 @@
+#pragma once
+
+#include "../util/c99defs.h"
+#include "simd-dispatch.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Vectorized float kernels used by the audio pipeline (source volume, mix
+ * accumulation and output clamping).  The best implementation available on
+ * the CPU is selected once by audio_kernels_init().
+ */
+
+struct audio_kernels {
+	const char *name;
+
+	/* dst[i] += src[i] */
+	void (*mix)(float *dst, const float *src, size_t count);
+
+	/* dst[i] *= gain */
+	void (*gain)(float *dst, float gain, size_t count);
+
+	/* dst[i] *= gain[i] */
+	void (*gain_ramp)(float *dst, const float *gain, size_t count);
+
+	/* dst[i] = clamp(dst[i], -1.0f, 1.0f), NaNs become 0.0f */
+	void (*clamp)(float *dst, size_t count);
+};
+
+extern const struct audio_kernels audio_kernels_scalar;
+extern const struct audio_kernels audio_kernels_sse2;
+#ifdef MEDIA_IO_AVX2
+#define AUDIO_KERNELS_AVX2
+extern const struct audio_kernels audio_kernels_avx2;
+#endif
+
+/* currently selected kernels, scalar until audio_kernels_init() is called */
+extern const struct audio_kernels *audio_kernels;
+
+extern void audio_kernels_init(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "../util/c99defs.h"
+#include "simd-dispatch.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Implementations of the vectorized packed 444 YUV functions of
+ * format-conversion.h.  The best set available on the CPU is selected on
+ * first use.
+ */
+
+struct format_conversion_kernels {
+	const char *name;
+
+	void (*compress_uyvx_to_i420)(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
+				      uint8_t *output[], const uint32_t out_linesize[]);
+	void (*compress_uyvx_to_nv12)(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
+				      uint8_t *output[], const uint32_t out_linesize[]);
+	void (*convert_uyvx_to_i444)(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
+				     uint8_t *output[], const uint32_t out_linesize[]);
+};
+
+extern const struct format_conversion_kernels format_conversion_kernels_sse2;
+#ifdef MEDIA_IO_AVX2
+#define FORMAT_CONVERSION_AVX2
+extern const struct format_conversion_kernels format_conversion_kernels_avx2;
+#endif
+
+extern const struct format_conversion_kernels *format_conversion_get_kernels(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -16,6 +16,7 @@
 ******************************************************************************/
 
 #include "format-conversion.h"
+#include "format-conversion-kernels.h"
 
 #include "../util/sse-intrin.h"
 
@@ -77,8 +78,11 @@ static FORCE_INLINE uint32_t min_uint32(uint32_t a, uint32_t b)
 	return a < b ? a : b;
 }
 
-void compress_uyvx_to_i420(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
-			   uint8_t *output[], const uint32_t out_linesize[])
+/* ------------------------------------------------------------------------- */
+/* SSE2 (NEON through SIMDe on ARM)                                          */
+
+static void compress_uyvx_to_i420_sse2(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
+				       uint8_t *output[], const uint32_t out_linesize[])
 {
 	uint8_t *lum_plane = output[0];
 	uint8_t *u_plane = output[1];
@@ -109,8 +113,8 @@ void compress_uyvx_to_i420(const uint8_t *input, uint32_t in_linesize, uint32_t
 	}
 }
 
-void compress_uyvx_to_nv12(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
-			   uint8_t *output[], const uint32_t out_linesize[])
+static void compress_uyvx_to_nv12_sse2(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
+				       uint8_t *output[], const uint32_t out_linesize[])
 {
 	uint8_t *lum_plane = output[0];
 	uint8_t *chroma_plane = output[1];
@@ -140,8 +144,8 @@ void compress_uyvx_to_nv12(const uint8_t *input, uint32_t in_linesize, uint32_t
 	}
 }
 
-void convert_uyvx_to_i444(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
-			  uint8_t *output[], const uint32_t out_linesize[])
+static void convert_uyvx_to_i444_sse2(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
+				      uint8_t *output[], const uint32_t out_linesize[])
 {
 	uint8_t *lum_plane = output[0];
 	uint8_t *u_plane = output[1];
@@ -173,6 +177,256 @@ void convert_uyvx_to_i444(const uint8_t *input, uint32_t in_linesize, uint32_t s
 	}
 }
 
+const struct format_conversion_kernels format_conversion_kernels_sse2 = {
+#if defined(__aarch64__) || defined(_M_ARM64) || defined(_M_ARM64EC)
+	.name = "NEON",
+#else
+	.name = "SSE2",
+#endif
+	.compress_uyvx_to_i420 = compress_uyvx_to_i420_sse2,
+	.compress_uyvx_to_nv12 = compress_uyvx_to_nv12_sse2,
+	.convert_uyvx_to_i444 = convert_uyvx_to_i444_sse2,
+};
+
+/* ------------------------------------------------------------------------- */
+/* AVX2, 8 pixels of two lines at a time                                     */
+
+#ifdef FORMAT_CONVERSION_AVX2
+/* gathers the low 32 bits of each 64-bit half of both lanes: after the
+ * in-lane packs the first line's values end up in elements 0 and 4 and the
+ * second line's in elements 1 and 5 */
+#define AVX2_ROWS_PERM _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7)
+
+AVX2_FUNC static inline void pack_rows_avx2(uint8_t *plane, uint32_t pos0, uint32_t pos1, __m256i val1, __m256i val2)
+{
+	__m256i packed = _mm256_packs_epi32(val1, val2);
+	packed = _mm256_packus_epi16(packed, packed);
+	packed = _mm256_permutevar8x32_epi32(packed, AVX2_ROWS_PERM);
+
+	__m128i rows = _mm256_castsi256_si128(packed);
+	_mm_storel_epi64((__m128i *)(plane + pos0), rows);
+	_mm_storel_epi64((__m128i *)(plane + pos1), _mm_srli_si128(rows, 8));
+}
+
+/* averages the chroma of each 2x2 block, returns the U/V byte pairs of the
+ * four blocks in the low 64 bits */
+AVX2_FUNC static inline __m128i average_uv_avx2(__m256i line1, __m256i line2)
+{
+	const __m256i uv_mask = _mm256_set1_epi16(0x00FF);
+
+	__m256i sum = _mm256_add_epi16(_mm256_and_si256(line1, uv_mask), _mm256_and_si256(line2, uv_mask));
+	sum = _mm256_add_epi16(sum, _mm256_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+	sum = _mm256_srai_epi16(sum, 2);
+	sum = _mm256_permutevar8x32_epi32(sum, _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7));
+
+	__m128i avg = _mm256_castsi256_si128(sum);
+	return _mm_packus_epi16(avg, avg);
+}
+
+AVX2_FUNC static void compress_uyvx_to_i420_avx2(const uint8_t *input, uint32_t in_linesize, uint32_t start_y,
+						 uint32_t end_y, uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint8_t *lum_plane = output[0];
+	uint8_t *u_plane = output[1];
+	uint8_t *v_plane = output[2];
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t y;
+
+	const __m256i lum_mask = _mm256_set1_epi32(0x0000FF00);
+	const __m128i uv_split = _mm_setr_epi8(0, 2, 4, 6, 1, 3, 5, 7, 8, 10, 12, 14, 9, 11, 13, 15);
+	__m128i lum_mask_sse = _mm_set1_epi32(0x0000FF00);
+	__m128i uv_mask_sse = _mm_set1_epi16(0x00FF);
+
+	for (y = start_y; y < end_y; y += 2) {
+		uint32_t y_pos = y * in_linesize;
+		uint32_t chroma_y_pos = (y >> 1) * out_linesize[1];
+		uint32_t lum_y_pos = y * out_linesize[0];
+		uint32_t x = 0;
+
+		for (; x + 8 <= width; x += 8) {
+			const uint8_t *img = input + y_pos + x * 4;
+			uint32_t lum_pos0 = lum_y_pos + x;
+			uint32_t lum_pos1 = lum_pos0 + out_linesize[0];
+
+			__m256i line1 = _mm256_loadu_si256((const __m256i *)img);
+			__m256i line2 = _mm256_loadu_si256((const __m256i *)(img + in_linesize));
+
+			pack_rows_avx2(lum_plane, lum_pos0, lum_pos1,
+				       _mm256_srli_epi32(_mm256_and_si256(line1, lum_mask), 8),
+				       _mm256_srli_epi32(_mm256_and_si256(line2, lum_mask), 8));
+
+			__m128i uv = _mm_shuffle_epi8(average_uv_avx2(line1, line2), uv_split);
+			uint32_t chroma_pos = chroma_y_pos + (x >> 1);
+			*(uint32_t *)(u_plane + chroma_pos) = (uint32_t)_mm_cvtsi128_si32(uv);
+			*(uint32_t *)(v_plane + chroma_pos) = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(uv, 4));
+		}
+
+		for (; x < width; x += 4) {
+			const uint8_t *img = input + y_pos + x * 4;
+			uint32_t lum_pos0 = lum_y_pos + x;
+			uint32_t lum_pos1 = lum_pos0 + out_linesize[0];
+
+			__m128i line1 = _mm_loadu_si128((const __m128i *)img);
+			__m128i line2 = _mm_loadu_si128((const __m128i *)(img + in_linesize));
+
+			pack_shift(lum_plane, lum_pos0, lum_pos1, line1, line2, lum_mask_sse, 1);
+			pack_ch_2plane(u_plane, v_plane, chroma_y_pos + (x >> 1), line1, line2, uv_mask_sse);
+		}
+	}
+}
+
+AVX2_FUNC static void compress_uyvx_to_nv12_avx2(const uint8_t *input, uint32_t in_linesize, uint32_t start_y,
+						 uint32_t end_y, uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint8_t *lum_plane = output[0];
+	uint8_t *chroma_plane = output[1];
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t y;
+
+	const __m256i lum_mask = _mm256_set1_epi32(0x0000FF00);
+	__m128i lum_mask_sse = _mm_set1_epi32(0x0000FF00);
+	__m128i uv_mask_sse = _mm_set1_epi16(0x00FF);
+
+	for (y = start_y; y < end_y; y += 2) {
+		uint32_t y_pos = y * in_linesize;
+		uint32_t chroma_y_pos = (y >> 1) * out_linesize[1];
+		uint32_t lum_y_pos = y * out_linesize[0];
+		uint32_t x = 0;
+
+		for (; x + 8 <= width; x += 8) {
+			const uint8_t *img = input + y_pos + x * 4;
+			uint32_t lum_pos0 = lum_y_pos + x;
+			uint32_t lum_pos1 = lum_pos0 + out_linesize[0];
+
+			__m256i line1 = _mm256_loadu_si256((const __m256i *)img);
+			__m256i line2 = _mm256_loadu_si256((const __m256i *)(img + in_linesize));
+
+			pack_rows_avx2(lum_plane, lum_pos0, lum_pos1,
+				       _mm256_srli_epi32(_mm256_and_si256(line1, lum_mask), 8),
+				       _mm256_srli_epi32(_mm256_and_si256(line2, lum_mask), 8));
+
+			_mm_storel_epi64((__m128i *)(chroma_plane + chroma_y_pos + x), average_uv_avx2(line1, line2));
+		}
+
+		for (; x < width; x += 4) {
+			const uint8_t *img = input + y_pos + x * 4;
+			uint32_t lum_pos0 = lum_y_pos + x;
+			uint32_t lum_pos1 = lum_pos0 + out_linesize[0];
+
+			__m128i line1 = _mm_loadu_si128((const __m128i *)img);
+			__m128i line2 = _mm_loadu_si128((const __m128i *)(img + in_linesize));
+
+			pack_shift(lum_plane, lum_pos0, lum_pos1, line1, line2, lum_mask_sse, 1);
+			pack_ch_1plane(chroma_plane, chroma_y_pos + x, line1, line2, uv_mask_sse);
+		}
+	}
+}
+
+AVX2_FUNC static void convert_uyvx_to_i444_avx2(const uint8_t *input, uint32_t in_linesize, uint32_t start_y,
+						uint32_t end_y, uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint8_t *lum_plane = output[0];
+	uint8_t *u_plane = output[1];
+	uint8_t *v_plane = output[2];
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t y;
+
+	const __m256i byte_mask = _mm256_set1_epi32(0x000000FF);
+	__m128i lum_mask_sse = _mm_set1_epi32(0x0000FF00);
+	__m128i u_mask_sse = _mm_set1_epi32(0x000000FF);
+	__m128i v_mask_sse = _mm_set1_epi32(0x00FF0000);
+
+	for (y = start_y; y < end_y; y += 2) {
+		uint32_t y_pos = y * in_linesize;
+		uint32_t lum_y_pos = y * out_linesize[0];
+		uint32_t x = 0;
+
+		for (; x + 8 <= width; x += 8) {
+			const uint8_t *img = input + y_pos + x * 4;
+			uint32_t lum_pos0 = lum_y_pos + x;
+			uint32_t lum_pos1 = lum_pos0 + out_linesize[0];
+
+			__m256i line1 = _mm256_loadu_si256((const __m256i *)img);
+			__m256i line2 = _mm256_loadu_si256((const __m256i *)(img + in_linesize));
+
+			pack_rows_avx2(lum_plane, lum_pos0, lum_pos1,
+				       _mm256_and_si256(_mm256_srli_epi32(line1, 8), byte_mask),
+				       _mm256_and_si256(_mm256_srli_epi32(line2, 8), byte_mask));
+			pack_rows_avx2(u_plane, lum_pos0, lum_pos1, _mm256_and_si256(line1, byte_mask),
+				       _mm256_and_si256(line2, byte_mask));
+			pack_rows_avx2(v_plane, lum_pos0, lum_pos1,
+				       _mm256_and_si256(_mm256_srli_epi32(line1, 16), byte_mask),
+				       _mm256_and_si256(_mm256_srli_epi32(line2, 16), byte_mask));
+		}
+
+		for (; x < width; x += 4) {
+			const uint8_t *img = input + y_pos + x * 4;
+			uint32_t lum_pos0 = lum_y_pos + x;
+			uint32_t lum_pos1 = lum_pos0 + out_linesize[0];
+
+			__m128i line1 = _mm_loadu_si128((const __m128i *)img);
+			__m128i line2 = _mm_loadu_si128((const __m128i *)(img + in_linesize));
+
+			pack_shift(lum_plane, lum_pos0, lum_pos1, line1, line2, lum_mask_sse, 1);
+			pack_val(u_plane, lum_pos0, lum_pos1, line1, line2, u_mask_sse);
+			pack_shift(v_plane, lum_pos0, lum_pos1, line1, line2, v_mask_sse, 2);
+		}
+	}
+}
+
+const struct format_conversion_kernels format_conversion_kernels_avx2 = {
+	.name = "AVX2",
+	.compress_uyvx_to_i420 = compress_uyvx_to_i420_avx2,
+	.compress_uyvx_to_nv12 = compress_uyvx_to_nv12_avx2,
+	.convert_uyvx_to_i444 = convert_uyvx_to_i444_avx2,
+};
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+static const struct format_conversion_kernels *kernels = NULL;
+
+const struct format_conversion_kernels *format_conversion_get_kernels(void)
+{
+	const struct format_conversion_kernels *cur = kernels;
+	if (cur)
+		return cur;
+
+	cur = &format_conversion_kernels_sse2;
+#ifdef FORMAT_CONVERSION_AVX2
+	if (cpu_has_avx2())
+		cur = &format_conversion_kernels_avx2;
+#endif
+
+	/* selecting twice from different threads is harmless */
+	kernels = cur;
+	return cur;
+}
+
+void compress_uyvx_to_i420(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
+			   uint8_t *output[], const uint32_t out_linesize[])
+{
+	format_conversion_get_kernels()->compress_uyvx_to_i420(input, in_linesize, start_y, end_y, output,
+								out_linesize);
+}
+
+void compress_uyvx_to_nv12(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
+			   uint8_t *output[], const uint32_t out_linesize[])
+{
+	format_conversion_get_kernels()->compress_uyvx_to_nv12(input, in_linesize, start_y, end_y, output,
+								out_linesize);
+}
+
+void convert_uyvx_to_i444(const uint8_t *input, uint32_t in_linesize, uint32_t start_y, uint32_t end_y,
+			  uint8_t *output[], const uint32_t out_linesize[])
+{
+	format_conversion_get_kernels()->convert_uyvx_to_i444(input, in_linesize, start_y, end_y, output,
+							       out_linesize);
+}
+
+/* ------------------------------------------------------------------------- */
+/* scalar                                                                    */
+
 void decompress_420(const uint8_t *const input[], const uint32_t in_linesize[], uint32_t start_y, uint32_t end_y,
 		    uint8_t *output, uint32_t out_linesize)
 {
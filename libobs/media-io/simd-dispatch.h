@@ -0,0 +1,45 @@
+#pragma once
+
+#include "../util/c99defs.h"
+
+/*
+ * Helpers for media-io kernels that have AVX2 versions picked at runtime.
+ * MEDIA_IO_AVX2 is defined on x86 builds, where functions marked with
+ * AVX2_FUNC may use AVX2 intrinsics once cpu_has_avx2() returned true.
+ */
+
+#if defined(__x86_64__) || defined(__i386__) || ((defined(_M_X64) || defined(_M_IX86)) && !defined(_M_ARM64EC))
+#define MEDIA_IO_AVX2
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define AVX2_FUNC
+#else
+#define AVX2_FUNC __attribute__((target("avx2")))
+#endif
+#include <immintrin.h>
+
+static inline bool cpu_has_avx2(void)
+{
+#ifdef _MSC_VER
+	int regs[4];
+
+	__cpuid(regs, 0);
+	if (regs[0] < 7)
+		return false;
+
+	/* AVX and OSXSAVE, then make sure the OS saves the YMM registers */
+	__cpuid(regs, 1);
+	if ((regs[2] & (1 << 27)) == 0 || (regs[2] & (1 << 28)) == 0)
+		return false;
+	if ((_xgetbv(0) & 6) != 6)
+		return false;
+
+	__cpuidex(regs, 7, 0);
+	return (regs[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
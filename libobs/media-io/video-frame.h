@@ -56,6 +56,10 @@ static inline void video_frame_destroy(struct video_frame *frame)
 	}
 }
 
+EXPORT void video_frame_get_linesizes(uint32_t linesize[MAX_AV_PLANES], enum video_format format, uint32_t width);
+EXPORT void video_frame_get_plane_heights(uint32_t heights[MAX_AV_PLANES], enum video_format format,
+					  uint32_t height);
+
 EXPORT void video_frame_copy(struct video_frame *dst, const struct video_frame *src, enum video_format format,
 			     uint32_t height);
 
@@ -16,6 +16,7 @@
 ******************************************************************************/
 
 #include <assert.h>
+#include <errno.h>
 #include <inttypes.h>
 #include "../util/bmem.h"
 #include "../util/platform.h"
@@ -38,6 +39,31 @@ struct cached_frame_info {
 	struct video_data frame;
 	int skipped;
 	int count;
+
+	/* number of input workers still using this frame, and whether the
+	 * video thread itself is done with it.  a cache slot is only handed
+	 * back to the producer once both are true, in ring order */
+	long refs;
+	bool done;
+};
+
+struct video_input;
+
+struct video_input_worker {
+	pthread_t thread;
+	os_sem_t *sem;
+	os_event_t *idle;
+	bool stop;
+
+	struct video_output *video;
+	struct video_input *input;
+	struct cached_frame_info *frame_info;
+	struct video_data frame;
+
+	const char *profile_name;
+
+	volatile long lagged_frames;
+	volatile long total_frames;
 };
 
 struct video_input {
@@ -58,10 +84,17 @@ struct video_input {
 
 	void (*callback)(void *param, struct video_data *frame);
 	void *param;
+
+	struct video_input_worker *worker;
 };
 
+static void video_input_worker_destroy(struct video_input_worker *worker);
+
 static inline void video_input_free(struct video_input *input)
 {
+	video_input_worker_destroy(input->worker);
+	input->worker = NULL;
+
 	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
 		video_frame_free(&input->frame[i]);
 	video_scaler_destroy(input->scaler);
@@ -85,8 +118,13 @@ struct video_output {
 	size_t available_frames;
 	size_t first_added;
 	size_t last_added;
+	size_t first_held;
+	int pending_count;
+	int pending_skipped;
 	struct cached_frame_info cache[MAX_CACHE_SIZE];
 
+	bool parallel_inputs;
+
 	struct video_output *parent;
 
 	volatile bool raw_active;
@@ -123,6 +161,145 @@ static inline bool scale_video_output(struct video_input *input, struct video_da
 	return success;
 }
 
+/* hands finished cache slots back to the producer.  slots are released
+ * strictly in ring order so that a slow input still holding an older frame
+ * keeps every newer slot reserved as well */
+static void release_held_frames(struct video_output *video)
+{
+	while (video->available_frames < video->info.cache_size) {
+		struct cached_frame_info *cfi = &video->cache[video->first_held];
+		if (!cfi->done || cfi->refs)
+			break;
+
+		if (++video->first_held == video->info.cache_size)
+			video->first_held = 0;
+
+		if (++video->available_frames == video->info.cache_size)
+			video->last_added = video->first_added;
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void *video_input_worker_thread(void *param)
+{
+	struct video_input_worker *worker = param;
+	struct video_output *video = worker->video;
+
+	os_set_thread_name("video-io: input thread");
+
+	while (os_sem_wait(worker->sem) == 0) {
+		if (worker->stop)
+			break;
+
+		profile_start(worker->profile_name);
+
+		struct video_input *input = worker->input;
+		if (scale_video_output(input, &worker->frame))
+			input->callback(input->param, &worker->frame);
+
+		os_atomic_inc_long(&worker->total_frames);
+
+		pthread_mutex_lock(&video->data_mutex);
+		worker->frame_info->refs--;
+		worker->frame_info = NULL;
+		release_held_frames(video);
+		pthread_mutex_unlock(&video->data_mutex);
+
+		os_event_signal(worker->idle);
+
+		profile_end(worker->profile_name);
+		profile_reenable_thread();
+	}
+
+	return NULL;
+}
+
+static struct video_input_worker *video_input_worker_create(struct video_output *video)
+{
+	struct video_input_worker *worker = bzalloc(sizeof(*worker));
+	worker->video = video;
+	worker->profile_name = profile_store_name(obs_get_profiler_name_store(), "video_input_thread(%s)",
+						  video->info.name);
+
+	if (os_sem_init(&worker->sem, 0) != 0)
+		goto fail0;
+	if (os_event_init(&worker->idle, OS_EVENT_TYPE_MANUAL) != 0)
+		goto fail1;
+	if (pthread_create(&worker->thread, NULL, video_input_worker_thread, worker) != 0)
+		goto fail2;
+
+	os_event_signal(worker->idle);
+	return worker;
+
+fail2:
+	os_event_destroy(worker->idle);
+fail1:
+	os_sem_destroy(worker->sem);
+fail0:
+	blog(LOG_WARNING, "video-io: Failed to create input thread, "
+			  "falling back to the video thread");
+	bfree(worker);
+	return NULL;
+}
+
+static void video_input_worker_destroy(struct video_input_worker *worker)
+{
+	if (!worker)
+		return;
+
+	os_event_wait(worker->idle);
+	worker->stop = true;
+	os_sem_post(worker->sem);
+	pthread_join(worker->thread, NULL);
+
+	long lagged = os_atomic_load_long(&worker->lagged_frames);
+	if (lagged)
+		blog(LOG_INFO, "video-io: input thread held up the video thread on %ld/%ld frames", lagged,
+		     os_atomic_load_long(&worker->total_frames));
+
+	os_event_destroy(worker->idle);
+	os_sem_destroy(worker->sem);
+	bfree(worker);
+}
+
+/* an input never skips a frame on its own (encoders derive their pts from
+ * the number of frames received), so if the worker is still busy with the
+ * previous frame the video thread waits for it and counts it as lagged */
+static void video_input_worker_dispatch(struct video_input_worker *worker, struct video_input *input,
+					struct cached_frame_info *frame_info, const struct video_data *frame)
+{
+	if (os_event_try(worker->idle) == EAGAIN) {
+		os_atomic_inc_long(&worker->lagged_frames);
+		os_event_wait(worker->idle);
+	}
+
+	os_event_reset(worker->idle);
+
+	pthread_mutex_lock(&worker->video->data_mutex);
+	frame_info->refs++;
+	pthread_mutex_unlock(&worker->video->data_mutex);
+
+	worker->input = input;
+	worker->frame_info = frame_info;
+	worker->frame = *frame;
+
+	os_sem_post(worker->sem);
+}
+
+/* workers reference their input directly, so they have to be idle before the
+ * inputs array is reallocated or shifted */
+static void wait_for_input_workers(struct video_output *video)
+{
+	for (size_t i = 0; i < video->inputs.num; i++) {
+		struct video_input_worker *worker = video->inputs.array[i].worker;
+		if (worker)
+			os_event_wait(worker->idle);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
 static inline bool video_output_cur_frame(struct video_output *video)
 {
 	struct cached_frame_info *frame_info;
@@ -155,7 +332,9 @@ static inline bool video_output_cur_frame(struct video_output *video)
 		if (skip)
 			continue;
 
-		if (scale_video_output(input, &frame))
+		if (input->worker)
+			video_input_worker_dispatch(input->worker, input, frame_info, &frame);
+		else if (scale_video_output(input, &frame))
 			input->callback(input->param, &frame);
 	}
 
@@ -173,8 +352,8 @@ static inline bool video_output_cur_frame(struct video_output *video)
 		if (++video->first_added == video->info.cache_size)
 			video->first_added = 0;
 
-		if (++video->available_frames == video->info.cache_size)
-			video->last_added = video->first_added;
+		frame_info->done = true;
+		release_held_frames(video);
 	} else if (skipped) {
 		--frame_info->skipped;
 		os_atomic_inc_long(&video->skipped_frames);
@@ -439,6 +618,10 @@ bool video_output_connect2(video_t *video, const struct video_scale_info *conver
 				}
 				os_atomic_set_bool(&video->raw_active, true);
 			}
+			if (video->parallel_inputs)
+				input.worker = video_input_worker_create(video);
+
+			wait_for_input_workers(video);
 			da_push_back(video->inputs, &input);
 		}
 	}
@@ -478,6 +661,7 @@ bool video_output_disconnect2(video_t *video, void (*callback)(void *param, stru
 
 	size_t idx = video_get_input_idx(video, callback, param);
 	if (idx != DARRAY_INVALID) {
+		wait_for_input_workers(video);
 		video_input_free(video->inputs.array + idx);
 		da_erase(video->inputs, idx);
 
@@ -519,8 +703,18 @@ bool video_output_lock_frame(video_t *video, struct video_frame *frame, int coun
 	pthread_mutex_lock(&video->data_mutex);
 
 	if (video->available_frames == 0) {
-		video->cache[video->last_added].count += count;
-		video->cache[video->last_added].skipped += count;
+		cfi = &video->cache[video->last_added];
+
+		/* if every slot is only held by input threads, there is no
+		 * queued frame left to repeat, so carry the count over to
+		 * the next frame instead */
+		if (cfi->done) {
+			video->pending_count += count;
+			video->pending_skipped += count;
+		} else {
+			cfi->count += count;
+			cfi->skipped += count;
+		}
 		locked = false;
 
 	} else {
@@ -529,10 +723,17 @@ bool video_output_lock_frame(video_t *video, struct video_frame *frame, int coun
 				video->last_added = 0;
 		}
 
+		/* frames carried over are output first, so they keep their
+		 * own timestamps */
 		cfi = &video->cache[video->last_added];
-		cfi->frame.timestamp = timestamp;
-		cfi->count = count;
-		cfi->skipped = 0;
+		cfi->frame.timestamp = timestamp - (uint64_t)video->pending_count * video->frame_time;
+		cfi->count = count + video->pending_count;
+		cfi->skipped = video->pending_skipped;
+		cfi->refs = 0;
+		cfi->done = false;
+
+		video->pending_count = 0;
+		video->pending_skipped = 0;
 
 		memcpy(frame, &cfi->frame, sizeof(*frame));
 
@@ -623,6 +824,66 @@ uint32_t video_output_get_total_frames(const video_t *video)
 	return (uint32_t)os_atomic_load_long(&get_const_root(video)->total_frames);
 }
 
+void video_output_set_parallel_inputs(video_t *video, bool enable)
+{
+	if (!video)
+		return;
+
+	video = get_root(video);
+
+	pthread_mutex_lock(&video->input_mutex);
+
+	if (video->parallel_inputs != enable) {
+		video->parallel_inputs = enable;
+
+		for (size_t i = 0; i < video->inputs.num; i++) {
+			struct video_input *input = video->inputs.array + i;
+
+			if (enable && !input->worker) {
+				input->worker = video_input_worker_create(video);
+			} else if (!enable && input->worker) {
+				video_input_worker_destroy(input->worker);
+				input->worker = NULL;
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&video->input_mutex);
+}
+
+bool video_output_parallel_inputs(const video_t *video)
+{
+	return video ? get_const_root(video)->parallel_inputs : false;
+}
+
+bool video_output_get_input_stats(video_t *video, void (*callback)(void *param, struct video_data *frame),
+				  void *param, uint32_t *total_frames, uint32_t *lagged_frames)
+{
+	bool found = false;
+
+	if (!video || !callback)
+		return false;
+
+	video = get_root(video);
+
+	pthread_mutex_lock(&video->input_mutex);
+
+	size_t idx = video_get_input_idx(video, callback, param);
+	if (idx != DARRAY_INVALID) {
+		struct video_input_worker *worker = video->inputs.array[idx].worker;
+
+		if (total_frames)
+			*total_frames = worker ? (uint32_t)os_atomic_load_long(&worker->total_frames) : 0;
+		if (lagged_frames)
+			*lagged_frames = worker ? (uint32_t)os_atomic_load_long(&worker->lagged_frames) : 0;
+		found = true;
+	}
+
+	pthread_mutex_unlock(&video->input_mutex);
+
+	return found;
+}
+
 /* Note: These four functions below are a very slight bit of a hack.  If the
  * texture encoder thread is active while the raw encoder thread is active, the
  * total frame count will just be doubled while they're both active.  Which is
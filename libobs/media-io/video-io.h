@@ -174,6 +174,42 @@ static inline bool format_is_yuv(enum video_format format)
 	return false;
 }
 
+static inline bool format_has_alpha(enum video_format format)
+{
+	switch (format) {
+	case VIDEO_FORMAT_RGBA:
+	case VIDEO_FORMAT_BGRA:
+	case VIDEO_FORMAT_I40A:
+	case VIDEO_FORMAT_I42A:
+	case VIDEO_FORMAT_YUVA:
+	case VIDEO_FORMAT_YA2L:
+	case VIDEO_FORMAT_AYUV:
+		return true;
+	case VIDEO_FORMAT_NONE:
+	case VIDEO_FORMAT_I420:
+	case VIDEO_FORMAT_NV12:
+	case VIDEO_FORMAT_I422:
+	case VIDEO_FORMAT_I210:
+	case VIDEO_FORMAT_YVYU:
+	case VIDEO_FORMAT_YUY2:
+	case VIDEO_FORMAT_UYVY:
+	case VIDEO_FORMAT_I444:
+	case VIDEO_FORMAT_I412:
+	case VIDEO_FORMAT_I010:
+	case VIDEO_FORMAT_P010:
+	case VIDEO_FORMAT_P216:
+	case VIDEO_FORMAT_P416:
+	case VIDEO_FORMAT_V210:
+	case VIDEO_FORMAT_BGRX:
+	case VIDEO_FORMAT_Y800:
+	case VIDEO_FORMAT_BGR3:
+	case VIDEO_FORMAT_R10L:
+		return false;
+	}
+
+	return false;
+}
+
 static inline const char *get_video_format_name(enum video_format format)
 {
 	switch (format) {
@@ -325,6 +361,22 @@ EXPORT double video_output_get_frame_rate(const video_t *video);
 EXPORT uint32_t video_output_get_skipped_frames(const video_t *video);
 EXPORT uint32_t video_output_get_total_frames(const video_t *video);
 
+/**
+ * Runs scaling and the callback of each connected input on its own thread,
+ * so that multiple raw outputs at different resolutions are processed
+ * concurrently instead of one after another on the video thread.
+ */
+EXPORT void video_output_set_parallel_inputs(video_t *video, bool enable);
+EXPORT bool video_output_parallel_inputs(const video_t *video);
+
+/**
+ * Gets the frame counters of an input while parallel inputs are enabled.
+ * lagged_frames is the number of frames the video thread had to wait for
+ * the input to finish its previous frame.
+ */
+EXPORT bool video_output_get_input_stats(video_t *video, void (*callback)(void *param, struct video_data *frame),
+					 void *param, uint32_t *total_frames, uint32_t *lagged_frames);
+
 extern void video_output_inc_texture_encoders(video_t *video);
 extern void video_output_dec_texture_encoders(video_t *video);
 extern void video_output_inc_texture_frames(video_t *video);
@@ -51,6 +51,7 @@ static bool init_encoder(struct obs_encoder *encoder, const char *name, obs_data
 	pthread_mutex_init_value(&encoder->outputs_mutex);
 	pthread_mutex_init_value(&encoder->pause.mutex);
 	pthread_mutex_init_value(&encoder->roi_mutex);
+	pthread_mutex_init_value(&encoder->audio_stats_mutex);
 
 	if (!obs_context_data_init(&encoder->context, OBS_OBJ_TYPE_ENCODER, settings, name, NULL, hotkey_data, false))
 		return false;
@@ -64,6 +65,8 @@ static bool init_encoder(struct obs_encoder *encoder, const char *name, obs_data
 		return false;
 	if (pthread_mutex_init(&encoder->roi_mutex, NULL) != 0)
 		return false;
+	if (pthread_mutex_init(&encoder->audio_stats_mutex, NULL) != 0)
+		return false;
 
 	if (encoder->orig_info.get_defaults) {
 		encoder->orig_info.get_defaults(encoder->context.settings);
@@ -308,13 +311,219 @@ static void maybe_set_up_gpu_rescale(struct obs_encoder *encoder)
 	pthread_mutex_unlock(&obs->video.mixes_mutex);
 }
 
+/* ------------------------------------------------------------------------- */
+/* audio encode threads */
+
+/* ~1.3 seconds of 1024-frame mixes at 48khz */
+#define AUDIO_QUEUE_SIZE 64
+
+struct encoder_audio_chunk {
+	struct audio_data data;
+	size_t mix_idx;
+	uint8_t *buf;
+	size_t capacity;
+};
+
+static void encode_audio_chunk(struct obs_encoder *encoder, struct encoder_audio_chunk *chunk)
+{
+	uint64_t start = os_gettime_ns();
+	uint64_t elapsed;
+
+	receive_audio(encoder, chunk->mix_idx, &chunk->data);
+	elapsed = os_gettime_ns() - start;
+
+	pthread_mutex_lock(&encoder->audio_stats_mutex);
+	encoder->audio_stats.chunks_encoded++;
+	encoder->audio_stats.encode_time_ns += elapsed;
+	if (elapsed > encoder->audio_stats.max_encode_time_ns)
+		encoder->audio_stats.max_encode_time_ns = elapsed;
+	pthread_mutex_unlock(&encoder->audio_stats_mutex);
+}
+
+static void *audio_encode_thread(void *param)
+{
+	struct obs_encoder *encoder = param;
+	struct encoder_audio_chunk *chunk;
+
+	os_set_thread_name("obs audio encode thread");
+
+	while (os_sem_wait(encoder->audio_sem) == 0) {
+		while ((chunk = spsc_ring_pop(&encoder->audio_ready)) != NULL) {
+			/* after an encode error the encoder is already
+			 * stopped, so just hand the remaining chunks back */
+			if (!os_atomic_load_bool(&encoder->audio_thread_stopped))
+				encode_audio_chunk(encoder, chunk);
+
+			spsc_ring_push(&encoder->audio_free, chunk);
+			os_event_signal(encoder->audio_space);
+		}
+
+		if (os_atomic_load_bool(&encoder->audio_thread_exit) ||
+		    os_atomic_load_bool(&encoder->audio_thread_stopped))
+			break;
+	}
+
+	return NULL;
+}
+
+static void receive_audio_threaded(void *param, size_t mix_idx, struct audio_data *in)
+{
+	struct obs_encoder *encoder = param;
+	struct encoder_audio_chunk *chunk;
+	size_t plane_size = in->frames * encoder->blocksize;
+	bool stalled = false;
+	uint32_t depth;
+
+	/* block the audio thread rather than dropping audio if the encoder
+	 * falls a full queue behind, same as encoding on the audio thread */
+	while ((chunk = spsc_ring_pop(&encoder->audio_free)) == NULL) {
+		if (os_atomic_load_bool(&encoder->audio_thread_stopped))
+			return;
+
+		stalled = true;
+		os_event_wait(encoder->audio_space);
+	}
+
+	if (chunk->capacity < plane_size * encoder->planes) {
+		chunk->capacity = plane_size * encoder->planes;
+		chunk->buf = brealloc(chunk->buf, chunk->capacity);
+	}
+
+	chunk->data = *in;
+	chunk->mix_idx = mix_idx;
+	for (size_t i = 0; i < encoder->planes; i++) {
+		chunk->data.data[i] = chunk->buf + plane_size * i;
+		memcpy(chunk->data.data[i], in->data[i], plane_size);
+	}
+
+	spsc_ring_push(&encoder->audio_ready, chunk);
+	os_sem_post(encoder->audio_sem);
+
+	depth = (uint32_t)spsc_ring_count(&encoder->audio_ready);
+
+	pthread_mutex_lock(&encoder->audio_stats_mutex);
+	encoder->audio_stats.queue_depth = depth;
+	if (depth > encoder->audio_stats.max_queue_depth)
+		encoder->audio_stats.max_queue_depth = depth;
+	if (stalled)
+		encoder->audio_stats.stalls++;
+	pthread_mutex_unlock(&encoder->audio_stats_mutex);
+}
+
+static void free_audio_thread(struct obs_encoder *encoder)
+{
+	if (!encoder->audio_thread_created)
+		return;
+
+	os_atomic_set_bool(&encoder->audio_thread_exit, true);
+	os_sem_post(encoder->audio_sem);
+	pthread_join(encoder->audio_thread, NULL);
+
+	for (size_t i = 0; i < AUDIO_QUEUE_SIZE - 1; i++)
+		bfree(encoder->audio_chunks[i].buf);
+	bfree(encoder->audio_chunks);
+	encoder->audio_chunks = NULL;
+
+	spsc_ring_free(&encoder->audio_ready);
+	spsc_ring_free(&encoder->audio_free);
+	os_sem_destroy(encoder->audio_sem);
+	os_event_destroy(encoder->audio_space);
+	encoder->audio_sem = NULL;
+	encoder->audio_space = NULL;
+	encoder->audio_thread_created = false;
+}
+
+static bool start_audio_thread(struct obs_encoder *encoder)
+{
+	/* the thread of an encoder that stopped itself is joined here */
+	free_audio_thread(encoder);
+
+	if (os_sem_init(&encoder->audio_sem, 0) != 0)
+		return false;
+	if (os_event_init(&encoder->audio_space, OS_EVENT_TYPE_AUTO) != 0) {
+		os_sem_destroy(encoder->audio_sem);
+		encoder->audio_sem = NULL;
+		return false;
+	}
+
+	spsc_ring_init(&encoder->audio_ready, AUDIO_QUEUE_SIZE);
+	spsc_ring_init(&encoder->audio_free, AUDIO_QUEUE_SIZE);
+	encoder->audio_chunks = bzalloc(sizeof(struct encoder_audio_chunk) * (AUDIO_QUEUE_SIZE - 1));
+	for (size_t i = 0; i < AUDIO_QUEUE_SIZE - 1; i++)
+		spsc_ring_push(&encoder->audio_free, &encoder->audio_chunks[i]);
+
+	os_atomic_set_bool(&encoder->audio_thread_exit, false);
+	os_atomic_set_bool(&encoder->audio_thread_stopped, false);
+
+	pthread_mutex_lock(&encoder->audio_stats_mutex);
+	memset(&encoder->audio_stats, 0, sizeof(encoder->audio_stats));
+	pthread_mutex_unlock(&encoder->audio_stats_mutex);
+
+	encoder->audio_thread_created = pthread_create(&encoder->audio_thread, NULL, audio_encode_thread, encoder) ==
+					0;
+	if (!encoder->audio_thread_created) {
+		blog(LOG_WARNING, "Failed to create encode thread for audio encoder '%s', encoding on the audio thread",
+		     encoder->context.name);
+
+		bfree(encoder->audio_chunks);
+		encoder->audio_chunks = NULL;
+		spsc_ring_free(&encoder->audio_ready);
+		spsc_ring_free(&encoder->audio_free);
+		os_sem_destroy(encoder->audio_sem);
+		os_event_destroy(encoder->audio_space);
+		encoder->audio_sem = NULL;
+		encoder->audio_space = NULL;
+	}
+
+	return encoder->audio_thread_created;
+}
+
+static void stop_audio_thread(struct obs_encoder *encoder)
+{
+	bool from_thread = pthread_equal(pthread_self(), encoder->audio_thread);
+
+	/* the encode thread stops its own encoder on encode errors, so it
+	 * can't free up chunks for receive_audio_threaded anymore */
+	if (from_thread) {
+		os_atomic_set_bool(&encoder->audio_thread_stopped, true);
+		os_event_signal(encoder->audio_space);
+	}
+
+	audio_output_disconnect(encoder->media, encoder->mixer_idx, receive_audio_threaded, encoder);
+
+	/* otherwise wait for the queued audio to be encoded */
+	if (!from_thread)
+		free_audio_thread(encoder);
+}
+
+bool obs_encoder_get_thread_stats(const obs_encoder_t *encoder, struct obs_encoder_thread_stats *stats)
+{
+	if (!obs_encoder_valid(encoder, "obs_encoder_get_thread_stats"))
+		return false;
+	if (!obs_ptr_valid(stats, "obs_encoder_get_thread_stats"))
+		return false;
+	if (encoder->info.type != OBS_ENCODER_AUDIO)
+		return false;
+
+	pthread_mutex_lock((pthread_mutex_t *)&encoder->audio_stats_mutex);
+	*stats = encoder->audio_stats;
+	pthread_mutex_unlock((pthread_mutex_t *)&encoder->audio_stats_mutex);
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+
 static void add_connection(struct obs_encoder *encoder)
 {
 	if (encoder->info.type == OBS_ENCODER_AUDIO) {
 		struct audio_convert_info audio_info = {0};
 		get_audio_info(encoder, &audio_info);
 
-		audio_output_connect(encoder->media, encoder->mixer_idx, &audio_info, receive_audio, encoder);
+		bool threaded = obs_threaded_audio_encoders_enabled() && start_audio_thread(encoder);
+
+		os_atomic_set_bool(&encoder->audio_threaded, threaded);
+		audio_output_connect(encoder->media, encoder->mixer_idx, &audio_info,
+				     threaded ? receive_audio_threaded : receive_audio, encoder);
 	} else {
 		struct video_scale_info info = {0};
 		get_video_info(encoder, &info);
@@ -342,7 +551,12 @@ void obs_encoder_group_actually_destroy(obs_encoder_group_t *group);
 static void remove_connection(struct obs_encoder *encoder, bool shutdown)
 {
 	if (encoder->info.type == OBS_ENCODER_AUDIO) {
-		audio_output_disconnect(encoder->media, encoder->mixer_idx, receive_audio, encoder);
+		/* the encode thread can get here on its own after an encode
+		 * error, only whichever gets here first stops the thread */
+		if (os_atomic_exchange_bool(&encoder->audio_threaded, false))
+			stop_audio_thread(encoder);
+		else
+			audio_output_disconnect(encoder->media, encoder->mixer_idx, receive_audio, encoder);
 	} else {
 		if (gpu_encode_available(encoder)) {
 			stop_gpu_encode(encoder);
@@ -379,6 +593,14 @@ static inline void free_audio_buffers(struct obs_encoder *encoder)
 	}
 }
 
+static inline void free_packet_data(struct obs_encoder *encoder)
+{
+	struct encoder_packet pkt = {.data = encoder->packet_data};
+
+	obs_encoder_packet_release(&pkt);
+	encoder->packet_data = NULL;
+}
+
 void obs_encoder_destroy(obs_encoder_t *encoder)
 {
 	if (encoder) {
@@ -396,10 +618,12 @@ void obs_encoder_destroy(obs_encoder_t *encoder)
 
 		obs_encoder_set_group(encoder, NULL);
 
+		free_audio_thread(encoder);
 		free_audio_buffers(encoder);
 
 		if (encoder->context.data)
 			encoder->info.destroy(encoder->context.data);
+		free_packet_data(encoder);
 		da_free(encoder->callbacks);
 		da_free(encoder->roi);
 		da_free(encoder->encoder_packet_times);
@@ -408,6 +632,7 @@ void obs_encoder_destroy(obs_encoder_t *encoder)
 		pthread_mutex_destroy(&encoder->outputs_mutex);
 		pthread_mutex_destroy(&encoder->pause.mutex);
 		pthread_mutex_destroy(&encoder->roi_mutex);
+		pthread_mutex_destroy(&encoder->audio_stats_mutex);
 		obs_context_data_free(&encoder->context);
 		if (encoder->owns_info_id)
 			bfree((void *)encoder->info.id);
@@ -674,6 +899,7 @@ void obs_encoder_shutdown(obs_encoder_t *encoder)
 		encoder->start_ts = 0;
 		encoder->frame_rate_divisor_counter = 0;
 		maybe_clear_encoder_core_video_mix(encoder);
+		free_packet_data(encoder);
 
 		for (size_t i = 0; i < encoder->paired_encoders.num; i++) {
 			obs_weak_encoder_release(encoder->paired_encoders.array[i]);
@@ -1227,7 +1453,6 @@ static void send_first_video_packet(struct obs_encoder *encoder, struct encoder_
 				    struct encoder_packet *packet, struct encoder_packet_time *packet_time)
 {
 	struct encoder_packet first_packet;
-	DARRAY(uint8_t) data;
 	uint8_t *sei;
 	size_t size;
 
@@ -1235,25 +1460,22 @@ static void send_first_video_packet(struct obs_encoder *encoder, struct encoder_
 	if (!packet->keyframe)
 		return;
 
-	da_init(data);
-
 	if (!get_sei(encoder, &sei, &size) || !sei || !size) {
 		cb->new_packet(cb->param, packet, packet_time);
 		cb->sent_first_packet = true;
 		return;
 	}
 
-	da_push_back_array(data, sei, size);
-	da_push_back_array(data, packet->data, packet->size);
-
 	first_packet = *packet;
-	first_packet.data = data.array;
-	first_packet.size = data.num;
+	first_packet.data = packet_pool_alloc(&obs->packet_pool, size + packet->size);
+	first_packet.size = size + packet->size;
+	memcpy(first_packet.data, sei, size);
+	memcpy(first_packet.data + size, packet->data, packet->size);
 
 	cb->new_packet(cb->param, &first_packet, packet_time);
 	cb->sent_first_packet = true;
 
-	da_free(data);
+	obs_encoder_packet_release(&first_packet);
 }
 
 static const char *send_packet_name = "send_packet";
@@ -1291,6 +1513,18 @@ void full_stop(struct obs_encoder *encoder)
 	}
 }
 
+static inline void create_shared_packet(struct obs_encoder *encoder, struct encoder_packet *dst,
+					const struct encoder_packet *src)
+{
+	if (src->data && src->data == encoder->packet_data) {
+		/* the encoder handed over its buffer */
+		*dst = *src;
+		encoder->packet_data = NULL;
+	} else {
+		obs_encoder_packet_create_instance(dst, src);
+	}
+}
+
 void send_off_encoder_packet(obs_encoder_t *encoder, bool success, bool received, struct encoder_packet *pkt)
 {
 	if (!success) {
@@ -1336,16 +1570,22 @@ void send_off_encoder_packet(obs_encoder_t *encoder, bool success, bool received
 				     pkt->pts);
 		}
 
+		/* all outputs reference the same copy of the packet data */
+		struct encoder_packet shared;
+		create_shared_packet(encoder, &shared, pkt);
+
 		pthread_mutex_lock(&encoder->callbacks_mutex);
 
 		for (size_t i = encoder->callbacks.num; i > 0; i--) {
 			struct encoder_callback *cb;
 			cb = encoder->callbacks.array + (i - 1);
-			send_packet(encoder, cb, pkt, found_ept ? &ept_local : NULL);
+			send_packet(encoder, cb, &shared, found_ept ? &ept_local : NULL);
 		}
 
 		pthread_mutex_unlock(&encoder->callbacks_mutex);
 
+		obs_encoder_packet_release(&shared);
+
 		// Count number of video frames successfully encoded
 		if (pkt->type == OBS_ENCODER_VIDEO)
 			encoder->encoded_frames++;
@@ -1739,12 +1979,8 @@ void obs_encoder_remove_output(struct obs_encoder *encoder, struct obs_output *o
 
 void obs_encoder_packet_create_instance(struct encoder_packet *dst, const struct encoder_packet *src)
 {
-	long *p_refs;
-
 	*dst = *src;
-	p_refs = bmalloc(src->size + sizeof(long));
-	dst->data = (void *)(p_refs + 1);
-	*p_refs = 1;
+	dst->data = packet_pool_alloc(&obs->packet_pool, src->size);
 	memcpy(dst->data, src->data, src->size);
 }
 
@@ -1768,13 +2004,24 @@ void obs_encoder_packet_release(struct encoder_packet *pkt)
 
 	if (pkt->data) {
 		long *p_refs = ((long *)pkt->data) - 1;
-		if (os_atomic_dec_long(p_refs) == 0)
-			bfree(p_refs);
+		long refs = os_atomic_dec_long(p_refs);
+		if ((refs & PACKET_REFS_MASK) == 0)
+			packet_pool_release(obs ? &obs->packet_pool : NULL, p_refs, refs);
 	}
 
 	memset(pkt, 0, sizeof(struct encoder_packet));
 }
 
+uint8_t *obs_encoder_alloc_packet_data(obs_encoder_t *encoder, size_t size)
+{
+	if (!obs_encoder_valid(encoder, "obs_encoder_alloc_packet_data"))
+		return NULL;
+
+	free_packet_data(encoder);
+	encoder->packet_data = packet_pool_alloc(&obs->packet_pool, size);
+	return encoder->packet_data;
+}
+
 void obs_encoder_set_preferred_video_format(obs_encoder_t *encoder, enum video_format format)
 {
 	if (!encoder || encoder->info.type != OBS_ENCODER_VIDEO)
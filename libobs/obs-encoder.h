@@ -142,6 +142,25 @@ struct encoder_packet {
 	obs_encoder_t *encoder;
 };
 
+/** Statistics of the pool that encoder packet data is allocated from */
+struct obs_packet_pool_stats {
+	uint64_t allocations;     /**< Buffers requested from the pool */
+	uint64_t hits;            /**< Requests served with a cached buffer */
+	uint64_t bytes_in_use;    /**< Bytes held by live packets */
+	uint64_t bytes_retained;  /**< Bytes cached for reuse */
+	uint64_t high_water_mark; /**< Peak of bytes in use plus bytes retained */
+};
+
+/** Statistics of an audio encoder running on its own encode thread */
+struct obs_encoder_thread_stats {
+	uint32_t queue_depth;        /**< Chunks of audio waiting to be encoded */
+	uint32_t max_queue_depth;    /**< Peak of queue_depth */
+	uint64_t stalls;             /**< Times the audio thread waited for a free chunk */
+	uint64_t chunks_encoded;     /**< Chunks of audio handed to the encoder */
+	uint64_t encode_time_ns;     /**< Total time spent encoding those chunks */
+	uint64_t max_encode_time_ns; /**< Longest time spent encoding one chunk */
+};
+
 /** Encoder input frame */
 struct encoder_frame {
 	/** Data for the frame/audio */
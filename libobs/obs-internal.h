@@ -38,6 +38,9 @@
 #include "media-io/audio-io.h"
 
 #include "obs.h"
+#include "obs-output-interleaver.h"
+#include "obs-packet-pool.h"
+#include "obs-spsc-ring.h"
 
 #include <obsversion.h>
 #include <caption/caption.h>
@@ -332,6 +335,21 @@ struct obs_core_video_mix {
 extern struct obs_core_video_mix *obs_create_video_mix(struct obs_video_info *ovi);
 extern void obs_free_video_mix(struct obs_core_video_mix *video);
 
+/* worker threads calling the video_tick callbacks of sources flagged with
+ * OBS_SOURCE_TICK_THREAD_SAFE, only used by the graphics thread */
+struct obs_tick_pool {
+	DARRAY(pthread_t) threads;
+	os_sem_t *start_sem;
+	os_event_t *done_event;
+	volatile bool stop;
+
+	DARRAY(obs_source_t *) sources;
+	DARRAY(uint64_t) tick_times;
+	float seconds;
+	volatile long next_source;
+	volatile long busy_workers;
+};
+
 struct obs_core_video {
 	graphics_t *graphics;
 	gs_effect_t *default_effect;
@@ -379,6 +397,18 @@ struct obs_core_video {
 
 	pthread_mutex_t mixes_mutex;
 	DARRAY(struct obs_core_video_mix *) mixes;
+
+	volatile bool parallel_ticks;
+	volatile bool scene_item_culling;
+
+	/* render target contents are lost when the device is rebuilt */
+	volatile long device_rebuilds;
+	struct obs_tick_pool tick_pool;
+
+	pthread_mutex_t lag_trace_mutex;
+	char *lag_trace_path;
+	volatile bool lag_trace_enabled;
+	uint64_t last_lag_trace_time;
 };
 
 extern void add_ready_encoder_group(obs_encoder_t *encoder);
@@ -408,6 +438,17 @@ struct obs_core_audio {
 
 	volatile bool prevent_monitoring_duplication;
 	struct obs_source *monitoring_duplicating_source;
+
+	/* per-source mixes processed, and skipped because the source isn't
+	 * routed to the mix or nothing is connected to it.  the audio thread
+	 * counts a tick on its own and adds it to the totals under the mutex */
+	uint64_t tick_processed_mixes;
+	uint64_t tick_skipped_mixes;
+	pthread_mutex_t mix_counts_mutex;
+	uint64_t processed_mixes;
+	uint64_t skipped_mixes;
+
+	volatile bool threaded_encoders;
 };
 
 /* user sources, output channels, and displays */
@@ -517,8 +558,11 @@ struct obs_core {
 	struct obs_core_hotkeys hotkeys;
 
 	os_task_queue_t *destruction_task_thread;
+	os_task_pool_t *task_pool;
 
 	obs_task_handler_t ui_task_handler;
+
+	struct packet_pool packet_pool;
 };
 
 extern struct obs_core *obs;
@@ -693,7 +737,6 @@ extern void obs_canvas_rename_source(obs_source_t *source, const char *name);
 
 struct async_frame {
 	struct obs_source_frame *frame;
-	long unused_count;
 	bool used;
 };
 
@@ -761,6 +804,13 @@ struct obs_source {
 	/* signals to call the source update in the video thread */
 	long defer_update_count;
 
+	/* incremented whenever the video of a source flagged with
+	 * OBS_SOURCE_CACHEABLE_VIDEO may have changed */
+	volatile long video_gen;
+
+	/* set by the source when its current video is fully opaque */
+	volatile bool video_opaque;
+
 	/* ensures show/hide are only called once */
 	volatile long show_refs;
 
@@ -822,6 +872,9 @@ struct obs_source {
 	struct obs_audio_data audio_data;
 	size_t audio_storage_size;
 	uint32_t audio_mixers;
+	/* mixes whose output buffers may hold non-silent data, every other
+	 * mix buffer is known to be zeroed */
+	uint32_t audio_live_mixers;
 	float user_volume;
 	float volume;
 	int64_t sync_offset;
@@ -854,6 +907,17 @@ struct obs_source {
 	DARRAY(struct async_frame) async_cache;
 	DARRAY(struct obs_source_frame *) async_frames;
 	pthread_mutex_t async_mutex;
+
+	/* new frames are passed to the graphics thread through async_ready
+	 * and come back for reuse through async_free, neither of which needs
+	 * async_mutex.  async_output_mutex serializes the threads outputting
+	 * frames and protects the async_cache_* state, async_mutex the
+	 * graphics side. */
+	struct spsc_ring async_ready;
+	struct spsc_ring async_free;
+	pthread_mutex_t async_output_mutex;
+	volatile long async_lock_waits;
+	volatile long async_frames_dropped;
 	uint32_t async_width;
 	uint32_t async_height;
 	uint32_t async_cache_width;
@@ -1063,6 +1127,23 @@ extern void obs_source_set_texcoords_centered(obs_source_t *source, bool centere
 extern void obs_source_activate(obs_source_t *source, enum view_type type);
 extern void obs_source_deactivate(obs_source_t *source, enum view_type type);
 extern void obs_source_video_tick(obs_source_t *source, float seconds);
+extern bool obs_source_video_tick_begin(obs_source_t *source, float seconds);
+extern bool obs_source_video_opaque(const obs_source_t *source);
+extern bool obs_source_get_video_hash(obs_source_t *source, uint64_t *hash);
+extern bool obs_scene_get_video_hash(obs_scene_t *scene, uint64_t *hash);
+
+/* FNV-1a, used to detect changes in what cached renders depend on */
+#define VIDEO_HASH_INIT 0xcbf29ce484222325ULL
+
+static inline uint64_t video_hash_mix(uint64_t hash, const void *data, size_t size)
+{
+	const uint8_t *bytes = data;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
 extern float obs_source_get_target_volume(obs_source_t *source, obs_source_t *target);
 extern uint64_t obs_source_get_last_async_ts(const obs_source_t *source);
 
@@ -1169,7 +1250,9 @@ struct obs_output {
 	pthread_t end_data_capture_thread;
 	os_event_t *stopping_event;
 	pthread_mutex_t interleaved_mutex;
+	/* packets received before the output started sending, sorted */
 	DARRAY(struct encoder_packet) interleaved_packets;
+	struct packet_interleaver interleaver;
 	size_t interleaver_max_batch_size;
 	int stop_code;
 
@@ -1383,6 +1466,28 @@ struct obs_encoder {
 
 	/* reconfigure encoder at next possible opportunity */
 	bool reconfigure_requested;
+
+	/* buffer from obs_encoder_alloc_packet_data that the next packet may
+	 * hand over instead of being copied */
+	uint8_t *packet_data;
+
+	/* audio encoded on its own thread (obs_set_threaded_audio_encoders).
+	 * the audio thread copies each mix into a free chunk and queues it
+	 * for the encode thread, waiting for it when the queue is full */
+	volatile bool audio_threaded;
+	bool audio_thread_created;
+	pthread_t audio_thread;
+	os_sem_t *audio_sem;
+	os_event_t *audio_space;
+	volatile bool audio_thread_exit;
+	/* set when the encode thread stopped its own encoder after an error */
+	volatile bool audio_thread_stopped;
+	struct spsc_ring audio_ready;
+	struct spsc_ring audio_free;
+	struct encoder_audio_chunk *audio_chunks;
+
+	pthread_mutex_t audio_stats_mutex;
+	struct obs_encoder_thread_stats audio_stats;
 };
 
 extern struct obs_encoder_info *find_encoder(const char *id);
@@ -1455,6 +1560,8 @@ extern void source_profiler_async_frame_received(obs_source_t *source);
 extern uint64_t source_profiler_source_tick_start(void);
 /* Submit start timestamp for source */
 extern void source_profiler_source_tick_end(obs_source_t *source, uint64_t start);
+/* Submit tick duration for source, for ticks that weren't timed in one go */
+extern void source_profiler_source_tick_time(obs_source_t *source, uint64_t delta);
 
 /* Obtain GPU timer and start timestamp for render start of a source. */
 extern uint64_t source_profiler_source_render_begin(gs_timer_t **timer);
@@ -0,0 +1,185 @@
+#include "obs-output-interleaver.h"
+
+static inline struct interleaved_packet *get_packet(struct packet_interleaver *pi, size_t track, size_t idx)
+{
+	return deque_data(&pi->tracks[track], idx * sizeof(struct interleaved_packet));
+}
+
+static inline size_t track_size(const struct packet_interleaver *pi, size_t track)
+{
+	return pi->tracks[track].size / sizeof(struct interleaved_packet);
+}
+
+static inline bool packet_before(const struct interleaved_packet *a, const struct interleaved_packet *b)
+{
+	if (a->packet.dts_usec != b->packet.dts_usec)
+		return a->packet.dts_usec < b->packet.dts_usec;
+
+	/* sort video packets with same DTS first and by track index, to
+	 * prevent the pruning logic from removing additional video tracks */
+	bool a_video = a->packet.type == OBS_ENCODER_VIDEO;
+	bool b_video = b->packet.type == OBS_ENCODER_VIDEO;
+	if (a_video != b_video)
+		return a_video;
+	if (a_video && a->packet.track_idx != b->packet.track_idx)
+		return a->packet.track_idx < b->packet.track_idx;
+
+	return a->seq < b->seq;
+}
+
+static inline bool track_before(struct packet_interleaver *pi, size_t a, size_t b)
+{
+	return packet_before(get_packet(pi, a, 0), get_packet(pi, b, 0));
+}
+
+static void sift_up(struct packet_interleaver *pi, size_t pos)
+{
+	while (pos) {
+		size_t parent = (pos - 1) / 2;
+		if (!track_before(pi, pi->heap[pos], pi->heap[parent]))
+			break;
+
+		size_t tmp = pi->heap[pos];
+		pi->heap[pos] = pi->heap[parent];
+		pi->heap[parent] = tmp;
+		pos = parent;
+	}
+}
+
+static void sift_down(struct packet_interleaver *pi, size_t pos)
+{
+	for (;;) {
+		size_t left = pos * 2 + 1;
+		size_t right = left + 1;
+		size_t min = pos;
+
+		if (left < pi->heap_size && track_before(pi, pi->heap[left], pi->heap[min]))
+			min = left;
+		if (right < pi->heap_size && track_before(pi, pi->heap[right], pi->heap[min]))
+			min = right;
+		if (min == pos)
+			break;
+
+		size_t tmp = pi->heap[pos];
+		pi->heap[pos] = pi->heap[min];
+		pi->heap[min] = tmp;
+		pos = min;
+	}
+}
+
+void packet_interleaver_push(struct packet_interleaver *pi, const struct encoder_packet *packet)
+{
+	size_t track = packet_interleaver_track(packet->type, packet->track_idx);
+	struct interleaved_packet entry = {.packet = *packet, .seq = pi->next_seq++};
+	bool was_empty = pi->tracks[track].size == 0;
+
+	deque_push_back(&pi->tracks[track], &entry, sizeof(entry));
+	pi->num++;
+
+	if (was_empty) {
+		pi->heap[pi->heap_size] = track;
+		sift_up(pi, pi->heap_size++);
+	}
+}
+
+struct encoder_packet *packet_interleaver_peek(struct packet_interleaver *pi)
+{
+	return pi->heap_size ? &get_packet(pi, pi->heap[0], 0)->packet : NULL;
+}
+
+bool packet_interleaver_pop(struct packet_interleaver *pi, struct encoder_packet *packet)
+{
+	struct interleaved_packet entry;
+
+	if (!pi->heap_size)
+		return false;
+
+	size_t track = pi->heap[0];
+	deque_pop_front(&pi->tracks[track], &entry, sizeof(entry));
+	pi->num--;
+
+	if (!pi->tracks[track].size)
+		pi->heap[0] = pi->heap[--pi->heap_size];
+	sift_down(pi, 0);
+
+	*packet = entry.packet;
+	return true;
+}
+
+/* index of the first packet of the track with dts_usec >= dts_usec */
+static size_t lower_bound_dts(struct packet_interleaver *pi, size_t track, int64_t dts_usec)
+{
+	size_t low = 0;
+	size_t high = track_size(pi, track);
+
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+		if (get_packet(pi, track, mid)->packet.dts_usec < dts_usec)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+/* number of packets of the track ordered before the given packet */
+static size_t count_before(struct packet_interleaver *pi, size_t track, const struct interleaved_packet *limit)
+{
+	size_t low = 0;
+	size_t high = track_size(pi, track);
+
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+		if (packet_before(get_packet(pi, track, mid), limit))
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+size_t packet_interleaver_count_ready(struct packet_interleaver *pi, const int64_t *thresholds)
+{
+	struct interleaved_packet *first_unready = NULL;
+
+	/* the first packet in merged order that isn't ready ends the run */
+	for (size_t track = 0; track < INTERLEAVER_MAX_TRACKS; track++) {
+		size_t size = track_size(pi, track);
+		if (!size)
+			continue;
+
+		size_t idx = lower_bound_dts(pi, track, thresholds[track]);
+		if (idx == size)
+			continue;
+
+		struct interleaved_packet *packet = get_packet(pi, track, idx);
+		if (!first_unready || packet_before(packet, first_unready))
+			first_unready = packet;
+	}
+
+	if (!first_unready)
+		return pi->num;
+
+	size_t count = 0;
+	for (size_t track = 0; track < INTERLEAVER_MAX_TRACKS; track++) {
+		if (track_size(pi, track))
+			count += count_before(pi, track, first_unready);
+	}
+
+	return count;
+}
+
+void packet_interleaver_free(struct packet_interleaver *pi)
+{
+	struct encoder_packet packet;
+
+	while (packet_interleaver_pop(pi, &packet))
+		obs_encoder_packet_release(&packet);
+
+	for (size_t i = 0; i < INTERLEAVER_MAX_TRACKS; i++)
+		deque_free(&pi->tracks[i]);
+
+	pi->next_seq = 0;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "util/deque.h"
+#include "obs.h"
+
+/*
+ * Interleaves encoded packets of all tracks of an output by DTS.
+ *
+ * Packets of a single track always arrive in DTS order, so every track is
+ * kept in its own FIFO and the tracks are merged through a min-heap of their
+ * front packets.  Pushing and popping a packet is O(log tracks), and
+ * counting the packets that are ready to be sent is O(tracks * log n).
+ *
+ * Ordering matches the old sorted array: by DTS, video before audio on equal
+ * DTS, video tracks by index, and audio in order of arrival.
+ */
+
+#define INTERLEAVER_MAX_TRACKS (MAX_OUTPUT_VIDEO_ENCODERS + MAX_OUTPUT_AUDIO_ENCODERS)
+
+struct interleaved_packet {
+	struct encoder_packet packet;
+	uint64_t seq;
+};
+
+struct packet_interleaver {
+	struct deque tracks[INTERLEAVER_MAX_TRACKS]; /* struct interleaved_packet */
+	size_t heap[INTERLEAVER_MAX_TRACKS];
+	size_t heap_size;
+	uint64_t next_seq;
+	size_t num;
+};
+
+static inline size_t packet_interleaver_track(enum obs_encoder_type type, size_t track_idx)
+{
+	return type == OBS_ENCODER_VIDEO ? track_idx : MAX_OUTPUT_VIDEO_ENCODERS + track_idx;
+}
+
+/* takes ownership of the packet */
+extern void packet_interleaver_push(struct packet_interleaver *pi, const struct encoder_packet *packet);
+extern struct encoder_packet *packet_interleaver_peek(struct packet_interleaver *pi);
+extern bool packet_interleaver_pop(struct packet_interleaver *pi, struct encoder_packet *packet);
+
+/* counts the packets from the front that are ready to be sent, where a packet
+ * of a track is ready if its DTS is below the track's threshold, indexed by
+ * packet_interleaver_track() */
+extern size_t packet_interleaver_count_ready(struct packet_interleaver *pi, const int64_t *thresholds);
+
+/* releases all remaining packets */
+extern void packet_interleaver_free(struct packet_interleaver *pi);
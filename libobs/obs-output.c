@@ -231,6 +231,7 @@ static inline void free_packets(struct obs_output *output)
 	for (size_t i = 0; i < output->interleaved_packets.num; i++)
 		obs_encoder_packet_release(output->interleaved_packets.array + i);
 	da_free(output->interleaved_packets);
+	packet_interleaver_free(&output->interleaver);
 }
 
 static inline void clear_raw_audio_buffers(obs_output_t *output)
@@ -1431,20 +1432,6 @@ static inline void apply_interleaved_packet_offset(struct obs_output *output, st
 	out->dts_usec = packet_dts_usec(out);
 }
 
-static inline bool has_higher_opposing_ts(struct obs_output *output, struct encoder_packet *packet)
-{
-	bool has_higher = true;
-
-	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
-		if (!output->video_encoders[i] || (packet->type == OBS_ENCODER_VIDEO && i == packet->track_idx))
-			continue;
-		has_higher = has_higher && output->highest_video_ts[i] > packet->dts_usec;
-	}
-
-	return packet->type == OBS_ENCODER_AUDIO ? has_higher
-						 : (has_higher && output->highest_audio_ts > packet->dts_usec);
-}
-
 static size_t extract_buffer_from_sei(sei_t *sei, uint8_t **data_out)
 {
 	if (!sei || !sei->head) {
@@ -1646,11 +1633,12 @@ static bool add_caption(struct obs_output *output, struct encoder_packet *out)
 
 static inline void send_interleaved(struct obs_output *output)
 {
-	struct encoder_packet out = output->interleaved_packets.array[0];
+	struct encoder_packet out;
 	struct encoder_packet_time ept_local = {0};
 	bool found_ept = false;
 
-	da_erase(output->interleaved_packets, 0);
+	if (!packet_interleaver_pop(&output->interleaver, &out))
+		return;
 
 	if (out.type == OBS_ENCODER_VIDEO) {
 		output->total_frames++;
@@ -2060,20 +2048,17 @@ static inline void insert_interleaved_packet(struct obs_output *output, struct e
 	da_insert(output->interleaved_packets, idx, out);
 }
 
+/* hands the starting packets over to the interleaver, which sorts them again
+ * now that their offsets have been applied */
 static void resort_interleaved_packets(struct obs_output *output)
 {
-	DARRAY(struct encoder_packet) old_array;
-
-	old_array.da = output->interleaved_packets.da;
-	memset(&output->interleaved_packets, 0, sizeof(output->interleaved_packets));
-
-	for (size_t i = 0; i < old_array.num; i++) {
-		set_higher_ts(output, &old_array.array[i]);
+	for (size_t i = 0; i < output->interleaved_packets.num; i++) {
+		set_higher_ts(output, &output->interleaved_packets.array[i]);
 
-		insert_interleaved_packet(output, &old_array.array[i]);
+		packet_interleaver_push(&output->interleaver, &output->interleaved_packets.array[i]);
 	}
 
-	da_free(old_array);
+	da_free(output->interleaved_packets);
 }
 
 static void discard_unused_audio_packets(struct obs_output *output, int64_t dts_usec)
@@ -2169,20 +2154,35 @@ static void apply_ept_offsets(struct obs_output *output)
 
 static inline size_t count_streamable_frames(struct obs_output *output)
 {
-	size_t eligible = 0;
+	int64_t thresholds[INTERLEAVER_MAX_TRACKS];
+	int64_t lowest_video_ts = INT64_MAX;
 
-	for (size_t idx = 0; idx < output->interleaved_packets.num; idx++) {
-		struct encoder_packet *pkt = &output->interleaved_packets.array[idx];
+	/* Only count an interleaved packet as streamable if there are packets of the opposing type and of a
+	 * higher timestamp in the interleave buffer. This ensures that the timestamps are monotonic.
+	 * Video tracks need audio and every other video track to be ahead, audio needs every video track. */
+	for (size_t i = 0; i < INTERLEAVER_MAX_TRACKS; i++)
+		thresholds[i] = INT64_MAX;
 
-		/* Only count an interleaved packet as streamable if there are packets of the opposing type and of a
-		 * higher timestamp in the interleave buffer. This ensures that the timestamps are monotonic. */
-		if (!has_higher_opposing_ts(output, pkt))
-			break;
+	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+		if (!output->video_encoders[i])
+			continue;
+
+		if (output->highest_video_ts[i] < lowest_video_ts)
+			lowest_video_ts = output->highest_video_ts[i];
+
+		int64_t threshold = output->highest_audio_ts;
+		for (size_t j = 0; j < MAX_OUTPUT_VIDEO_ENCODERS; j++) {
+			if (j != i && output->video_encoders[j] && output->highest_video_ts[j] < threshold)
+				threshold = output->highest_video_ts[j];
+		}
 
-		eligible++;
+		thresholds[packet_interleaver_track(OBS_ENCODER_VIDEO, i)] = threshold;
 	}
 
-	return eligible;
+	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++)
+		thresholds[packet_interleaver_track(OBS_ENCODER_AUDIO, i)] = lowest_video_ts;
+
+	return packet_interleaver_count_ready(&output->interleaver, thresholds);
 }
 
 static void interleave_packets(void *data, struct encoder_packet *packet, struct encoder_packet_time *packet_time)
@@ -2223,19 +2223,20 @@ static void interleave_packets(void *data, struct encoder_packet *packet, struct
 	if (output->active_delay_ns)
 		out = *packet;
 	else
-		obs_encoder_packet_create_instance(&out, packet);
+		obs_encoder_packet_ref(&out, packet);
 
 	if (packet_time) {
 		output_packet_time = da_push_back_new(output->encoder_packet_times[packet->track_idx]);
 		*output_packet_time = *packet_time;
 	}
 
-	if (was_started)
+	if (was_started) {
 		apply_interleaved_packet_offset(output, &out, output_packet_time);
-	else
+		packet_interleaver_push(&output->interleaver, &out);
+	} else {
 		check_received(output, packet);
-
-	insert_interleaved_packet(output, &out);
+		insert_interleaved_packet(output, &out);
+	}
 
 	received_video = true;
 	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
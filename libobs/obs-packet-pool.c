@@ -0,0 +1,124 @@
+#include "obs-packet-pool.h"
+
+static inline size_t class_size(size_t class_idx)
+{
+	return (size_t)1 << (class_idx + PACKET_POOL_MIN_SHIFT);
+}
+
+static inline bool get_class(size_t size, size_t *class_idx)
+{
+	size_t idx = 0;
+
+	if (size > class_size(PACKET_POOL_NUM_CLASSES - 1))
+		return false;
+
+	while (class_size(idx) < size)
+		idx++;
+
+	*class_idx = idx;
+	return true;
+}
+
+static inline size_t max_free_blocks(size_t class_idx)
+{
+	size_t max = PACKET_POOL_MAX_CLASS_BYTES / class_size(class_idx);
+	return max < PACKET_POOL_MIN_CLASS_BLOCKS ? PACKET_POOL_MIN_CLASS_BLOCKS : max;
+}
+
+static inline void update_high_water_mark(struct obs_packet_pool_stats *stats)
+{
+	uint64_t total = stats->bytes_in_use + stats->bytes_retained;
+	if (total > stats->high_water_mark)
+		stats->high_water_mark = total;
+}
+
+bool packet_pool_init(struct packet_pool *pool)
+{
+	memset(pool, 0, sizeof(*pool));
+	return pthread_mutex_init(&pool->mutex, NULL) == 0;
+}
+
+void packet_pool_free(struct packet_pool *pool)
+{
+	for (size_t i = 0; i < PACKET_POOL_NUM_CLASSES; i++) {
+		void *block = pool->free_lists[i];
+		while (block) {
+			void *next = *(void **)block;
+			bfree(block);
+			block = next;
+		}
+		pool->free_lists[i] = NULL;
+		pool->free_counts[i] = 0;
+	}
+
+	pthread_mutex_destroy(&pool->mutex);
+}
+
+uint8_t *packet_pool_alloc(struct packet_pool *pool, size_t size)
+{
+	void *block = NULL;
+	size_t class_idx;
+	long *p_refs;
+
+	if (!get_class(size, &class_idx)) {
+		p_refs = bmalloc(size + sizeof(long));
+		*p_refs = 1;
+		return (uint8_t *)(p_refs + 1);
+	}
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->stats.allocations++;
+	pool->stats.bytes_in_use += class_size(class_idx);
+
+	if (pool->free_lists[class_idx]) {
+		block = pool->free_lists[class_idx];
+		pool->free_lists[class_idx] = *(void **)block;
+		pool->free_counts[class_idx]--;
+		pool->stats.hits++;
+		pool->stats.bytes_retained -= class_size(class_idx);
+	}
+
+	update_high_water_mark(&pool->stats);
+	pthread_mutex_unlock(&pool->mutex);
+
+	if (!block)
+		block = bmalloc(class_size(class_idx) + sizeof(long));
+
+	p_refs = block;
+	*p_refs = PACKET_REFS_POOLED | ((long)class_idx << PACKET_REFS_CLASS_SHIFT) | 1;
+	return (uint8_t *)(p_refs + 1);
+}
+
+void packet_pool_release(struct packet_pool *pool, long *p_refs, long refs)
+{
+	size_t class_idx = (size_t)((refs >> PACKET_REFS_CLASS_SHIFT) & PACKET_REFS_CLASS_MASK);
+	bool keep = false;
+
+	if (!pool || (refs & PACKET_REFS_POOLED) == 0) {
+		bfree(p_refs);
+		return;
+	}
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->stats.bytes_in_use -= class_size(class_idx);
+
+	if (pool->free_counts[class_idx] < max_free_blocks(class_idx) &&
+	    pool->stats.bytes_retained + class_size(class_idx) <= PACKET_POOL_MAX_RETAINED_BYTES) {
+		*(void **)p_refs = pool->free_lists[class_idx];
+		pool->free_lists[class_idx] = p_refs;
+		pool->free_counts[class_idx]++;
+		pool->stats.bytes_retained += class_size(class_idx);
+		keep = true;
+	}
+	pthread_mutex_unlock(&pool->mutex);
+
+	if (!keep)
+		bfree(p_refs);
+}
+
+void packet_pool_get_stats(struct packet_pool *pool, struct obs_packet_pool_stats *stats)
+{
+	pthread_mutex_lock(&pool->mutex);
+	*stats = pool->stats;
+	pthread_mutex_unlock(&pool->mutex);
+}
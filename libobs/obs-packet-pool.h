@@ -0,0 +1,52 @@
+#pragma once
+
+#include "util/threading.h"
+#include "obs.h"
+
+/*
+ * Size-classed pool for encoder packet data.
+ *
+ * Encoder packet data is preceded by a reference count (a long, see
+ * obs_encoder_packet_ref).  Buffers handed out by the pool keep their size
+ * class in the upper bits of that word, which lets obs_encoder_packet_release
+ * return them to the pool, while packets built elsewhere with a plain count
+ * (captions, muxer generated packets) are still freed with bfree.
+ *
+ * Classes are powers of two from 256 bytes to 1 MiB, larger buffers (the odd
+ * big keyframe) are not pooled.  Each class keeps up to
+ * PACKET_POOL_MAX_CLASS_BYTES (but at least PACKET_POOL_MIN_CLASS_BLOCKS) of
+ * free buffers around, and all classes together no more than
+ * PACKET_POOL_MAX_RETAINED_BYTES.  A single lock is enough at packet rates.
+ */
+
+#define PACKET_POOL_MIN_SHIFT 8
+#define PACKET_POOL_MAX_SHIFT 20
+#define PACKET_POOL_NUM_CLASSES (PACKET_POOL_MAX_SHIFT - PACKET_POOL_MIN_SHIFT + 1)
+#define PACKET_POOL_MAX_CLASS_BYTES (1024 * 1024)
+#define PACKET_POOL_MIN_CLASS_BLOCKS 2
+#define PACKET_POOL_MAX_RETAINED_BYTES (4 * 1024 * 1024)
+
+#define PACKET_REFS_MASK 0x00FFFFFFL
+#define PACKET_REFS_CLASS_SHIFT 24
+#define PACKET_REFS_CLASS_MASK 0x1FL
+#define PACKET_REFS_POOLED (1L << 30)
+
+struct packet_pool {
+	pthread_mutex_t mutex;
+	void *free_lists[PACKET_POOL_NUM_CLASSES];
+	size_t free_counts[PACKET_POOL_NUM_CLASSES];
+	struct obs_packet_pool_stats stats;
+};
+
+extern bool packet_pool_init(struct packet_pool *pool);
+extern void packet_pool_free(struct packet_pool *pool);
+
+/* returns the data pointer of a buffer of at least size bytes, with its
+ * reference count set to 1 */
+extern uint8_t *packet_pool_alloc(struct packet_pool *pool, size_t size);
+
+/* returns the buffer that owns p_refs, whose reference count just dropped to
+ * zero; refs is the last value of the count word.  pool may be NULL. */
+extern void packet_pool_release(struct packet_pool *pool, long *p_refs, long refs);
+
+extern void packet_pool_get_stats(struct packet_pool *pool, struct obs_packet_pool_stats *stats);
@@ -894,6 +894,34 @@ static bool are_texcoords_centered(struct matrix4 *m)
 	return memcmp(m, &copy, sizeof(*m)) == 0;
 }
 
+/* keeps the item's texrender from being rendered again while nothing that
+ * affects its contents has changed */
+static void update_render_cache(struct obs_scene_item *item, uint32_t cx, uint32_t cy, enum gs_color_space space)
+{
+	uint64_t hash = VIDEO_HASH_INIT;
+	long rebuilds = os_atomic_load_long(&obs->video.device_rebuilds);
+	uint32_t size[2] = {cx, cy};
+	bool cacheable = !transition_active(item->show_transition) && !transition_active(item->hide_transition) &&
+			 obs_source_get_video_hash(item->source, &hash);
+
+	if (cacheable) {
+		hash = video_hash_mix(hash, size, sizeof(size));
+		hash = video_hash_mix(hash, &space, sizeof(space));
+		hash = video_hash_mix(hash, &item->crop, sizeof(item->crop));
+		hash = video_hash_mix(hash, &item->bounds_crop, sizeof(item->bounds_crop));
+		hash = video_hash_mix(hash, &rebuilds, sizeof(rebuilds));
+
+		if (!item->render_cached || item->render_hash != hash)
+			gs_texrender_reset(item->item_render);
+		item->render_hash = hash;
+	} else if (item->render_cached) {
+		/* the tick skipped the reset while the item was cached */
+		gs_texrender_reset(item->item_render);
+	}
+
+	item->render_cached = cacheable;
+}
+
 static inline void render_item(struct obs_scene_item *item)
 {
 	GS_DEBUG_MARKER_BEGIN_FORMAT(GS_DEBUG_COLOR_ITEM, "Item: %s", obs_source_get_name(item->source));
@@ -925,6 +953,8 @@ static inline void render_item(struct obs_scene_item *item)
 		uint32_t cx = calc_cx(item, width);
 		uint32_t cy = calc_cy(item, height);
 
+		update_render_cache(item, cx, cy, source_space);
+
 		if (cx && cy && gs_texrender_begin_with_color_space(item->item_render, cx, cy, source_space)) {
 			float cx_scale = (float)width / (float)cx;
 			float cy_scale = (float)height / (float)cy;
@@ -995,7 +1025,7 @@ static void scene_video_tick(void *data, float seconds)
 	video_lock(scene);
 	item = scene->first_item;
 	while (item) {
-		if (item->item_render)
+		if (item->item_render && !item->render_cached)
 			gs_texrender_reset(item->item_render);
 		item = item->next;
 	}
@@ -1056,6 +1086,160 @@ static inline bool scene_size_changed(obs_scene_t *scene)
 	return true;
 }
 
+/* ------------------------------------------------------------------------- */
+/* Culling of items that are outside of the scene or covered by an opaque,
+ * axis-aligned item above them */
+
+#define MAX_OCCLUDERS 8
+
+struct cull_rect {
+	float x0, y0, x1, y1;
+};
+
+static inline bool item_will_render(const struct obs_scene_item *item)
+{
+	return item->user_visible || transition_active(item->hide_transition);
+}
+
+static inline bool item_is_opaque(const struct obs_scene_item *item)
+{
+	return item->user_visible && !transition_active(item->show_transition) &&
+	       !transition_active(item->hide_transition) && default_blending_enabled(item) && !item->is_group &&
+	       obs_source_video_opaque(item->source);
+}
+
+/* gets the canvas area of the item, returns whether it is axis-aligned */
+static bool get_item_rect(const struct obs_scene_item *item, struct cull_rect *rect)
+{
+	const struct matrix4 *m = &item->draw_transform;
+	float cx = (float)calc_cx(item, obs_source_get_width(item->source));
+	float cy = (float)calc_cy(item, obs_source_get_height(item->source));
+	const float corners[4][2] = {{0.0f, 0.0f}, {cx, 0.0f}, {0.0f, cy}, {cx, cy}};
+
+	rect->x0 = rect->y0 = M_INFINITE;
+	rect->x1 = rect->y1 = -M_INFINITE;
+
+	for (size_t i = 0; i < 4; i++) {
+		struct vec3 v;
+		vec3_set(&v, corners[i][0], corners[i][1], 0.0f);
+		vec3_transform(&v, &v, m);
+
+		rect->x0 = fminf(rect->x0, v.x);
+		rect->y0 = fminf(rect->y0, v.y);
+		rect->x1 = fmaxf(rect->x1, v.x);
+		rect->y1 = fmaxf(rect->y1, v.y);
+	}
+
+	return close_float(m->x.y, 0.0f, EPSILON) && close_float(m->y.x, 0.0f, EPSILON);
+}
+
+static inline bool rect_contains(const struct cull_rect *outer, const struct cull_rect *inner)
+{
+	return inner->x0 >= outer->x0 && inner->y0 >= outer->y0 && inner->x1 <= outer->x1 && inner->y1 <= outer->y1;
+}
+
+/* assumes video lock.  walks the items from the top down, collecting the
+ * areas covered by opaque items, and marks the items that won't be visible */
+static void cull_items(struct obs_scene *scene)
+{
+	struct cull_rect occluders[MAX_OCCLUDERS];
+	struct cull_rect canvas = {0.0f, 0.0f, (float)scene_getwidth(scene), (float)scene_getheight(scene)};
+	size_t num_occluders = 0;
+	long culled = 0;
+
+	struct obs_scene_item *item = scene->first_item;
+	if (!item) {
+		os_atomic_set_long(&scene->culled_items, 0);
+		return;
+	}
+
+	while (item->next)
+		item = item->next;
+
+	for (; item; item = item->prev) {
+		struct cull_rect rect;
+		bool axis_aligned;
+
+		item->culled = false;
+		if (!item_will_render(item))
+			continue;
+
+		axis_aligned = get_item_rect(item, &rect);
+
+		/* items in groups are always within the group's area */
+		if (!scene->is_group && (rect.x1 <= canvas.x0 || rect.y1 <= canvas.y0 || rect.x0 >= canvas.x1 ||
+					 rect.y0 >= canvas.y1)) {
+			item->culled = true;
+		}
+
+		for (size_t i = 0; !item->culled && i < num_occluders; i++) {
+			if (rect_contains(&occluders[i], &rect))
+				item->culled = true;
+		}
+
+		if (item->culled) {
+			culled++;
+			continue;
+		}
+
+		if (num_occluders < MAX_OCCLUDERS && axis_aligned && item_is_opaque(item))
+			occluders[num_occluders++] = rect;
+	}
+
+	os_atomic_set_long(&scene->culled_items, culled);
+}
+
+/* hash of everything the scene's rendered output depends on, returns false if
+ * any item can change without that being reflected in the hash */
+bool obs_scene_get_video_hash(obs_scene_t *scene, uint64_t *hash)
+{
+	uint64_t h = *hash;
+	bool cacheable = true;
+
+	/* culling changes which items are drawn */
+	bool cull = os_atomic_load_bool(&obs->video.scene_item_culling);
+	h = video_hash_mix(h, &cull, sizeof(cull));
+
+	video_lock(scene);
+
+	for (struct obs_scene_item *item = scene->first_item; item; item = item->next) {
+		if (!item_will_render(item))
+			continue;
+
+		if (transition_active(item->show_transition) || transition_active(item->hide_transition)) {
+			cacheable = false;
+			break;
+		}
+
+		h = video_hash_mix(h, &item, sizeof(item));
+		h = video_hash_mix(h, &item->user_visible, sizeof(item->user_visible));
+		h = video_hash_mix(h, &item->draw_transform, sizeof(item->draw_transform));
+		h = video_hash_mix(h, &item->crop, sizeof(item->crop));
+		h = video_hash_mix(h, &item->bounds_crop, sizeof(item->bounds_crop));
+		h = video_hash_mix(h, &item->scale_filter, sizeof(item->scale_filter));
+		h = video_hash_mix(h, &item->blend_method, sizeof(item->blend_method));
+		h = video_hash_mix(h, &item->blend_type, sizeof(item->blend_type));
+
+		if (!obs_source_get_video_hash(item->source, &h)) {
+			cacheable = false;
+			break;
+		}
+	}
+
+	video_unlock(scene);
+
+	*hash = h;
+	return cacheable;
+}
+
+uint32_t obs_scene_get_culled_item_count(const obs_scene_t *scene)
+{
+	if (!obs_ptr_valid(scene, "obs_scene_get_culled_item_count"))
+		return 0;
+
+	return (uint32_t)os_atomic_load_long(&scene->culled_items);
+}
+
 static void scene_video_render(void *data, gs_effect_t *effect)
 {
 	obs_scene_item_ptr_array_t remove_items;
@@ -1071,12 +1255,18 @@ static void scene_video_render(void *data, gs_effect_t *effect)
 		update_transforms_and_prune_sources(scene, &remove_items, NULL, size_changed);
 	}
 
+	bool cull = os_atomic_load_bool(&obs->video.scene_item_culling);
+	if (cull)
+		cull_items(scene);
+	else
+		os_atomic_set_long(&scene->culled_items, 0);
+
 	gs_blend_state_push();
 	gs_reset_blend_state();
 
 	item = scene->first_item;
 	while (item) {
-		if (item->user_visible || transition_active(item->hide_transition))
+		if (item_will_render(item) && !(cull && item->culled))
 			render_item(item);
 
 		item = item->next;
@@ -1700,7 +1890,8 @@ static bool scene_audio_render(void *data, uint64_t *ts_out, struct obs_source_a
 
 		if (!source->audio_is_duplicated) {
 			for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
-				if ((mixers & (1 << mix)) == 0)
+				/* silent mixes of the child don't contribute */
+				if ((mixers & source->audio_live_mixers & (1 << mix)) == 0)
 					continue;
 
 				for (size_t ch = 0; ch < channels; ch++) {
@@ -48,7 +48,15 @@ struct obs_scene_item {
 	bool selected;
 	bool locked;
 
+	/* skipped in this frame's render, only used by scene_video_render */
+	bool culled;
+
 	gs_texrender_t *item_render;
+
+	/* item_render holds a render that stays valid until render_hash changes,
+	 * so it isn't reset every tick */
+	bool render_cached;
+	uint64_t render_hash;
 	struct obs_sceneitem_crop crop;
 
 	bool absolute_coordinates;
@@ -110,6 +118,9 @@ struct obs_scene {
 
 	int64_t id_counter;
 
+	/* items skipped by culling during the last render */
+	volatile long culled_items;
+
 	pthread_mutex_t video_mutex;
 	pthread_mutex_t audio_mutex;
 	struct obs_scene_item *first_item;
@@ -21,6 +21,7 @@
 #include "media-io/format-conversion.h"
 #include "media-io/video-frame.h"
 #include "media-io/audio-io.h"
+#include "media-io/audio-kernels.h"
 #include "util/threading.h"
 #include "util/platform.h"
 #include "util/util_uint64.h"
@@ -33,7 +34,12 @@
 
 #define get_weak(source) ((obs_weak_source_t *)source->context.control)
 
+/* must be a power of two larger than MAX_ASYNC_FRAMES */
+#define ASYNC_RING_SIZE 32
+
 static bool filter_compatible(obs_source_t *source, obs_source_t *filter);
+static inline void lock_async(struct obs_source *source);
+static void receive_async_frames(struct obs_source *source);
 
 static inline bool data_valid(const struct obs_source *source, const char *f)
 {
@@ -181,6 +187,7 @@ static bool obs_source_init(struct obs_source *source)
 	source->audio_active = true;
 	pthread_mutex_init_value(&source->filter_mutex);
 	pthread_mutex_init_value(&source->async_mutex);
+	pthread_mutex_init_value(&source->async_output_mutex);
 	pthread_mutex_init_value(&source->audio_mutex);
 	pthread_mutex_init_value(&source->audio_buf_mutex);
 	pthread_mutex_init_value(&source->audio_cb_mutex);
@@ -199,11 +206,16 @@ static bool obs_source_init(struct obs_source *source)
 		return false;
 	if (pthread_mutex_init_recursive(&source->async_mutex) != 0)
 		return false;
+	if (pthread_mutex_init(&source->async_output_mutex, NULL) != 0)
+		return false;
 	if (pthread_mutex_init(&source->caption_cb_mutex, NULL) != 0)
 		return false;
 	if (pthread_mutex_init(&source->media_actions_mutex, NULL) != 0)
 		return false;
 
+	spsc_ring_init(&source->async_ready, ASYNC_RING_SIZE);
+	spsc_ring_init(&source->async_free, ASYNC_RING_SIZE);
+
 	if (is_audio_source(source) || is_composite_source(source))
 		allocate_audio_output_buffer(source);
 	if (source->info.audio_mix)
@@ -716,6 +728,8 @@ static void obs_source_destroy_defer(struct obs_source *source)
 	da_free(source->caption_cb_list);
 	da_free(source->async_cache);
 	da_free(source->async_frames);
+	spsc_ring_free(&source->async_ready);
+	spsc_ring_free(&source->async_free);
 	da_free(source->filters);
 	da_free(source->media_actions);
 	pthread_mutex_destroy(&source->filter_mutex);
@@ -725,6 +739,7 @@ static void obs_source_destroy_defer(struct obs_source *source)
 	pthread_mutex_destroy(&source->audio_mutex);
 	pthread_mutex_destroy(&source->caption_cb_mutex);
 	pthread_mutex_destroy(&source->async_mutex);
+	pthread_mutex_destroy(&source->async_output_mutex);
 	pthread_mutex_destroy(&source->media_actions_mutex);
 	obs_data_release(source->private_settings);
 	obs_context_data_free(&source->context);
@@ -954,6 +969,7 @@ static void obs_source_deferred_update(obs_source_t *source)
 		long count = os_atomic_load_long(&source->defer_update_count);
 		source->info.update(source->context.data, source->context.settings);
 		os_atomic_compare_swap_long(&source->defer_update_count, count, 0);
+		os_atomic_inc_long(&source->video_gen);
 		obs_source_dosignal(source, "source_update", "update");
 	}
 }
@@ -1224,7 +1240,8 @@ static void async_tick(obs_source_t *source)
 {
 	uint64_t sys_time = obs->video.video_time;
 
-	pthread_mutex_lock(&source->async_mutex);
+	lock_async(source);
+	receive_async_frames(source);
 
 	if (deinterlacing_enabled(source)) {
 		deinterlace_process_last_frame(source, sys_time);
@@ -1249,13 +1266,13 @@ static void async_tick(obs_source_t *source)
 	pthread_mutex_unlock(&source->async_mutex);
 }
 
-void obs_source_video_tick(obs_source_t *source, float seconds)
+/* everything that happens in a video tick besides the source's own video_tick
+ * callback, which tick_sources may call on another thread.  returns whether
+ * the callback needs to be called */
+bool obs_source_video_tick_begin(obs_source_t *source, float seconds)
 {
 	bool now_showing, now_active;
 
-	if (!obs_source_valid(source, "obs_source_video_tick"))
-		return;
-
 	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION)
 		obs_transition_tick(source, seconds);
 
@@ -1318,11 +1335,19 @@ void obs_source_video_tick(obs_source_t *source, float seconds)
 		source->active = now_active;
 	}
 
-	if (source->context.data && source->info.video_tick)
-		source->info.video_tick(source->context.data, seconds);
-
 	source->async_rendered = false;
 	source->deinterlace_rendered = false;
+
+	return source->context.data && source->info.video_tick;
+}
+
+void obs_source_video_tick(obs_source_t *source, float seconds)
+{
+	if (!obs_source_valid(source, "obs_source_video_tick"))
+		return;
+
+	if (obs_source_video_tick_begin(source, seconds))
+		source->info.video_tick(source->context.data, seconds);
 }
 
 /* unless the value is 3+ hours worth of frames, this won't overflow */
@@ -2852,6 +2877,89 @@ void obs_source_video_render(obs_source_t *source)
 	}
 }
 
+/* whether rendering the source is known to fill its whole area with fully
+ * opaque pixels.  filters may add transparency, so filtered sources never
+ * count as opaque. */
+bool obs_source_video_opaque(const obs_source_t *source)
+{
+	uint32_t flags = source->info.output_flags;
+
+	if (!source->context.data || !source->enabled || source->filters.num)
+		return false;
+	if ((flags & OBS_SOURCE_VIDEO) == 0)
+		return false;
+	if ((flags & OBS_SOURCE_OPAQUE) != 0 || os_atomic_load_bool(&source->video_opaque))
+		return true;
+
+	if (source->info.type == OBS_SOURCE_TYPE_INPUT && (flags & OBS_SOURCE_ASYNC) != 0 &&
+	    !source->info.video_render)
+		return source->async_active && source->async_textures[0] && !format_has_alpha(source->async_format);
+
+	return false;
+}
+
+void obs_source_set_video_opaque(obs_source_t *source, bool opaque)
+{
+	if (!obs_source_valid(source, "obs_source_set_video_opaque"))
+		return;
+
+	/* which items a scene culls can change with it */
+	if (os_atomic_exchange_bool(&source->video_opaque, opaque) != opaque)
+		os_atomic_inc_long(&source->video_gen);
+}
+
+void obs_source_mark_video_changed(obs_source_t *source)
+{
+	if (!obs_source_valid(source, "obs_source_mark_video_changed"))
+		return;
+
+	os_atomic_inc_long(&source->video_gen);
+}
+
+/* computes a hash of everything the source's rendered video depends on.
+ * returns false if the video can change without the hash changing. */
+bool obs_source_get_video_hash(obs_source_t *source, uint64_t *hash)
+{
+	uint32_t flags = source->info.output_flags;
+	uint64_t h = video_hash_mix(*hash, &source, sizeof(source));
+	bool cacheable = true;
+
+	if (source->info.type == OBS_SOURCE_TYPE_SCENE) {
+		if (!obs_scene_get_video_hash(source->context.data, &h))
+			return false;
+	} else if ((flags & OBS_SOURCE_VIDEO) != 0 && (flags & OBS_SOURCE_CACHEABLE_VIDEO) == 0) {
+		return false;
+	}
+
+	long gen = os_atomic_load_long(&source->video_gen);
+	uint32_t size[2] = {obs_source_get_width(source), obs_source_get_height(source)};
+	h = video_hash_mix(h, &gen, sizeof(gen));
+	h = video_hash_mix(h, &source->enabled, sizeof(source->enabled));
+	h = video_hash_mix(h, size, sizeof(size));
+
+	pthread_mutex_lock(&source->filter_mutex);
+	for (size_t i = 0; i < source->filters.num; i++) {
+		obs_source_t *filter = source->filters.array[i];
+		uint32_t filter_flags = filter->info.output_flags;
+
+		if ((filter_flags & OBS_SOURCE_VIDEO) == 0)
+			continue;
+		if ((filter_flags & OBS_SOURCE_CACHEABLE_VIDEO) == 0) {
+			cacheable = false;
+			break;
+		}
+
+		gen = os_atomic_load_long(&filter->video_gen);
+		h = video_hash_mix(h, &filter, sizeof(filter));
+		h = video_hash_mix(h, &gen, sizeof(gen));
+		h = video_hash_mix(h, &filter->enabled, sizeof(filter->enabled));
+	}
+	pthread_mutex_unlock(&source->filter_mutex);
+
+	*hash = h;
+	return cacheable;
+}
+
 static uint32_t get_recurse_width(obs_source_t *source)
 {
 	uint32_t width;
@@ -3367,8 +3475,14 @@ static inline bool async_texture_changed(struct obs_source *source, const struct
 	return source->async_cache_width != frame->width || source->async_cache_height != frame->height || prev != cur;
 }
 
+/* both async_output_mutex and async_mutex must be held */
 static inline void free_async_cache(struct obs_source *source)
 {
+	while (spsc_ring_pop(&source->async_ready))
+		;
+	while (spsc_ring_pop(&source->async_free))
+		;
+
 	for (size_t i = 0; i < source->async_cache.num; i++)
 		obs_source_frame_decref(source->async_cache.array[i].frame);
 
@@ -3378,40 +3492,92 @@ static inline void free_async_cache(struct obs_source *source)
 	source->prev_async_frame = NULL;
 }
 
-#define MAX_UNUSED_FRAME_DURATION 5
+/* counts how often the graphics thread and frame producers actually had to
+ * wait for each other */
+static inline void lock_async(struct obs_source *source)
+{
+	if (pthread_mutex_trylock(&source->async_mutex) != 0) {
+		os_atomic_inc_long(&source->async_lock_waits);
+		pthread_mutex_lock(&source->async_mutex);
+	}
+}
+
+#define MAX_ASYNC_FRAMES 30
+#define MAX_UNUSED_ASYNC_FRAMES 4
+
+static inline size_t find_async_frame(struct obs_source *source, const struct obs_source_frame *frame)
+{
+	for (size_t i = 0; i < source->async_cache.num; i++) {
+		if (source->async_cache.array[i].frame == frame)
+			return i;
+	}
+
+	return DARRAY_INVALID;
+}
 
-/* frees frame allocations if they haven't been used for a specific period
- * of time */
-static void clean_cache(obs_source_t *source)
+/* hands a frame that is no longer used back to the producers, or frees it if
+ * enough frames are waiting for reuse already.  async_mutex must be held. */
+static void recycle_async_frame(struct obs_source *source, size_t idx)
 {
-	for (size_t i = source->async_cache.num; i > 0; i--) {
-		struct async_frame *af = &source->async_cache.array[i - 1];
-		if (!af->used) {
-			if (++af->unused_count == MAX_UNUSED_FRAME_DURATION) {
-				obs_source_frame_destroy(af->frame);
-				da_erase(source->async_cache, i - 1);
+	struct async_frame *af = &source->async_cache.array[idx];
+
+	af->used = false;
+
+	if (spsc_ring_count(&source->async_free) >= MAX_UNUSED_ASYNC_FRAMES ||
+	    !spsc_ring_push(&source->async_free, af->frame)) {
+		obs_source_frame_decref(af->frame);
+		da_erase(source->async_cache, idx);
+	}
+}
+
+/* moves frames that were output since the last tick to async_frames.
+ * async_mutex must be held. */
+static void receive_async_frames(struct obs_source *source)
+{
+	struct obs_source_frame *frame;
+
+	while ((frame = spsc_ring_pop(&source->async_ready)) != NULL) {
+		size_t idx = find_async_frame(source, frame);
+		if (idx != DARRAY_INVALID)
+			source->async_cache.array[idx].used = true;
+
+		/* not keeping up, start over from the newest frame */
+		if (source->async_frames.num >= MAX_ASYNC_FRAMES) {
+			for (size_t i = 0; i < source->async_frames.num; i++) {
+				remove_async_frame(source, source->async_frames.array[i]);
+				os_atomic_inc_long(&source->async_frames_dropped);
 			}
+
+			da_resize(source->async_frames, 0);
+			source->last_frame_ts = 0;
 		}
+
+		da_push_back(source->async_frames, &frame);
 	}
 }
 
-#define MAX_ASYNC_FRAMES 30
-//if return value is not null then do (os_atomic_dec_long(&output->refs) == 0) && obs_source_frame_destroy(output)
-static inline struct obs_source_frame *cache_video(struct obs_source *source, const struct obs_source_frame *frame)
+/* gets an unused frame from the async cache, or allocates one, for frames of
+ * the given layout.  async_output_mutex must be held.
+ * if return value is not null then do (os_atomic_dec_long(&output->refs) == 0) && obs_source_frame_destroy(output) */
+static struct obs_source_frame *get_cached_frame(struct obs_source *source, const struct obs_source_frame *frame)
 {
-	struct obs_source_frame *new_frame = NULL;
-
-	pthread_mutex_lock(&source->async_mutex);
+	struct obs_source_frame *new_frame;
 
-	if (source->async_frames.num >= MAX_ASYNC_FRAMES) {
+	if (spsc_ring_count(&source->async_ready) >= MAX_ASYNC_FRAMES) {
+		lock_async(source);
 		free_async_cache(source);
 		source->last_frame_ts = 0;
 		pthread_mutex_unlock(&source->async_mutex);
+
+		os_atomic_inc_long(&source->async_frames_dropped);
 		return NULL;
 	}
 
 	if (async_texture_changed(source, frame)) {
+		lock_async(source);
 		free_async_cache(source);
+		pthread_mutex_unlock(&source->async_mutex);
+
 		source->async_cache_width = frame->width;
 		source->async_cache_height = frame->height;
 	}
@@ -3421,38 +3587,50 @@ static inline struct obs_source_frame *cache_video(struct obs_source *source, co
 	source->async_cache_full_range = frame->full_range;
 	source->async_cache_trc = frame->trc;
 
-	for (size_t i = 0; i < source->async_cache.num; i++) {
-		struct async_frame *af = &source->async_cache.array[i];
-		if (!af->used) {
-			new_frame = af->frame;
-			new_frame->format = format;
-			af->used = true;
-			af->unused_count = 0;
-			break;
-		}
-	}
-
-	clean_cache(source);
+	new_frame = spsc_ring_pop(&source->async_free);
 
-	if (!new_frame) {
+	if (new_frame) {
+		new_frame->format = format;
+	} else {
 		struct async_frame new_af;
 
 		new_frame = obs_source_frame_create(format, frame->width, frame->height);
 		new_af.frame = new_frame;
-		new_af.used = true;
-		new_af.unused_count = 0;
+		new_af.used = false;
 		new_frame->refs = 1;
 
+		lock_async(source);
 		da_push_back(source->async_cache, &new_af);
+		pthread_mutex_unlock(&source->async_mutex);
 	}
 
 	os_atomic_inc_long(&new_frame->refs);
+	return new_frame;
+}
 
-	pthread_mutex_unlock(&source->async_mutex);
+/* async_output_mutex must be held */
+static void queue_async_frame(struct obs_source *source, struct obs_source_frame *output)
+{
+	if (!output)
+		return;
 
-	copy_frame_data(new_frame, frame);
+	if (os_atomic_dec_long(&output->refs) == 0) {
+		obs_source_frame_destroy(output);
+		return;
+	}
 
-	return new_frame;
+	if (!spsc_ring_push(&source->async_ready, output)) {
+		lock_async(source);
+		size_t idx = find_async_frame(source, output);
+		if (idx != DARRAY_INVALID)
+			recycle_async_frame(source, idx);
+		pthread_mutex_unlock(&source->async_mutex);
+
+		os_atomic_inc_long(&source->async_frames_dropped);
+		return;
+	}
+
+	source->async_active = true;
 }
 
 static void obs_source_output_video_internal(obs_source_t *source, const struct obs_source_frame *frame)
@@ -3461,30 +3639,28 @@ static void obs_source_output_video_internal(obs_source_t *source, const struct
 		return;
 
 	if (!frame) {
-		pthread_mutex_lock(&source->async_mutex);
+		pthread_mutex_lock(&source->async_output_mutex);
+		lock_async(source);
 		source->async_active = false;
 		source->last_frame_ts = 0;
 		free_async_cache(source);
 		pthread_mutex_unlock(&source->async_mutex);
+		pthread_mutex_unlock(&source->async_output_mutex);
 		return;
 	}
 
 	source_profiler_async_frame_received(source);
 
-	struct obs_source_frame *output = cache_video(source, frame);
+	pthread_mutex_lock(&source->async_output_mutex);
+
+	struct obs_source_frame *output = get_cached_frame(source, frame);
+	if (output)
+		copy_frame_data(output, frame);
 
 	/* ------------------------------------------- */
-	pthread_mutex_lock(&source->async_mutex);
-	if (output) {
-		if (os_atomic_dec_long(&output->refs) == 0) {
-			obs_source_frame_destroy(output);
-			output = NULL;
-		} else {
-			da_push_back(source->async_frames, &output);
-			source->async_active = true;
-		}
-	}
-	pthread_mutex_unlock(&source->async_mutex);
+	queue_async_frame(source, output);
+
+	pthread_mutex_unlock(&source->async_output_mutex);
 }
 
 void obs_source_output_video(obs_source_t *source, const struct obs_source_frame *frame)
@@ -3536,6 +3712,65 @@ void obs_source_output_video2(obs_source_t *source, const struct obs_source_fram
 	obs_source_output_video_internal(source, &new_frame);
 }
 
+struct obs_source_frame *obs_source_borrow_frame(obs_source_t *source, enum video_format format, uint32_t width,
+					       uint32_t height)
+{
+	struct obs_source_frame *frame;
+
+	if (!obs_source_valid(source, "obs_source_borrow_frame"))
+		return NULL;
+	if (destroying(source))
+		return NULL;
+
+	pthread_mutex_lock(&source->async_output_mutex);
+
+	/* assume the range and transfer of the previous frames so borrowing
+	 * doesn't invalidate the cache, they are updated on output */
+	struct obs_source_frame layout = {
+		.format = format,
+		.width = width,
+		.height = height,
+		.full_range = source->async_cache_full_range,
+		.trc = source->async_cache_trc,
+	};
+
+	frame = get_cached_frame(source, &layout);
+	pthread_mutex_unlock(&source->async_output_mutex);
+
+	if (frame) {
+		frame->timestamp = 0;
+		frame->flip = false;
+		frame->flags = 0;
+		frame->max_luminance = 0;
+	}
+
+	return frame;
+}
+
+void obs_source_output_borrowed_frame(obs_source_t *source, struct obs_source_frame *frame)
+{
+	if (!obs_source_valid(source, "obs_source_output_borrowed_frame"))
+		return;
+	if (!obs_ptr_valid(frame, "obs_source_output_borrowed_frame"))
+		return;
+
+	if (destroying(source)) {
+		obs_source_release_frame(source, frame);
+		return;
+	}
+
+	if (!format_is_yuv(frame->format))
+		frame->full_range = true;
+
+	source_profiler_async_frame_received(source);
+
+	pthread_mutex_lock(&source->async_output_mutex);
+	source->async_cache_full_range = frame->full_range;
+	source->async_cache_trc = frame->trc;
+	queue_async_frame(source, frame);
+	pthread_mutex_unlock(&source->async_output_mutex);
+}
+
 void obs_source_set_async_rotation(obs_source_t *source, long rotation)
 {
 	if (source)
@@ -3964,17 +4199,14 @@ void obs_source_output_audio(obs_source_t *source, const struct obs_source_audio
 
 void remove_async_frame(obs_source_t *source, struct obs_source_frame *frame)
 {
-	if (frame)
-		frame->prev_frame = false;
+	if (!frame)
+		return;
 
-	for (size_t i = 0; i < source->async_cache.num; i++) {
-		struct async_frame *f = &source->async_cache.array[i];
+	frame->prev_frame = false;
 
-		if (f->frame == frame) {
-			f->used = false;
-			break;
-		}
-	}
+	size_t idx = find_async_frame(source, frame);
+	if (idx != DARRAY_INVALID && source->async_cache.array[idx].used)
+		recycle_async_frame(source, idx);
 }
 
 /* #define DEBUG_ASYNC_FRAMES 1 */
@@ -4098,7 +4330,7 @@ struct obs_source_frame *obs_source_get_frame(obs_source_t *source)
 	if (!obs_source_valid(source, "obs_source_get_frame"))
 		return NULL;
 
-	pthread_mutex_lock(&source->async_mutex);
+	lock_async(source);
 
 	frame = source->cur_async_frame;
 	source->cur_async_frame = NULL;
@@ -4120,12 +4352,19 @@ void obs_source_release_frame(obs_source_t *source, struct obs_source_frame *fra
 	if (!source) {
 		obs_source_frame_destroy(frame);
 	} else {
-		pthread_mutex_lock(&source->async_mutex);
+		lock_async(source);
 
-		if (os_atomic_dec_long(&frame->refs) == 0)
+		if (os_atomic_dec_long(&frame->refs) == 0) {
 			obs_source_frame_destroy(frame);
-		else
-			remove_async_frame(source, frame);
+		} else {
+			/* borrowed frames that were never output aren't
+			 * marked as used yet */
+			size_t idx = find_async_frame(source, frame);
+			if (idx != DARRAY_INVALID && !source->async_cache.array[idx].used)
+				recycle_async_frame(source, idx);
+			else
+				remove_async_frame(source, frame);
+		}
 
 		pthread_mutex_unlock(&source->async_mutex);
 	}
@@ -5109,23 +5348,14 @@ static float get_source_volume(obs_source_t *source, uint64_t os_time)
 
 static inline void multiply_output_audio(obs_source_t *source, size_t mix, size_t channels, float vol)
 {
-	register float *out = source->audio_output_buf[mix][0];
-	register float *end = out + AUDIO_OUTPUT_FRAMES * channels;
-
-	while (out < end)
-		*(out++) *= vol;
+	/* channel buffers of a mix are contiguous */
+	audio_kernels->gain(source->audio_output_buf[mix][0], vol, AUDIO_OUTPUT_FRAMES * channels);
 }
 
 static inline void multiply_vol_data(obs_source_t *source, size_t mix, size_t channels, float *vol_data)
 {
-	for (size_t ch = 0; ch < channels; ch++) {
-		register float *out = source->audio_output_buf[mix][ch];
-		register float *end = out + AUDIO_OUTPUT_FRAMES;
-		register float *vol = vol_data;
-
-		while (out < end)
-			*(out++) *= *(vol++);
-	}
+	for (size_t ch = 0; ch < channels; ch++)
+		audio_kernels->gain_ramp(source->audio_output_buf[mix][ch], vol_data, AUDIO_OUTPUT_FRAMES);
 }
 
 static inline void apply_audio_action(obs_source_t *source, const struct audio_action *action)
@@ -5146,7 +5376,7 @@ static inline void apply_audio_action(obs_source_t *source, const struct audio_a
 	}
 }
 
-static void apply_audio_actions(obs_source_t *source, size_t channels, size_t sample_rate)
+static void apply_audio_actions(obs_source_t *source, uint32_t mixers, size_t channels, size_t sample_rate)
 {
 	float vol_data[AUDIO_OUTPUT_FRAMES];
 	float cur_vol = get_source_volume(source, source->audio_ts);
@@ -5185,11 +5415,36 @@ static void apply_audio_actions(obs_source_t *source, size_t channels, size_t sa
 	pthread_mutex_unlock(&source->audio_actions_mutex);
 
 	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
-		if ((source->audio_mixers & (1 << mix)) != 0)
+		if ((source->audio_live_mixers & mixers & (1 << mix)) != 0)
 			multiply_vol_data(source, mix, channels, vol_data);
 	}
 }
 
+static void clear_live_audio_mixes(obs_source_t *source, uint32_t keep_mixers, size_t channels)
+{
+	uint32_t clear_mixers = source->audio_live_mixers & ~keep_mixers;
+
+	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
+		if ((clear_mixers & (1 << mix)) != 0)
+			memset(source->audio_output_buf[mix][0], 0, sizeof(float) * AUDIO_OUTPUT_FRAMES * channels);
+	}
+
+	source->audio_live_mixers &= keep_mixers;
+}
+
+static inline void count_audio_mixes(uint32_t mixers)
+{
+	uint64_t processed = 0;
+
+	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
+		if ((mixers & (1 << mix)) != 0)
+			processed++;
+	}
+
+	obs->audio.tick_processed_mixes += processed;
+	obs->audio.tick_skipped_mixes += MAX_AUDIO_MIXES - processed;
+}
+
 static void apply_audio_volume(obs_source_t *source, uint32_t mixers, size_t channels, size_t sample_rate)
 {
 	struct audio_action action;
@@ -5208,7 +5463,7 @@ static void apply_audio_volume(obs_source_t *source, uint32_t mixers, size_t cha
 		uint64_t duration = conv_frames_to_time(sample_rate, AUDIO_OUTPUT_FRAMES);
 
 		if (action.timestamp < (source->audio_ts + duration)) {
-			apply_audio_actions(source, channels, sample_rate);
+			apply_audio_actions(source, mixers, channels, sample_rate);
 			return;
 		}
 	}
@@ -5218,14 +5473,13 @@ static void apply_audio_volume(obs_source_t *source, uint32_t mixers, size_t cha
 		return;
 
 	if (vol == 0.0f || mixers == 0) {
-		memset(source->audio_output_buf[0][0], 0,
-		       AUDIO_OUTPUT_FRAMES * sizeof(float) * MAX_AUDIO_CHANNELS * MAX_AUDIO_MIXES);
+		/* mixes that aren't live are already silent */
+		clear_live_audio_mixes(source, 0, channels);
 		return;
 	}
 
 	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
-		uint32_t mix_and_val = (1 << mix);
-		if ((source->audio_mixers & mix_and_val) != 0 && (mixers & mix_and_val) != 0)
+		if ((source->audio_live_mixers & mixers & (1 << mix)) != 0)
 			multiply_output_audio(source, mix, channels, vol);
 	}
 }
@@ -5250,6 +5504,9 @@ static void custom_audio_render(obs_source_t *source, uint32_t mixers, size_t ch
 	source->audio_ts = success ? ts : 0;
 	source->audio_pending = !success;
 
+	/* the source may have written to any mix it was asked for */
+	source->audio_live_mixers |= mixers;
+
 	if (!success || !source->audio_ts || !mixers)
 		return;
 
@@ -5315,33 +5572,37 @@ static inline void process_audio_source_tick(obs_source_t *source, uint32_t mixe
 
 	pthread_mutex_unlock(&source->audio_buf_mutex);
 
-	for (size_t mix = 1; mix < MAX_AUDIO_MIXES; mix++) {
-		uint32_t mix_and_val = (1 << mix);
+	if (audio_submix) {
+		/* submix consumers read mix 1 regardless of what is connected
+		 * to the outputs, so only the source's own track 1 gates it */
+		if ((source->audio_mixers & 1) == 0) {
+			memset(source->audio_output_buf[1][0], 0, size * channels);
+		} else {
+			for (size_t ch = 0; ch < channels; ch++)
+				memcpy(source->audio_output_buf[1][ch], source->audio_output_buf[0][ch], size);
+		}
 
-		if (audio_submix) {
-			if (mix > 1)
-				break;
+		source->audio_live_mixers |= (1 << 0) | (1 << 1);
+		source->audio_pending = false;
+		return;
+	}
 
-			mixers = 1;
-			mix_and_val = 1;
-		}
+	/* only fill the mixes the source is routed to and that something is
+	 * connected to, everything else just needs to stay silent */
+	uint32_t render_mixers = source->audio_mixers & mixers;
+	source->audio_live_mixers |= 1;
+	clear_live_audio_mixes(source, render_mixers, channels);
 
-		if ((source->audio_mixers & mix_and_val) == 0 || (mixers & mix_and_val) == 0) {
-			memset(source->audio_output_buf[mix][0], 0, size * channels);
+	for (size_t mix = 1; mix < MAX_AUDIO_MIXES; mix++) {
+		if ((render_mixers & (1 << mix)) == 0)
 			continue;
-		}
 
 		for (size_t ch = 0; ch < channels; ch++)
 			memcpy(source->audio_output_buf[mix][ch], source->audio_output_buf[0][ch], size);
 	}
 
-	if (audio_submix) {
-		source->audio_pending = false;
-		return;
-	}
-
-	if ((source->audio_mixers & 1) == 0 || (mixers & 1) == 0)
-		memset(source->audio_output_buf[0][0], 0, size * channels);
+	source->audio_live_mixers = render_mixers;
+	count_audio_mixes(render_mixers);
 
 	apply_audio_volume(source, mixers, channels, sample_rate);
 	source->audio_pending = false;
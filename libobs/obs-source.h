@@ -208,6 +208,37 @@ enum obs_media_state {
  */
 #define OBS_SOURCE_REQUIRES_CANVAS (1 << 17)
 
+/**
+ * Source's video_tick callback can be called on a thread other than the
+ * graphics thread, concurrently with the ticks of other sources.
+ *
+ * Only used when enabled with obs_set_parallel_source_ticks.  The callback
+ * must not use other sources, and may only use the graphics subsystem inside
+ * obs_enter_graphics/obs_leave_graphics.
+ */
+#define OBS_SOURCE_TICK_THREAD_SAFE (1 << 18)
+
+/**
+ * Source's video always covers its whole width and height with fully opaque
+ * pixels.
+ *
+ * Lets scenes skip drawing the items it covers when scene item culling is
+ * enabled with obs_set_scene_item_culling.  Async sources don't need this
+ * flag, their current frame format is checked instead.  Sources that are only
+ * opaque with some settings use obs_source_set_video_opaque instead.
+ */
+#define OBS_SOURCE_OPAQUE (1 << 19)
+
+/**
+ * Source's video only changes when its settings are updated, or when it calls
+ * obs_source_mark_video_changed.
+ *
+ * Lets scenes keep the rendered output of nested scenes made of such sources
+ * until something in them changes.  For filters, the output must also only
+ * depend on the input.
+ */
+#define OBS_SOURCE_CACHEABLE_VIDEO (1 << 20)
+
 /** @} */
 
 typedef void (*obs_source_enum_proc_t)(obs_source_t *parent, obs_source_t *child, void *param);
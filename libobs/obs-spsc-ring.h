@@ -0,0 +1,74 @@
+#pragma once
+
+#include "util/bmem.h"
+#include "util/threading.h"
+
+/*
+ * Bounded single-producer/single-consumer queue of pointers.
+ *
+ * Pushing and popping don't take any locks: each side only writes its own
+ * index and reads the other one.  If more than one thread can be on the same
+ * side, those threads have to be serialized by the caller (the two sides
+ * still never wait on each other).  A ring of size N holds up to N - 1 items.
+ */
+
+struct spsc_ring {
+	void **items;
+	long mask;
+
+	/* written by the producer */
+	volatile long head;
+	/* written by the consumer */
+	volatile long tail;
+};
+
+/* size must be a power of two */
+static inline void spsc_ring_init(struct spsc_ring *ring, size_t size)
+{
+	ring->items = bzalloc(size * sizeof(void *));
+	ring->mask = (long)size - 1;
+	ring->head = 0;
+	ring->tail = 0;
+}
+
+static inline void spsc_ring_free(struct spsc_ring *ring)
+{
+	bfree(ring->items);
+	ring->items = NULL;
+	ring->mask = 0;
+}
+
+static inline size_t spsc_ring_count(const struct spsc_ring *ring)
+{
+	long head = os_atomic_load_long(&ring->head);
+	long tail = os_atomic_load_long(&ring->tail);
+	return (size_t)((head - tail) & ring->mask);
+}
+
+/* returns false if the ring is full */
+static inline bool spsc_ring_push(struct spsc_ring *ring, void *item)
+{
+	long head = os_atomic_load_long(&ring->head);
+	long next = (head + 1) & ring->mask;
+
+	if (next == os_atomic_load_long(&ring->tail))
+		return false;
+
+	ring->items[head] = item;
+	os_atomic_store_long(&ring->head, next);
+	return true;
+}
+
+/* returns NULL if the ring is empty */
+static inline void *spsc_ring_pop(struct spsc_ring *ring)
+{
+	long tail = os_atomic_load_long(&ring->tail);
+	void *item;
+
+	if (tail == os_atomic_load_long(&ring->head))
+		return NULL;
+
+	item = ring->items[tail];
+	os_atomic_store_long(&ring->tail, (tail + 1) & ring->mask);
+	return item;
+}
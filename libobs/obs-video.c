@@ -29,8 +29,178 @@
 #include <windows.h>
 #endif
 
+#define MAX_TICK_WORKERS 8
+
+static void run_tick_jobs(struct obs_tick_pool *pool)
+{
+	const long num = (long)pool->sources.num;
+	long i;
+
+	while ((i = os_atomic_inc_long(&pool->next_source) - 1) < num) {
+		obs_source_t *s = pool->sources.array[i];
+		const uint64_t start = source_profiler_source_tick_start();
+
+		s->info.video_tick(s->context.data, pool->seconds);
+
+		if (start)
+			pool->tick_times.array[i] += os_gettime_ns() - start;
+	}
+}
+
+static void *tick_worker_thread(void *param)
+{
+	struct obs_tick_pool *pool = param;
+
+	os_set_thread_name("libobs: source tick thread");
+
+	while (os_sem_wait(pool->start_sem) == 0) {
+		if (pool->stop)
+			break;
+
+		run_tick_jobs(pool);
+
+		if (os_atomic_dec_long(&pool->busy_workers) == 0)
+			os_event_signal(pool->done_event);
+	}
+
+	return NULL;
+}
+
+static void tick_pool_stop(struct obs_tick_pool *pool)
+{
+	pool->stop = true;
+
+	for (size_t i = 0; i < pool->threads.num; i++)
+		os_sem_post(pool->start_sem);
+	for (size_t i = 0; i < pool->threads.num; i++)
+		pthread_join(pool->threads.array[i], NULL);
+
+	da_resize(pool->threads, 0);
+	os_sem_destroy(pool->start_sem);
+	os_event_destroy(pool->done_event);
+	pool->start_sem = NULL;
+	pool->done_event = NULL;
+}
+
+static void tick_pool_start(struct obs_tick_pool *pool)
+{
+	int cores = os_get_logical_cores();
+	size_t num = cores > 2 ? (size_t)cores - 1 : 1;
+
+	if (num > MAX_TICK_WORKERS)
+		num = MAX_TICK_WORKERS;
+
+	pool->stop = false;
+
+	if (os_sem_init(&pool->start_sem, 0) != 0)
+		goto fail;
+	if (os_event_init(&pool->done_event, OS_EVENT_TYPE_AUTO) != 0)
+		goto fail;
+
+	for (size_t i = 0; i < num; i++) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, tick_worker_thread, pool) != 0)
+			break;
+		da_push_back(pool->threads, &thread);
+	}
+
+	if (!pool->threads.num)
+		goto fail;
+
+	blog(LOG_INFO, "Ticking thread-safe sources on %zu worker threads", pool->threads.num);
+	return;
+
+fail:
+	blog(LOG_WARNING, "Failed to start source tick threads, ticking all sources on the graphics thread");
+	tick_pool_stop(pool);
+	os_atomic_set_bool(&obs->video.parallel_ticks, false);
+}
+
+static void tick_pool_free(void)
+{
+	struct obs_tick_pool *pool = &obs->video.tick_pool;
+
+	if (pool->threads.num)
+		tick_pool_stop(pool);
+
+	da_free(pool->threads);
+	da_free(pool->sources);
+	da_free(pool->tick_times);
+}
+
+/* calls the video_tick callbacks in the pool, the graphics thread works on
+ * them too until all are done */
+static void run_tick_pool(struct obs_tick_pool *pool, float seconds)
+{
+	size_t workers = pool->sources.num - 1;
+
+	if (workers > pool->threads.num)
+		workers = pool->threads.num;
+
+	pool->seconds = seconds;
+	os_atomic_set_long(&pool->next_source, 0);
+	os_atomic_set_long(&pool->busy_workers, (long)workers + 1);
+
+	for (size_t i = 0; i < workers; i++)
+		os_sem_post(pool->start_sem);
+
+	run_tick_jobs(pool);
+
+	if (os_atomic_dec_long(&pool->busy_workers) != 0)
+		os_event_wait(pool->done_event);
+}
+
+static inline bool tick_thread_safe(const struct obs_source *source)
+{
+	return (source->info.output_flags & OBS_SOURCE_TICK_THREAD_SAFE) != 0;
+}
+
+/* sources flagged as thread-safe are ticked first, the video_tick callbacks
+ * of those run concurrently.  the remaining sources are then ticked one after
+ * another as usual. */
+static void tick_sources_parallel(struct obs_tick_pool *pool, float seconds)
+{
+	struct obs_core_data *data = &obs->data;
+
+	da_clear(pool->sources);
+	da_clear(pool->tick_times);
+
+	for (size_t i = 0; i < data->sources_to_tick.num; i++) {
+		obs_source_t *s = data->sources_to_tick.array[i];
+		if (!tick_thread_safe(s))
+			continue;
+
+		const uint64_t start = source_profiler_source_tick_start();
+
+		if (obs_source_video_tick_begin(s, seconds)) {
+			uint64_t begin_time = start ? os_gettime_ns() - start : 0;
+			da_push_back(pool->sources, &s);
+			da_push_back(pool->tick_times, &begin_time);
+		} else {
+			source_profiler_source_tick_end(s, start);
+		}
+	}
+
+	if (pool->sources.num)
+		run_tick_pool(pool, seconds);
+
+	for (size_t i = 0; i < pool->sources.num; i++)
+		source_profiler_source_tick_time(pool->sources.array[i], pool->tick_times.array[i]);
+
+	for (size_t i = 0; i < data->sources_to_tick.num; i++) {
+		obs_source_t *s = data->sources_to_tick.array[i];
+		if (tick_thread_safe(s))
+			continue;
+
+		const uint64_t start = source_profiler_source_tick_start();
+		obs_source_video_tick(s, seconds);
+		source_profiler_source_tick_end(s, start);
+	}
+}
+
 static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 {
+	struct obs_tick_pool *pool = &obs->video.tick_pool;
 	struct obs_core_data *data = &obs->data;
 	struct obs_source *source;
 	uint64_t delta_time;
@@ -75,14 +245,26 @@ static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 	/* ------------------------------------- */
 	/* call the tick function of each source */
 
-	for (size_t i = 0; i < data->sources_to_tick.num; i++) {
-		obs_source_t *s = data->sources_to_tick.array[i];
-		const uint64_t start = source_profiler_source_tick_start();
-		obs_source_video_tick(s, seconds);
-		source_profiler_source_tick_end(s, start);
-		obs_source_release(s);
+	const bool parallel = os_atomic_load_bool(&obs->video.parallel_ticks);
+	if (parallel && !pool->threads.num)
+		tick_pool_start(pool);
+	else if (!parallel && pool->threads.num)
+		tick_pool_stop(pool);
+
+	if (pool->threads.num) {
+		tick_sources_parallel(pool, seconds);
+	} else {
+		for (size_t i = 0; i < data->sources_to_tick.num; i++) {
+			obs_source_t *s = data->sources_to_tick.array[i];
+			const uint64_t start = source_profiler_source_tick_start();
+			obs_source_video_tick(s, seconds);
+			source_profiler_source_tick_end(s, start);
+		}
 	}
 
+	for (size_t i = 0; i < data->sources_to_tick.num; i++)
+		obs_source_release(data->sources_to_tick.array[i]);
+
 	return cur_time;
 }
 
@@ -802,6 +984,46 @@ void add_ready_encoder_group(obs_encoder_t *encoder)
 	pthread_mutex_unlock(&obs->video.encoder_group_mutex);
 }
 
+/* don't write lag traces more often than this */
+#define LAG_TRACE_INTERVAL_NS 10000000000ULL
+
+static const char *lagged_frame_name = "lagged frame";
+
+static void write_lag_trace(void *param)
+{
+	struct obs_core_video *video = param;
+	char *path;
+
+	pthread_mutex_lock(&video->lag_trace_mutex);
+	path = bstrdup(video->lag_trace_path);
+	pthread_mutex_unlock(&video->lag_trace_mutex);
+
+	if (path) {
+		if (profiler_trace_dump_json(path))
+			blog(LOG_INFO, "Lagged frame, wrote timeline trace to '%s'", path);
+		else
+			blog(LOG_WARNING, "Lagged frame, failed to write timeline trace to '%s'", path);
+	}
+
+	bfree(path);
+}
+
+static inline void trace_lagged_frame(struct obs_core_video *video, uint64_t time)
+{
+	if (!profiler_trace_active())
+		return;
+
+	profile_trace_instant(lagged_frame_name);
+
+	if (!os_atomic_load_bool(&video->lag_trace_enabled))
+		return;
+	if (video->last_lag_trace_time && time - video->last_lag_trace_time < LAG_TRACE_INTERVAL_NS)
+		return;
+
+	video->last_lag_trace_time = time;
+	obs_queue_task(OBS_TASK_DESTROY, write_lag_trace, video, false);
+}
+
 static inline void video_sleep(struct obs_core_video *video, uint64_t *p_time, uint64_t interval_ns)
 {
 	struct obs_vframe_info vframe_info;
@@ -824,6 +1046,9 @@ static inline void video_sleep(struct obs_core_video *video, uint64_t *p_time, u
 	video->total_frames += count;
 	video->lagged_frames += count - 1;
 
+	if (count > 1)
+		trace_lagged_frame(video, *p_time);
+
 	vframe_info.timestamp = cur_time;
 	vframe_info.count = count;
 
@@ -1194,6 +1419,8 @@ void *obs_graphics_thread(void *param)
 #endif
 		;
 
+	tick_pool_free();
+
 #ifdef _WIN32
 	uninit_winrt_state(&winrt);
 #endif
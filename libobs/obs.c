@@ -475,6 +475,15 @@ gs_effect_t *obs_load_effect(gs_effect_t **effect, const char *file)
 }
 
 static const char *shader_comp_name = "shader compilation";
+#ifdef _WIN32
+static void graphics_device_rebuilt(void *device, void *data)
+{
+	struct obs_core_video *video = data;
+	os_atomic_inc_long(&video->device_rebuilds);
+	UNUSED_PARAMETER(device);
+}
+#endif
+
 static const char *obs_init_graphics_name = "obs_init_graphics";
 static int obs_init_graphics(struct obs_video_info *ovi)
 {
@@ -504,6 +513,14 @@ static int obs_init_graphics(struct obs_video_info *ovi)
 	profile_start(shader_comp_name);
 	gs_enter_context(video->graphics);
 
+#ifdef _WIN32
+	struct gs_device_loss loss_callbacks = {
+		.device_loss_rebuild = graphics_device_rebuilt,
+		.data = video,
+	};
+	gs_register_loss_callbacks(&loss_callbacks);
+#endif
+
 	char *filename = obs_find_data_file("default.effect");
 	video->default_effect = gs_effect_create_from_file(filename, NULL);
 	bfree(filename);
@@ -857,6 +874,10 @@ static void obs_free_graphics(void)
 	if (video->graphics) {
 		gs_enter_context(video->graphics);
 
+#ifdef _WIN32
+		gs_unregister_loss_callbacks(video);
+#endif
+
 		gs_texture_destroy(video->transparent_texture);
 
 		gs_samplerstate_destroy(video->point_sampler);
@@ -888,11 +909,14 @@ static bool obs_init_audio(struct audio_output_info *ai)
 	int errorcode;
 
 	pthread_mutex_init_value(&audio->monitoring_mutex);
+	pthread_mutex_init_value(&audio->mix_counts_mutex);
 
 	if (pthread_mutex_init_recursive(&audio->monitoring_mutex) != 0)
 		return false;
 	if (pthread_mutex_init(&audio->task_mutex, NULL) != 0)
 		return false;
+	if (pthread_mutex_init(&audio->mix_counts_mutex, NULL) != 0)
+		return false;
 
 	struct obs_task_info audio_init = {.task = set_audio_thread};
 	deque_push_back(&audio->tasks, &audio_init, sizeof(audio_init));
@@ -927,6 +951,11 @@ static void obs_free_audio(void)
 	if (audio->audio)
 		audio_output_close(audio->audio);
 
+	uint64_t total_mixes = audio->processed_mixes + audio->skipped_mixes;
+	if (total_mixes)
+		blog(LOG_INFO, "Audio mixes skipped: %" PRIu64 "/%" PRIu64 " (%0.1f%%)", audio->skipped_mixes,
+		     total_mixes, (double)audio->skipped_mixes / (double)total_mixes * 100.0);
+
 	deque_free(&audio->buffered_timestamps);
 	da_free(audio->render_order);
 	da_free(audio->root_nodes);
@@ -937,6 +966,7 @@ static void obs_free_audio(void)
 	deque_free(&audio->tasks);
 	pthread_mutex_destroy(&audio->task_mutex);
 	pthread_mutex_destroy(&audio->monitoring_mutex);
+	pthread_mutex_destroy(&audio->mix_counts_mutex);
 
 	memset(audio, 0, sizeof(struct obs_core_audio));
 }
@@ -1207,6 +1237,7 @@ static bool obs_init(const char *locale, const char *module_config_path, profile
 	pthread_mutex_init_value(&obs->video.task_mutex);
 	pthread_mutex_init_value(&obs->video.encoder_group_mutex);
 	pthread_mutex_init_value(&obs->video.mixes_mutex);
+	pthread_mutex_init_value(&obs->video.lag_trace_mutex);
 
 	obs->name_store_owned = !store;
 	obs->name_store = store ? store : profiler_name_store_create();
@@ -1233,6 +1264,16 @@ static bool obs_init(const char *locale, const char *module_config_path, profile
 	if (!obs->destruction_task_thread)
 		return false;
 
+	obs->task_pool = os_task_pool_create(0);
+	if (!obs->task_pool)
+		return false;
+
+	if (pthread_mutex_init(&obs->video.lag_trace_mutex, NULL) != 0)
+		return false;
+
+	if (!packet_pool_init(&obs->packet_pool))
+		return false;
+
 	if (module_config_path)
 		obs->module_config_path = bstrdup(module_config_path);
 	obs->locale = bstrdup(locale);
@@ -1354,6 +1395,19 @@ struct obs_cmdline_args obs_get_cmdline_args(void)
 	return cmdline_args;
 }
 
+static void log_packet_pool_stats(void)
+{
+	struct obs_packet_pool_stats stats;
+
+	packet_pool_get_stats(&obs->packet_pool, &stats);
+	if (!stats.allocations)
+		return;
+
+	blog(LOG_INFO, "Encoder packet pool: %" PRIu64 " allocations, %.1f%% reused, high-water mark %" PRIu64 " KiB",
+	     stats.allocations, (double)stats.hits * 100.0 / (double)stats.allocations,
+	     stats.high_water_mark / 1024);
+}
+
 void obs_shutdown(void)
 {
 	struct obs_module *module;
@@ -1405,6 +1459,9 @@ void obs_shutdown(void)
 	obs_free_audio();
 	obs_free_video();
 	os_task_queue_destroy(obs->destruction_task_thread);
+	os_task_pool_destroy(obs->task_pool);
+	pthread_mutex_destroy(&obs->video.lag_trace_mutex);
+	bfree(obs->video.lag_trace_path);
 	obs_free_hotkeys();
 	obs_free_graphics();
 	proc_handler_destroy(obs->procs);
@@ -1412,6 +1469,9 @@ void obs_shutdown(void)
 	obs->procs = NULL;
 	obs->signals = NULL;
 
+	log_packet_pool_stats();
+	packet_pool_free(&obs->packet_pool);
+
 	for (size_t i = 0; i < obs->module_paths.num; i++)
 		free_module_path(obs->module_paths.array + i);
 	da_free(obs->module_paths);
@@ -1779,11 +1839,68 @@ audio_t *obs_get_audio(void)
 	return obs->audio.audio;
 }
 
+void obs_get_audio_mix_counts(uint64_t *processed, uint64_t *skipped)
+{
+	pthread_mutex_lock(&obs->audio.mix_counts_mutex);
+	if (processed)
+		*processed = obs->audio.processed_mixes;
+	if (skipped)
+		*skipped = obs->audio.skipped_mixes;
+	pthread_mutex_unlock(&obs->audio.mix_counts_mutex);
+}
+
+void obs_get_packet_pool_stats(struct obs_packet_pool_stats *stats)
+{
+	if (stats)
+		packet_pool_get_stats(&obs->packet_pool, stats);
+}
+
 video_t *obs_get_video(void)
 {
 	return obs->data.main_canvas->mix->video;
 }
 
+void obs_set_parallel_source_ticks(bool enable)
+{
+	os_atomic_set_bool(&obs->video.parallel_ticks, enable);
+}
+
+bool obs_parallel_source_ticks_enabled(void)
+{
+	return os_atomic_load_bool(&obs->video.parallel_ticks);
+}
+
+void obs_set_scene_item_culling(bool enable)
+{
+	os_atomic_set_bool(&obs->video.scene_item_culling, enable);
+}
+
+bool obs_scene_item_culling_enabled(void)
+{
+	return os_atomic_load_bool(&obs->video.scene_item_culling);
+}
+
+void obs_set_threaded_audio_encoders(bool enable)
+{
+	os_atomic_set_bool(&obs->audio.threaded_encoders, enable);
+}
+
+bool obs_threaded_audio_encoders_enabled(void)
+{
+	return os_atomic_load_bool(&obs->audio.threaded_encoders);
+}
+
+void obs_set_lag_trace_file(const char *path)
+{
+	struct obs_core_video *video = &obs->video;
+
+	pthread_mutex_lock(&video->lag_trace_mutex);
+	bfree(video->lag_trace_path);
+	video->lag_trace_path = (path && *path) ? bstrdup(path) : NULL;
+	os_atomic_set_bool(&video->lag_trace_enabled, video->lag_trace_path != NULL);
+	pthread_mutex_unlock(&video->lag_trace_mutex);
+}
+
 obs_source_t *obs_get_output_source(uint32_t channel)
 {
 	return obs_canvas_get_channel(obs->data.main_canvas, channel);
@@ -3315,6 +3432,11 @@ bool obs_wait_for_destroy_queue(void)
 	return os_task_queue_wait(obs->destruction_task_thread);
 }
 
+os_task_pool_t *obs_get_task_pool(void)
+{
+	return obs ? obs->task_pool : NULL;
+}
+
 static void set_ui_thread(void *unused)
 {
 	is_ui_thread = true;
@@ -652,12 +652,51 @@ EXPORT void obs_leave_graphics(void);
 /** Gets the main audio output handler for this OBS context */
 EXPORT audio_t *obs_get_audio(void);
 
+/**
+ * Gets the number of per-source audio mixes the audio thread processed, and
+ * the number it skipped because the source isn't routed to the mix or no
+ * output is connected to it
+ */
+EXPORT void obs_get_audio_mix_counts(uint64_t *processed, uint64_t *skipped);
+
+/** Gets the statistics of the pool encoder packet data is allocated from */
+EXPORT void obs_get_packet_pool_stats(struct obs_packet_pool_stats *stats);
+
 /** Gets the main video output handler for this OBS context */
 EXPORT video_t *obs_get_video(void);
 
 /** Returns true if video is active, false otherwise */
 EXPORT bool obs_video_active(void);
 
+/**
+ * Enables calling the video_tick callbacks of sources flagged with
+ * OBS_SOURCE_TICK_THREAD_SAFE concurrently on worker threads.  Takes effect
+ * on the next frame.
+ */
+EXPORT void obs_set_parallel_source_ticks(bool enable);
+EXPORT bool obs_parallel_source_ticks_enabled(void);
+
+/**
+ * Enables skipping scene items that are outside of the scene or fully covered
+ * by an opaque item above them.  Takes effect on the next frame.
+ */
+EXPORT void obs_set_scene_item_culling(bool enable);
+EXPORT bool obs_scene_item_culling_enabled(void);
+
+/**
+ * Enables running each audio encoder on its own encode thread instead of the
+ * audio thread.  Takes effect the next time an audio encoder is started.
+ */
+EXPORT void obs_set_threaded_audio_encoders(bool enable);
+EXPORT bool obs_threaded_audio_encoders_enabled(void);
+
+/**
+ * Sets the file a timeline trace is written to when the graphics thread lags
+ * while a profiler trace is running (see profiler_trace_start).  Pass NULL to
+ * disable.
+ */
+EXPORT void obs_set_lag_trace_file(const char *path);
+
 /** Sets the primary output source for a channel. */
 EXPORT void obs_set_output_source(uint32_t channel, obs_source_t *source);
 
@@ -878,6 +917,13 @@ EXPORT bool obs_in_task_thread(enum obs_task_type type);
 
 EXPORT bool obs_wait_for_destroy_queue(void);
 
+/**
+ * Gets the thread pool for background work of sources and other plugins, to
+ * create task queues with os_task_queue_create_pooled.  Queues created on it
+ * have to be destroyed before obs_shutdown.
+ */
+EXPORT struct os_task_pool *obs_get_task_pool(void);
+
 typedef void (*obs_task_handler_t)(obs_task_t task, void *param, bool wait);
 EXPORT void obs_set_ui_task_handler(obs_task_handler_t handler);
 
@@ -1053,6 +1099,19 @@ EXPORT void obs_source_reset_settings(obs_source_t *source, obs_data_t *settings
 /** Renders a video source. */
 EXPORT void obs_source_video_render(obs_source_t *source);
 
+/**
+ * Tells libobs that the video of a source flagged with
+ * OBS_SOURCE_CACHEABLE_VIDEO changed for a reason other than a settings update
+ */
+EXPORT void obs_source_mark_video_changed(obs_source_t *source);
+
+/**
+ * Tells libobs whether the current video of a source fully covers its width
+ * and height with opaque pixels, for sources that are only opaque with some
+ * settings or files
+ */
+EXPORT void obs_source_set_video_opaque(obs_source_t *source, bool opaque);
+
 /** Gets the width of a source (if it has video) */
 EXPORT uint32_t obs_source_get_width(obs_source_t *source);
 
@@ -1347,6 +1406,27 @@ EXPORT void obs_source_draw(gs_texture_t *image, int x, int y, uint32_t cx, uint
 EXPORT void obs_source_output_video(obs_source_t *source, const struct obs_source_frame *frame);
 EXPORT void obs_source_output_video2(obs_source_t *source, const struct obs_source_frame2 *frame);
 
+/**
+ * Borrows a frame from the source's async frame cache so that the image can be
+ * written into it directly rather than copied by obs_source_output_video.
+ * The planes are allocated for the given format and size, use the frame's
+ * linesizes when writing them.  Fill in the image and all other properties
+ * (timestamp, color settings, ...), then call
+ * obs_source_output_borrowed_frame, or obs_source_release_frame to give the
+ * frame back unused.
+ *
+ * Returns NULL if the frame can't be queued, e.g. because too many frames
+ * are already waiting to be rendered.
+ *
+ * NOTE: Non-YUV formats are always treated as full range, like with
+ * obs_source_output_video.
+ */
+EXPORT struct obs_source_frame *obs_source_borrow_frame(obs_source_t *source, enum video_format format,
+							uint32_t width, uint32_t height);
+
+/** Outputs a frame from obs_source_borrow_frame, which is consumed */
+EXPORT void obs_source_output_borrowed_frame(obs_source_t *source, struct obs_source_frame *frame);
+
 EXPORT void obs_source_set_async_rotation(obs_source_t *source, long rotation);
 
 EXPORT void obs_source_output_cea708(obs_source_t *source, const struct obs_source_cea_708 *captions);
@@ -1622,6 +1702,9 @@ EXPORT obs_sceneitem_t *obs_scene_find_source_recursive(obs_scene_t *scene, cons
 
 EXPORT obs_sceneitem_t *obs_scene_find_sceneitem_by_id(obs_scene_t *scene, int64_t id);
 
+/** Gets the number of items skipped by culling the last time the scene rendered */
+EXPORT uint32_t obs_scene_get_culled_item_count(const obs_scene_t *scene);
+
 /** Gets scene by name, increments the reference */
 static inline obs_scene_t *obs_get_scene_by_name(const char *name)
 {
@@ -2362,6 +2445,14 @@ EXPORT uint32_t obs_encoder_get_caps(const obs_encoder_t *encoder);
 EXPORT void obs_encoder_packet_ref(struct encoder_packet *dst, struct encoder_packet *src);
 EXPORT void obs_encoder_packet_release(struct encoder_packet *packet);
 
+/**
+ * Allocates a buffer for the data of the next packet the encoder returns.  If
+ * the packet returned from the encode callback points to this buffer, libobs
+ * takes ownership of it instead of copying the packet data.  A buffer that
+ * isn't used is freed on the next call or when the encoder is shut down.
+ */
+EXPORT uint8_t *obs_encoder_alloc_packet_data(obs_encoder_t *encoder, size_t size);
+
 EXPORT void *obs_encoder_create_rerouted(obs_encoder_t *encoder, const char *reroute_id);
 
 /** Returns whether encoder is paused */
@@ -2372,6 +2463,13 @@ EXPORT void obs_encoder_set_last_error(obs_encoder_t *encoder, const char *messa
 
 EXPORT uint64_t obs_encoder_get_pause_offset(const obs_encoder_t *encoder);
 
+/**
+ * Gets the queue and timing statistics of an audio encoder since it was last
+ * started on its own encode thread (see obs_set_threaded_audio_encoders).
+ * Returns false if the encoder isn't an audio encoder.
+ */
+EXPORT bool obs_encoder_get_thread_stats(const obs_encoder_t *encoder, struct obs_encoder_thread_stats *stats);
+
 /**
  * Creates an "encoder group", allowing synchronized startup of encoders within
  * the group. Encoder groups are single owner, and hold strong references to
@@ -355,8 +355,347 @@ static void merge_context(profile_call *context)
 	free_call_context(prev_call);
 }
 
+/* ------------------------------------------------------------------------- */
+/* Timeline tracing */
+
+enum trace_event_type {
+	TRACE_BEGIN,
+	TRACE_END,
+	TRACE_INSTANT,
+};
+
+struct trace_event {
+	uint64_t time;
+	const char *name;
+	enum trace_event_type type;
+};
+
+/* Each thread writes its events to its own ring buffer, so recording never
+ * takes a lock.  A buffer belongs to a thread for one trace only; starting a
+ * new trace moves the buffers to a free list to be reused by whichever
+ * threads record next, so threads that exited don't keep theirs around. */
+struct trace_buffer {
+	struct trace_event *events;
+	unsigned long size;
+	unsigned long mask;
+	volatile long head;
+	volatile bool full;
+	volatile bool writing;
+
+	long generation;
+	long tid;
+	int depth;
+	const char *thread_name;
+
+	struct trace_buffer *next;
+};
+
+static volatile bool trace_active = false;
+static volatile long trace_generation = 0;
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long trace_buffer_size = 0;
+static struct trace_buffer *trace_buffers = NULL;
+static struct trace_buffer *trace_free_buffers = NULL;
+static long trace_next_tid = 1;
+
+/* only dereferenced while thread_trace_generation is the current generation,
+ * the buffer may belong to another thread (or be freed) after that */
+static THREAD_LOCAL struct trace_buffer *thread_trace = NULL;
+static THREAD_LOCAL long thread_trace_generation = 0;
+
+/* Moves the buffers of earlier traces to the free list.  A buffer whose owner
+ * is in the middle of writing an event stays where it is until the next time,
+ * since the owner will see the new generation and stop writing to it. */
+static void recycle_trace_buffers(long generation)
+{
+	struct trace_buffer **prev = &trace_buffers;
+
+	while (*prev) {
+		struct trace_buffer *buf = *prev;
+
+		if (buf->generation == generation || os_atomic_load_bool(&buf->writing)) {
+			prev = &buf->next;
+			continue;
+		}
+
+		*prev = buf->next;
+
+		if (buf->size != trace_buffer_size) {
+			bfree(buf->events);
+			buf->events = NULL;
+			buf->size = 0;
+		}
+
+		buf->next = trace_free_buffers;
+		trace_free_buffers = buf;
+	}
+}
+
+static struct trace_buffer *get_thread_trace_buffer(long generation)
+{
+	struct trace_buffer *buf = NULL;
+
+	pthread_mutex_lock(&trace_mutex);
+	if (!trace_active || os_atomic_load_long(&trace_generation) != generation)
+		goto unlock;
+
+	buf = trace_free_buffers;
+	if (buf) {
+		trace_free_buffers = buf->next;
+	} else {
+		buf = bzalloc(sizeof(struct trace_buffer));
+		buf->tid = trace_next_tid++;
+	}
+
+	if (buf->size != trace_buffer_size) {
+		bfree(buf->events);
+		buf->events = bmalloc(sizeof(struct trace_event) * trace_buffer_size);
+		buf->size = trace_buffer_size;
+		buf->mask = trace_buffer_size - 1;
+	}
+
+	buf->next = trace_buffers;
+	trace_buffers = buf;
+
+	os_atomic_store_long(&buf->head, 0);
+	os_atomic_set_bool(&buf->full, false);
+	buf->depth = 0;
+	buf->thread_name = NULL;
+	buf->generation = generation;
+
+	thread_trace = buf;
+	thread_trace_generation = generation;
+
+unlock:
+	pthread_mutex_unlock(&trace_mutex);
+	return buf;
+}
+
+static void trace_record(const char *name, enum trace_event_type type, uint64_t time)
+{
+	struct trace_buffer *buf = thread_trace;
+	long generation = os_atomic_load_long(&trace_generation);
+
+	if (!buf || thread_trace_generation != generation) {
+		buf = get_thread_trace_buffer(generation);
+		if (!buf)
+			return;
+	}
+
+	/* a new trace may have been started since the generation was checked,
+	 * in which case the buffer can be handed to another thread as soon as
+	 * it isn't being written to */
+	os_atomic_set_bool(&buf->writing, true);
+	if (os_atomic_load_long(&trace_generation) != thread_trace_generation) {
+		os_atomic_set_bool(&buf->writing, false);
+		return;
+	}
+
+	if (type == TRACE_BEGIN) {
+		/* name the thread after its outermost profile node */
+		if (buf->depth++ == 0 && !buf->thread_name)
+			buf->thread_name = name;
+	} else if (type == TRACE_END && buf->depth > 0) {
+		buf->depth--;
+	}
+
+	unsigned long head = (unsigned long)buf->head;
+	struct trace_event *event = &buf->events[head & buf->mask];
+	event->time = time;
+	event->name = name;
+	event->type = type;
+
+	if ((head & buf->mask) == buf->mask)
+		os_atomic_set_bool(&buf->full, true);
+	os_atomic_store_long(&buf->head, (long)(head + 1));
+	os_atomic_set_bool(&buf->writing, false);
+}
+
+void profiler_trace_start(size_t events_per_thread)
+{
+	unsigned long size = 16;
+	while (size < events_per_thread && size < 0x1000000)
+		size <<= 1;
+
+	pthread_mutex_lock(&trace_mutex);
+	trace_buffer_size = size;
+	long generation = os_atomic_inc_long(&trace_generation);
+	recycle_trace_buffers(generation);
+	os_atomic_set_bool(&trace_active, true);
+	pthread_mutex_unlock(&trace_mutex);
+}
+
+void profiler_trace_stop(void)
+{
+	os_atomic_set_bool(&trace_active, false);
+}
+
+bool profiler_trace_active(void)
+{
+	return os_atomic_load_bool(&trace_active);
+}
+
+void profile_trace_instant(const char *name)
+{
+	if (os_atomic_load_bool(&trace_active))
+		trace_record(name, TRACE_INSTANT, os_gettime_ns());
+}
+
+struct trace_thread_events {
+	long tid;
+	const char *thread_name;
+	DARRAY(struct trace_event) events;
+};
+
+/* Copies the events of a buffer that may still be written to.  Anything the
+ * owning thread overwrote while the copy was being made is dropped, and so is
+ * the oldest event of a full buffer, as that is the slot being written. */
+static void copy_trace_buffer(struct trace_buffer *buf, struct trace_thread_events *out)
+{
+	unsigned long head = (unsigned long)os_atomic_load_long(&buf->head);
+	unsigned long count = os_atomic_load_bool(&buf->full) ? buf->size : head;
+	if (count > buf->size)
+		count = buf->size;
+
+	unsigned long start = head - count;
+
+	da_resize(out->events, count);
+	for (unsigned long i = 0; i < count; i++)
+		out->events.array[i] = buf->events[(start + i) & buf->mask];
+
+	unsigned long overwritten = (unsigned long)os_atomic_load_long(&buf->head) - head;
+	if (count == buf->size)
+		overwritten++;
+	if (overwritten > count)
+		overwritten = count;
+	if (overwritten)
+		da_erase_range(out->events, 0, overwritten);
+
+	out->tid = buf->tid;
+	out->thread_name = buf->thread_name;
+}
+
+static void json_cat_string(struct dstr *json, const char *str)
+{
+	dstr_cat_ch(json, '"');
+	for (; str && *str; str++) {
+		unsigned char ch = (unsigned char)*str;
+		if (ch == '"' || ch == '\\') {
+			dstr_cat_ch(json, '\\');
+			dstr_cat_ch(json, (char)ch);
+		} else if (ch < 0x20) {
+			dstr_catf(json, "\\u%04x", ch);
+		} else {
+			dstr_cat_ch(json, (char)ch);
+		}
+	}
+	dstr_cat_ch(json, '"');
+}
+
+static void dump_trace_thread(FILE *f, struct dstr *json, const struct trace_thread_events *thread, uint64_t base,
+			      bool *first)
+{
+	int depth = 0;
+
+	if (thread->thread_name) {
+		dstr_printf(json, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%ld,\"args\":{\"name\":",
+			    *first ? "" : ",", thread->tid);
+		json_cat_string(json, thread->thread_name);
+		dstr_cat(json, "}}");
+		fwrite(json->array, 1, json->len, f);
+		*first = false;
+	}
+
+	for (size_t i = 0; i < thread->events.num; i++) {
+		const struct trace_event *event = &thread->events.array[i];
+		const char *phase = "i";
+
+		if (event->type == TRACE_BEGIN) {
+			phase = "B";
+			depth++;
+		} else if (event->type == TRACE_END) {
+			/* the matching begin event was already overwritten */
+			if (!depth)
+				continue;
+			phase = "E";
+			depth--;
+		}
+
+		dstr_printf(json, "%s\n{\"name\":", *first ? "" : ",");
+		json_cat_string(json, event->name);
+		dstr_catf(json, ",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":%ld", phase,
+			  (double)(event->time - base) / 1000.0, thread->tid);
+		dstr_cat(json, event->type == TRACE_INSTANT ? ",\"s\":\"g\"}" : "}");
+		fwrite(json->array, 1, json->len, f);
+		*first = false;
+	}
+}
+
+bool profiler_trace_dump_json(const char *filename)
+{
+	DARRAY(struct trace_thread_events) threads = {0};
+	uint64_t base = ~(uint64_t)0;
+
+	pthread_mutex_lock(&trace_mutex);
+	long generation = os_atomic_load_long(&trace_generation);
+	for (struct trace_buffer *buf = trace_buffers; buf; buf = buf->next) {
+		if (buf->generation != generation)
+			continue;
+
+		struct trace_thread_events *thread = da_push_back_new(threads);
+		copy_trace_buffer(buf, thread);
+		if (thread->events.num && thread->events.array[0].time < base)
+			base = thread->events.array[0].time;
+	}
+	pthread_mutex_unlock(&trace_mutex);
+
+	FILE *f = os_fopen(filename, "wb");
+	if (f) {
+		struct dstr json = {0};
+		bool first = true;
+
+		fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", f);
+		for (size_t i = 0; i < threads.num; i++)
+			dump_trace_thread(f, &json, &threads.array[i], base, &first);
+		fputs("\n]}\n", f);
+
+		dstr_free(&json);
+		fclose(f);
+	}
+
+	for (size_t i = 0; i < threads.num; i++)
+		da_free(threads.array[i].events);
+	da_free(threads);
+
+	return f != NULL;
+}
+
+static void free_trace_buffers(void)
+{
+	pthread_mutex_lock(&trace_mutex);
+	os_atomic_set_bool(&trace_active, false);
+	os_atomic_inc_long(&trace_generation);
+
+	struct trace_buffer *lists[] = {trace_buffers, trace_free_buffers};
+	for (size_t i = 0; i < sizeof(lists) / sizeof(lists[0]); i++) {
+		struct trace_buffer *buf = lists[i];
+		while (buf) {
+			struct trace_buffer *next = buf->next;
+			bfree(buf->events);
+			bfree(buf);
+			buf = next;
+		}
+	}
+	trace_buffers = NULL;
+	trace_free_buffers = NULL;
+	pthread_mutex_unlock(&trace_mutex);
+}
+
 void profile_start(const char *name)
 {
+	if (os_atomic_load_bool(&trace_active))
+		trace_record(name, TRACE_BEGIN, os_gettime_ns());
+
 	if (!thread_enabled)
 		return;
 
@@ -385,6 +724,9 @@ void profile_start(const char *name)
 void profile_end(const char *name)
 {
 	uint64_t end = os_gettime_ns();
+	if (os_atomic_load_bool(&trace_active))
+		trace_record(name, TRACE_END, end);
+
 	if (!thread_enabled)
 		return;
 
@@ -791,6 +1133,8 @@ void profiler_free(void)
 
 	da_free(old_root_entries);
 
+	free_trace_buffers();
+
 	pthread_mutex_destroy(&root_mutex);
 }
 
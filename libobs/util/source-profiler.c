@@ -69,6 +69,11 @@ struct profiler_entry {
 	struct ucirclebuf async_frame_ts;
 	/* Timestamps of last N async frames rendered */
 	struct ucirclebuf async_rendered_ts;
+	/* Async lock wait and dropped frame counters of last N frames */
+	struct ucirclebuf async_lock_waits;
+	struct ucirclebuf async_frames_dropped;
+	/* Times of the last N frames in each stage reported by the source */
+	struct ucirclebuf async_stage[SOURCE_PROFILER_ASYNC_STAGE_COUNT];
 
 	UT_hash_handle hh;
 };
@@ -174,6 +179,10 @@ static struct profiler_entry *entry_create(const uintptr_t key)
 	ucirclebuf_init(&ent->render_gpu_sum, profiler_samples);
 	ucirclebuf_init(&ent->async_frame_ts, profiler_samples);
 	ucirclebuf_init(&ent->async_rendered_ts, profiler_samples);
+	ucirclebuf_init(&ent->async_lock_waits, profiler_samples);
+	ucirclebuf_init(&ent->async_frames_dropped, profiler_samples);
+	for (size_t i = 0; i < SOURCE_PROFILER_ASYNC_STAGE_COUNT; i++)
+		ucirclebuf_init(&ent->async_stage[i], profiler_samples);
 	return ent;
 }
 
@@ -186,6 +195,10 @@ static void entry_destroy(struct profiler_entry *entry)
 	ucirclebuf_free(&entry->render_gpu_sum);
 	ucirclebuf_free(&entry->async_frame_ts);
 	ucirclebuf_free(&entry->async_rendered_ts);
+	ucirclebuf_free(&entry->async_lock_waits);
+	ucirclebuf_free(&entry->async_frames_dropped);
+	for (size_t i = 0; i < SOURCE_PROFILER_ASYNC_STAGE_COUNT; i++)
+		ucirclebuf_free(&entry->async_stage[i]);
 	bfree(entry);
 }
 
@@ -373,6 +386,9 @@ void source_profiler_frame_collect(void)
 		if (is_async_video_source(src)) {
 			uint64_t ts = obs_source_get_last_async_ts(src);
 			ucirclebuf_push(&ent->async_rendered_ts, ts);
+			ucirclebuf_push(&ent->async_lock_waits, (uint64_t)os_atomic_load_long(&src->async_lock_waits));
+			ucirclebuf_push(&ent->async_frames_dropped,
+					(uint64_t)os_atomic_load_long(&src->async_frames_dropped));
 		}
 
 		smps = smps->hh.next;
@@ -412,6 +428,21 @@ void source_profiler_async_frame_received(obs_source_t *source)
 	pthread_rwlock_unlock(&hm_rwlock);
 }
 
+void source_profiler_async_stage_time(obs_source_t *source, enum source_profiler_async_stage stage, uint64_t delta)
+{
+	if (!enabled || stage >= SOURCE_PROFILER_ASYNC_STAGE_COUNT)
+		return;
+
+	pthread_rwlock_wrlock(&hm_rwlock);
+
+	struct profiler_entry *ent;
+	HASH_FIND_PTR(hm_entries, &source, ent);
+	if (ent)
+		ucirclebuf_push(&ent->async_stage[stage], delta);
+
+	pthread_rwlock_unlock(&hm_rwlock);
+}
+
 uint64_t source_profiler_source_tick_start(void)
 {
 	if (!enabled)
@@ -425,7 +456,13 @@ void source_profiler_source_tick_end(obs_source_t *source, uint64_t start)
 	if (!enabled)
 		return;
 
-	const uint64_t delta = os_gettime_ns() - start;
+	source_profiler_source_tick_time(source, os_gettime_ns() - start);
+}
+
+void source_profiler_source_tick_time(obs_source_t *source, uint64_t delta)
+{
+	if (!enabled)
+		return;
 
 	struct source_samples *smp = NULL;
 	HASH_FIND_PTR(hm_samples, &source, smp);
@@ -560,6 +597,34 @@ static inline void calculate_render(struct profiler_entry *ent, struct profiler_
 	}
 }
 
+static inline void calculate_avg_max(const struct ucirclebuf *times, uint64_t *avg, uint64_t *max)
+{
+	uint64_t sum = 0;
+
+	for (size_t idx = 0; idx < times->num; idx++) {
+		const uint64_t delta = times->array[idx];
+		if (delta > *max)
+			*max = delta;
+
+		sum += delta;
+	}
+
+	if (times->num)
+		*avg = sum / times->num;
+}
+
+/* difference between the newest and oldest sample of a counter */
+static inline uint64_t calculate_count(const struct ucirclebuf *counter)
+{
+	if (counter->num < 2)
+		return 0;
+
+	size_t newest = (counter->idx + counter->capacity - 1) % counter->capacity;
+	size_t oldest = counter->num == counter->capacity ? counter->idx % counter->capacity : 0;
+
+	return (uint64_t)(long)(counter->array[newest] - counter->array[oldest]);
+}
+
 static inline void calculate_fps(const struct ucirclebuf *frames, double *avg, uint64_t *best, uint64_t *worst)
 {
 	uint64_t deltas = 0, delta_sum = 0, best_delta = 0, worst_delta = 0;
@@ -611,6 +676,12 @@ bool source_profiler_fill_result(obs_source_t *source, struct profiler_result *r
 				      &result->async_input_worst);
 			calculate_fps(&ent->async_rendered_ts, &result->async_rendered, &result->async_rendered_best,
 				      &result->async_rendered_worst);
+			result->async_lock_waits = calculate_count(&ent->async_lock_waits);
+			result->async_frames_dropped = calculate_count(&ent->async_frames_dropped);
+
+			for (size_t i = 0; i < SOURCE_PROFILER_ASYNC_STAGE_COUNT; i++)
+				calculate_avg_max(&ent->async_stage[i], &result->async_stage_avg[i],
+						  &result->async_stage_max[i]);
 		}
 	}
 
@@ -23,6 +23,15 @@
 extern "C" {
 #endif
 
+/* Stages an async source's frames go through before they're output, for
+ * sources that report them */
+enum source_profiler_async_stage {
+	SOURCE_PROFILER_ASYNC_STAGE_COPY,
+	SOURCE_PROFILER_ASYNC_STAGE_DECODE,
+	SOURCE_PROFILER_ASYNC_STAGE_REORDER,
+	SOURCE_PROFILER_ASYNC_STAGE_COUNT,
+};
+
 typedef struct profiler_result {
 	/* Tick times in ns */
 	uint64_t tick_avg;
@@ -49,6 +58,16 @@ typedef struct profiler_result {
 	uint64_t async_input_worst;
 	uint64_t async_rendered_best;
 	uint64_t async_rendered_worst;
+
+	/* Number of times the video thread or a thread outputting async
+	 * frames had to wait on the other, and async frames dropped because
+	 * they weren't rendered in time */
+	uint64_t async_lock_waits;
+	uint64_t async_frames_dropped;
+
+	/* Average and max times of the stages reported by the source in ns */
+	uint64_t async_stage_avg[SOURCE_PROFILER_ASYNC_STAGE_COUNT];
+	uint64_t async_stage_max[SOURCE_PROFILER_ASYNC_STAGE_COUNT];
 } profiler_result_t;
 
 /* Enable/disable profiler (applied on next frame) */
@@ -56,6 +75,11 @@ EXPORT void source_profiler_enable(bool enable);
 /* Enable/disable GPU profiling (applied on next frame) */
 EXPORT void source_profiler_gpu_enable(bool enable);
 
+/* Report the time a frame spent in a stage before being output, can be
+ * called from any thread */
+EXPORT void source_profiler_async_stage_time(obs_source_t *source, enum source_profiler_async_stage stage,
+					     uint64_t delta);
+
 /* Get latest profiling results for source (must be freed by user) */
 EXPORT profiler_result_t *source_profiler_get_result(obs_source_t *source);
 /* Update existing profiler results object for source */
@@ -1,24 +1,50 @@
 #include "task.h"
 #include "bmem.h"
 #include "threading.h"
+#include "platform.h"
 #include "deque.h"
+#include "darray.h"
 
 struct os_task_queue {
 	pthread_t thread;
 	os_sem_t *sem;
 	long id;
 
+	/* only set for queues that run on a pool */
+	struct os_task_pool *pool;
+	bool serial;
+	bool scheduled;
+	long pending;
+
 	bool waiting;
 	bool tasks_processed;
 	os_event_t *wait_event;
 
 	pthread_mutex_t mutex;
-	struct deque tasks;
+	struct deque tasks[OS_TASK_PRIORITY_COUNT];
+
+	struct os_task_queue_stats stats;
 };
 
 struct os_task_info {
 	os_task_t task;
 	void *param;
+	uint64_t queued_ts;
+};
+
+/* a task of a concurrent queue, or for serial queues (task is NULL), a
+ * request to run the next task of the queue */
+struct os_pool_entry {
+	struct os_task_queue *tq;
+	struct os_task_info ti;
+};
+
+struct os_task_pool {
+	pthread_mutex_t mutex;
+	os_sem_t *sem;
+	struct deque entries[OS_TASK_PRIORITY_COUNT];
+	DARRAY(pthread_t) threads;
+	bool exit;
 };
 
 static THREAD_LOCAL bool exit_thread = false;
@@ -27,6 +53,48 @@ static volatile long thread_id_counter = 1;
 
 static void *tiny_tubular_task_thread(void *param);
 
+static inline bool has_tasks(const struct deque *tasks)
+{
+	for (size_t i = 0; i < OS_TASK_PRIORITY_COUNT; i++) {
+		if (tasks[i].size)
+			return true;
+	}
+	return false;
+}
+
+static inline enum os_task_priority top_priority(const struct deque *tasks)
+{
+	for (size_t i = OS_TASK_PRIORITY_COUNT; i > 0; i--) {
+		if (tasks[i - 1].size)
+			return (enum os_task_priority)(i - 1);
+	}
+	return OS_TASK_PRIORITY_LOW;
+}
+
+static inline void pop_top(struct deque *tasks, void *item, size_t size)
+{
+	deque_pop_front(&tasks[top_priority(tasks)], item, size);
+}
+
+static inline void record_start(struct os_task_queue *tq, const struct os_task_info *ti)
+{
+	uint64_t latency = os_gettime_ns() - ti->queued_ts;
+
+	tq->stats.total_latency_ns += latency;
+	if (latency > tq->stats.max_latency_ns)
+		tq->stats.max_latency_ns = latency;
+}
+
+static void free_queue(struct os_task_queue *tq)
+{
+	os_event_destroy(tq->wait_event);
+	os_sem_destroy(tq->sem);
+	pthread_mutex_destroy(&tq->mutex);
+	for (size_t i = 0; i < OS_TASK_PRIORITY_COUNT; i++)
+		deque_free(&tq->tasks[i]);
+	bfree(tq);
+}
+
 os_task_queue_t *os_task_queue_create(void)
 {
 	struct os_task_queue *tq = bzalloc(sizeof(*tq));
@@ -54,23 +122,91 @@ fail1:
 	return NULL;
 }
 
-bool os_task_queue_queue_task(os_task_queue_t *tq, os_task_t task, void *param)
+os_task_queue_t *os_task_queue_create_pooled(os_task_pool_t *pool, bool serial)
+{
+	if (!pool)
+		return NULL;
+
+	struct os_task_queue *tq = bzalloc(sizeof(*tq));
+	tq->id = os_atomic_inc_long(&thread_id_counter);
+	tq->pool = pool;
+	tq->serial = serial;
+
+	if (pthread_mutex_init(&tq->mutex, NULL) != 0)
+		goto fail1;
+	if (os_event_init(&tq->wait_event, OS_EVENT_TYPE_AUTO) != 0)
+		goto fail2;
+
+	return tq;
+
+fail2:
+	pthread_mutex_destroy(&tq->mutex);
+fail1:
+	bfree(tq);
+	return NULL;
+}
+
+static void pool_push(struct os_task_pool *pool, const struct os_pool_entry *entry, enum os_task_priority priority)
+{
+	pthread_mutex_lock(&pool->mutex);
+	deque_push_back(&pool->entries[priority], entry, sizeof(*entry));
+	pthread_mutex_unlock(&pool->mutex);
+	os_sem_post(pool->sem);
+}
+
+static void queue_pooled_task(struct os_task_queue *tq, const struct os_task_info *ti, enum os_task_priority priority)
+{
+	struct os_pool_entry entry = {tq};
+	bool schedule = true;
+
+	pthread_mutex_lock(&tq->mutex);
+	tq->pending++;
+	tq->stats.tasks_queued++;
+	if (tq->serial) {
+		deque_push_back(&tq->tasks[priority], ti, sizeof(*ti));
+		schedule = !tq->scheduled;
+		tq->scheduled = true;
+	} else {
+		entry.ti = *ti;
+	}
+	pthread_mutex_unlock(&tq->mutex);
+
+	if (schedule)
+		pool_push(tq->pool, &entry, priority);
+}
+
+bool os_task_queue_queue_task_priority(os_task_queue_t *tq, os_task_t task, void *param,
+				       enum os_task_priority priority)
 {
 	struct os_task_info ti = {
 		task,
 		param,
+		os_gettime_ns(),
 	};
 
 	if (!tq)
 		return false;
+	if (priority >= OS_TASK_PRIORITY_COUNT)
+		priority = OS_TASK_PRIORITY_HIGH;
+
+	if (tq->pool) {
+		queue_pooled_task(tq, &ti, priority);
+		return true;
+	}
 
 	pthread_mutex_lock(&tq->mutex);
-	deque_push_back(&tq->tasks, &ti, sizeof(ti));
+	deque_push_back(&tq->tasks[priority], &ti, sizeof(ti));
+	tq->stats.tasks_queued++;
 	pthread_mutex_unlock(&tq->mutex);
 	os_sem_post(tq->sem);
 	return true;
 }
 
+bool os_task_queue_queue_task(os_task_queue_t *tq, os_task_t task, void *param)
+{
+	return os_task_queue_queue_task_priority(tq, task, param, OS_TASK_PRIORITY_NORMAL);
+}
+
 static void wait_for_thread(void *data)
 {
 	os_task_queue_t *tq = data;
@@ -83,18 +219,41 @@ static void stop_thread(void *unused)
 	UNUSED_PARAMETER(unused);
 }
 
+/* wait and stop requests go behind every task already queued, no matter
+ * the priority of the task */
+static void queue_marker(struct os_task_queue *tq, os_task_t task)
+{
+	struct os_task_info ti = {
+		task,
+		tq,
+		0,
+	};
+
+	deque_push_back(&tq->tasks[OS_TASK_PRIORITY_LOW], &ti, sizeof(ti));
+}
+
 void os_task_queue_destroy(os_task_queue_t *tq)
 {
 	if (!tq)
 		return;
 
-	os_task_queue_queue_task(tq, stop_thread, NULL);
+	if (tq->pool) {
+		os_task_queue_wait(tq);
+
+		/* the last task may still be unlocking the queue */
+		pthread_mutex_lock(&tq->mutex);
+		pthread_mutex_unlock(&tq->mutex);
+		free_queue(tq);
+		return;
+	}
+
+	pthread_mutex_lock(&tq->mutex);
+	queue_marker(tq, stop_thread);
+	pthread_mutex_unlock(&tq->mutex);
+	os_sem_post(tq->sem);
+
 	pthread_join(tq->thread, NULL);
-	os_event_destroy(tq->wait_event);
-	os_sem_destroy(tq->sem);
-	pthread_mutex_destroy(&tq->mutex);
-	deque_free(&tq->tasks);
-	bfree(tq);
+	free_queue(tq);
 }
 
 bool os_task_queue_wait(os_task_queue_t *tq)
@@ -102,15 +261,21 @@ bool os_task_queue_wait(os_task_queue_t *tq)
 	if (!tq)
 		return false;
 
-	struct os_task_info ti = {
-		wait_for_thread,
-		tq,
-	};
+	if (tq->pool) {
+		pthread_mutex_lock(&tq->mutex);
+		bool tasks_pending = tq->pending > 0;
+		tq->waiting = tasks_pending;
+		pthread_mutex_unlock(&tq->mutex);
+
+		if (tasks_pending)
+			os_event_wait(tq->wait_event);
+		return tasks_pending;
+	}
 
 	pthread_mutex_lock(&tq->mutex);
 	tq->waiting = true;
 	tq->tasks_processed = false;
-	deque_push_back(&tq->tasks, &ti, sizeof(ti));
+	queue_marker(tq, wait_for_thread);
 	pthread_mutex_unlock(&tq->mutex);
 
 	os_sem_post(tq->sem);
@@ -128,6 +293,16 @@ bool os_task_queue_inside(os_task_queue_t *tq)
 	return tq->id == thread_id;
 }
 
+void os_task_queue_get_stats(os_task_queue_t *tq, struct os_task_queue_stats *stats)
+{
+	if (!tq || !stats)
+		return;
+
+	pthread_mutex_lock(&tq->mutex);
+	*stats = tq->stats;
+	pthread_mutex_unlock(&tq->mutex);
+}
+
 static void *tiny_tubular_task_thread(void *param)
 {
 	struct os_task_queue *tq = param;
@@ -139,14 +314,14 @@ static void *tiny_tubular_task_thread(void *param)
 		struct os_task_info ti;
 
 		pthread_mutex_lock(&tq->mutex);
-		deque_pop_front(&tq->tasks, &ti, sizeof(ti));
-		if (tq->tasks.size && ti.task == wait_for_thread) {
-			deque_push_back(&tq->tasks, &ti, sizeof(ti));
-			deque_pop_front(&tq->tasks, &ti, sizeof(ti));
+		pop_top(tq->tasks, &ti, sizeof(ti));
+		if (has_tasks(tq->tasks) && ti.task == wait_for_thread) {
+			deque_push_back(&tq->tasks[OS_TASK_PRIORITY_LOW], &ti, sizeof(ti));
+			pop_top(tq->tasks, &ti, sizeof(ti));
 		}
-		if (tq->tasks.size && ti.task == stop_thread) {
-			deque_push_back(&tq->tasks, &ti, sizeof(ti));
-			deque_pop_front(&tq->tasks, &ti, sizeof(ti));
+		if (has_tasks(tq->tasks) && ti.task == stop_thread) {
+			deque_push_back(&tq->tasks[OS_TASK_PRIORITY_LOW], &ti, sizeof(ti));
+			pop_top(tq->tasks, &ti, sizeof(ti));
 		}
 		if (tq->waiting) {
 			if (ti.task == wait_for_thread) {
@@ -155,10 +330,150 @@ static void *tiny_tubular_task_thread(void *param)
 				tq->tasks_processed = true;
 			}
 		}
+
+		bool marker = ti.task == wait_for_thread || ti.task == stop_thread;
+		if (!marker)
+			record_start(tq, &ti);
 		pthread_mutex_unlock(&tq->mutex);
 
 		ti.task(ti.param);
+
+		if (!marker) {
+			pthread_mutex_lock(&tq->mutex);
+			tq->stats.tasks_completed++;
+			pthread_mutex_unlock(&tq->mutex);
+		}
+	}
+
+	return NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+/* pools */
+
+static void run_pool_entry(struct os_pool_entry *entry)
+{
+	struct os_task_queue *tq = entry->tq;
+	struct os_task_info ti = entry->ti;
+	enum os_task_priority priority = OS_TASK_PRIORITY_NORMAL;
+	bool reschedule = false;
+	bool done;
+
+	pthread_mutex_lock(&tq->mutex);
+	if (tq->serial)
+		pop_top(tq->tasks, &ti, sizeof(ti));
+	record_start(tq, &ti);
+	pthread_mutex_unlock(&tq->mutex);
+
+	thread_id = tq->id;
+	ti.task(ti.param);
+	thread_id = 0;
+
+	pthread_mutex_lock(&tq->mutex);
+	tq->stats.tasks_completed++;
+	tq->pending--;
+
+	if (tq->serial) {
+		reschedule = has_tasks(tq->tasks);
+		priority = top_priority(tq->tasks);
+		tq->scheduled = reschedule;
+	}
+
+	done = tq->waiting && !tq->pending;
+	if (done) {
+		tq->waiting = false;
+		os_event_signal(tq->wait_event);
+	}
+	pthread_mutex_unlock(&tq->mutex);
+
+	/* the queue can't be destroyed while it has tasks left */
+	if (reschedule) {
+		struct os_pool_entry next = {tq};
+		pool_push(tq->pool, &next, priority);
+	}
+}
+
+static void *os_task_pool_thread(void *param)
+{
+	struct os_task_pool *pool = param;
+
+	os_set_thread_name(__FUNCTION__);
+
+	while (os_sem_wait(pool->sem) == 0) {
+		struct os_pool_entry entry;
+
+		pthread_mutex_lock(&pool->mutex);
+		if (pool->exit) {
+			pthread_mutex_unlock(&pool->mutex);
+			break;
+		}
+		pop_top(pool->entries, &entry, sizeof(entry));
+		pthread_mutex_unlock(&pool->mutex);
+
+		run_pool_entry(&entry);
 	}
 
 	return NULL;
 }
+
+os_task_pool_t *os_task_pool_create(size_t threads)
+{
+	struct os_task_pool *pool = bzalloc(sizeof(*pool));
+
+	if (!threads) {
+		int cores = os_get_logical_cores();
+		threads = cores > 0 ? (size_t)cores : 1;
+	}
+
+	if (pthread_mutex_init(&pool->mutex, NULL) != 0)
+		goto fail1;
+	if (os_sem_init(&pool->sem, 0) != 0)
+		goto fail2;
+
+	for (size_t i = 0; i < threads; i++) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, os_task_pool_thread, pool) != 0)
+			break;
+		da_push_back(pool->threads, &thread);
+	}
+
+	if (!pool->threads.num) {
+		os_sem_destroy(pool->sem);
+		goto fail2;
+	}
+
+	return pool;
+
+fail2:
+	pthread_mutex_destroy(&pool->mutex);
+fail1:
+	bfree(pool);
+	return NULL;
+}
+
+void os_task_pool_destroy(os_task_pool_t *pool)
+{
+	if (!pool)
+		return;
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->exit = true;
+	pthread_mutex_unlock(&pool->mutex);
+
+	for (size_t i = 0; i < pool->threads.num; i++)
+		os_sem_post(pool->sem);
+	for (size_t i = 0; i < pool->threads.num; i++)
+		pthread_join(pool->threads.array[i], NULL);
+
+	da_free(pool->threads);
+	os_sem_destroy(pool->sem);
+	pthread_mutex_destroy(&pool->mutex);
+	for (size_t i = 0; i < OS_TASK_PRIORITY_COUNT; i++)
+		deque_free(&pool->entries[i]);
+	bfree(pool);
+}
+
+size_t os_task_pool_get_thread_count(os_task_pool_t *pool)
+{
+	return pool ? pool->threads.num : 0;
+}
@@ -9,14 +9,52 @@ extern "C" {
 struct os_task_queue;
 typedef struct os_task_queue os_task_queue_t;
 
+struct os_task_pool;
+typedef struct os_task_pool os_task_pool_t;
+
 typedef void (*os_task_t)(void *param);
 
+enum os_task_priority {
+	OS_TASK_PRIORITY_LOW,
+	OS_TASK_PRIORITY_NORMAL,
+	OS_TASK_PRIORITY_HIGH,
+};
+
+#define OS_TASK_PRIORITY_COUNT 3
+
+struct os_task_queue_stats {
+	uint64_t tasks_queued;
+	uint64_t tasks_completed;
+	uint64_t total_latency_ns; /* time from queueing to starting a task */
+	uint64_t max_latency_ns;
+};
+
 EXPORT os_task_queue_t *os_task_queue_create(void);
 EXPORT bool os_task_queue_queue_task(os_task_queue_t *tt, os_task_t task, void *param);
 EXPORT void os_task_queue_destroy(os_task_queue_t *tt);
 EXPORT bool os_task_queue_wait(os_task_queue_t *tt);
 EXPORT bool os_task_queue_inside(os_task_queue_t *tt);
 
+/* Higher priority tasks of a queue run before lower priority ones that are
+ * still waiting, tasks of the same priority run in the order they were
+ * queued. */
+EXPORT bool os_task_queue_queue_task_priority(os_task_queue_t *tt, os_task_t task, void *param,
+					      enum os_task_priority priority);
+EXPORT void os_task_queue_get_stats(os_task_queue_t *tt, struct os_task_queue_stats *stats);
+
+/* Pool of worker threads shared by task queues.  A thread count of 0 uses
+ * one thread per logical core.  All queues of a pool have to be destroyed
+ * before the pool. */
+EXPORT os_task_pool_t *os_task_pool_create(size_t threads);
+EXPORT void os_task_pool_destroy(os_task_pool_t *pool);
+EXPORT size_t os_task_pool_get_thread_count(os_task_pool_t *pool);
+
+/* Creates a queue that runs its tasks on the threads of a pool instead of on
+ * its own thread.  Tasks of a serial queue run one at a time, tasks of a
+ * concurrent queue run on as many threads as are available.  Tasks running
+ * on a pool shouldn't block waiting for other tasks of the same pool. */
+EXPORT os_task_queue_t *os_task_queue_create_pooled(os_task_pool_t *pool, bool serial);
+
 #ifdef __cplusplus
 }
 #endif
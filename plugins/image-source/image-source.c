@@ -70,8 +70,14 @@ static void image_source_load_texture(void *data)
 
 	if (!context->if4.image3.image2.image.loaded)
 		warn("failed to load texture '%s'", context->file);
+
+	/* images without an alpha channel are decoded to BGRX */
+	const gs_image_file_t *image = &context->if4.image3.image2.image;
+	obs_source_set_video_opaque(context->source, image->loaded && image->format == GS_BGRX);
+
 	context->update_time_elapsed = 0;
 	os_atomic_set_bool(&context->texture_loaded, true);
+	obs_source_mark_video_changed(context->source);
 }
 
 static void image_source_unload(void *data)
@@ -79,10 +85,13 @@ static void image_source_unload(void *data)
 	struct image_source *context = data;
 	os_atomic_set_bool(&context->file_decoded, false);
 	os_atomic_set_bool(&context->texture_loaded, false);
+	obs_source_set_video_opaque(context->source, false);
 
 	obs_enter_graphics();
 	gs_image_file4_free(&context->if4);
 	obs_leave_graphics();
+
+	obs_source_mark_video_changed(context->source);
 }
 
 static void image_source_load(struct image_source *context)
@@ -155,6 +164,7 @@ static void restart_gif(void *data)
 		gs_image_file4_update_texture(&context->if4);
 		obs_leave_graphics();
 
+		obs_source_mark_video_changed(context->source);
 		context->restart_gif = false;
 	}
 }
@@ -276,6 +286,8 @@ static void image_source_tick(void *data, float seconds)
 			obs_enter_graphics();
 			gs_image_file4_update_texture(&context->if4);
 			obs_leave_graphics();
+
+			obs_source_mark_video_changed(context->source);
 		}
 	}
 
@@ -363,7 +375,7 @@ static enum gs_color_space image_source_get_color_space(void *data, size_t count
 static struct obs_source_info image_source_info = {
 	.id = "image_source",
 	.type = OBS_SOURCE_TYPE_INPUT,
-	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB | OBS_SOURCE_CACHEABLE_VIDEO | OBS_SOURCE_TICK_THREAD_SAFE,
 	.get_name = image_source_get_name,
 	.create = image_source_create,
 	.destroy = image_source_destroy,
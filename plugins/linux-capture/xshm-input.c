@@ -18,6 +18,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <stdio.h>
 #include <stdlib.h>
 #include <inttypes.h>
+#include <xcb/damage.h>
 #include <xcb/randr.h>
 #include <xcb/shm.h>
 #include <xcb/xfixes.h>
@@ -25,6 +26,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <obs-module.h>
 #include <util/dstr.h>
+#include <util/platform.h>
+#include <util/threading.h>
 #include "xcursor-xcb.h"
 #include "xhelpers.h"
 
@@ -34,14 +37,52 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define INVALID_DISPLAY (-1)
 
+#define XSHM_BUFFERS 2
+
+/* more damaged rectangles than this are captured as their bounding box */
+#define XSHM_MAX_RECTS 8
+
+struct xshm_buffer {
+	xcb_shm_t *shm;
+
+	/* the parts of the screen in the segment, relative to the captured
+	 * area and packed one after the other */
+	xcb_rectangle_t rects[XSHM_MAX_RECTS];
+	size_t num_rects;
+};
+
 struct xshm_data {
 	obs_source_t *source;
 
 	xcb_connection_t *xcb;
 	xcb_screen_t *xcb_screen;
-	xcb_shm_t *xshm;
 	xcb_xcursor_t *cursor;
 
+	/* the capture thread fills one buffer while the other is uploaded */
+	struct xshm_buffer buffers[XSHM_BUFFERS];
+	pthread_mutex_t buffer_mutex;
+	int ready_buffer;
+	int upload_buffer;
+
+	pthread_t capture_thread;
+	bool capture_thread_active;
+	os_event_t *capture_event;
+	volatile bool stop_capture;
+
+	bool use_damage;
+	bool damaged;
+	volatile bool need_full;
+	xcb_damage_damage_t damage;
+	xcb_xfixes_region_t damage_region;
+	uint8_t damage_event;
+
+	volatile long frames_captured;
+	volatile long frames_skipped;
+	/* bytes copied into the texture's upload buffer, the GPU upload itself
+	 * may still be of the whole texture (OpenGL unmaps with glTexImage2D) */
+	volatile long bytes_copied;
+	volatile long last_bytes_copied;
+
 	char *server;
 	int_fast32_t screen_id;
 	int_fast32_t x_org;
@@ -99,6 +140,9 @@ static bool xshm_check_extensions(xcb_connection_t *xcb)
 	if (!xcb_get_extension_data(xcb, &xcb_randr_id)->present)
 		blog(LOG_INFO, "Missing Randr extension !");
 
+	if (!xcb_get_extension_data(xcb, &xcb_damage_id)->present)
+		blog(LOG_INFO, "Missing Damage extension !");
+
 	return ok;
 }
 
@@ -170,6 +214,271 @@ static int_fast32_t xshm_update_geometry(struct xshm_data *data)
 	return 1;
 }
 
+/**
+ * Start tracking changes of the root window
+ *
+ * Without the Damage extension every frame is captured in full.
+ */
+static void xshm_damage_init(struct xshm_data *data)
+{
+	const xcb_query_extension_reply_t *ext = xcb_get_extension_data(data->xcb, &xcb_damage_id);
+	xcb_damage_query_version_reply_t *damage_r;
+	xcb_xfixes_query_version_reply_t *xfixes_r;
+
+	data->use_damage = false;
+
+	if (!ext->present || !xcb_get_extension_data(data->xcb, &xcb_xfixes_id)->present)
+		return;
+
+	damage_r = xcb_damage_query_version_reply(
+		data->xcb, xcb_damage_query_version(data->xcb, XCB_DAMAGE_MAJOR_VERSION, XCB_DAMAGE_MINOR_VERSION),
+		NULL);
+	xfixes_r = xcb_xfixes_query_version_reply(
+		data->xcb, xcb_xfixes_query_version(data->xcb, XCB_XFIXES_MAJOR_VERSION, XCB_XFIXES_MINOR_VERSION),
+		NULL);
+
+	if (damage_r && xfixes_r) {
+		data->damage = xcb_generate_id(data->xcb);
+		xcb_damage_create(data->xcb, data->damage, data->xcb_screen->root, XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY);
+
+		data->damage_region = xcb_generate_id(data->xcb);
+		xcb_xfixes_create_region(data->xcb, data->damage_region, 0, NULL);
+
+		data->damage_event = ext->first_event + XCB_DAMAGE_NOTIFY;
+		data->use_damage = true;
+	}
+
+	free(damage_r);
+	free(xfixes_r);
+}
+
+static void xshm_damage_free(struct xshm_data *data)
+{
+	if (!data->use_damage)
+		return;
+
+	xcb_damage_destroy(data->xcb, data->damage);
+	xcb_xfixes_destroy_region(data->xcb, data->damage_region);
+	data->use_damage = false;
+}
+
+/**
+ * Clip a rectangle of the root window to the captured area
+ *
+ * @return false if nothing of it is captured
+ */
+static bool xshm_clip_rect(struct xshm_data *data, xcb_rectangle_t *rect)
+{
+	int_fast32_t x1 = rect->x - data->adj_x_org;
+	int_fast32_t y1 = rect->y - data->adj_y_org;
+	int_fast32_t x2 = x1 + rect->width;
+	int_fast32_t y2 = y1 + rect->height;
+
+	if (x1 < 0)
+		x1 = 0;
+	if (y1 < 0)
+		y1 = 0;
+	if (x2 > data->adj_width)
+		x2 = data->adj_width;
+	if (y2 > data->adj_height)
+		y2 = data->adj_height;
+
+	if (x2 <= x1 || y2 <= y1)
+		return false;
+
+	rect->x = (int16_t)x1;
+	rect->y = (int16_t)y1;
+	rect->width = (uint16_t)(x2 - x1);
+	rect->height = (uint16_t)(y2 - y1);
+	return true;
+}
+
+/**
+ * Get the parts of the captured area that changed since the last capture
+ *
+ * @return the number of rectangles, 0 if nothing changed
+ */
+static size_t xshm_get_damage(struct xshm_data *data, xcb_rectangle_t *rects)
+{
+	xcb_xfixes_fetch_region_reply_t *region_r;
+	xcb_generic_event_t *ev;
+	bool full = os_atomic_exchange_bool(&data->need_full, false);
+	size_t num_rects = 0;
+
+	if (!data->use_damage)
+		full = true;
+
+	/* the server only reports when the damage stops being empty, so
+	 * unchanged frames cost no round trip */
+	while ((ev = xcb_poll_for_event(data->xcb))) {
+		if ((ev->response_type & ~0x80) == data->damage_event)
+			data->damaged = true;
+		free(ev);
+	}
+
+	if (data->use_damage && (data->damaged || full)) {
+		xcb_damage_subtract(data->xcb, data->damage, XCB_NONE, data->damage_region);
+		region_r = xcb_xfixes_fetch_region_reply(data->xcb, xcb_xfixes_fetch_region(data->xcb, data->damage_region),
+							 NULL);
+		data->damaged = false;
+
+		if (!region_r) {
+			full = true;
+
+		} else if (!full) {
+			xcb_rectangle_t *damage = xcb_xfixes_fetch_region_rectangles(region_r);
+			int count = xcb_xfixes_fetch_region_rectangles_length(region_r);
+
+			for (int i = 0; i < count && num_rects <= XSHM_MAX_RECTS; i++) {
+				xcb_rectangle_t rect = damage[i];
+				if (!xshm_clip_rect(data, &rect))
+					continue;
+				if (num_rects < XSHM_MAX_RECTS)
+					rects[num_rects] = rect;
+				num_rects++;
+			}
+
+			if (num_rects > XSHM_MAX_RECTS) {
+				rects[0] = region_r->extents;
+				num_rects = xshm_clip_rect(data, &rects[0]) ? 1 : 0;
+			}
+		}
+
+		free(region_r);
+	}
+
+	if (full) {
+		rects[0].x = 0;
+		rects[0].y = 0;
+		rects[0].width = (uint16_t)data->adj_width;
+		rects[0].height = (uint16_t)data->adj_height;
+		num_rects = 1;
+	}
+
+	return num_rects;
+}
+
+/**
+ * Capture the damaged parts of the screen into a free buffer
+ */
+static void xshm_capture_frame(struct xshm_data *data)
+{
+	xcb_rectangle_t rects[XSHM_MAX_RECTS];
+	xcb_shm_get_image_cookie_t cookies[XSHM_MAX_RECTS];
+	bool pending;
+	int idx;
+
+	pthread_mutex_lock(&data->buffer_mutex);
+	/* neither the buffer waiting to be uploaded nor the one being uploaded */
+	pending = data->ready_buffer != -1;
+	idx = data->upload_buffer == 0 ? 1 : 0;
+	pthread_mutex_unlock(&data->buffer_mutex);
+
+	/* the previous frame was not uploaded yet, the damage keeps adding up
+	 * on the server until it is */
+	if (pending)
+		return;
+
+	size_t num_rects = xshm_get_damage(data, rects);
+	if (!num_rects) {
+		os_atomic_inc_long(&data->frames_skipped);
+		return;
+	}
+
+	struct xshm_buffer *buf = &data->buffers[idx];
+	uint32_t offset = 0;
+
+	/* send all requests before waiting, so it's one round trip */
+	for (size_t i = 0; i < num_rects; i++) {
+		xcb_rectangle_t *rect = &rects[i];
+		cookies[i] = xcb_shm_get_image_unchecked(data->xcb, data->xcb_screen->root,
+							 data->adj_x_org + rect->x, data->adj_y_org + rect->y,
+							 rect->width, rect->height, ~0, XCB_IMAGE_FORMAT_Z_PIXMAP,
+							 buf->shm->seg, offset);
+		buf->rects[i] = *rect;
+		offset += rect->width * rect->height * 4;
+	}
+
+	bool success = true;
+	for (size_t i = 0; i < num_rects; i++) {
+		xcb_shm_get_image_reply_t *img_r = xcb_shm_get_image_reply(data->xcb, cookies[i], NULL);
+		if (!img_r)
+			success = false;
+		free(img_r);
+	}
+
+	if (!success) {
+		os_atomic_set_bool(&data->need_full, true);
+		return;
+	}
+
+	buf->num_rects = num_rects;
+
+	pthread_mutex_lock(&data->buffer_mutex);
+	data->ready_buffer = idx;
+	pthread_mutex_unlock(&data->buffer_mutex);
+
+	os_atomic_inc_long(&data->frames_captured);
+}
+
+static void *xshm_capture_thread(void *vptr)
+{
+	XSHM_DATA(vptr);
+
+	os_set_thread_name("xshm-input: capture");
+
+	while (os_event_wait(data->capture_event) == 0) {
+		if (os_atomic_load_bool(&data->stop_capture))
+			break;
+
+		xshm_capture_frame(data);
+	}
+
+	return NULL;
+}
+
+/**
+ * Copy the captured parts of a buffer to the texture
+ *
+ * Only the damaged rows are written, this relies on the texture's upload
+ * buffer keeping the rest of the previous frame.  This saves the copy on the
+ * CPU, the texture itself may still be uploaded in full when unmapped.
+ *
+ * @note requires to be called within the obs graphics context
+ */
+static void xshm_upload_buffer(struct xshm_data *data, struct xshm_buffer *buf)
+{
+	uint8_t *ptr;
+	uint32_t linesize;
+	long bytes = 0;
+
+	if (!gs_texture_map(data->texture, &ptr, &linesize)) {
+		os_atomic_set_bool(&data->need_full, true);
+		return;
+	}
+
+	const uint8_t *src = buf->shm->data;
+
+	for (size_t i = 0; i < buf->num_rects; i++) {
+		const xcb_rectangle_t *rect = &buf->rects[i];
+		const size_t row = rect->width * 4;
+		uint8_t *dst = ptr + rect->y * linesize + rect->x * 4;
+
+		for (uint16_t y = 0; y < rect->height; y++) {
+			memcpy(dst, src, row);
+			dst += linesize;
+			src += row;
+		}
+
+		bytes += (long)(row * rect->height);
+	}
+
+	gs_texture_unmap(data->texture);
+
+	os_atomic_set_long(&data->last_bytes_copied, bytes);
+	os_atomic_set_long(&data->bytes_copied, os_atomic_load_long(&data->bytes_copied) + bytes);
+}
+
 /**
  * Returns the name of the plugin
  */
@@ -184,6 +493,16 @@ static const char *xshm_getname(void *unused)
  */
 static void xshm_capture_stop(struct xshm_data *data)
 {
+	if (data->capture_thread_active) {
+		os_atomic_set_bool(&data->stop_capture, true);
+		os_event_signal(data->capture_event);
+		pthread_join(data->capture_thread, NULL);
+		data->capture_thread_active = false;
+
+		blog(LOG_INFO, "Captured %ld frames, skipped %ld unchanged, copied %ld MB", data->frames_captured,
+		     data->frames_skipped, data->bytes_copied / (1024 * 1024));
+	}
+
 	obs_enter_graphics();
 
 	if (data->texture) {
@@ -197,12 +516,15 @@ static void xshm_capture_stop(struct xshm_data *data)
 
 	obs_leave_graphics();
 
-	if (data->xshm) {
-		xshm_xcb_detach(data->xshm);
-		data->xshm = NULL;
+	for (size_t i = 0; i < XSHM_BUFFERS; i++) {
+		if (data->buffers[i].shm) {
+			xshm_xcb_detach(data->buffers[i].shm);
+			data->buffers[i].shm = NULL;
+		}
 	}
 
 	if (data->xcb) {
+		xshm_damage_free(data);
 		xcb_disconnect(data->xcb);
 		data->xcb = NULL;
 	}
@@ -247,12 +569,16 @@ static void xshm_capture_start(struct xshm_data *data)
 		goto fail;
 	}
 
-	data->xshm = xshm_xcb_attach(data->xcb, data->adj_width, data->adj_height);
-	if (!data->xshm) {
-		blog(LOG_ERROR, "failed to attach shm !");
-		goto fail;
+	for (size_t i = 0; i < XSHM_BUFFERS; i++) {
+		data->buffers[i].shm = xshm_xcb_attach(data->xcb, data->adj_width, data->adj_height);
+		if (!data->buffers[i].shm) {
+			blog(LOG_ERROR, "failed to attach shm !");
+			goto fail;
+		}
 	}
 
+	xshm_damage_init(data);
+
 	data->cursor = xcb_xcursor_init(data->xcb);
 	xcb_xcursor_offset(data->cursor, data->adj_x_org, data->adj_y_org);
 
@@ -262,6 +588,22 @@ static void xshm_capture_start(struct xshm_data *data)
 
 	obs_leave_graphics();
 
+	data->ready_buffer = -1;
+	data->upload_buffer = -1;
+	data->damaged = true;
+	data->need_full = true;
+	data->stop_capture = false;
+	data->frames_captured = 0;
+	data->frames_skipped = 0;
+	data->bytes_copied = 0;
+	data->last_bytes_copied = 0;
+
+	if (pthread_create(&data->capture_thread, NULL, xshm_capture_thread, data) != 0) {
+		blog(LOG_ERROR, "failed to create capture thread !");
+		goto fail;
+	}
+	data->capture_thread_active = true;
+
 	return;
 fail:
 	xshm_capture_stop(data);
@@ -465,9 +807,24 @@ static void xshm_destroy(void *vptr)
 
 	xshm_capture_stop(data);
 
+	os_event_destroy(data->capture_event);
+	pthread_mutex_destroy(&data->buffer_mutex);
 	bfree(data);
 }
 
+/**
+ * Get the capture statistics
+ */
+static void xshm_get_stats(void *vptr, calldata_t *cd)
+{
+	XSHM_DATA(vptr);
+
+	calldata_set_int(cd, "frames_captured", os_atomic_load_long(&data->frames_captured));
+	calldata_set_int(cd, "frames_skipped", os_atomic_load_long(&data->frames_skipped));
+	calldata_set_int(cd, "bytes_copied", os_atomic_load_long(&data->bytes_copied));
+	calldata_set_int(cd, "last_bytes_copied", os_atomic_load_long(&data->last_bytes_copied));
+}
+
 /**
  * Create the capture
  */
@@ -476,6 +833,22 @@ static void *xshm_create(obs_data_t *settings, obs_source_t *source)
 	struct xshm_data *data = bzalloc(sizeof(struct xshm_data));
 	data->source = source;
 
+	if (pthread_mutex_init(&data->buffer_mutex, NULL) != 0) {
+		bfree(data);
+		return NULL;
+	}
+	if (os_event_init(&data->capture_event, OS_EVENT_TYPE_AUTO) != 0) {
+		pthread_mutex_destroy(&data->buffer_mutex);
+		bfree(data);
+		return NULL;
+	}
+
+	proc_handler_t *ph = obs_source_get_proc_handler(source);
+	proc_handler_add(ph,
+			 "void get_stats(out int frames_captured, out int frames_skipped, out int bytes_copied, "
+			 "out int last_bytes_copied)",
+			 xshm_get_stats, data);
+
 	xshm_update(data, settings);
 
 	return data;
@@ -494,27 +867,31 @@ static void xshm_video_tick(void *vptr, float seconds)
 	if (!obs_source_showing(data->source))
 		return;
 
-	xcb_shm_get_image_cookie_t img_c;
-	xcb_shm_get_image_reply_t *img_r;
-
-	img_c = xcb_shm_get_image_unchecked(data->xcb, data->xcb_screen->root, data->adj_x_org, data->adj_y_org,
-					    data->adj_width, data->adj_height, ~0, XCB_IMAGE_FORMAT_Z_PIXMAP,
-					    data->xshm->seg, 0);
+	int idx;
 
-	img_r = xcb_shm_get_image_reply(data->xcb, img_c, NULL);
+	pthread_mutex_lock(&data->buffer_mutex);
+	idx = data->ready_buffer;
+	data->ready_buffer = -1;
+	data->upload_buffer = idx;
+	pthread_mutex_unlock(&data->buffer_mutex);
 
-	if (!img_r)
-		goto exit;
+	/* capture the next frame into the other buffer while this one is being
+	 * uploaded and rendered */
+	os_event_signal(data->capture_event);
 
 	obs_enter_graphics();
 
-	gs_texture_set_image(data->texture, (void *)data->xshm->data, data->adj_width * 4, false);
+	if (idx != -1)
+		xshm_upload_buffer(data, &data->buffers[idx]);
 	xcb_xcursor_update(data->xcb, data->cursor);
 
 	obs_leave_graphics();
 
-exit:
-	free(img_r);
+	if (idx != -1) {
+		pthread_mutex_lock(&data->buffer_mutex);
+		data->upload_buffer = -1;
+		pthread_mutex_unlock(&data->buffer_mutex);
+	}
 }
 
 /**
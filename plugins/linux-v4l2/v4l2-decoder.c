@@ -15,9 +15,12 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <inttypes.h>
 #include <obs-module.h>
 #include <linux/videodev2.h>
 #include <libavutil/error.h>
+#include <util/platform.h>
+#include <util/source-profiler.h>
 
 #include "v4l2-decoder.h"
 
@@ -130,3 +133,177 @@ int v4l2_decode_frame(struct obs_source_frame *out, uint8_t *data, size_t length
 
 	return 0;
 }
+
+/* jobs per worker, one being decoded and one waiting */
+#define JOBS_PER_WORKER 2
+
+static void *decode_thread(void *data)
+{
+	struct v4l2_decode_worker *worker = data;
+	struct v4l2_decode_pipeline *pipeline = worker->pipeline;
+
+	os_set_thread_name("v4l2: decode");
+
+	while (os_sem_wait(pipeline->pending_sem) == 0) {
+		struct v4l2_decode_job *job = NULL;
+
+		if (os_atomic_load_bool(&pipeline->stopping))
+			break;
+
+		pthread_mutex_lock(&pipeline->mutex);
+		if (pipeline->pending_jobs.size)
+			deque_pop_front(&pipeline->pending_jobs, &job, sizeof(job));
+		pthread_mutex_unlock(&pipeline->mutex);
+
+		if (!job)
+			continue;
+
+		uint64_t start = os_gettime_ns();
+		bool success = v4l2_decode_frame(&job->frame, job->data, job->size, &worker->decoder) == 0 &&
+			       job->frame.data[0];
+		uint64_t decoded = os_gettime_ns();
+
+		if (!success)
+			blog(LOG_ERROR, "failed to unpack jpeg");
+
+		/* the decoded frame lives in this worker's decoder, so it is
+		 * output from here once all earlier frames have been */
+		pthread_mutex_lock(&pipeline->mutex);
+		while (job->seq != pipeline->output_seq && !os_atomic_load_bool(&pipeline->stopping))
+			pthread_cond_wait(&pipeline->output_cond, &pipeline->mutex);
+		pthread_mutex_unlock(&pipeline->mutex);
+
+		if (success && !os_atomic_load_bool(&pipeline->stopping)) {
+			source_profiler_async_stage_time(pipeline->source, SOURCE_PROFILER_ASYNC_STAGE_DECODE,
+							 decoded - start);
+			source_profiler_async_stage_time(pipeline->source, SOURCE_PROFILER_ASYNC_STAGE_REORDER,
+							 os_gettime_ns() - decoded);
+			obs_source_output_video(pipeline->source, &job->frame);
+		}
+
+		pthread_mutex_lock(&pipeline->mutex);
+		pipeline->output_seq++;
+		deque_push_back(&pipeline->free_jobs, &job, sizeof(job));
+		pthread_cond_broadcast(&pipeline->output_cond);
+		pthread_mutex_unlock(&pipeline->mutex);
+	}
+
+	return NULL;
+}
+
+int v4l2_init_decode_pipeline(struct v4l2_decode_pipeline *pipeline, obs_source_t *source, int pixfmt,
+			      size_t num_workers)
+{
+	pipeline->source = source;
+
+	if (pthread_mutex_init(&pipeline->mutex, NULL) != 0)
+		return -1;
+	if (pthread_cond_init(&pipeline->output_cond, NULL) != 0) {
+		pthread_mutex_destroy(&pipeline->mutex);
+		return -1;
+	}
+	if (os_sem_init(&pipeline->pending_sem, 0) != 0) {
+		pthread_cond_destroy(&pipeline->output_cond);
+		pthread_mutex_destroy(&pipeline->mutex);
+		return -1;
+	}
+	pipeline->initialized = true;
+
+	pipeline->num_jobs = num_workers * JOBS_PER_WORKER;
+	pipeline->jobs = bzalloc(pipeline->num_jobs * sizeof(struct v4l2_decode_job));
+	for (size_t i = 0; i < pipeline->num_jobs; i++) {
+		struct v4l2_decode_job *job = &pipeline->jobs[i];
+		deque_push_back(&pipeline->free_jobs, &job, sizeof(job));
+	}
+
+	pipeline->workers = bzalloc(num_workers * sizeof(struct v4l2_decode_worker));
+	pipeline->num_workers = num_workers;
+
+	for (size_t i = 0; i < num_workers; i++) {
+		struct v4l2_decode_worker *worker = &pipeline->workers[i];
+		worker->pipeline = pipeline;
+
+		if (v4l2_init_decoder(&worker->decoder, pixfmt) < 0)
+			return -1;
+		if (pthread_create(&worker->thread, NULL, decode_thread, worker) != 0)
+			return -1;
+		worker->thread_active = true;
+	}
+
+	blog(LOG_INFO, "decoding on %zu threads", num_workers);
+	return 0;
+}
+
+void v4l2_destroy_decode_pipeline(struct v4l2_decode_pipeline *pipeline)
+{
+	if (!pipeline->initialized)
+		return;
+
+	os_atomic_set_bool(&pipeline->stopping, true);
+
+	pthread_mutex_lock(&pipeline->mutex);
+	pthread_cond_broadcast(&pipeline->output_cond);
+	pthread_mutex_unlock(&pipeline->mutex);
+
+	for (size_t i = 0; i < pipeline->num_workers; i++)
+		os_sem_post(pipeline->pending_sem);
+
+	for (size_t i = 0; i < pipeline->num_workers; i++) {
+		struct v4l2_decode_worker *worker = &pipeline->workers[i];
+		if (worker->thread_active)
+			pthread_join(worker->thread, NULL);
+		v4l2_destroy_decoder(&worker->decoder);
+	}
+
+	if (pipeline->frames_dropped)
+		blog(LOG_INFO, "dropped %" PRIu64 " frames waiting for a decoding thread", pipeline->frames_dropped);
+
+	for (size_t i = 0; i < pipeline->num_jobs; i++)
+		bfree(pipeline->jobs[i].data);
+
+	bfree(pipeline->workers);
+	bfree(pipeline->jobs);
+	deque_free(&pipeline->free_jobs);
+	deque_free(&pipeline->pending_jobs);
+	os_sem_destroy(pipeline->pending_sem);
+	pthread_cond_destroy(&pipeline->output_cond);
+	pthread_mutex_destroy(&pipeline->mutex);
+	memset(pipeline, 0, sizeof(*pipeline));
+}
+
+bool v4l2_decode_pipeline_submit(struct v4l2_decode_pipeline *pipeline, const uint8_t *data, size_t length,
+				 const struct obs_source_frame *frame)
+{
+	struct v4l2_decode_job *job = NULL;
+	uint64_t start = os_gettime_ns();
+
+	pthread_mutex_lock(&pipeline->mutex);
+	if (pipeline->free_jobs.size)
+		deque_pop_front(&pipeline->free_jobs, &job, sizeof(job));
+	else
+		pipeline->frames_dropped++;
+	pthread_mutex_unlock(&pipeline->mutex);
+
+	if (!job)
+		return false;
+
+	if (job->capacity < length) {
+		job->data = brealloc(job->data, length);
+		job->capacity = length;
+	}
+	memcpy(job->data, data, length);
+	job->size = length;
+	job->frame = *frame;
+
+	source_profiler_async_stage_time(pipeline->source, SOURCE_PROFILER_ASYNC_STAGE_COPY, os_gettime_ns() - start);
+
+	/* sequence numbers are only taken by frames that are decoded, so a
+	 * dropped frame leaves no gap in the output order */
+	pthread_mutex_lock(&pipeline->mutex);
+	job->seq = pipeline->next_seq++;
+	deque_push_back(&pipeline->pending_jobs, &job, sizeof(job));
+	pthread_mutex_unlock(&pipeline->mutex);
+
+	os_sem_post(pipeline->pending_sem);
+	return true;
+}
@@ -24,6 +24,8 @@ extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
 #include <libavutil/pixfmt.h>
+#include <util/deque.h>
+#include <util/threading.h>
 
 /**
  * Data structure for decoder
@@ -63,6 +65,87 @@ void v4l2_destroy_decoder(struct v4l2_decoder *decoder);
  */
 int v4l2_decode_frame(struct obs_source_frame *out, uint8_t *data, size_t length, struct v4l2_decoder *decoder);
 
+/**
+ * A captured frame waiting to be decoded
+ */
+struct v4l2_decode_job {
+	uint8_t *data;
+	size_t size;
+	size_t capacity;
+	/** order in which the frame was captured */
+	uint64_t seq;
+	struct obs_source_frame frame;
+};
+
+struct v4l2_decode_pipeline;
+
+struct v4l2_decode_worker {
+	struct v4l2_decode_pipeline *pipeline;
+	struct v4l2_decoder decoder;
+	pthread_t thread;
+	bool thread_active;
+};
+
+/**
+ * Decodes frames of an intra-only format (mjpeg) on several threads,
+ * outputting them to the source in the order they were captured
+ */
+struct v4l2_decode_pipeline {
+	obs_source_t *source;
+	bool initialized;
+
+	struct v4l2_decode_worker *workers;
+	size_t num_workers;
+
+	struct v4l2_decode_job *jobs;
+	size_t num_jobs;
+	struct deque free_jobs;
+	struct deque pending_jobs;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t output_cond;
+	os_sem_t *pending_sem;
+	uint64_t next_seq;
+	uint64_t output_seq;
+	volatile bool stopping;
+
+	uint64_t frames_dropped;
+};
+
+/**
+ * Start the decode pipeline.
+ * The pipeline must be destroyed on failure.
+ *
+ * @param pipeline the pipeline structure, zeroed
+ * @param source the source to output the decoded frames to
+ * @param pixfmt which codec is used
+ * @param num_workers number of decoding threads
+ * @return non-zero on failure
+ */
+int v4l2_init_decode_pipeline(struct v4l2_decode_pipeline *pipeline, obs_source_t *source, int pixfmt,
+			      size_t num_workers);
+
+/**
+ * Stop the decoding threads and free any data associated with the pipeline.
+ * Frames that were not decoded yet are discarded.
+ *
+ * @param pipeline the pipeline structure
+ */
+void v4l2_destroy_decode_pipeline(struct v4l2_decode_pipeline *pipeline);
+
+/**
+ * Copy a captured frame into the pipeline, so the device buffer can be
+ * requeued right away
+ *
+ * @param pipeline the pipeline as initialized by v4l2_init_decode_pipeline
+ * @param data the codec data
+ * @param length length of the data
+ * @param frame the obs frame prepared for the capture, with the timestamp set
+ * @return false if all jobs are busy and the frame was dropped
+ */
+bool v4l2_decode_pipeline_submit(struct v4l2_decode_pipeline *pipeline, const uint8_t *data, size_t length,
+				 const struct obs_source_frame *frame);
+
 #ifdef __cplusplus
 }
 #endif
@@ -41,6 +41,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define FALLBACK_FRAMERATE 30
 
+/* mjpeg frames are decoded on up to this many threads */
+#define MAX_DECODE_THREADS 4
+
 #if HAVE_UDEV
 #include "v4l2-udev.h"
 #endif
@@ -82,6 +85,7 @@ struct v4l2_data {
 	pthread_t thread;
 	os_event_t *event;
 	struct v4l2_decoder decoder;
+	struct v4l2_decode_pipeline pipeline;
 
 	bool framerate_unchanged;
 	bool resolution_unchanged;
@@ -258,6 +262,13 @@ static void *v4l2_thread(void *vptr)
 
 		start = (uint8_t *)data->buffers.info[buf.index].start;
 
+		/* the decoding threads output the frame, the buffer can go
+		 * back to the device once it's copied */
+		if (data->pipeline.initialized) {
+			v4l2_decode_pipeline_submit(&data->pipeline, start, buf.bytesused, &out);
+			goto continue_queue_buffer;
+		}
+
 		if (data->pixfmt == V4L2_PIX_FMT_MJPEG || data->pixfmt == V4L2_PIX_FMT_H264) {
 			if (v4l2_decode_frame(&out, start, buf.bytesused, &data->decoder) < 0) {
 				blog(LOG_ERROR, "failed to unpack jpeg or h264");
@@ -838,9 +849,10 @@ static void v4l2_terminate(struct v4l2_data *data)
 		data->thread = 0;
 	}
 
-	if (data->pixfmt == V4L2_PIX_FMT_MJPEG || data->pixfmt == V4L2_PIX_FMT_H264) {
+	if (data->pixfmt == V4L2_PIX_FMT_H264) {
 		v4l2_destroy_decoder(&data->decoder);
 	}
+	v4l2_destroy_decode_pipeline(&data->pipeline);
 	v4l2_destroy_mmap(&data->buffers);
 
 	if (data->dev != -1) {
@@ -958,7 +970,20 @@ static void v4l2_init(struct v4l2_data *data)
 		goto fail;
 	}
 
-	if (data->pixfmt == V4L2_PIX_FMT_MJPEG || data->pixfmt == V4L2_PIX_FMT_H264) {
+	/* mjpeg frames don't depend on each other, so they can be decoded in
+	 * parallel, h264 is decoded on the capture thread */
+	if (data->pixfmt == V4L2_PIX_FMT_MJPEG) {
+		int threads = os_get_logical_cores() - 1;
+		if (threads < 1)
+			threads = 1;
+		if (threads > MAX_DECODE_THREADS)
+			threads = MAX_DECODE_THREADS;
+
+		if (v4l2_init_decode_pipeline(&data->pipeline, data->source, data->pixfmt, threads) < 0) {
+			blog(LOG_ERROR, "Failed to initialize decoder");
+			goto fail;
+		}
+	} else if (data->pixfmt == V4L2_PIX_FMT_H264) {
 		if (v4l2_init_decoder(&data->decoder, data->pixfmt) < 0) {
 			blog(LOG_ERROR, "Failed to initialize decoder");
 			goto fail;
@@ -3,19 +3,64 @@
 #include <obs-module.h>
 #include <util/dstr.h>
 #include <util/platform.h>
+#include <util/threading.h>
+#include <util/deque.h>
 #include <linux/videodev2.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <poll.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <dirent.h>
 #include <errno.h>
 #include <string.h>
 
+/* frames waiting for the writer thread, the oldest one is dropped when a new
+ * frame arrives and the queue is full */
+#define VCAM_QUEUE_SIZE 2
+
+/* one more frame for the writer thread, a full queue hands its oldest frame
+ * to the new one */
+#define VCAM_FRAME_COUNT (VCAM_QUEUE_SIZE + 1)
+
+#define VCAM_DEVICE_BUFFERS 4
+
+struct vcam_frame {
+	uint8_t *data;
+	uint64_t ts;
+};
+
+struct vcam_buffer {
+	void *start;
+	size_t length;
+};
+
 struct virtualcam_data {
 	obs_output_t *output;
 	int device;
 	uint32_t frame_size;
 	bool use_caps_workaround;
+
+	/* device buffers for streaming I/O, write() is used without them */
+	struct vcam_buffer *buffers;
+	uint32_t buffer_count;
+	uint32_t buffers_queued;
+
+	struct vcam_frame frames[VCAM_FRAME_COUNT];
+	struct deque free_frames;
+	struct deque queued_frames;
+	pthread_mutex_t frames_mutex;
+	bool capturing;
+
+	pthread_t writer_thread;
+	bool writer_thread_active;
+	os_sem_t *writer_sem;
+	volatile bool stopping;
+
+	long frames_written;
+	long frames_dropped;
+	uint64_t total_latency_ns;
+	uint64_t max_latency_ns;
 };
 
 static const char *virtualcam_name(void *unused)
@@ -28,6 +73,8 @@ static void virtualcam_destroy(void *data)
 {
 	struct virtualcam_data *vcam = (struct virtualcam_data *)data;
 	close(vcam->device);
+	os_sem_destroy(vcam->writer_sem);
+	pthread_mutex_destroy(&vcam->frames_mutex);
 	bfree(data);
 }
 
@@ -129,11 +176,120 @@ bool loopback_module_available()
 }
 #endif
 
+static void virtualcam_get_stats(void *data, calldata_t *cd)
+{
+	struct virtualcam_data *vcam = (struct virtualcam_data *)data;
+	long written;
+
+	pthread_mutex_lock(&vcam->frames_mutex);
+	written = vcam->frames_written;
+	calldata_set_int(cd, "frames_written", written);
+	calldata_set_int(cd, "frames_dropped", vcam->frames_dropped);
+	calldata_set_int(cd, "avg_latency_ns", written ? (long long)(vcam->total_latency_ns / written) : 0);
+	calldata_set_int(cd, "max_latency_ns", (long long)vcam->max_latency_ns);
+	pthread_mutex_unlock(&vcam->frames_mutex);
+}
+
+static void free_device_buffers(struct virtualcam_data *vcam)
+{
+	for (uint32_t i = 0; i < vcam->buffer_count; i++) {
+		if (vcam->buffers[i].start != MAP_FAILED)
+			munmap(vcam->buffers[i].start, vcam->buffers[i].length);
+	}
+
+	bfree(vcam->buffers);
+	vcam->buffers = NULL;
+	vcam->buffer_count = 0;
+	vcam->buffers_queued = 0;
+}
+
+/* sets up mmap streaming I/O, false if the device doesn't support it */
+static bool create_device_buffers(struct virtualcam_data *vcam)
+{
+	struct v4l2_requestbuffers req;
+	struct v4l2_buffer buf;
+
+	memset(&req, 0, sizeof(req));
+	req.count = VCAM_DEVICE_BUFFERS;
+	req.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+	req.memory = V4L2_MEMORY_MMAP;
+
+	if (ioctl(vcam->device, VIDIOC_REQBUFS, &req) < 0 || req.count < 2)
+		return false;
+
+	vcam->buffers = bzalloc(req.count * sizeof(struct vcam_buffer));
+	vcam->buffer_count = req.count;
+
+	for (uint32_t i = 0; i < req.count; i++) {
+		memset(&buf, 0, sizeof(buf));
+		buf.type = req.type;
+		buf.memory = req.memory;
+		buf.index = i;
+
+		vcam->buffers[i].start = MAP_FAILED;
+
+		if (ioctl(vcam->device, VIDIOC_QUERYBUF, &buf) < 0 || buf.length < vcam->frame_size)
+			goto fail;
+
+		vcam->buffers[i].length = buf.length;
+		vcam->buffers[i].start =
+			mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, vcam->device, buf.m.offset);
+		if (vcam->buffers[i].start == MAP_FAILED)
+			goto fail;
+	}
+
+	return true;
+
+fail:
+	free_device_buffers(vcam);
+
+	memset(&req, 0, sizeof(req));
+	req.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+	req.memory = V4L2_MEMORY_MMAP;
+	ioctl(vcam->device, VIDIOC_REQBUFS, &req);
+	return false;
+}
+
+static void free_frames(struct virtualcam_data *vcam)
+{
+	for (size_t i = 0; i < VCAM_FRAME_COUNT; i++) {
+		bfree(vcam->frames[i].data);
+		vcam->frames[i].data = NULL;
+	}
+
+	deque_free(&vcam->free_frames);
+	deque_free(&vcam->queued_frames);
+}
+
+static void create_frames(struct virtualcam_data *vcam)
+{
+	for (size_t i = 0; i < VCAM_FRAME_COUNT; i++) {
+		struct vcam_frame *frame = &vcam->frames[i];
+		frame->data = bmalloc(vcam->frame_size);
+		deque_push_back(&vcam->free_frames, &frame, sizeof(frame));
+	}
+}
+
 static void *virtualcam_create(obs_data_t *settings, obs_output_t *output)
 {
 	struct virtualcam_data *vcam = (struct virtualcam_data *)bzalloc(sizeof(*vcam));
 	vcam->output = output;
 
+	if (pthread_mutex_init(&vcam->frames_mutex, NULL) != 0) {
+		bfree(vcam);
+		return NULL;
+	}
+	if (os_sem_init(&vcam->writer_sem, 0) != 0) {
+		pthread_mutex_destroy(&vcam->frames_mutex);
+		bfree(vcam);
+		return NULL;
+	}
+
+	proc_handler_t *ph = obs_output_get_proc_handler(output);
+	proc_handler_add(ph, "void get_stats(out int frames_written, out int frames_dropped, out int avg_latency_ns, "
+			     "out int max_latency_ns)",
+			 virtualcam_get_stats, vcam);
+
 	UNUSED_PARAMETER(settings);
 	return vcam;
 }
@@ -180,6 +336,119 @@ fail_close_reset_caps_fd:
 	return false;
 }
 
+/* waits until the device gives back a buffer, false if it didn't within a
+ * frame or if the output is stopping */
+static bool dequeue_buffer(struct virtualcam_data *vcam, struct v4l2_buffer *buf)
+{
+	struct pollfd pfd = {.fd = vcam->device, .events = POLLOUT};
+	int timeout_ms = (int)(obs_get_frame_interval_ns() / 1000000) + 1;
+
+	for (;;) {
+		if (ioctl(vcam->device, VIDIOC_DQBUF, buf) == 0)
+			return true;
+		if (errno != EAGAIN && errno != EINTR)
+			return false;
+		if (os_atomic_load_bool(&vcam->stopping))
+			return false;
+
+		int ret = poll(&pfd, 1, timeout_ms);
+		if (ret == 0)
+			return false;
+		if (ret < 0 && errno != EINTR)
+			return false;
+	}
+}
+
+static bool write_frame_mmap(struct virtualcam_data *vcam, const struct vcam_frame *frame)
+{
+	struct v4l2_buffer buf;
+
+	memset(&buf, 0, sizeof(buf));
+	buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+	buf.memory = V4L2_MEMORY_MMAP;
+
+	/* every buffer is handed to the device once before any is reused */
+	if (vcam->buffers_queued < vcam->buffer_count)
+		buf.index = vcam->buffers_queued++;
+	else if (!dequeue_buffer(vcam, &buf))
+		return false;
+
+	memcpy(vcam->buffers[buf.index].start, frame->data, vcam->frame_size);
+
+	buf.bytesused = vcam->frame_size;
+	buf.field = V4L2_FIELD_NONE;
+	buf.timestamp.tv_sec = (time_t)(frame->ts / 1000000000);
+	buf.timestamp.tv_usec = (suseconds_t)(frame->ts % 1000000000 / 1000);
+
+	return ioctl(vcam->device, VIDIOC_QBUF, &buf) == 0;
+}
+
+static bool write_frame(struct virtualcam_data *vcam, const struct vcam_frame *frame)
+{
+	uint32_t frame_size = vcam->frame_size;
+	const uint8_t *data = frame->data;
+	struct pollfd pfd = {.fd = vcam->device, .events = POLLOUT};
+
+	while (frame_size > 0) {
+		ssize_t written = write(vcam->device, data, frame_size);
+		if (written > 0) {
+			data += written;
+			frame_size -= (uint32_t)written;
+			continue;
+		}
+
+		if (written == -1 && errno == EINTR)
+			continue;
+		if (written == -1 && errno == EAGAIN && !os_atomic_load_bool(&vcam->stopping) &&
+		    poll(&pfd, 1, 100) >= 0)
+			continue;
+
+		return false;
+	}
+
+	return true;
+}
+
+static void *writer_thread(void *data)
+{
+	struct virtualcam_data *vcam = (struct virtualcam_data *)data;
+
+	os_set_thread_name("v4l2-output: writer");
+
+	while (os_sem_wait(vcam->writer_sem) == 0) {
+		struct vcam_frame *frame = NULL;
+
+		if (os_atomic_load_bool(&vcam->stopping))
+			break;
+
+		pthread_mutex_lock(&vcam->frames_mutex);
+		if (vcam->queued_frames.size)
+			deque_pop_front(&vcam->queued_frames, &frame, sizeof(frame));
+		pthread_mutex_unlock(&vcam->frames_mutex);
+
+		/* already dropped for a newer frame */
+		if (!frame)
+			continue;
+
+		bool success = vcam->buffer_count ? write_frame_mmap(vcam, frame) : write_frame(vcam, frame);
+		uint64_t latency = os_gettime_ns() - frame->ts;
+
+		pthread_mutex_lock(&vcam->frames_mutex);
+		if (success) {
+			vcam->frames_written++;
+			vcam->total_latency_ns += latency;
+			if (latency > vcam->max_latency_ns)
+				vcam->max_latency_ns = latency;
+		} else {
+			vcam->frames_dropped++;
+		}
+		deque_push_back(&vcam->free_frames, &frame, sizeof(frame));
+		pthread_mutex_unlock(&vcam->frames_mutex);
+	}
+
+	return NULL;
+}
+
 static bool try_connect(void *data, const char *device)
 {
 	static bool use_caps_workaround = false;
@@ -193,7 +462,7 @@ static bool try_connect(void *data, const char *device)
 
 	vcam->frame_size = width * height * 2;
 
-	vcam->device = open(device, O_RDWR);
+	vcam->device = open(device, O_RDWR | O_NONBLOCK);
 
 	if (vcam->device < 0)
 		return false;
@@ -244,16 +513,42 @@ static bool try_connect(void *data, const char *device)
 	memset(&parm, 0, sizeof(parm));
 	parm.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
 
-	if (vcam->use_caps_workaround && ioctl(vcam->device, VIDIOC_STREAMON, &format.type) < 0) {
+	if (!create_device_buffers(vcam))
+		blog(LOG_INFO, "'%s' does not support streaming I/O, using write()", device);
+
+	if ((vcam->buffer_count || vcam->use_caps_workaround) &&
+	    ioctl(vcam->device, VIDIOC_STREAMON, &format.type) < 0) {
 		blog(LOG_ERROR, "Failed to start streaming on '%s' (%s)", device, strerror(errno));
-		goto fail_close_device;
+		goto fail_free_buffers;
+	}
+
+	pthread_mutex_lock(&vcam->frames_mutex);
+	create_frames(vcam);
+	vcam->capturing = true;
+	pthread_mutex_unlock(&vcam->frames_mutex);
+	vcam->frames_written = 0;
+	vcam->frames_dropped = 0;
+	vcam->total_latency_ns = 0;
+	vcam->max_latency_ns = 0;
+	vcam->stopping = false;
+
+	if (pthread_create(&vcam->writer_thread, NULL, writer_thread, vcam) != 0) {
+		blog(LOG_ERROR, "Failed to create virtual camera writer thread");
+		pthread_mutex_lock(&vcam->frames_mutex);
+		vcam->capturing = false;
+		free_frames(vcam);
+		pthread_mutex_unlock(&vcam->frames_mutex);
+		goto fail_free_buffers;
 	}
+	vcam->writer_thread_active = true;
 
 	blog(LOG_INFO, "Virtual camera started");
 	obs_output_begin_data_capture(vcam->output, 0);
 
 	return true;
 
+fail_free_buffers:
+	free_device_buffers(vcam);
 fail_close_device:
 	close(vcam->device);
 	return false;
@@ -324,28 +619,77 @@ static void virtualcam_stop(void *data, uint64_t ts)
 	struct virtualcam_data *vcam = (struct virtualcam_data *)data;
 	obs_output_end_data_capture(vcam->output);
 
+	if (vcam->writer_thread_active) {
+		os_atomic_set_bool(&vcam->stopping, true);
+		os_sem_post(vcam->writer_sem);
+		pthread_join(vcam->writer_thread, NULL);
+		vcam->writer_thread_active = false;
+	}
+
 	uint32_t buf_type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
 
-	if (vcam->use_caps_workaround && ioctl(vcam->device, VIDIOC_STREAMOFF, buf_type) < 0) {
+	if ((vcam->buffer_count || vcam->use_caps_workaround) && ioctl(vcam->device, VIDIOC_STREAMOFF, &buf_type) < 0) {
 		blog(LOG_WARNING, "Failed to stop streaming on video device %d (%s)", vcam->device, strerror(errno));
 	}
 
+	free_device_buffers(vcam);
+
+	/* the raw video callback is only disconnected later on, so a frame may
+	 * still be arriving here */
+	pthread_mutex_lock(&vcam->frames_mutex);
+	vcam->capturing = false;
+	free_frames(vcam);
+	pthread_mutex_unlock(&vcam->frames_mutex);
+
 	close(vcam->device);
-	blog(LOG_INFO, "Virtual camera stopped");
+	blog(LOG_INFO, "Virtual camera stopped, %ld frames written, %ld dropped, average latency %.2f ms",
+	     vcam->frames_written, vcam->frames_dropped,
+	     vcam->frames_written ? (double)vcam->total_latency_ns / vcam->frames_written / 1000000.0 : 0.0);
 
 	UNUSED_PARAMETER(ts);
 }
 
+/* runs on the video thread, so this only copies the frame for the writer
+ * thread and never waits on the device.  The copy is done under frames_mutex
+ * so that stopping can't free the frames underneath it. */
 static void virtual_video(void *param, struct video_data *frame)
 {
 	struct virtualcam_data *vcam = (struct virtualcam_data *)param;
-	uint32_t frame_size = vcam->frame_size;
-	while (frame_size > 0) {
-		ssize_t written = write(vcam->device, frame->data[0], vcam->frame_size);
-		if (written == -1)
-			break;
-		frame_size -= written;
+	struct vcam_frame *out = NULL;
+
+	pthread_mutex_lock(&vcam->frames_mutex);
+	if (!vcam->capturing) {
+		pthread_mutex_unlock(&vcam->frames_mutex);
+		return;
+	}
+
+	if (vcam->queued_frames.size >= VCAM_QUEUE_SIZE * sizeof(out)) {
+		deque_pop_front(&vcam->queued_frames, &out, sizeof(out));
+		vcam->frames_dropped++;
+	} else if (vcam->free_frames.size) {
+		deque_pop_front(&vcam->free_frames, &out, sizeof(out));
 	}
+
+	if (out) {
+		memcpy(out->data, frame->data[0], vcam->frame_size);
+		out->ts = os_gettime_ns();
+		deque_push_back(&vcam->queued_frames, &out, sizeof(out));
+	} else {
+		vcam->frames_dropped++;
+	}
+	pthread_mutex_unlock(&vcam->frames_mutex);
+
+	if (out)
+		os_sem_post(vcam->writer_sem);
+}
+
+static int virtualcam_dropped_frames(void *data)
+{
+	struct virtualcam_data *vcam = (struct virtualcam_data *)data;
+	pthread_mutex_lock(&vcam->frames_mutex);
+	int dropped = (int)vcam->frames_dropped;
+	pthread_mutex_unlock(&vcam->frames_mutex);
+	return dropped;
 }
 
 struct obs_output_info virtualcam_info = {
@@ -357,4 +701,5 @@ struct obs_output_info virtualcam_info = {
 	.start = virtualcam_start,
 	.stop = virtualcam_stop,
 	.raw_video = virtual_video,
+	.get_dropped_frames = virtualcam_dropped_frames,
 };
@@ -0,0 +1,254 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <string.h>
+
+#include "ffmpeg-mux-shm.h"
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#define FFM_SHM_VERSION 1
+#define FFM_SHM_DATA_OFFSET 64
+
+struct ffm_shm_header {
+	uint32_t version;
+	uint32_t capacity;
+	volatile long read_pos;
+};
+
+struct ffm_shm {
+	char name[32];
+	bool owner;
+	size_t map_size;
+	struct ffm_shm_header *header;
+	uint8_t *data;
+	uint32_t mask;
+	uint32_t write_pos;
+#ifdef _WIN32
+	HANDLE handle;
+#endif
+};
+
+static void make_name(char *name, size_t size)
+{
+	static volatile long counter = 0;
+	long id = os_atomic_inc_long(&counter);
+
+#ifdef _WIN32
+	snprintf(name, size, "Local\\obs-ffm-%lx-%lx", GetCurrentProcessId(), id);
+#else
+	snprintf(name, size, "/obs-ffm-%lx-%lx", (long)getpid(), id);
+#endif
+}
+
+#ifdef _WIN32
+static void *map_shared_memory(struct ffm_shm *shm, bool create)
+{
+	wchar_t *name_w = NULL;
+	void *ptr = NULL;
+
+	os_utf8_to_wcs_ptr(shm->name, 0, &name_w);
+	if (!name_w)
+		return NULL;
+
+	if (create) {
+		shm->handle = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+						 (DWORD)((uint64_t)shm->map_size >> 32), (DWORD)shm->map_size, name_w);
+		if (shm->handle && GetLastError() == ERROR_ALREADY_EXISTS) {
+			CloseHandle(shm->handle);
+			shm->handle = NULL;
+		}
+	} else {
+		shm->handle = OpenFileMappingW(FILE_MAP_ALL_ACCESS, false, name_w);
+	}
+
+	bfree(name_w);
+
+	if (!shm->handle)
+		return NULL;
+
+	ptr = MapViewOfFile(shm->handle, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+	if (ptr && !create) {
+		MEMORY_BASIC_INFORMATION mbi;
+		if (VirtualQuery(ptr, &mbi, sizeof(mbi)))
+			shm->map_size = mbi.RegionSize;
+	}
+
+	return ptr;
+}
+
+static void unmap_shared_memory(struct ffm_shm *shm)
+{
+	if (shm->header)
+		UnmapViewOfFile(shm->header);
+	if (shm->handle)
+		CloseHandle(shm->handle);
+}
+#else
+static void *map_shared_memory(struct ffm_shm *shm, bool create)
+{
+	void *ptr;
+	int fd;
+
+	if (create) {
+		fd = shm_open(shm->name, O_CREAT | O_EXCL | O_RDWR, 0600);
+		if (fd == -1)
+			return NULL;
+		if (ftruncate(fd, (off_t)shm->map_size) == -1) {
+			close(fd);
+			shm_unlink(shm->name);
+			return NULL;
+		}
+	} else {
+		struct stat st;
+
+		fd = shm_open(shm->name, O_RDWR, 0);
+		if (fd == -1)
+			return NULL;
+
+		/* nobody else needs to open it, so don't leave it behind
+		 * if either process crashes */
+		shm_unlink(shm->name);
+
+		if (fstat(fd, &st) == -1) {
+			close(fd);
+			return NULL;
+		}
+		shm->map_size = (size_t)st.st_size;
+	}
+
+	ptr = mmap(NULL, shm->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (ptr == MAP_FAILED) {
+		if (create)
+			shm_unlink(shm->name);
+		return NULL;
+	}
+
+	return ptr;
+}
+
+static void unmap_shared_memory(struct ffm_shm *shm)
+{
+	if (shm->header)
+		munmap(shm->header, shm->map_size);
+	if (shm->owner)
+		shm_unlink(shm->name);
+}
+#endif
+
+struct ffm_shm *ffm_shm_create(uint32_t capacity)
+{
+	struct ffm_shm *shm;
+
+	if (!capacity || (capacity & (capacity - 1)) != 0 || capacity > 0x40000000)
+		return NULL;
+
+	shm = bzalloc(sizeof(*shm));
+	shm->owner = true;
+	shm->map_size = FFM_SHM_DATA_OFFSET + (size_t)capacity;
+	make_name(shm->name, sizeof(shm->name));
+
+	shm->header = map_shared_memory(shm, true);
+	if (!shm->header) {
+		ffm_shm_close(shm);
+		return NULL;
+	}
+
+	shm->header->version = FFM_SHM_VERSION;
+	shm->header->capacity = capacity;
+	os_atomic_store_long(&shm->header->read_pos, 0);
+
+	shm->data = (uint8_t *)shm->header + FFM_SHM_DATA_OFFSET;
+	shm->mask = capacity - 1;
+	return shm;
+}
+
+struct ffm_shm *ffm_shm_open(const char *name)
+{
+	struct ffm_shm *shm;
+	uint32_t capacity;
+
+	if (!name || !*name || strlen(name) >= sizeof(((struct ffm_shm *)0)->name))
+		return NULL;
+
+	shm = bzalloc(sizeof(*shm));
+	strcpy(shm->name, name);
+
+	shm->header = map_shared_memory(shm, false);
+	if (!shm->header)
+		goto fail;
+
+	capacity = shm->header->capacity;
+	if (shm->header->version != FFM_SHM_VERSION || !capacity || (capacity & (capacity - 1)) != 0 ||
+	    shm->map_size < FFM_SHM_DATA_OFFSET + (size_t)capacity)
+		goto fail;
+
+	shm->data = (uint8_t *)shm->header + FFM_SHM_DATA_OFFSET;
+	shm->mask = capacity - 1;
+	return shm;
+
+fail:
+	ffm_shm_close(shm);
+	return NULL;
+}
+
+void ffm_shm_close(struct ffm_shm *shm)
+{
+	if (!shm)
+		return;
+
+	unmap_shared_memory(shm);
+	bfree(shm);
+}
+
+const char *ffm_shm_name(struct ffm_shm *shm)
+{
+	return shm->name;
+}
+
+bool ffm_shm_write(struct ffm_shm *shm, const uint8_t *data, uint32_t size, uint32_t *p_pos)
+{
+	uint32_t read_pos = (uint32_t)os_atomic_load_long(&shm->header->read_pos);
+	uint32_t pos = shm->write_pos;
+	uint32_t offset = pos & shm->mask;
+
+	if (!size || size > shm->mask)
+		return false;
+
+	/* payloads are kept contiguous, so skip the end of the buffer when
+	 * the packet doesn't fit there */
+	if (offset + size > shm->mask + 1)
+		pos += shm->mask + 1 - offset;
+	if (pos + size - read_pos > shm->mask + 1)
+		return false;
+
+	memcpy(shm->data + (pos & shm->mask), data, size);
+	shm->write_pos = pos + size;
+	*p_pos = pos;
+	return true;
+}
+
+const uint8_t *ffm_shm_read(struct ffm_shm *shm, uint32_t pos, uint32_t size)
+{
+	uint32_t offset = pos & shm->mask;
+
+	if (!size || size > shm->mask || offset + size > shm->mask + 1)
+		return NULL;
+
+	return shm->data + offset;
+}
+
+void ffm_shm_release(struct ffm_shm *shm, uint32_t pos, uint32_t size)
+{
+	os_atomic_store_long(&shm->header->read_pos, (long)(pos + size));
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Shared memory ring buffer for packet payloads.
+ *
+ * The packet info structures keep going through the pipe, which orders them
+ * and wakes up the muxer, but a packet with ffm_packet_info::in_shm set has
+ * its payload in the ring at ffm_packet_info::shm_pos instead of following
+ * it on the pipe.  Payloads are stored contiguously and consumed in order,
+ * so the muxer frees space simply by advancing the read position past the
+ * packet it has finished with.  Positions wrap around at 2^32, which is why
+ * the capacity has to be a power of two.
+ *
+ * The writer never blocks on the ring: when a packet doesn't fit, it is sent
+ * through the pipe as before.
+ */
+
+struct ffm_shm;
+
+extern struct ffm_shm *ffm_shm_create(uint32_t capacity);
+extern struct ffm_shm *ffm_shm_open(const char *name);
+extern void ffm_shm_close(struct ffm_shm *shm);
+
+extern const char *ffm_shm_name(struct ffm_shm *shm);
+
+extern bool ffm_shm_write(struct ffm_shm *shm, const uint8_t *data, uint32_t size, uint32_t *pos);
+
+extern const uint8_t *ffm_shm_read(struct ffm_shm *shm, uint32_t pos, uint32_t size);
+extern void ffm_shm_release(struct ffm_shm *shm, uint32_t pos, uint32_t size);
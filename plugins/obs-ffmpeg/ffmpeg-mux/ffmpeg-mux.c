@@ -25,6 +25,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "ffmpeg-mux.h"
+#include "ffmpeg-mux-shm.h"
 
 #include <util/threading.h>
 #include <util/platform.h>
@@ -97,6 +98,7 @@ struct main_params {
 	int max_luminance;
 	char *acodec;
 	char *muxer_settings;
+	char *shm_name;
 	int codec_tag;
 };
 
@@ -410,6 +412,9 @@ static bool init_params(int *argc, char ***argv, struct main_params *params, str
 
 	get_opt_str(argc, argv, &params->muxer_settings, "muxer settings");
 
+	if (*argc)
+		get_opt_str(argc, argv, &params->shm_name, "shared memory name");
+
 	return true;
 }
 
@@ -616,7 +621,7 @@ static bool ffmpeg_mux_get_header(struct ffmpeg_mux *ffm)
 {
 	struct ffm_packet_info info = {0};
 
-	bool success = safe_read(&info, sizeof(info)) == sizeof(info);
+	bool success = safe_read(&info, sizeof(info)) == sizeof(info) && !info.in_shm;
 	if (success) {
 		uint8_t *data = malloc(info.size);
 
@@ -1139,6 +1144,7 @@ int main(int argc, char *argv[])
 	struct ffmpeg_mux ffm = {0};
 	struct resize_buf rb = {0};
 	struct resize_buf rb_filename = {0};
+	struct ffm_shm *shm = NULL;
 	bool fail = false;
 	int ret;
 
@@ -1168,12 +1174,33 @@ int main(int argc, char *argv[])
 		return ret;
 	}
 
+	if (ffm.params.shm_name) {
+		shm = ffm_shm_open(ffm.params.shm_name);
+		if (!shm) {
+			fprintf(stderr, "Couldn't open shared memory '%s'\n", ffm.params.shm_name);
+			fail = true;
+		}
+	}
+
 	while (!fail && safe_read(&info, sizeof(info)) == sizeof(info)) {
 		if (info.type == FFM_PACKET_CHANGE_FILE) {
 			fail = !read_change_file(&ffm, info.size, &rb_filename, argc, argv);
 			continue;
 		}
 
+		if (info.in_shm) {
+			const uint8_t *data = shm ? ffm_shm_read(shm, info.shm_pos, info.size) : NULL;
+			if (!data) {
+				fail = true;
+				continue;
+			}
+
+			/* muxed straight out of the shared memory */
+			fail = !ffmpeg_mux_packet(&ffm, (uint8_t *)data, &info);
+			ffm_shm_release(shm, info.shm_pos, info.size);
+			continue;
+		}
+
 		resize_buf_resize(&rb, info.size);
 
 		if (safe_read(rb.buf, info.size) == info.size) {
@@ -1184,6 +1211,7 @@ int main(int argc, char *argv[])
 	}
 
 	ffmpeg_mux_free(&ffm);
+	ffm_shm_close(shm);
 	resize_buf_free(&rb);
 	resize_buf_free(&rb_filename);
 
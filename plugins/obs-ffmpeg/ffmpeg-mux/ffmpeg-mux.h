@@ -36,4 +36,9 @@ struct ffm_packet_info {
 	uint32_t index;
 	enum ffm_packet_type type;
 	bool keyframe;
+
+	/* payload is in the shared memory ring at shm_pos instead of
+	 * following on the pipe, see ffmpeg-mux-shm.h */
+	bool in_shm;
+	uint32_t shm_pos;
 };
@@ -15,6 +15,7 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 #include "ffmpeg-mux/ffmpeg-mux.h"
+#include "ffmpeg-mux/ffmpeg-mux-shm.h"
 #include "obs-ffmpeg-mux.h"
 #include "obs-ffmpeg-formats.h"
 
@@ -46,6 +47,8 @@ static const char *ffmpeg_mpegts_mux_getname(void *type)
 
 static inline void replay_buffer_clear(struct ffmpeg_muxer *stream)
 {
+	replay_file_destroy(stream);
+
 	while (stream->packets.size > 0) {
 		struct encoder_packet pkt;
 		deque_pop_front(&stream->packets, &pkt, sizeof(pkt));
@@ -53,6 +56,8 @@ static inline void replay_buffer_clear(struct ffmpeg_muxer *stream)
 	}
 
 	deque_free(&stream->packets);
+	deque_free(&stream->keyframe_index);
+	stream->first_packet_seq = 0;
 	stream->cur_size = 0;
 	stream->cur_time = 0;
 	stream->max_size = 0;
@@ -73,7 +78,7 @@ static void ffmpeg_mux_destroy(void *data)
 	da_free(stream->mux_packets);
 	deque_free(&stream->packets);
 
-	os_process_pipe_destroy(stream->pipe);
+	stop_pipe(stream);
 	dstr_free(&stream->path);
 	dstr_free(&stream->printable_path);
 	dstr_free(&stream->stream_key);
@@ -300,14 +305,56 @@ static void build_command_line(struct ffmpeg_muxer *stream, os_process_args_t **
 
 	add_stream_key(*args, stream);
 	add_muxer_params(*args, stream);
+
+	if (stream->shm)
+		os_process_args_add_arg(*args, ffm_shm_name(stream->shm));
+}
+
+/* opt-in, the frontend sets shared_memory_mb when Output/MuxSharedMemory is on */
+static void create_shared_memory(struct ffmpeg_muxer *stream)
+{
+	obs_data_t *settings = obs_output_get_settings(stream->output);
+	long long size_mb = obs_data_get_int(settings, "shared_memory_mb");
+	obs_data_release(settings);
+
+	if (size_mb <= 0)
+		return;
+
+	uint32_t capacity = 1024 * 1024;
+	while (capacity < (uint64_t)size_mb * 1024 * 1024 && capacity < 0x40000000)
+		capacity <<= 1;
+
+	stream->shm = ffm_shm_create(capacity);
+	if (stream->shm)
+		info("Sending packets through %u MB of shared memory", capacity / (1024 * 1024));
+	else
+		warn("Failed to create shared memory, sending packets through the pipe");
 }
 
 void start_pipe(struct ffmpeg_muxer *stream, const char *path)
 {
 	os_process_args_t *args = NULL;
+	create_shared_memory(stream);
 	build_command_line(stream, &args, path);
 	stream->pipe = os_process_pipe_create2(args, "w");
 	os_process_args_destroy(args);
+
+	if (!stream->pipe) {
+		ffm_shm_close(stream->shm);
+		stream->shm = NULL;
+	}
+}
+
+int stop_pipe(struct ffmpeg_muxer *stream)
+{
+	/* waits for the process to exit, so the shared memory isn't in use
+	 * anymore afterwards */
+	int ret = os_process_pipe_destroy(stream->pipe);
+	stream->pipe = NULL;
+
+	ffm_shm_close(stream->shm);
+	stream->shm = NULL;
+	return ret;
 }
 
 static void set_file_not_readable_error(struct ffmpeg_muxer *stream, obs_data_t *settings, const char *path)
@@ -466,8 +513,7 @@ int deactivate(struct ffmpeg_muxer *stream, int code)
 	}
 
 	if (active(stream)) {
-		ret = os_process_pipe_destroy(stream->pipe);
-		stream->pipe = NULL;
+		ret = stop_pipe(stream);
 
 		os_atomic_set_bool(&stream->active, false);
 		os_atomic_set_bool(&stream->sent_headers, false);
@@ -600,7 +646,7 @@ static void generate_filename(struct ffmpeg_muxer *stream, struct dstr *dst, boo
 	obs_data_release(settings);
 }
 
-bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
+static bool write_packet_internal(struct ffmpeg_muxer *stream, struct encoder_packet *packet, bool allow_shm)
 {
 	bool is_video = packet->type == OBS_ENCODER_VIDEO;
 	size_t ret;
@@ -622,6 +668,9 @@ bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
 		}
 	}
 
+	if (allow_shm && stream->shm)
+		info.in_shm = ffm_shm_write(stream->shm, packet->data, info.size, &info.shm_pos);
+
 	ret = os_process_pipe_write(stream->pipe, (const uint8_t *)&info, sizeof(info));
 	if (ret != sizeof(info)) {
 		warn("os_process_pipe_write for info structure failed");
@@ -629,11 +678,13 @@ bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
 		return false;
 	}
 
-	ret = os_process_pipe_write(stream->pipe, packet->data, packet->size);
-	if (ret != packet->size) {
-		warn("os_process_pipe_write for packet data failed");
-		signal_failure(stream);
-		return false;
+	if (!info.in_shm) {
+		ret = os_process_pipe_write(stream->pipe, packet->data, packet->size);
+		if (ret != packet->size) {
+			warn("os_process_pipe_write for packet data failed");
+			signal_failure(stream);
+			return false;
+		}
 	}
 
 	stream->total_bytes += packet->size;
@@ -644,13 +695,20 @@ bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
 	return true;
 }
 
+bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
+{
+	return write_packet_internal(stream, packet, true);
+}
+
+/* headers are read while the muxer is (re)initializing, before it looks at
+ * the shared memory, so they always go through the pipe */
 static bool send_audio_headers(struct ffmpeg_muxer *stream, obs_encoder_t *aencoder, size_t idx)
 {
 	struct encoder_packet packet = {.type = OBS_ENCODER_AUDIO, .timebase_den = 1, .track_idx = idx};
 
 	if (!obs_encoder_get_extra_data(aencoder, &packet.data, &packet.size))
 		return false;
-	return write_packet(stream, &packet);
+	return write_packet_internal(stream, &packet, false);
 }
 
 static bool send_video_headers(struct ffmpeg_muxer *stream)
@@ -661,7 +719,7 @@ static bool send_video_headers(struct ffmpeg_muxer *stream)
 
 	if (!obs_encoder_get_extra_data(vencoder, &packet.data, &packet.size))
 		return false;
-	return write_packet(stream, &packet);
+	return write_packet_internal(stream, &packet, false);
 }
 
 bool send_headers(struct ffmpeg_muxer *stream)
@@ -930,6 +988,32 @@ static void replay_buffer_hotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hot
 			return;
 		}
 
+		stream->save_start_usec = 0;
+		stream->save_end_usec = 0;
+		stream->save_ts = os_gettime_ns() / 1000LL;
+	}
+}
+
+static void save_replay_window_proc(void *data, calldata_t *cd)
+{
+	struct ffmpeg_muxer *stream = data;
+	double start_sec = calldata_float(cd, "start_sec");
+	double end_sec = calldata_float(cd, "end_sec");
+
+	if (start_sec <= 0.0 || end_sec < 0.0 || end_sec >= start_sec) {
+		info("Invalid replay window: %g to %g seconds ago", start_sec, end_sec);
+		return;
+	}
+
+	if (os_atomic_load_bool(&stream->active)) {
+		obs_encoder_t *vencoder = obs_output_get_video_encoder(stream->output);
+		if (obs_encoder_paused(vencoder)) {
+			info("Could not save buffer because encoders paused");
+			return;
+		}
+
+		stream->save_start_usec = (int64_t)(start_sec * 1000000.0);
+		stream->save_end_usec = (int64_t)(end_sec * 1000000.0);
 		stream->save_ts = os_gettime_ns() / 1000LL;
 	}
 }
@@ -958,6 +1042,7 @@ static void *replay_buffer_create(obs_data_t *settings, obs_output_t *output)
 
 	proc_handler_t *ph = obs_output_get_proc_handler(output);
 	proc_handler_add(ph, "void save()", save_replay_proc, stream);
+	proc_handler_add(ph, "void save_window(in float start_sec, in float end_sec)", save_replay_window_proc, stream);
 	proc_handler_add(ph, "void get_last_replay(out string path)", get_last_replay, stream);
 
 	signal_handler_t *sh = obs_output_get_signal_handler(output);
@@ -985,7 +1070,16 @@ static bool replay_buffer_start(void *data)
 
 	obs_data_t *s = obs_output_get_settings(stream->output);
 	stream->max_time = obs_data_get_int(s, "max_time_sec") * 1000000LL;
+
+	/* the sum of the packet sizes, which doesn't bound memory exactly:
+	 * pooled packet data is rounded up to a power of two, so it can take
+	 * up to twice this, and it's shared with other outputs */
 	stream->max_size = obs_data_get_int(s, "max_size_mb") * (1024 * 1024);
+
+	if (obs_data_get_bool(s, "use_disk_buffer") && !replay_file_create(stream, s)) {
+		obs_data_release(s);
+		return false;
+	}
 	obs_data_release(s);
 
 	os_atomic_set_bool(&stream->active, true);
@@ -1010,6 +1104,7 @@ static bool purge_front(struct ffmpeg_muxer *stream)
 
 	if (keyframe)
 		stream->keyframes--;
+	replay_index_pop(stream, keyframe);
 
 	if (!stream->packets.size) {
 		stream->cur_size = 0;
@@ -1059,13 +1154,16 @@ static inline void replay_buffer_purge(struct ffmpeg_muxer *stream, struct encod
 		purge(stream);
 }
 
-static void insert_packet(mux_packets_t *packets, struct encoder_packet *packet, int64_t video_offset,
+static void insert_packet(mux_packets_t *packets, struct encoder_packet *packet, bool ref, int64_t video_offset,
 			  int64_t *audio_offsets, int64_t video_pts_offset, int64_t *audio_dts_offsets)
 {
 	struct encoder_packet pkt;
 	size_t idx;
 
-	obs_encoder_packet_ref(&pkt, packet);
+	if (ref)
+		obs_encoder_packet_ref(&pkt, packet);
+	else
+		pkt = *packet;
 
 	if (pkt.type == OBS_ENCODER_VIDEO) {
 		pkt.dts_usec -= video_offset;
@@ -1089,6 +1187,7 @@ static void insert_packet(mux_packets_t *packets, struct encoder_packet *packet,
 static void *replay_buffer_mux_thread(void *data)
 {
 	struct ffmpeg_muxer *stream = data;
+	bool overwritten = false;
 	bool error = false;
 
 	start_pipe(stream, stream->path.array);
@@ -1112,15 +1211,23 @@ static void *replay_buffer_mux_thread(void *data)
 			error = true;
 			goto error;
 		}
-		obs_encoder_packet_release(pkt);
+		if (!stream->replay_file) {
+			obs_encoder_packet_release(pkt);
+		} else if (!replay_file_packet_intact(stream, pkt)) {
+			warn("Buffer file was overwritten while saving, discarding '%s'", stream->path.array);
+			overwritten = true;
+			error = true;
+			goto error;
+		}
 	}
 
 	info("Wrote replay buffer to '%s'", stream->path.array);
 
 error:
-	os_process_pipe_destroy(stream->pipe);
-	stream->pipe = NULL;
-	if (error) {
+	stop_pipe(stream);
+	if (overwritten) {
+		os_unlink(stream->path.array);
+	} else if (!stream->replay_file && error) {
 		for (size_t i = 0; i < stream->mux_packets.num; i++)
 			obs_encoder_packet_release(&stream->mux_packets.array[i]);
 	}
@@ -1139,9 +1246,25 @@ error:
 static void replay_buffer_save(struct ffmpeg_muxer *stream)
 {
 	const size_t size = sizeof(struct encoder_packet);
-	size_t num_packets = stream->packets.size / size;
+	size_t num_packets = stream->replay_file ? replay_file_num_packets(stream) : stream->packets.size / size;
+	size_t start_idx = 0;
+	int64_t end_usec = INT64_MAX;
+
+	/* ---------------------------- */
+	/* find the requested window */
+
+	if (stream->save_start_usec && num_packets) {
+		struct encoder_packet last;
 
-	da_reserve(stream->mux_packets, num_packets);
+		if (stream->replay_file)
+			replay_file_get_packet(stream, num_packets - 1, &last);
+		else
+			last = *(struct encoder_packet *)deque_data(&stream->packets, (num_packets - 1) * size);
+
+		replay_index_get_window(stream, num_packets, last.dts_usec, &start_idx, &end_usec);
+	}
+
+	da_reserve(stream->mux_packets, num_packets - start_idx);
 
 	/* ---------------------------- */
 	/* reorder packets */
@@ -1153,9 +1276,20 @@ static void replay_buffer_save(struct ffmpeg_muxer *stream)
 	int64_t audio_offsets[MAX_AUDIO_MIXES] = {0};
 	int64_t audio_dts_offsets[MAX_AUDIO_MIXES] = {0};
 
-	for (size_t i = 0; i < num_packets; i++) {
+	for (size_t i = start_idx; i < num_packets; i++) {
+		struct encoder_packet file_pkt;
 		struct encoder_packet *pkt;
-		pkt = deque_data(&stream->packets, i * size);
+
+		if (stream->replay_file) {
+			replay_file_get_packet(stream, i, &file_pkt);
+			pkt = &file_pkt;
+		} else {
+			pkt = deque_data(&stream->packets, i * size);
+		}
+
+		/* encoders don't submit in strict dts order, so check every packet */
+		if (pkt->dts_usec > end_usec)
+			continue;
 
 		if (pkt->type == OBS_ENCODER_VIDEO) {
 			if (!found_video) {
@@ -1171,10 +1305,13 @@ static void replay_buffer_save(struct ffmpeg_muxer *stream)
 			}
 		}
 
-		insert_packet(&stream->mux_packets, pkt, video_offset, audio_offsets, video_pts_offset,
-			      audio_dts_offsets);
+		insert_packet(&stream->mux_packets, pkt, !stream->replay_file, video_offset, audio_offsets,
+			      video_pts_offset, audio_dts_offsets);
 	}
 
+	if (stream->replay_file && num_packets)
+		replay_file_begin_save(stream, start_idx);
+
 	generate_filename(stream, &stream->path, true);
 
 	os_atomic_set_bool(&stream->muxing, true);
@@ -1220,17 +1357,23 @@ static void replay_buffer_data(void *data, struct encoder_packet *packet)
 		}
 	}
 
-	obs_encoder_packet_ref(&pkt, packet);
-	replay_buffer_purge(stream, &pkt);
+	if (stream->replay_file) {
+		replay_file_push(stream, packet);
+	} else {
+		obs_encoder_packet_ref(&pkt, packet);
+		replay_buffer_purge(stream, &pkt);
 
-	if (!stream->packets.size)
-		stream->cur_time = pkt.dts_usec;
-	stream->cur_size += pkt.size;
+		if (!stream->packets.size)
+			stream->cur_time = pkt.dts_usec;
+		stream->cur_size += pkt.size;
 
-	deque_push_back(&stream->packets, packet, sizeof(*packet));
+		if (packet->type == OBS_ENCODER_VIDEO && packet->keyframe) {
+			replay_index_push(stream, packet->dts_usec, stream->packets.size / sizeof(*packet));
+			stream->keyframes++;
+		}
 
-	if (packet->type == OBS_ENCODER_VIDEO && packet->keyframe)
-		stream->keyframes++;
+		deque_push_back(&stream->packets, packet, sizeof(*packet));
+	}
 
 	if (stream->save_ts && packet->sys_dts_usec >= stream->save_ts) {
 		if (os_atomic_load_bool(&stream->muxing))
@@ -11,9 +11,13 @@
 
 typedef DARRAY(struct encoder_packet) mux_packets_t;
 
+struct ffm_shm;
+struct replay_file;
+
 struct ffmpeg_muxer {
 	obs_output_t *output;
 	os_process_pipe_t *pipe;
+	struct ffm_shm *shm;
 	int64_t stop_ts;
 	uint64_t total_bytes;
 	bool sent_headers;
@@ -33,10 +37,15 @@ struct ffmpeg_muxer {
 
 	/* replay buffer */
 	int64_t save_ts;
+	int64_t save_start_usec;
+	int64_t save_end_usec;
 	int keyframes;
+	uint64_t first_packet_seq;
+	struct deque keyframe_index;
 	obs_hotkey_id hotkey;
 	volatile bool muxing;
 	mux_packets_t mux_packets;
+	struct replay_file *replay_file;
 
 	/* split file */
 	bool found_video;
@@ -69,8 +78,23 @@ struct ffmpeg_muxer {
 bool stopping(struct ffmpeg_muxer *stream);
 bool active(struct ffmpeg_muxer *stream);
 void start_pipe(struct ffmpeg_muxer *stream, const char *path);
+int stop_pipe(struct ffmpeg_muxer *stream);
 bool write_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet);
 bool send_headers(struct ffmpeg_muxer *stream);
 int deactivate(struct ffmpeg_muxer *stream, int code);
 void ffmpeg_mux_stop(void *data, uint64_t ts);
 uint64_t ffmpeg_mux_total_bytes(void *data);
+
+void replay_index_push(struct ffmpeg_muxer *stream, int64_t dts_usec, size_t num_packets);
+void replay_index_pop(struct ffmpeg_muxer *stream, bool keyframe);
+size_t replay_index_find(struct ffmpeg_muxer *stream, int64_t dts_usec);
+void replay_index_get_window(struct ffmpeg_muxer *stream, size_t num_packets, int64_t last_dts_usec, size_t *start_idx,
+			     int64_t *end_usec);
+
+bool replay_file_create(struct ffmpeg_muxer *stream, obs_data_t *settings);
+void replay_file_destroy(struct ffmpeg_muxer *stream);
+void replay_file_push(struct ffmpeg_muxer *stream, struct encoder_packet *packet);
+size_t replay_file_num_packets(struct ffmpeg_muxer *stream);
+void replay_file_get_packet(struct ffmpeg_muxer *stream, size_t idx, struct encoder_packet *pkt);
+void replay_file_begin_save(struct ffmpeg_muxer *stream, size_t first_idx);
+bool replay_file_packet_intact(struct ffmpeg_muxer *stream, const struct encoder_packet *pkt);
@@ -0,0 +1,430 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <inttypes.h>
+
+#include "obs-ffmpeg-mux.h"
+
+#define do_log(level, format, ...) \
+	blog(level, "[replay buffer: '%s'] " format, obs_output_get_name(stream->output), ##__VA_ARGS__)
+
+#define warn(format, ...) do_log(LOG_WARNING, format, ##__VA_ARGS__)
+#define info(format, ...) do_log(LOG_INFO, format, ##__VA_ARGS__)
+
+/* used when neither a disk buffer size nor encoder bitrates are known */
+#define DEFAULT_DISK_BUFFER_MB 2048
+#define MIN_DISK_BUFFER_MB 16
+
+/*
+ * Replay buffer packets stored in a memory-mapped ring file.
+ *
+ * Payloads are appended to the ring back to back (the end of the file is
+ * skipped when a packet doesn't fit there), while stream->packets only keeps
+ * a small index entry per packet.  Positions are byte offsets that only ever
+ * increase, the file offset being the position modulo the capacity.
+ *
+ * A save muxes straight out of the mapping on the mux thread.  The packet
+ * thread never waits for it: if a whole ring's worth of data arrives during
+ * a single save, it overwrites data the save still uses, and the save checks
+ * each packet once it's written and gives up when it was overwritten.
+ */
+
+struct replay_file_entry {
+	uint64_t pos;
+	int64_t pts;
+	int64_t dts;
+	int64_t dts_usec;
+	uint32_t size;
+	int32_t timebase_num;
+	int32_t timebase_den;
+	uint8_t type;
+	uint8_t track_idx;
+	bool keyframe;
+};
+
+struct replay_file {
+	uint8_t *map;
+	uint64_t capacity;
+	uint64_t write_pos;
+
+	/* video after a dropped video packet can't be decoded */
+	bool wait_for_keyframe;
+
+	/* end of the data the packet thread has started to overwrite */
+	pthread_mutex_t write_mutex;
+	uint64_t write_end;
+
+	/* position of the first packet of the current save */
+	uint64_t save_pos;
+
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#endif
+};
+
+#ifdef _WIN32
+static bool map_file(struct replay_file *rf, const char *path)
+{
+	wchar_t *path_w = NULL;
+	LARGE_INTEGER size;
+
+	os_utf8_to_wcs_ptr(path, 0, &path_w);
+	if (!path_w)
+		return false;
+
+	/* deleted as soon as it's closed, even if we crash */
+	rf->file = CreateFileW(path_w, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+			       FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+	bfree(path_w);
+
+	if (rf->file == INVALID_HANDLE_VALUE) {
+		rf->file = NULL;
+		return false;
+	}
+
+	size.QuadPart = (LONGLONG)rf->capacity;
+	if (!SetFilePointerEx(rf->file, size, NULL, FILE_BEGIN) || !SetEndOfFile(rf->file))
+		return false;
+
+	rf->mapping = CreateFileMappingW(rf->file, NULL, PAGE_READWRITE, 0, 0, NULL);
+	if (!rf->mapping)
+		return false;
+
+	rf->map = MapViewOfFile(rf->mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+	return rf->map != NULL;
+}
+
+static void unmap_file(struct replay_file *rf)
+{
+	if (rf->map)
+		UnmapViewOfFile(rf->map);
+	if (rf->mapping)
+		CloseHandle(rf->mapping);
+	if (rf->file)
+		CloseHandle(rf->file);
+}
+#else
+static bool map_file(struct replay_file *rf, const char *path)
+{
+	void *map;
+	int fd;
+
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fd == -1)
+		return false;
+
+	/* keep the file around only for as long as it's mapped */
+	unlink(path);
+
+	/* allocate the blocks up front so running out of disk space can't
+	 * turn into SIGBUS when writing to the mapping */
+#if defined(__linux__) || defined(__FreeBSD__)
+	if (posix_fallocate(fd, 0, (off_t)rf->capacity) != 0) {
+#else
+	if (ftruncate(fd, (off_t)rf->capacity) != 0) {
+#endif
+		close(fd);
+		return false;
+	}
+
+	map = mmap(NULL, rf->capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (map == MAP_FAILED)
+		return false;
+
+	rf->map = map;
+	return true;
+}
+
+static void unmap_file(struct replay_file *rf)
+{
+	if (rf->map)
+		munmap(rf->map, rf->capacity);
+}
+#endif
+
+static int64_t encoder_bitrate(obs_encoder_t *encoder)
+{
+	if (!encoder)
+		return 0;
+
+	obs_data_t *settings = obs_encoder_get_settings(encoder);
+	int64_t bitrate = obs_data_get_int(settings, "bitrate");
+	obs_data_release(settings);
+	return bitrate;
+}
+
+/* max_size_mb is the limit of the in-memory buffer, the ring is sized for
+ * max_time_sec instead unless disk_buffer_mb is set */
+static uint64_t get_capacity(struct ffmpeg_muxer *stream, obs_data_t *settings)
+{
+	int64_t size_mb = obs_data_get_int(settings, "disk_buffer_mb");
+
+	if (size_mb <= 0) {
+		int64_t kbps = encoder_bitrate(obs_output_get_video_encoder(stream->output));
+		for (size_t i = 0; i < MAX_AUDIO_MIXES; i++)
+			kbps += encoder_bitrate(obs_output_get_audio_encoder(stream->output, i));
+
+		/* twice the average to leave room for bitrate peaks */
+		size_mb = kbps ? kbps * obs_data_get_int(settings, "max_time_sec") * 2 / 8 / 1024
+			       : DEFAULT_DISK_BUFFER_MB;
+	}
+
+	if (size_mb < MIN_DISK_BUFFER_MB)
+		size_mb = MIN_DISK_BUFFER_MB;
+
+	return (uint64_t)size_mb * 1024 * 1024;
+}
+
+bool replay_file_create(struct ffmpeg_muxer *stream, obs_data_t *settings)
+{
+	struct replay_file *rf = bzalloc(sizeof(*rf));
+	struct dstr path = {0};
+
+	rf->capacity = get_capacity(stream, settings);
+	pthread_mutex_init_value(&rf->write_mutex);
+
+	if (pthread_mutex_init(&rf->write_mutex, NULL) != 0)
+		goto fail;
+
+	dstr_copy(&path, obs_data_get_string(settings, "disk_buffer_dir"));
+	if (dstr_is_empty(&path))
+		dstr_copy(&path, obs_data_get_string(settings, "directory"));
+	dstr_replace(&path, "\\", "/");
+	if (!dstr_is_empty(&path)) {
+		os_mkdirs(path.array);
+		if (dstr_end(&path) != '/')
+			dstr_cat_ch(&path, '/');
+	}
+	dstr_catf(&path, ".obs-replay-buffer-%" PRIx64 ".tmp", os_gettime_ns());
+
+	if (!map_file(rf, path.array)) {
+		warn("Failed to create %" PRIu64 " MB buffer file '%s'", rf->capacity / (1024 * 1024), path.array);
+		goto fail;
+	}
+
+	info("Buffering on disk in '%s' (%" PRIu64 " MB)", path.array, rf->capacity / (1024 * 1024));
+	dstr_free(&path);
+
+	stream->replay_file = rf;
+	return true;
+
+fail:
+	unmap_file(rf);
+	pthread_mutex_destroy(&rf->write_mutex);
+	dstr_free(&path);
+	bfree(rf);
+	return false;
+}
+
+void replay_file_destroy(struct ffmpeg_muxer *stream)
+{
+	struct replay_file *rf = stream->replay_file;
+	if (!rf)
+		return;
+
+	/* a save might still be reading from the mapping */
+	if (stream->mux_thread_joinable) {
+		pthread_join(stream->mux_thread, NULL);
+		stream->mux_thread_joinable = false;
+	}
+
+	deque_free(&stream->packets);
+
+	unmap_file(rf);
+	pthread_mutex_destroy(&rf->write_mutex);
+	bfree(rf);
+
+	stream->replay_file = NULL;
+}
+
+static bool purge_front(struct ffmpeg_muxer *stream)
+{
+	struct replay_file_entry entry;
+
+	if (!stream->packets.size)
+		return false;
+
+	deque_pop_front(&stream->packets, &entry, sizeof(entry));
+
+	bool keyframe = entry.type == OBS_ENCODER_VIDEO && entry.keyframe;
+	if (keyframe)
+		stream->keyframes--;
+	replay_index_pop(stream, keyframe);
+
+	if (!stream->packets.size) {
+		stream->cur_size = 0;
+		stream->cur_time = 0;
+	} else {
+		struct replay_file_entry *first = deque_data(&stream->packets, 0);
+		stream->cur_time = first->dts_usec;
+		stream->cur_size -= (int64_t)entry.size;
+	}
+
+	return keyframe;
+}
+
+static void purge(struct ffmpeg_muxer *stream)
+{
+	if (purge_front(stream)) {
+		for (;;) {
+			if (!stream->packets.size)
+				return;
+
+			struct replay_file_entry *first = deque_data(&stream->packets, 0);
+			if (first->type == OBS_ENCODER_VIDEO && first->keyframe)
+				return;
+
+			purge_front(stream);
+		}
+	}
+}
+
+static inline uint64_t oldest_pos(struct ffmpeg_muxer *stream)
+{
+	struct replay_file_entry *first = deque_data(&stream->packets, 0);
+	return first->pos;
+}
+
+static void replay_file_purge(struct ffmpeg_muxer *stream, struct encoder_packet *pkt, uint64_t end_pos)
+{
+	struct replay_file *rf = stream->replay_file;
+
+	/* the ring can't hold more, whatever the limits say */
+	while (stream->packets.size && end_pos - oldest_pos(stream) > rf->capacity)
+		purge(stream);
+
+	if (!stream->packets.size || stream->keyframes <= 2)
+		return;
+
+	while ((pkt->dts_usec - stream->cur_time) > stream->max_time)
+		purge(stream);
+}
+
+static bool drop_packet(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
+{
+	struct replay_file *rf = stream->replay_file;
+	bool video = packet->type == OBS_ENCODER_VIDEO;
+
+	if (packet->size > rf->capacity / 2) {
+		warn("Dropping %zu byte packet, buffer file is too small", packet->size);
+
+		/* the frames after it can't be decoded without it */
+		if (video)
+			rf->wait_for_keyframe = true;
+		return true;
+	}
+
+	if (video && rf->wait_for_keyframe) {
+		if (!packet->keyframe)
+			return true;
+		rf->wait_for_keyframe = false;
+	}
+
+	return false;
+}
+
+void replay_file_push(struct ffmpeg_muxer *stream, struct encoder_packet *packet)
+{
+	struct replay_file *rf = stream->replay_file;
+	uint64_t pos = rf->write_pos;
+	uint64_t offset = pos % rf->capacity;
+
+	if (drop_packet(stream, packet))
+		return;
+
+	if (offset + packet->size > rf->capacity)
+		pos += rf->capacity - offset;
+
+	replay_file_purge(stream, packet, pos + packet->size);
+
+	pthread_mutex_lock(&rf->write_mutex);
+	rf->write_end = pos + packet->size;
+	pthread_mutex_unlock(&rf->write_mutex);
+
+	memcpy(rf->map + pos % rf->capacity, packet->data, packet->size);
+	rf->write_pos = pos + packet->size;
+
+	struct replay_file_entry entry = {
+		.pos = pos,
+		.pts = packet->pts,
+		.dts = packet->dts,
+		.dts_usec = packet->dts_usec,
+		.size = (uint32_t)packet->size,
+		.timebase_num = packet->timebase_num,
+		.timebase_den = packet->timebase_den,
+		.type = (uint8_t)packet->type,
+		.track_idx = (uint8_t)packet->track_idx,
+		.keyframe = packet->keyframe,
+	};
+
+	if (!stream->packets.size)
+		stream->cur_time = entry.dts_usec;
+	stream->cur_size += entry.size;
+
+	if (entry.type == OBS_ENCODER_VIDEO && entry.keyframe) {
+		replay_index_push(stream, entry.dts_usec, replay_file_num_packets(stream));
+		stream->keyframes++;
+	}
+
+	deque_push_back(&stream->packets, &entry, sizeof(entry));
+}
+
+size_t replay_file_num_packets(struct ffmpeg_muxer *stream)
+{
+	return stream->packets.size / sizeof(struct replay_file_entry);
+}
+
+/* the packet data points into the mapping and isn't reference counted */
+void replay_file_get_packet(struct ffmpeg_muxer *stream, size_t idx, struct encoder_packet *pkt)
+{
+	struct replay_file *rf = stream->replay_file;
+	struct replay_file_entry *entry = deque_data(&stream->packets, idx * sizeof(*entry));
+
+	memset(pkt, 0, sizeof(*pkt));
+	pkt->data = rf->map + entry->pos % rf->capacity;
+	pkt->size = entry->size;
+	pkt->pts = entry->pts;
+	pkt->dts = entry->dts;
+	pkt->dts_usec = entry->dts_usec;
+	pkt->timebase_num = entry->timebase_num;
+	pkt->timebase_den = entry->timebase_den;
+	pkt->type = (enum obs_encoder_type)entry->type;
+	pkt->track_idx = entry->track_idx;
+	pkt->keyframe = entry->keyframe;
+}
+
+/* called before the mux thread starts, with the first packet of the save */
+void replay_file_begin_save(struct ffmpeg_muxer *stream, size_t first_idx)
+{
+	struct replay_file *rf = stream->replay_file;
+	struct replay_file_entry *entry = deque_data(&stream->packets, first_idx * sizeof(*entry));
+
+	rf->save_pos = entry->pos;
+}
+
+/* whether a packet of the current save is still intact, checked by the mux
+ * thread after the packet was written out */
+bool replay_file_packet_intact(struct ffmpeg_muxer *stream, const struct encoder_packet *pkt)
+{
+	struct replay_file *rf = stream->replay_file;
+	uint64_t offset = (uint64_t)(pkt->data - rf->map);
+	uint64_t pos;
+	bool intact;
+
+	/* every packet of the save is within a capacity after save_pos */
+	pos = rf->save_pos + (offset + rf->capacity - rf->save_pos % rf->capacity) % rf->capacity;
+
+	pthread_mutex_lock(&rf->write_mutex);
+	intact = rf->write_end - pos <= rf->capacity;
+	pthread_mutex_unlock(&rf->write_mutex);
+
+	return intact;
+}
@@ -0,0 +1,57 @@
+#include "obs-ffmpeg-mux.h"
+
+/* Video keyframes in the buffer, used to find where to start a save.  Packets
+ * are identified by a sequence number that keeps counting up as packets are
+ * purged from the front of the buffer. */
+struct replay_keyframe {
+	int64_t dts_usec;
+	uint64_t seq;
+};
+
+void replay_index_push(struct ffmpeg_muxer *stream, int64_t dts_usec, size_t num_packets)
+{
+	struct replay_keyframe kf = {dts_usec, stream->first_packet_seq + num_packets};
+	deque_push_back(&stream->keyframe_index, &kf, sizeof(kf));
+}
+
+void replay_index_pop(struct ffmpeg_muxer *stream, bool keyframe)
+{
+	if (keyframe && stream->keyframe_index.size)
+		deque_pop_front(&stream->keyframe_index, NULL, sizeof(struct replay_keyframe));
+	stream->first_packet_seq++;
+}
+
+/* returns the index of the packet starting the GOP that contains dts_usec */
+size_t replay_index_find(struct ffmpeg_muxer *stream, int64_t dts_usec)
+{
+	const size_t size = sizeof(struct replay_keyframe);
+	size_t lo = 0;
+	size_t hi = stream->keyframe_index.size / size;
+
+	if (!hi)
+		return 0;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		struct replay_keyframe *kf = deque_data(&stream->keyframe_index, mid * size);
+		if (kf->dts_usec <= dts_usec)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	struct replay_keyframe *kf = deque_data(&stream->keyframe_index, (lo ? lo - 1 : 0) * size);
+	return (size_t)(kf->seq - stream->first_packet_seq);
+}
+
+/* for a save of save_start_usec to save_end_usec before the last packet,
+ * gets the packet to start muxing at and the dts after which packets are left
+ * out */
+void replay_index_get_window(struct ffmpeg_muxer *stream, size_t num_packets, int64_t last_dts_usec, size_t *start_idx,
+			     int64_t *end_usec)
+{
+	*start_idx = replay_index_find(stream, last_dts_usec - stream->save_start_usec);
+	*end_usec = last_dts_usec - stream->save_end_usec;
+	if (*start_idx >= num_packets)
+		*start_idx = 0;
+}
@@ -18,6 +18,7 @@
 #pragma once
 
 #include <obs.h>
+#include <util/serializer.h>
 
 #define MILLISECOND_DEN 1000
 
@@ -77,3 +78,20 @@ extern void flv_packet_audio_start(struct encoder_packet *packet, enum audio_id_
 				   size_t idx);
 extern void flv_packet_audio_frames(struct encoder_packet *packet, enum audio_id_t codec, int32_t dts_offset,
 				    uint8_t **output, size_t *size, size_t idx);
+
+/* Prefix variants: write only the FLV tag header and the codec specific bytes
+ * that precede the packet payload.  The payload itself (packet->data) and the
+ * trailing previous tag size are left to the caller, which lets the payload be
+ * sent straight from the encoder packet without copying it. */
+extern void flv_packet_mux_prefix(struct serializer *s, struct encoder_packet *packet, int32_t dts_offset,
+				  bool is_header);
+extern void flv_packet_start_prefix(struct serializer *s, struct encoder_packet *packet, enum video_id_t codec,
+				    size_t idx);
+extern void flv_packet_frames_prefix(struct serializer *s, struct encoder_packet *packet, enum video_id_t codec,
+				     int32_t dts_offset, size_t idx);
+extern void flv_packet_end_prefix(struct serializer *s, struct encoder_packet *packet, enum video_id_t codec,
+				  size_t idx);
+extern void flv_packet_audio_start_prefix(struct serializer *s, struct encoder_packet *packet, enum audio_id_t codec,
+					  size_t idx);
+extern void flv_packet_audio_frames_prefix(struct serializer *s, struct encoder_packet *packet, enum audio_id_t codec,
+					   int32_t dts_offset, size_t idx);
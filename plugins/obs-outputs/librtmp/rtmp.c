@@ -39,6 +39,22 @@
 #define MSG_NOSIGNAL 0
 #endif
 
+#ifdef _WIN32
+typedef WSABUF RTMPIOVec;
+#define IOV_SET(v, p, n)	((v).buf = (CHAR *)(p), (v).len = (ULONG)(n))
+#define IOV_LEN(v)		((int)(v).len)
+#define IOV_ADVANCE(v, n)	((v).buf += (n), (v).len -= (ULONG)(n))
+#else
+#include <sys/uio.h>
+typedef struct iovec RTMPIOVec;
+#define IOV_SET(v, p, n)	((v).iov_base = (void *)(p), (v).iov_len = (size_t)(n))
+#define IOV_LEN(v)		((int)(v).iov_len)
+#define IOV_ADVANCE(v, n)	((v).iov_base = (char *)(v).iov_base + (n), (v).iov_len -= (size_t)(n))
+#endif
+
+/* number of chunks handed to the socket per scatter-gather send */
+#define RTMP_IOV_CHUNKS 64
+
 #ifdef CRYPTO
 
 #ifdef __APPLE__
@@ -1576,11 +1592,29 @@ ReadN(RTMP *r, char *buffer, int n)
     return nOriginalSize - n;
 }
 
+static void
+CloseAfterSendError(RTMP *r, int sockerr)
+{
+    struct linger l;
+
+    r->last_error_code = sockerr;
+
+    // Force-close the socket. Sometimes a send() error isn't fatal, so
+    // we could end up writing an unpublish message which some services
+    // treat as a clean shutdown. We need to disable lingering too so
+    // the remote side sees an abortive shutdown (RST).
+    l.l_onoff = 1;
+    l.l_linger = 0;
+    setsockopt(r->m_sb.sb_socket, SOL_SOCKET, SO_LINGER, (char *)&l, sizeof(l));
+    RTMPSockBuf_Close(&r->m_sb);
+
+    RTMP_Close(r);
+}
+
 static int
 WriteN(RTMP *r, const char *buffer, int n)
 {
     const char *ptr = buffer;
-    struct linger l;
 
     while (n > 0)
     {
@@ -1603,18 +1637,7 @@ WriteN(RTMP *r, const char *buffer, int n)
             if (sockerr == EINTR && !RTMP_ctrlC)
                 continue;
 
-            r->last_error_code = sockerr;
-
-            // Force-close the socket. Sometimes a send() error isn't fatal, so
-            // we could end up writing an unpublish message which some services
-            // treat as a clean shutdown. We need to disable lingering too so
-            // the remote side sees an abortive shutdown (RST).
-            l.l_onoff = 1;
-            l.l_linger = 0;
-            setsockopt(r->m_sb.sb_socket, SOL_SOCKET, SO_LINGER, (char *)&l, sizeof(l));
-            RTMPSockBuf_Close(&r->m_sb);
-
-            RTMP_Close(r);
+            CloseAfterSendError(r, sockerr);
             n = 1;
             break;
         }
@@ -1629,6 +1652,56 @@ WriteN(RTMP *r, const char *buffer, int n)
     return n == 0;
 }
 
+/* Scatter-gather counterpart of WriteN for plain TCP connections.  The iovec
+ * array is advanced in place as data is written. */
+static int
+WriteV(RTMP *r, RTMPIOVec *iov, int cnt)
+{
+    while (cnt > 0)
+    {
+        int nBytes;
+
+#ifdef _WIN32
+        DWORD sent = 0;
+        if (WSASend(r->m_sb.sb_socket, iov, cnt, &sent, 0, NULL, NULL) == 0)
+            nBytes = (int)sent;
+        else
+            nBytes = -1;
+#else
+        struct msghdr msg = {0};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = cnt;
+        nBytes = (int)sendmsg(r->m_sb.sb_socket, &msg, MSG_NOSIGNAL);
+#endif
+
+        if (nBytes < 0)
+        {
+            int sockerr = GetSockError();
+            RTMP_Log(RTMP_LOGERROR, "%s, RTMP send error %d", __FUNCTION__, sockerr);
+
+            if (sockerr == EINTR && !RTMP_ctrlC)
+                continue;
+
+            CloseAfterSendError(r, sockerr);
+            return FALSE;
+        }
+
+        if (nBytes == 0)
+            return FALSE;
+
+        while (cnt > 0 && nBytes >= IOV_LEN(*iov))
+        {
+            nBytes -= IOV_LEN(*iov);
+            iov++;
+            cnt--;
+        }
+        if (cnt > 0)
+            IOV_ADVANCE(*iov, nBytes);
+    }
+
+    return TRUE;
+}
+
 #define SAVC(x)	static const AVal av_##x = AVC(#x)
 
 SAVC(app);
@@ -4085,18 +4158,18 @@ RTMP_SendChunk(RTMP *r, RTMPChunk *chunk)
     return wrote;
 }
 
-int
-RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
+/* Encodes the chunk header for the first chunk of packet so that it ends at
+ * hend, which must have RTMP_MAX_HEADER_SIZE bytes of room in front of it. */
+static int
+EncodeChunkHeader(RTMP *r, RTMPPacket *packet, char *hend, char **pheader, int *phSize, int *pcSize, char *pc,
+                  uint32_t *pt)
 {
     const RTMPPacket *prevPacket;
     uint32_t last = 0;
     int nSize;
     int hSize, cSize;
-    char *header, *hptr, *hend, hbuf[RTMP_MAX_HEADER_SIZE], c;
+    char *header, *hptr, c;
     uint32_t t;
-    char *buffer, *tbuf = NULL, *toff = NULL;
-    int nChunkSize;
-    int tlen;
 
     if (packet->m_nChannel >= r->m_channelsAllocatedOut)
     {
@@ -4129,7 +4202,7 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
          *
          * The type 3 chunks/RTMP_PACKET_SIZE_MINIMUM packets produced here specify the beginning of a new
          * message as opposed to message continuation type 3 chunks that are handled in the loop further down
-         * in this function.
+         * in RTMP_SendPacket.
          */
         uint32_t delta = packet->m_nTimeStamp - prevPacket->m_nTimeStamp;
         if (delta == prevPacket->m_nLastWireTimeStamp
@@ -4150,17 +4223,9 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
     cSize = 0;
     t = packet->m_nTimeStamp - last;
     packet->m_nLastWireTimeStamp = t;
+    *pt = t;
 
-    if (packet->m_body)
-    {
-        header = packet->m_body - nSize;
-        hend = packet->m_body;
-    }
-    else
-    {
-        header = hbuf + 6;
-        hend = hbuf + sizeof(hbuf);
-    }
+    header = hend - nSize;
 
     if (packet->m_nChannel > 319)
         cSize = 2;
@@ -4171,6 +4236,7 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
         header -= cSize;
         hSize += cSize;
     }
+    *pcSize = cSize;
 
     if (nSize > 1 && t >= 0xffffff)
     {
@@ -4192,6 +4258,7 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
         break;
     }
     *hptr++ = c;
+    *pc = c;
     if (cSize)
     {
         int tmp = packet->m_nChannel - 64;
@@ -4217,6 +4284,26 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
     if (nSize > 1 && t >= 0xffffff)
         hptr = AMF_EncodeInt32(hptr, hend, t);
 
+    *pheader = header;
+    *phSize = hSize;
+    return TRUE;
+}
+
+int
+RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
+{
+    int nSize;
+    int hSize, cSize;
+    char *header, hbuf[RTMP_MAX_HEADER_SIZE], c;
+    uint32_t t;
+    char *buffer, *tbuf = NULL, *toff = NULL;
+    int nChunkSize;
+    int tlen;
+
+    if (!EncodeChunkHeader(r, packet, packet->m_body ? packet->m_body : hbuf + sizeof(hbuf), &header, &hSize,
+                           &cSize, &c, &t))
+        return FALSE;
+
     nSize = packet->m_nBodySize;
     buffer = packet->m_body;
     nChunkSize = r->m_outChunkSize;
@@ -4320,6 +4407,109 @@ RTMP_SendPacket(RTMP *r, RTMPPacket *packet, int queue)
     return TRUE;
 }
 
+/* Whether packets can be written straight from their source buffers with
+ * WriteV.  Everything that needs the data in one piece (HTTP tunneling, TLS,
+ * a custom send function or dumping the stream) goes through WriteN. */
+static int
+CanWriteV(const RTMP *r)
+{
+#if defined(RTMP_NETSTACK_DUMP)
+    (void)r;
+    return FALSE;
+#else
+    if (r->Link.protocol & RTMP_FEATURE_HTTP)
+        return FALSE;
+    if (r->m_bCustomSend && r->m_customSendFunc)
+        return FALSE;
+#if defined(CRYPTO) && !defined(NO_SSL)
+    if (r->m_sb.sb_ssl)
+        return FALSE;
+#endif
+    return TRUE;
+#endif
+}
+
+/* Sends a packet whose body is prefix followed by payload without assembling
+ * the body in a contiguous buffer.  Unlike RTMP_SendPacket, which writes the
+ * chunk headers into the body in front of each chunk, the chunk headers are
+ * kept in a scratch area and sent along with references to the body. */
+static int
+SendPacketV(RTMP *r, RTMPPacket *packet, const char *prefix, int prefixSize, const char *payload,
+            int payloadSize)
+{
+    RTMPIOVec iov[RTMP_IOV_CHUNKS * 3];
+    char chunkHeaders[RTMP_IOV_CHUNKS][7];
+    char hbuf[RTMP_MAX_HEADER_SIZE], *header, c;
+    int hSize, cSize;
+    int nChunkSize = r->m_outChunkSize;
+    int nSize = prefixSize + payloadSize;
+    int offset = 0, chunk = 0, iovCnt = 0;
+    uint32_t t;
+
+    if (!EncodeChunkHeader(r, packet, hbuf + sizeof(hbuf), &header, &hSize, &cSize, &c, &t))
+        return FALSE;
+
+    RTMP_Log(RTMP_LOGDEBUG2, "%s: fd=%d, size=%d", __FUNCTION__, (int)r->m_sb.sb_socket,
+             nSize);
+
+    do
+    {
+        int end = nSize - offset > nChunkSize ? offset + nChunkSize : nSize;
+
+        // continuation chunks get a Type 3 header
+        if (offset > 0)
+        {
+            header = chunkHeaders[chunk];
+            hSize = 0;
+            header[hSize++] = (0xc0 | c);
+            if (cSize)
+            {
+                int tmp = packet->m_nChannel - 64;
+                header[hSize++] = tmp & 0xff;
+                if (cSize == 2)
+                    header[hSize++] = tmp >> 8;
+            }
+            if (t >= 0xffffff)
+            {
+                AMF_EncodeInt32(header + hSize, header + hSize + 4, t);
+                hSize += 4;
+            }
+        }
+
+        IOV_SET(iov[iovCnt], header, hSize);
+        iovCnt++;
+
+        if (offset < prefixSize)
+        {
+            int last = end < prefixSize ? end : prefixSize;
+            IOV_SET(iov[iovCnt], prefix + offset, last - offset);
+            iovCnt++;
+        }
+        if (end > prefixSize)
+        {
+            int first = offset > prefixSize ? offset - prefixSize : 0;
+            IOV_SET(iov[iovCnt], payload + first, end - prefixSize - first);
+            iovCnt++;
+        }
+
+        offset = end;
+
+        if (++chunk == RTMP_IOV_CHUNKS || offset == nSize)
+        {
+            if (!WriteV(r, iov, iovCnt))
+                return FALSE;
+            chunk = 0;
+            iovCnt = 0;
+        }
+    } while (offset < nSize);
+
+    if (!r->m_vecChannelsOut[packet->m_nChannel])
+        r->m_vecChannelsOut[packet->m_nChannel] = malloc(sizeof(RTMPPacket));
+    memcpy(r->m_vecChannelsOut[packet->m_nChannel], packet, sizeof(RTMPPacket));
+    r->m_vecChannelsOut[packet->m_nChannel]->m_body = NULL;
+    return TRUE;
+}
+
 void
 RTMP_Close(RTMP *r)
 {
@@ -5314,6 +5504,70 @@ fail:
     return total;
 }
 
+int
+RTMP_WriteTag(RTMP *r, const char *tag, int tagSize, const char *payload, int payloadSize, int streamIdx)
+{
+    RTMPPacket pkt = {0};
+    const char *buf = tag;
+    int prefixSize = tagSize - 11;
+    int ret;
+
+    if (tagSize < 11 || payloadSize < 0)
+    {
+        /* FLV pkt too small */
+        return 0;
+    }
+
+    pkt.m_nChannel = 0x04;	/* source channel */
+    pkt.m_nInfoField2 = r->Link.streams[streamIdx].id;
+
+    pkt.m_packetType = *buf++;
+    pkt.m_nBodySize = AMF_DecodeInt24(buf);
+    buf += 3;
+    pkt.m_nTimeStamp = AMF_DecodeInt24(buf);
+    buf += 3;
+    pkt.m_nTimeStamp |= *buf++ << 24;
+    buf += 3;
+
+    if (pkt.m_nBodySize != (uint32_t)(prefixSize + payloadSize))
+    {
+        RTMP_Log(RTMP_LOGERROR, "%s, FLV tag body size %u does not match the data given (%d)", __FUNCTION__,
+                 pkt.m_nBodySize, prefixSize + payloadSize);
+        return -1;
+    }
+
+    if (((pkt.m_packetType == RTMP_PACKET_TYPE_AUDIO
+            || pkt.m_packetType == RTMP_PACKET_TYPE_VIDEO) &&
+            !pkt.m_nTimeStamp) || pkt.m_packetType == RTMP_PACKET_TYPE_INFO)
+    {
+        pkt.m_headerType = RTMP_PACKET_SIZE_LARGE;
+    }
+    else
+    {
+        pkt.m_headerType = RTMP_PACKET_SIZE_MEDIUM;
+    }
+
+    if (CanWriteV(r))
+    {
+        ret = SendPacketV(r, &pkt, buf, prefixSize, payload, payloadSize);
+    }
+    else
+    {
+        if (!RTMPPacket_Alloc(&pkt, pkt.m_nBodySize))
+        {
+            RTMP_Log(RTMP_LOGDEBUG, "%s, failed to allocate packet", __FUNCTION__);
+            return FALSE;
+        }
+        memcpy(pkt.m_body, buf, prefixSize);
+        if (payloadSize)
+            memcpy(pkt.m_body + prefixSize, payload, payloadSize);
+        ret = RTMP_SendPacket(r, &pkt, FALSE);
+        RTMPPacket_Free(&pkt);
+    }
+
+    return ret ? tagSize + payloadSize : -1;
+}
+
 int
 RTMP_Write(RTMP *r, const char *buf, int size, int streamIdx)
 {
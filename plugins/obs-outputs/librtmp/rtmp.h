@@ -543,6 +543,12 @@ extern "C"
     void RTMP_DropRequest(RTMP *r, int i, int freeit);
     int RTMP_Read(RTMP *r, char *buf, int size);
     int RTMP_Write(RTMP *r, const char *buf, int size, int streamIdx);
+    /* Writes a single FLV tag whose body continues in payload.  tag holds the
+     * 11 byte tag header and the start of the body, there is no previous
+     * tag size trailer.  The payload is sent without being copied when the
+     * connection allows it. */
+    int RTMP_WriteTag(RTMP *r, const char *tag, int tagSize, const char *payload,
+                      int payloadSize, int streamIdx);
 
 #ifdef USE_HASHSWF
     /* hashswf.c */
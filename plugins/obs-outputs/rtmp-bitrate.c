@@ -0,0 +1,287 @@
+#include "rtmp-bitrate.h"
+
+#include <util/bmem.h>
+#include <string.h>
+
+#define MSEC_TO_NSEC 1000000ULL
+
+/* bitrates are rounded down to this, and never go lower */
+#define BITRATE_STEP 100
+#define MIN_BITRATE 50
+
+/* time between two increases, the same as the send-time estimator */
+#define INC_HOLD_TIME (4000ULL * MSEC_TO_NSEC)
+
+/* ------------------------------------------------------------------------- */
+/* BBR-style: the bandwidth is the largest delivery rate recently seen */
+
+#define BBR_BW_WINDOW (2000ULL * MSEC_TO_NSEC)
+#define BBR_RTT_WINDOW (10000ULL * MSEC_TO_NSEC)
+#define BBR_NUM_BW_SAMPLES 32
+
+/* use a little less than the bandwidth so the queue can drain, and less
+ * still while it's visibly building up */
+#define BBR_GAIN 0.9
+#define BBR_DRAIN_GAIN 0.75
+#define BBR_QUEUE_USEC 100000
+#define BBR_PROBE_GAIN 1.1
+
+struct bw_sample {
+	uint64_t ts;
+	uint64_t rate;
+};
+
+struct bbr_estimator {
+	struct bw_sample bw[BBR_NUM_BW_SAMPLES];
+	size_t bw_count;
+	size_t bw_next;
+
+	uint32_t min_rtt_usec;
+	uint64_t min_rtt_ts;
+
+	struct bitrate_sample last;
+	bool has_sample;
+};
+
+static void *bbr_create(void)
+{
+	return bzalloc(sizeof(struct bbr_estimator));
+}
+
+static void bbr_destroy(void *data)
+{
+	bfree(data);
+}
+
+static uint64_t bbr_max_bw(const struct bbr_estimator *bbr, uint64_t ts)
+{
+	uint64_t max = 0;
+
+	for (size_t i = 0; i < bbr->bw_count; i++) {
+		const struct bw_sample *s = &bbr->bw[i];
+		if (ts - s->ts <= BBR_BW_WINDOW && s->rate > max)
+			max = s->rate;
+	}
+
+	return max;
+}
+
+static void bbr_add_sample(void *data, const struct bitrate_sample *sample)
+{
+	struct bbr_estimator *bbr = data;
+	uint32_t rtt = sample->min_rtt_usec ? sample->min_rtt_usec : sample->rtt_usec;
+
+	if (rtt && (!bbr->min_rtt_usec || rtt <= bbr->min_rtt_usec ||
+		    sample->ts - bbr->min_rtt_ts > BBR_RTT_WINDOW)) {
+		bbr->min_rtt_usec = rtt;
+		bbr->min_rtt_ts = sample->ts;
+	}
+
+	/* an app-limited sample only shows how much was sent, so it can raise
+	 * the estimate but not lower it */
+	if (sample->delivery_rate &&
+	    (!sample->app_limited || sample->delivery_rate > bbr_max_bw(bbr, sample->ts))) {
+		bbr->bw[bbr->bw_next].ts = sample->ts;
+		bbr->bw[bbr->bw_next].rate = sample->delivery_rate;
+		bbr->bw_next = (bbr->bw_next + 1) % BBR_NUM_BW_SAMPLES;
+		if (bbr->bw_count < BBR_NUM_BW_SAMPLES)
+			bbr->bw_count++;
+	}
+
+	bbr->last = *sample;
+	bbr->has_sample = true;
+}
+
+static long bbr_get_target(void *data, long cur_bitrate)
+{
+	struct bbr_estimator *bbr = data;
+
+	if (!bbr->has_sample)
+		return 0;
+
+	uint64_t max_bw = bbr_max_bw(bbr, bbr->last.ts);
+	if (!max_bw)
+		return 0;
+
+	long bw_kbps = (long)(max_bw * 8 / 1000);
+	uint32_t queue_usec = bbr->last.rtt_usec > bbr->min_rtt_usec ? bbr->last.rtt_usec - bbr->min_rtt_usec : 0;
+
+	if (queue_usec > BBR_QUEUE_USEC)
+		return (long)(bw_kbps * BBR_DRAIN_GAIN);
+
+	/* the link wasn't full, so the real bandwidth is somewhere above
+	 * what was delivered */
+	if (bbr->last.app_limited) {
+		long probe = (long)(cur_bitrate * BBR_PROBE_GAIN);
+		return probe > bw_kbps ? probe : bw_kbps;
+	}
+
+	return (long)(bw_kbps * BBR_GAIN);
+}
+
+const struct bitrate_estimator_info bbr_estimator = {
+	.id = "bbr",
+	.create = bbr_create,
+	.destroy = bbr_destroy,
+	.add_sample = bbr_add_sample,
+	.get_target = bbr_get_target,
+};
+
+/* ------------------------------------------------------------------------- */
+/* GCC-style: back off when the queuing delay grows, increase otherwise */
+
+#define DELAY_OVERUSE_USEC 60000
+#define DELAY_UNDERUSE_USEC 20000
+#define DELAY_DECREASE_FACTOR 0.85
+#define DELAY_SMOOTHING 0.3
+
+struct delay_estimator {
+	uint32_t min_rtt_usec;
+	double queue_usec;
+	double prev_queue_usec;
+
+	uint64_t last_ts;
+	uint64_t last_acked;
+	double acked_kbps;
+	bool has_rate;
+};
+
+static void *delay_create(void)
+{
+	return bzalloc(sizeof(struct delay_estimator));
+}
+
+static void delay_destroy(void *data)
+{
+	bfree(data);
+}
+
+static void delay_add_sample(void *data, const struct bitrate_sample *sample)
+{
+	struct delay_estimator *de = data;
+	uint32_t min_rtt = sample->min_rtt_usec ? sample->min_rtt_usec : sample->rtt_usec;
+
+	if (min_rtt && (!de->min_rtt_usec || min_rtt < de->min_rtt_usec))
+		de->min_rtt_usec = min_rtt;
+
+	double queue = sample->rtt_usec > de->min_rtt_usec ? (double)(sample->rtt_usec - de->min_rtt_usec) : 0.0;
+	de->prev_queue_usec = de->queue_usec;
+	de->queue_usec += (queue - de->queue_usec) * DELAY_SMOOTHING;
+
+	if (de->last_ts && sample->ts > de->last_ts && sample->bytes_acked >= de->last_acked) {
+		double dt = (double)(sample->ts - de->last_ts) / 1e9;
+		double kbps = (double)(sample->bytes_acked - de->last_acked) * 8.0 / 1000.0 / dt;
+
+		de->acked_kbps = de->has_rate ? de->acked_kbps + (kbps - de->acked_kbps) * DELAY_SMOOTHING : kbps;
+		de->has_rate = true;
+	}
+
+	de->last_ts = sample->ts;
+	de->last_acked = sample->bytes_acked;
+}
+
+static long delay_get_target(void *data, long cur_bitrate)
+{
+	struct delay_estimator *de = data;
+
+	if (!de->has_rate)
+		return 0;
+
+	if (de->queue_usec > DELAY_OVERUSE_USEC && de->queue_usec >= de->prev_queue_usec)
+		return (long)(de->acked_kbps * DELAY_DECREASE_FACTOR);
+
+	/* bitrate_control paces the increase */
+	if (de->queue_usec < DELAY_UNDERUSE_USEC)
+		return cur_bitrate * 2;
+
+	return cur_bitrate;
+}
+
+const struct bitrate_estimator_info delay_estimator = {
+	.id = "delay",
+	.create = delay_create,
+	.destroy = delay_destroy,
+	.add_sample = delay_add_sample,
+	.get_target = delay_get_target,
+};
+
+/* ------------------------------------------------------------------------- */
+
+const struct bitrate_estimator_info *bitrate_estimator_find(const char *id)
+{
+	if (!id)
+		return NULL;
+	if (strcmp(id, bbr_estimator.id) == 0)
+		return &bbr_estimator;
+	if (strcmp(id, delay_estimator.id) == 0)
+		return &delay_estimator;
+	return NULL;
+}
+
+bool bitrate_control_init(struct bitrate_control *ctrl, const struct bitrate_estimator_info *info, long orig_bitrate,
+			  long audio_bitrate)
+{
+	memset(ctrl, 0, sizeof(*ctrl));
+
+	if (!info)
+		return false;
+
+	ctrl->data = info->create();
+	if (!ctrl->data)
+		return false;
+
+	ctrl->info = info;
+	ctrl->orig_bitrate = orig_bitrate;
+	ctrl->audio_bitrate = audio_bitrate;
+	ctrl->cur_bitrate = orig_bitrate;
+	ctrl->inc_bitrate = orig_bitrate / 10;
+	return true;
+}
+
+void bitrate_control_free(struct bitrate_control *ctrl)
+{
+	if (ctrl->info)
+		ctrl->info->destroy(ctrl->data);
+	memset(ctrl, 0, sizeof(*ctrl));
+}
+
+void bitrate_control_add_sample(struct bitrate_control *ctrl, const struct bitrate_sample *sample)
+{
+	if (ctrl->info)
+		ctrl->info->add_sample(ctrl->data, sample);
+}
+
+bool bitrate_control_update(struct bitrate_control *ctrl, uint64_t ts)
+{
+	if (!ctrl->info)
+		return false;
+
+	long target = ctrl->info->get_target(ctrl->data, ctrl->cur_bitrate + ctrl->audio_bitrate);
+	if (!target)
+		return false;
+
+	target -= ctrl->audio_bitrate;
+	if (target > ctrl->orig_bitrate)
+		target = ctrl->orig_bitrate;
+
+	long new_bitrate = ctrl->cur_bitrate;
+
+	if (target < ctrl->cur_bitrate) {
+		new_bitrate = target / BITRATE_STEP * BITRATE_STEP;
+		if (new_bitrate < MIN_BITRATE)
+			new_bitrate = MIN_BITRATE;
+		ctrl->hold_until = ts + INC_HOLD_TIME;
+
+	} else if (target > ctrl->cur_bitrate && ts >= ctrl->hold_until) {
+		new_bitrate = ctrl->cur_bitrate + ctrl->inc_bitrate;
+		if (new_bitrate > target)
+			new_bitrate = target;
+		ctrl->hold_until = ts + INC_HOLD_TIME;
+	}
+
+	if (new_bitrate == ctrl->cur_bitrate)
+		return false;
+
+	ctrl->cur_bitrate = new_bitrate;
+	return true;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <util/c99defs.h>
+
+/* One reading of the connection's state, as reported by the kernel */
+struct bitrate_sample {
+	uint64_t ts; /* nanoseconds */
+	uint32_t rtt_usec;
+	uint32_t min_rtt_usec; /* 0 if unknown */
+	uint64_t delivery_rate; /* bytes per second, 0 if unknown */
+	uint64_t bytes_acked;
+	bool app_limited; /* the sender didn't use all of the bandwidth */
+};
+
+/* Estimates the bitrate (audio and video, in kbps) the connection can
+ * sustain from the samples it's given */
+struct bitrate_estimator_info {
+	const char *id;
+
+	void *(*create)(void);
+	void (*destroy)(void *data);
+
+	void (*add_sample)(void *data, const struct bitrate_sample *sample);
+
+	/* returns 0 until the estimator has enough samples */
+	long (*get_target)(void *data, long cur_bitrate);
+};
+
+extern const struct bitrate_estimator_info bbr_estimator;
+extern const struct bitrate_estimator_info delay_estimator;
+
+extern const struct bitrate_estimator_info *bitrate_estimator_find(const char *id);
+
+/* Applies the target of an estimator to the video bitrate: decreases are
+ * applied right away, increases are limited to one step at a time with a
+ * hold time in between */
+struct bitrate_control {
+	const struct bitrate_estimator_info *info;
+	void *data;
+
+	long orig_bitrate; /* video, kbps */
+	long audio_bitrate;
+	long cur_bitrate;
+	long inc_bitrate;
+
+	uint64_t hold_until;
+};
+
+extern bool bitrate_control_init(struct bitrate_control *ctrl, const struct bitrate_estimator_info *info,
+				 long orig_bitrate, long audio_bitrate);
+extern void bitrate_control_free(struct bitrate_control *ctrl);
+
+extern void bitrate_control_add_sample(struct bitrate_control *ctrl, const struct bitrate_sample *sample);
+
+/* returns true if cur_bitrate changed */
+extern bool bitrate_control_update(struct bitrate_control *ctrl, uint64_t ts);
@@ -0,0 +1,265 @@
+#ifdef __linux__
+#include "rtmp-stream.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <linux/tcp.h>
+
+/* how often TCP_INFO is sampled while the stream is idle */
+#define TCP_INFO_INTERVAL_MS 100
+
+/* keeps the kernel's unsent data small, so that the backlog stays in the
+ * write buffer where it can be measured and limited */
+#define NOTSENT_LOWAT (128 * 1024)
+#define NOTSENT_LOWAT_LOW_LATENCY (16 * 1024)
+
+static void fatal_sock_shutdown(struct rtmp_stream *stream)
+{
+	close(stream->rtmp.m_sb.sb_socket);
+	stream->rtmp.m_sb.sb_socket = -1;
+	stream->write_buf_len = 0;
+	os_event_signal(stream->buffer_space_available_event);
+}
+
+static void sample_tcp_info(struct rtmp_stream *stream)
+{
+	struct tcp_info ti = {0};
+	socklen_t len = sizeof(ti);
+
+	if (getsockopt(stream->rtmp.m_sb.sb_socket, IPPROTO_TCP, TCP_INFO, &ti, &len) != 0)
+		return;
+
+	/* older kernels fill in less of the structure, the rest stays 0 */
+	pthread_mutex_lock(&stream->tcp_info_mutex);
+	stream->tcp_info.ts = os_gettime_ns();
+	stream->tcp_info.unsent_bytes = ti.tcpi_notsent_bytes;
+	stream->tcp_info.rtt_usec = ti.tcpi_rtt;
+	stream->tcp_info.min_rtt_usec = ti.tcpi_min_rtt;
+	stream->tcp_info.cwnd = ti.tcpi_snd_cwnd;
+	stream->tcp_info.mss = ti.tcpi_snd_mss;
+	stream->tcp_info.total_retrans = ti.tcpi_total_retrans;
+	stream->tcp_info.delivery_rate = ti.tcpi_delivery_rate;
+	stream->tcp_info.bytes_acked = ti.tcpi_bytes_acked;
+	stream->tcp_info.app_limited = ti.tcpi_delivery_rate_app_limited;
+	stream->has_tcp_info = true;
+	pthread_mutex_unlock(&stream->tcp_info_mutex);
+}
+
+static bool discard_recv_data(struct rtmp_stream *stream)
+{
+	char discard[16384];
+
+	for (;;) {
+		ssize_t ret = recv(stream->rtmp.m_sb.sb_socket, discard, sizeof(discard), 0);
+		if (ret > 0)
+			continue;
+		if (ret == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			return true;
+		if (ret == -1 && errno == EINTR)
+			continue;
+
+		int err_code = ret == 0 ? 0 : errno;
+		blog(LOG_ERROR,
+		     "socket_thread_linux: Socket error, recv() returned "
+		     "%zd, errno %d",
+		     ret, err_code);
+		stream->rtmp.last_error_code = err_code;
+		return false;
+	}
+}
+
+enum data_ret { RET_EMPTY, RET_BLOCKED, RET_FATAL };
+
+/* sends as much of the write buffer as the socket takes without blocking */
+static enum data_ret write_data(struct rtmp_stream *stream, uint64_t *last_send_time)
+{
+	enum data_ret result = RET_EMPTY;
+
+	pthread_mutex_lock(&stream->write_buf_mutex);
+
+	while (stream->write_buf_len) {
+		int ret = RTMPSockBuf_Send(&stream->rtmp.m_sb, (const char *)stream->write_buf,
+					   (int)stream->write_buf_len);
+
+		if (ret > 0) {
+			if (stream->write_buf_len - ret)
+				memmove(stream->write_buf, stream->write_buf + ret, stream->write_buf_len - ret);
+			stream->write_buf_len -= ret;
+
+			*last_send_time = os_gettime_ns() / 1000000;
+
+			os_event_signal(stream->buffer_space_available_event);
+			continue;
+		}
+
+		if (ret == -1 && errno == EINTR)
+			continue;
+		if (ret == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			result = RET_BLOCKED;
+			break;
+		}
+
+		/* connection closed, or connection was aborted / socket
+		 * closed / etc, that's a fatal error. */
+		int err_code = ret == 0 ? 0 : errno;
+		blog(LOG_ERROR,
+		     "socket_thread_linux: Socket error, send() returned "
+		     "%d, errno %d",
+		     ret, err_code);
+
+		pthread_mutex_unlock(&stream->write_buf_mutex);
+		stream->rtmp.last_error_code = err_code;
+		fatal_sock_shutdown(stream);
+		return RET_FATAL;
+	}
+
+	pthread_mutex_unlock(&stream->write_buf_mutex);
+	return result;
+}
+
+static bool set_write_interest(struct rtmp_stream *stream, int epoll_fd, bool write)
+{
+	struct epoll_event ev = {0};
+	ev.events = EPOLLIN | EPOLLRDHUP | (write ? EPOLLOUT : 0);
+	ev.data.fd = stream->rtmp.m_sb.sb_socket;
+
+	return epoll_ctl(epoll_fd, EPOLL_CTL_MOD, stream->rtmp.m_sb.sb_socket, &ev) == 0;
+}
+
+static inline bool write_buf_empty(struct rtmp_stream *stream)
+{
+	pthread_mutex_lock(&stream->write_buf_mutex);
+	bool empty = stream->write_buf_len == 0;
+	pthread_mutex_unlock(&stream->write_buf_mutex);
+	return empty;
+}
+
+static void socket_thread_linux_internal(struct rtmp_stream *stream, int epoll_fd)
+{
+	int sock = stream->rtmp.m_sb.sb_socket;
+	uint64_t last_send_time = 0;
+	uint64_t last_sample = 0;
+	bool blocked = false;
+	struct epoll_event ev = {0};
+
+	uint32_t lowat = stream->low_latency_mode ? NOTSENT_LOWAT_LOW_LATENCY : NOTSENT_LOWAT;
+	if (setsockopt(sock, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &lowat, sizeof(lowat)) == 0) {
+		stream->socket_lowat = lowat;
+	} else {
+		blog(LOG_WARNING, "socket_thread_linux: Failed to set TCP_NOTSENT_LOWAT, errno %d", errno);
+		stream->socket_lowat = 0;
+	}
+
+	ev.events = EPOLLIN;
+	ev.data.fd = stream->socket_wake_fd;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stream->socket_wake_fd, &ev) != 0) {
+		blog(LOG_ERROR, "socket_thread_linux: Aborting due to epoll_ctl failure, errno %d", errno);
+		fatal_sock_shutdown(stream);
+		return;
+	}
+
+	ev.events = EPOLLIN | EPOLLRDHUP;
+	ev.data.fd = sock;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sock, &ev) != 0) {
+		blog(LOG_ERROR, "socket_thread_linux: Aborting due to epoll_ctl failure, errno %d", errno);
+		fatal_sock_shutdown(stream);
+		return;
+	}
+
+	for (;;) {
+		struct epoll_event events[2];
+
+		if (os_event_try(stream->send_thread_signaled_exit) != EAGAIN && write_buf_empty(stream)) {
+			os_event_reset(stream->send_thread_signaled_exit);
+			break;
+		}
+
+		/* only wait for the socket to become writable while the
+		 * kernel can't take more data */
+		if (!blocked) {
+			enum data_ret ret = write_data(stream, &last_send_time);
+			if (ret == RET_FATAL)
+				return;
+
+			if (ret == RET_BLOCKED) {
+				blocked = true;
+				set_write_interest(stream, epoll_fd, true);
+			}
+		}
+
+		int count = epoll_wait(epoll_fd, events, 2, TCP_INFO_INTERVAL_MS);
+		if (count == -1 && errno != EINTR) {
+			blog(LOG_ERROR, "socket_thread_linux: Aborting due to epoll_wait failure, errno %d", errno);
+			fatal_sock_shutdown(stream);
+			return;
+		}
+
+		for (int i = 0; i < count; i++) {
+			if (events[i].data.fd == stream->socket_wake_fd) {
+				eventfd_t val;
+				eventfd_read(stream->socket_wake_fd, &val);
+				continue;
+			}
+
+			if (events[i].events & EPOLLIN) {
+				if (!discard_recv_data(stream)) {
+					fatal_sock_shutdown(stream);
+					return;
+				}
+			}
+
+			if (events[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+				int err_code = 0;
+				socklen_t len = sizeof(err_code);
+				getsockopt(sock, SOL_SOCKET, SO_ERROR, &err_code, &len);
+
+				if (last_send_time) {
+					uint32_t diff = (uint32_t)(os_gettime_ns() / 1000000 - last_send_time);
+					blog(LOG_ERROR,
+					     "socket_thread_linux: Connection closed, %u ms since last send "
+					     "(buffer: %zu / %zu)",
+					     diff, stream->write_buf_len, stream->write_buf_size);
+				}
+
+				blog(LOG_ERROR, "socket_thread_linux: Aborting due to connection close, error %d",
+				     err_code);
+				stream->rtmp.last_error_code = err_code;
+				fatal_sock_shutdown(stream);
+				return;
+			}
+
+			if (events[i].events & EPOLLOUT) {
+				blocked = false;
+				set_write_interest(stream, epoll_fd, false);
+			}
+		}
+
+		uint64_t now = os_gettime_ns();
+		if (now - last_sample >= TCP_INFO_INTERVAL_MS * 1000000ULL) {
+			sample_tcp_info(stream);
+			last_sample = now;
+		}
+	}
+
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, sock, NULL);
+	blog(LOG_INFO, "socket_thread_linux: Normal exit");
+}
+
+void *socket_thread_linux(void *data)
+{
+	struct rtmp_stream *stream = data;
+
+	os_set_thread_name("rtmp-stream: socket_thread");
+
+	int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd == -1) {
+		blog(LOG_ERROR, "socket_thread_linux: Aborting due to epoll_create1 failure, errno %d", errno);
+		fatal_sock_shutdown(stream);
+		return NULL;
+	}
+
+	socket_thread_linux_internal(stream, epoll_fd);
+	close(epoll_fd);
+	return NULL;
+}
+#endif
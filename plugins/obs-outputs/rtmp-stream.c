@@ -24,6 +24,8 @@
 
 #ifdef _WIN32
 #include <util/windows/win-version.h>
+#elif defined(__linux__)
+#include <sys/eventfd.h>
 #endif
 
 #ifndef SEC_TO_NSEC
@@ -135,13 +137,20 @@ static void rtmp_stream_destroy(void *data)
 	deque_free(&stream->droptest_info);
 #endif
 	deque_free(&stream->dbr_frames);
+	bitrate_control_free(&stream->dbr_ctrl);
 	pthread_mutex_destroy(&stream->dbr_mutex);
+	array_output_serializer_free(&stream->tag_prefix_data);
 
 	os_event_destroy(stream->buffer_space_available_event);
 	os_event_destroy(stream->buffer_has_data_event);
 	os_event_destroy(stream->socket_available_event);
 	os_event_destroy(stream->send_thread_signaled_exit);
 	pthread_mutex_destroy(&stream->write_buf_mutex);
+	pthread_mutex_destroy(&stream->tcp_info_mutex);
+#ifdef __linux__
+	if (stream->socket_wake_fd != -1)
+		close(stream->socket_wake_fd);
+#endif
 
 	if (stream->write_buf)
 		bfree(stream->write_buf);
@@ -153,6 +162,11 @@ static void *rtmp_stream_create(obs_data_t *settings, obs_output_t *output)
 	struct rtmp_stream *stream = bzalloc(sizeof(struct rtmp_stream));
 	stream->output = output;
 	pthread_mutex_init_value(&stream->packets_mutex);
+	pthread_mutex_init_value(&stream->tcp_info_mutex);
+#ifdef __linux__
+	stream->socket_wake_fd = -1;
+#endif
+	array_output_serializer_init(&stream->tag_prefix, &stream->tag_prefix_data);
 
 	RTMP_LogSetCallback(log_rtmp);
 	RTMP_LogSetLevel(RTMP_LOGWARNING);
@@ -172,6 +186,11 @@ static void *rtmp_stream_create(obs_data_t *settings, obs_output_t *output)
 		goto fail;
 	}
 
+	if (pthread_mutex_init(&stream->tcp_info_mutex, NULL) != 0) {
+		warn("Failed to initialize tcp info mutex");
+		goto fail;
+	}
+
 	if (os_event_init(&stream->buffer_space_available_event, OS_EVENT_TYPE_AUTO) != 0) {
 		warn("Failed to initialize write buffer event");
 		goto fail;
@@ -188,6 +207,13 @@ static void *rtmp_stream_create(obs_data_t *settings, obs_output_t *output)
 		warn("Failed to initialize socket exit event");
 		goto fail;
 	}
+#ifdef __linux__
+	stream->socket_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (stream->socket_wake_fd == -1) {
+		warn("Failed to initialize socket wake eventfd");
+		goto fail;
+	}
+#endif
 
 	UNUSED_PARAMETER(settings);
 	return stream;
@@ -341,7 +367,15 @@ static void droptest_cap_data_rate(struct rtmp_stream *stream, size_t size)
 }
 #endif
 
-#ifdef _WIN32
+#if defined(_WIN32) || defined(__linux__)
+static inline void signal_buffer_has_data(struct rtmp_stream *stream)
+{
+	os_event_signal(stream->buffer_has_data_event);
+#ifdef __linux__
+	eventfd_write(stream->socket_wake_fd, 1);
+#endif
+}
+
 static int socket_queue_data(RTMPSockBuf *sb, const char *data, int len, void *arg)
 {
 	UNUSED_PARAMETER(sb);
@@ -371,11 +405,11 @@ retry_send:
 
 	pthread_mutex_unlock(&stream->write_buf_mutex);
 
-	os_event_signal(stream->buffer_has_data_event);
+	signal_buffer_has_data(stream);
 
 	return len;
 }
-#endif // _WIN32
+#endif
 
 static int handle_socket_read(struct rtmp_stream *stream)
 {
@@ -396,23 +430,48 @@ static int handle_socket_read(struct rtmp_stream *stream)
 	return 0;
 }
 
+static inline struct serializer *reset_tag_prefix(struct rtmp_stream *stream)
+{
+	array_output_serializer_reset(&stream->tag_prefix_data);
+	return &stream->tag_prefix;
+}
+
+/* size of the FLV tag including its previous tag size trailer */
+static inline size_t get_tag_size(struct rtmp_stream *stream, struct encoder_packet *packet)
+{
+	size_t prefix_size = stream->tag_prefix_data.bytes.num;
+	return prefix_size ? prefix_size + packet->size + 4 : 0;
+}
+
+static int write_tag(struct rtmp_stream *stream, struct encoder_packet *packet)
+{
+	struct array_output_data *prefix = &stream->tag_prefix_data;
+
+	if (!prefix->bytes.num)
+		return 0;
+
+	return RTMP_WriteTag(&stream->rtmp, (char *)prefix->bytes.array, (int)prefix->bytes.num, (char *)packet->data,
+			     (int)packet->size, 0);
+}
+
 static int send_packet(struct rtmp_stream *stream, struct encoder_packet *packet, bool is_header)
 {
-	uint8_t *data;
+	struct serializer *s;
 	size_t size;
 	int ret = 0;
 
 	if (handle_socket_read(stream))
 		return -1;
 
-	flv_packet_mux(packet, is_header ? 0 : stream->start_dts_offset, &data, &size, is_header);
+	s = reset_tag_prefix(stream);
+	flv_packet_mux_prefix(s, packet, is_header ? 0 : stream->start_dts_offset, is_header);
+	size = get_tag_size(stream, packet);
 
 #ifdef TEST_FRAMEDROPS
 	droptest_cap_data_rate(stream, size);
 #endif
 
-	ret = RTMP_Write(&stream->rtmp, (char *)data, (int)size, 0);
-	bfree(data);
+	ret = write_tag(stream, packet);
 
 	if (is_header)
 		bfree(packet->data);
@@ -426,27 +485,28 @@ static int send_packet(struct rtmp_stream *stream, struct encoder_packet *packet
 static int send_packet_ex(struct rtmp_stream *stream, struct encoder_packet *packet, bool is_header, bool is_footer,
 			  size_t idx)
 {
-	uint8_t *data;
+	struct serializer *s;
 	size_t size = 0;
 	int ret = 0;
 
 	if (handle_socket_read(stream))
 		return -1;
 
+	s = reset_tag_prefix(stream);
 	if (is_header) {
-		flv_packet_start(packet, stream->video_codec[idx], &data, &size, idx);
+		flv_packet_start_prefix(s, packet, stream->video_codec[idx], idx);
 	} else if (is_footer) {
-		flv_packet_end(packet, stream->video_codec[idx], &data, &size, idx);
+		flv_packet_end_prefix(s, packet, stream->video_codec[idx], idx);
 	} else {
-		flv_packet_frames(packet, stream->video_codec[idx], stream->start_dts_offset, &data, &size, idx);
+		flv_packet_frames_prefix(s, packet, stream->video_codec[idx], stream->start_dts_offset, idx);
 	}
+	size = get_tag_size(stream, packet);
 
 #ifdef TEST_FRAMEDROPS
 	droptest_cap_data_rate(stream, size);
 #endif
 
-	ret = RTMP_Write(&stream->rtmp, (char *)data, (int)size, 0);
-	bfree(data);
+	ret = write_tag(stream, packet);
 
 	if (is_header || is_footer) // manually created packets
 		bfree(packet->data);
@@ -459,21 +519,20 @@ static int send_packet_ex(struct rtmp_stream *stream, struct encoder_packet *pac
 
 static int send_audio_packet_ex(struct rtmp_stream *stream, struct encoder_packet *packet, bool is_header, size_t idx)
 {
-	uint8_t *data;
-	size_t size = 0;
+	struct serializer *s;
 	int ret = 0;
 
 	if (handle_socket_read(stream))
 		return -1;
 
+	s = reset_tag_prefix(stream);
 	if (is_header) {
-		flv_packet_audio_start(packet, stream->audio_codec[idx], &data, &size, idx);
+		flv_packet_audio_start_prefix(s, packet, stream->audio_codec[idx], idx);
 	} else {
-		flv_packet_audio_frames(packet, stream->audio_codec[idx], stream->start_dts_offset, &data, &size, idx);
+		flv_packet_audio_frames_prefix(s, packet, stream->audio_codec[idx], stream->start_dts_offset, idx);
 	}
 
-	ret = RTMP_Write(&stream->rtmp, (char *)data, (int)size, 0);
-	bfree(data);
+	ret = write_tag(stream, packet);
 
 	if (is_header)
 		bfree(packet->data);
@@ -709,7 +768,7 @@ static void *send_thread(void *data)
 
 	if (stream->new_socket_loop) {
 		os_event_signal(stream->send_thread_signaled_exit);
-		os_event_signal(stream->buffer_has_data_event);
+		signal_buffer_has_data(stream);
 		pthread_join(stream->socket_thread, NULL);
 		stream->socket_thread_active = false;
 		stream->rtmp.m_bCustomSend = false;
@@ -1056,12 +1115,23 @@ static int init_send(struct rtmp_stream *stream)
 
 		stream->write_buf_size = ideal_buffer_size;
 		stream->write_buf = bmalloc(ideal_buffer_size);
+		stream->socket_bitrate = total_bitrate;
 
-#ifndef _WIN32
+		pthread_mutex_lock(&stream->tcp_info_mutex);
+		memset(&stream->tcp_info, 0, sizeof(stream->tcp_info));
+		stream->has_tcp_info = false;
+		pthread_mutex_unlock(&stream->tcp_info_mutex);
+		stream->socket_lowat = 0;
+
+#if !defined(_WIN32) && !defined(__linux__)
 		warn("New socket loop not supported on this platform");
 		return OBS_OUTPUT_ERROR;
 #else
+#ifdef _WIN32
 		ret = pthread_create(&stream->socket_thread, NULL, socket_thread_windows, stream);
+#else
+		ret = pthread_create(&stream->socket_thread, NULL, socket_thread_linux, stream);
+#endif
 
 		if (ret != 0) {
 			RTMP_Close(&stream->rtmp);
@@ -1336,7 +1406,7 @@ static bool init_connect(struct rtmp_stream *stream)
 		stream->addrlen_hint = len;
 	}
 
-#ifdef _WIN32
+#if defined(_WIN32) || defined(__linux__)
 	stream->new_socket_loop = obs_data_get_bool(settings, OPT_NEWSOCKETLOOP_ENABLED);
 	stream->low_latency_mode = obs_data_get_bool(settings, OPT_LOWLATENCY_ENABLED);
 
@@ -1350,6 +1420,29 @@ static bool init_connect(struct rtmp_stream *stream)
 	stream->low_latency_mode = false;
 #endif
 
+	bitrate_control_free(&stream->dbr_ctrl);
+	stream->dbr_sample_ts = 0;
+
+	if (stream->dbr_enabled) {
+		const char *estimator = obs_data_get_string(settings, OPT_DYN_BITRATE_ESTIMATOR);
+		const struct bitrate_estimator_info *est = bitrate_estimator_find(estimator);
+
+		/* only the Linux socket loop samples TCP_INFO */
+#ifdef __linux__
+		bool has_tcp_info = stream->new_socket_loop;
+#else
+		bool has_tcp_info = false;
+#endif
+		if (est && !has_tcp_info) {
+			warn("The '%s' bitrate estimator needs the new socket loop, "
+			     "using the default one",
+			     est->id);
+		} else if (est && bitrate_control_init(&stream->dbr_ctrl, est, stream->dbr_orig_bitrate,
+							stream->audio_bitrate)) {
+			info("Using the '%s' bitrate estimator", est->id);
+		}
+	}
+
 	obs_data_release(settings);
 	return true;
 }
@@ -1563,6 +1656,64 @@ static void dbr_inc_bitrate(struct rtmp_stream *stream)
 	}
 }
 
+static uint32_t get_socket_unsent_bytes(struct rtmp_stream *stream)
+{
+	uint32_t unsent = 0;
+
+	pthread_mutex_lock(&stream->tcp_info_mutex);
+	if (stream->has_tcp_info)
+		unsent = stream->tcp_info.unsent_bytes;
+	pthread_mutex_unlock(&stream->tcp_info_mutex);
+
+	return unsent;
+}
+
+/* time it takes to send the data already handed to the socket thread, only
+ * counted where the kernel reports its own part of it */
+static int64_t get_socket_backlog_usec(struct rtmp_stream *stream)
+{
+	if (!stream->new_socket_loop || !stream->has_tcp_info || !stream->socket_bitrate)
+		return 0;
+
+	uint64_t bytes = stream->write_buf_len + get_socket_unsent_bytes(stream);
+	return (int64_t)(bytes * 8000 / (uint64_t)stream->socket_bitrate);
+}
+
+static void dbr_update_estimator(struct rtmp_stream *stream)
+{
+	struct bitrate_sample sample;
+	bool bitrate_changed;
+	long prev_bitrate;
+
+	pthread_mutex_lock(&stream->tcp_info_mutex);
+	if (!stream->has_tcp_info || stream->tcp_info.ts == stream->dbr_sample_ts) {
+		pthread_mutex_unlock(&stream->tcp_info_mutex);
+		return;
+	}
+
+	sample.ts = stream->tcp_info.ts;
+	sample.rtt_usec = stream->tcp_info.rtt_usec;
+	sample.min_rtt_usec = stream->tcp_info.min_rtt_usec;
+	sample.delivery_rate = stream->tcp_info.delivery_rate;
+	sample.bytes_acked = stream->tcp_info.bytes_acked;
+	sample.app_limited = stream->tcp_info.app_limited;
+	stream->dbr_sample_ts = sample.ts;
+	pthread_mutex_unlock(&stream->tcp_info_mutex);
+
+	pthread_mutex_lock(&stream->dbr_mutex);
+	prev_bitrate = stream->dbr_cur_bitrate;
+	bitrate_control_add_sample(&stream->dbr_ctrl, &sample);
+	bitrate_changed = bitrate_control_update(&stream->dbr_ctrl, sample.ts);
+	stream->dbr_cur_bitrate = stream->dbr_ctrl.cur_bitrate;
+	pthread_mutex_unlock(&stream->dbr_mutex);
+
+	if (bitrate_changed) {
+		info("bitrate %s to: %ld", stream->dbr_cur_bitrate < prev_bitrate ? "decreased" : "increased",
+		     stream->dbr_cur_bitrate);
+		dbr_set_bitrate(stream);
+	}
+}
+
 static void check_to_drop_frames(struct rtmp_stream *stream, bool pframes)
 {
 	struct encoder_packet first;
@@ -1572,7 +1723,10 @@ static void check_to_drop_frames(struct rtmp_stream *stream, bool pframes)
 	int priority = pframes ? OBS_NAL_PRIORITY_HIGHEST : OBS_NAL_PRIORITY_HIGH;
 	int64_t drop_threshold = pframes ? stream->pframe_drop_threshold_usec : stream->drop_threshold_usec;
 
-	if (!pframes && stream->dbr_enabled) {
+	if (!pframes && stream->dbr_enabled && stream->dbr_ctrl.info) {
+		dbr_update_estimator(stream);
+
+	} else if (!pframes && stream->dbr_enabled) {
 		if (stream->dbr_inc_timeout) {
 			uint64_t t = os_gettime_ns();
 
@@ -1596,6 +1750,7 @@ static void check_to_drop_frames(struct rtmp_stream *stream, bool pframes)
 	/* if the amount of time stored in the buffered packets waiting to be
 	 * sent is higher than threshold, drop frames */
 	buffer_duration_usec = stream->last_dts_usec - first.dts_usec;
+	buffer_duration_usec += get_socket_backlog_usec(stream);
 
 	if (!pframes) {
 		stream->congestion = (float)buffer_duration_usec / (float)drop_threshold;
@@ -1612,7 +1767,7 @@ static void check_to_drop_frames(struct rtmp_stream *stream, bool pframes)
 			return;
 		}
 
-		if ((uint64_t)buffer_duration_usec >= DBR_TRIGGER_USEC) {
+		if (!stream->dbr_ctrl.info && (uint64_t)buffer_duration_usec >= DBR_TRIGGER_USEC) {
 			pthread_mutex_lock(&stream->dbr_mutex);
 			bitrate_changed = dbr_bitrate_lowered(stream);
 			pthread_mutex_unlock(&stream->dbr_mutex);
@@ -1720,10 +1875,13 @@ static void rtmp_stream_defaults(obs_data_t *defaults)
 	obs_data_set_default_int(defaults, OPT_PFRAME_DROP_THRESHOLD, 900);
 	obs_data_set_default_int(defaults, OPT_MAX_SHUTDOWN_TIME_SEC, 30);
 	obs_data_set_default_string(defaults, OPT_BIND_IP, "default");
-#ifdef _WIN32
+#if defined(_WIN32) || defined(__linux__)
 	obs_data_set_default_bool(defaults, OPT_NEWSOCKETLOOP_ENABLED, false);
 	obs_data_set_default_bool(defaults, OPT_LOWLATENCY_ENABLED, false);
 #endif
+#ifdef __linux__
+	obs_data_set_default_string(defaults, OPT_DYN_BITRATE_ESTIMATOR, "default");
+#endif
 }
 
 static obs_properties_t *rtmp_stream_properties(void *unused)
@@ -1757,10 +1915,17 @@ static obs_properties_t *rtmp_stream_properties(void *unused)
 	}
 	netif_saddr_data_free(&addrs);
 
-#ifdef _WIN32
+#if defined(_WIN32) || defined(__linux__)
 	obs_properties_add_bool(props, OPT_NEWSOCKETLOOP_ENABLED, obs_module_text("RTMPStream.NewSocketLoop"));
 	obs_properties_add_bool(props, OPT_LOWLATENCY_ENABLED, obs_module_text("RTMPStream.LowLatencyMode"));
 #endif
+#ifdef __linux__
+	p = obs_properties_add_list(props, OPT_DYN_BITRATE_ESTIMATOR, obs_module_text("RTMPStream.BitrateEstimator"),
+				    OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
+	obs_property_list_add_string(p, obs_module_text("Default"), "default");
+	obs_property_list_add_string(p, obs_module_text("RTMPStream.BitrateEstimator.BBR"), bbr_estimator.id);
+	obs_property_list_add_string(p, obs_module_text("RTMPStream.BitrateEstimator.Delay"), delay_estimator.id);
+#endif
 
 	return props;
 }
@@ -1781,9 +1946,12 @@ static float rtmp_stream_congestion(void *data)
 {
 	struct rtmp_stream *stream = data;
 
-	if (stream->new_socket_loop)
-		return (float)stream->write_buf_len / (float)stream->write_buf_size;
-	else
+	if (stream->new_socket_loop) {
+		/* include the data the kernel hasn't sent yet where it's known */
+		size_t queued = stream->write_buf_len + get_socket_unsent_bytes(stream);
+		float congestion = (float)queued / (float)(stream->write_buf_size + stream->socket_lowat);
+		return congestion < 1.0f ? congestion : 1.0f;
+	} else
 		return stream->min_priority > 0 ? 1.0f : stream->congestion;
 }
 
@@ -3,11 +3,13 @@
 #include <util/deque.h>
 #include <util/dstr.h>
 #include <util/threading.h>
+#include <util/array-serializer.h>
 #include <inttypes.h>
 #include "librtmp/rtmp.h"
 #include "librtmp/log.h"
 #include "flv-mux.h"
 #include "net-if.h"
+#include "rtmp-bitrate.h"
 
 #ifdef _WIN32
 #include <Iphlpapi.h>
@@ -23,6 +25,7 @@
 #define debug(format, ...) do_log(LOG_DEBUG, format, ##__VA_ARGS__)
 
 #define OPT_DYN_BITRATE "dyn_bitrate"
+#define OPT_DYN_BITRATE_ESTIMATOR "dyn_bitrate_estimator"
 #define OPT_DROP_THRESHOLD "drop_threshold_ms"
 #define OPT_PFRAME_DROP_THRESHOLD "pframe_drop_threshold_ms"
 #define OPT_MAX_SHUTDOWN_TIME_SEC "max_shutdown_time_sec"
@@ -46,6 +49,21 @@ struct droptest_info {
 };
 #endif
 
+/* kernel-side state of the stream's TCP connection, sampled by the socket
+ * thread on platforms that report it */
+struct rtmp_tcp_info {
+	uint64_t ts;
+	uint32_t unsent_bytes; /* written to the socket but not sent yet */
+	uint32_t rtt_usec;
+	uint32_t min_rtt_usec;
+	uint32_t cwnd; /* in segments */
+	uint32_t mss;
+	uint32_t total_retrans;
+	uint64_t delivery_rate; /* bytes per second */
+	uint64_t bytes_acked;
+	bool app_limited;
+};
+
 struct dbr_frame {
 	uint64_t send_beg;
 	uint64_t send_end;
@@ -94,6 +112,11 @@ struct rtmp_stream {
 	uint64_t total_bytes_sent;
 	int dropped_frames;
 
+	/* FLV tag header of the packet being sent, the payload is sent from the
+	 * encoder packet itself */
+	struct serializer tag_prefix;
+	struct array_output_data tag_prefix_data;
+
 #ifdef TEST_FRAMEDROPS
 	struct deque droptest_info;
 	uint64_t droptest_last_key_check;
@@ -113,6 +136,11 @@ struct rtmp_stream {
 	long dbr_inc_bitrate;
 	bool dbr_enabled;
 
+	/* estimates the bitrate from the socket's TCP_INFO instead of from
+	 * send times, when one is selected */
+	struct bitrate_control dbr_ctrl;
+	uint64_t dbr_sample_ts;
+
 	enum audio_id_t audio_codec[MAX_OUTPUT_AUDIO_ENCODERS];
 	enum video_id_t video_codec[MAX_OUTPUT_VIDEO_ENCODERS];
 
@@ -131,10 +159,23 @@ struct rtmp_stream {
 	os_event_t *buffer_has_data_event;
 	os_event_t *socket_available_event;
 	os_event_t *send_thread_signaled_exit;
+
+	/* total bitrate of the encoders in kbps, used to turn queued bytes
+	 * into queued time */
+	long socket_bitrate;
+	uint32_t socket_lowat;
+	pthread_mutex_t tcp_info_mutex;
+	struct rtmp_tcp_info tcp_info;
+	bool has_tcp_info;
+#ifdef __linux__
+	int socket_wake_fd;
+#endif
 };
 
 #ifdef _WIN32
 void *socket_thread_windows(void *data);
+#elif defined(__linux__)
+void *socket_thread_linux(void *data);
 #endif
 
 /* Adapted from FFmpeg's libavutil/pixfmt.h
@@ -15,7 +15,10 @@
  */
 
 #include <media-io/audio-io.h>
+#include <media-io/video-frame.h>
 #include <util/platform.h>
+#include <inttypes.h>
+#include <sys/stat.h>
 
 #include "media-playback.h"
 #include "cache.h"
@@ -32,8 +35,200 @@ static bool mp_cache_reset(mp_cache_t *c);
 
 static int64_t base_sys_ts = 0;
 
-#define v_eof(c) (c->cur_v_idx == c->video_frames.num)
-#define a_eof(c) (c->cur_a_idx == c->audio_segments.num)
+#define v_eof(c) (c->cur_v_idx == c->data->video_frames.num)
+#define a_eof(c) (c->cur_a_idx == c->data->audio_segments.num)
+
+/* ------------------------------------------------------------------------- */
+/* Memory limit shared by all caches.  Video frames decoded once the limit is
+ * reached go to a temporary file instead and are read back when played. */
+
+#define DEFAULT_MEMORY_LIMIT (2048ULL * 1024 * 1024)
+
+static pthread_mutex_t limit_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t memory_limit = 0;
+static struct mp_cache_stats global_stats = {0};
+
+static inline uint64_t get_memory_limit_internal(void)
+{
+	if (!memory_limit) {
+		uint64_t total = os_get_sys_total_size();
+		memory_limit = total ? total / 4 : DEFAULT_MEMORY_LIMIT;
+	}
+	return memory_limit;
+}
+
+void mp_cache_set_memory_limit(uint64_t bytes)
+{
+	pthread_mutex_lock(&limit_mutex);
+	/* 0 goes back to the default, computed on next use */
+	memory_limit = bytes;
+	pthread_mutex_unlock(&limit_mutex);
+}
+
+uint64_t mp_cache_get_memory_limit(void)
+{
+	uint64_t limit;
+	pthread_mutex_lock(&limit_mutex);
+	limit = get_memory_limit_internal();
+	pthread_mutex_unlock(&limit_mutex);
+	return limit;
+}
+
+void mp_cache_get_global_stats(struct mp_cache_stats *stats)
+{
+	pthread_mutex_lock(&limit_mutex);
+	*stats = global_stats;
+	pthread_mutex_unlock(&limit_mutex);
+}
+
+void mp_cache_get_stats(mp_cache_t *c, struct mp_cache_stats *stats)
+{
+	pthread_mutex_lock(&limit_mutex);
+	stats->hits = c->hits;
+	stats->misses = c->misses;
+	stats->resident_bytes = c->data ? c->data->resident_bytes : 0;
+	stats->disk_bytes = c->data ? c->data->disk_size : 0;
+	pthread_mutex_unlock(&limit_mutex);
+}
+
+static bool reserve_memory(struct mp_cache_data *d, uint64_t size, bool force)
+{
+	bool success;
+
+	pthread_mutex_lock(&limit_mutex);
+	success = force || global_stats.resident_bytes + size <= get_memory_limit_internal();
+	if (success) {
+		global_stats.resident_bytes += size;
+		d->resident_bytes += size;
+	}
+	pthread_mutex_unlock(&limit_mutex);
+
+	return success;
+}
+
+static void release_memory(struct mp_cache_data *d)
+{
+	pthread_mutex_lock(&limit_mutex);
+	global_stats.resident_bytes -= d->resident_bytes;
+	global_stats.disk_bytes -= d->disk_size;
+	d->resident_bytes = 0;
+	d->disk_size = 0;
+	pthread_mutex_unlock(&limit_mutex);
+}
+
+static inline void count_access(mp_cache_t *c, bool hit)
+{
+	pthread_mutex_lock(&limit_mutex);
+	if (hit) {
+		c->hits++;
+		global_stats.hits++;
+	} else {
+		c->misses++;
+		global_stats.misses++;
+	}
+	pthread_mutex_unlock(&limit_mutex);
+}
+
+static size_t get_plane_sizes(const struct obs_source_frame *frame, size_t sizes[MAX_AV_PLANES])
+{
+	uint32_t heights[MAX_AV_PLANES] = {0};
+	size_t total = 0;
+
+	video_frame_get_plane_heights(heights, frame->format, frame->height);
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		sizes[i] = (size_t)frame->linesize[i] * heights[i];
+		total += sizes[i];
+	}
+
+	return total;
+}
+
+static int64_t write_frame_to_disk(struct mp_cache_data *d, const struct obs_source_frame *frame,
+				   const size_t sizes[MAX_AV_PLANES])
+{
+	int64_t pos = (int64_t)d->disk_size;
+	size_t total = 0;
+
+	if (d->disk_failed)
+		return -1;
+
+	if (!d->disk_file) {
+		d->disk_file = tmpfile();
+		if (!d->disk_file) {
+			blog(LOG_WARNING, "MP: Failed to create cache file, "
+					  "keeping all frames in memory");
+			d->disk_failed = true;
+			return -1;
+		}
+	}
+
+	if (os_fseeki64(d->disk_file, pos, SEEK_SET) != 0)
+		goto fail;
+
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		if (sizes[i] && fwrite(frame->data[i], 1, sizes[i], d->disk_file) != sizes[i])
+			goto fail;
+		total += sizes[i];
+	}
+
+	pthread_mutex_lock(&limit_mutex);
+	d->disk_size += total;
+	global_stats.disk_bytes += total;
+	pthread_mutex_unlock(&limit_mutex);
+	return pos;
+
+fail:
+	blog(LOG_WARNING, "MP: Failed to write to cache file, "
+			  "keeping remaining frames in memory");
+	d->disk_failed = true;
+	return -1;
+}
+
+/* fills out a frame that can be passed to callbacks.  frames stored on disk
+ * are read into a staging buffer that is only valid until the next call. */
+static bool load_frame(mp_cache_t *c, size_t idx, struct obs_source_frame *out)
+{
+	struct mp_cache_data *d = c->data;
+	struct obs_source_frame *frame = &d->video_frames.array[idx];
+	size_t sizes[MAX_AV_PLANES];
+	bool success;
+
+	*out = *frame;
+	out->flags = c->is_linear_alpha ? OBS_SOURCE_FRAME_LINEAR_ALPHA : 0;
+
+	if (frame->data[0]) {
+		count_access(c, true);
+		return true;
+	}
+
+	size_t size = get_plane_sizes(frame, sizes);
+	if (c->staging_size < size) {
+		bfree(c->staging);
+		c->staging = bmalloc(size);
+		c->staging_size = size;
+	}
+
+	/* the file position is shared by every cache playing this data */
+	pthread_mutex_lock(&d->disk_mutex);
+	success = os_fseeki64(d->disk_file, d->disk_pos.array[idx], SEEK_SET) == 0 &&
+		  fread(c->staging, 1, size, d->disk_file) == size;
+	pthread_mutex_unlock(&d->disk_mutex);
+
+	if (!success) {
+		blog(LOG_WARNING, "MP: Failed to read frame %zu from cache file", idx);
+		return false;
+	}
+
+	uint8_t *ptr = c->staging;
+	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+		out->data[i] = sizes[i] ? ptr : NULL;
+		ptr += sizes[i];
+	}
+
+	count_access(c, false);
+	return true;
+}
 
 static inline int64_t mp_cache_get_next_min_pts(mp_cache_t *c)
 {
@@ -110,8 +305,166 @@ static bool mp_cache_eof(mp_cache_t *c)
 	return true;
 }
 
-bool mp_cache_decode(mp_cache_t *c)
+/* ------------------------------------------------------------------------- */
+/* Registry of decoded data, so that sources playing the same file with the
+ * same decode settings only decode and store it once.  A local file is only
+ * shared while its modification time and size stay the same. */
+
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct mp_cache_data *registry = NULL;
+
+static inline bool str_equal(const char *a, const char *b)
+{
+	return strcmp(a ? a : "", b ? b : "") == 0;
+}
+
+static void get_file_info(const struct mp_media_info *info, time_t *mtime, int64_t *size)
+{
+	struct stat stats;
+
+	*mtime = 0;
+	*size = 0;
+
+	if (info->is_local_file && info->path && os_stat(info->path, &stats) == 0) {
+		*mtime = stats.st_mtime;
+		*size = (int64_t)stats.st_size;
+	}
+}
+
+static bool mp_cache_data_matches(const struct mp_cache_data *d, const struct mp_media_info *info, time_t mtime,
+				  int64_t size)
 {
+	return str_equal(d->path, info->path) && str_equal(d->format_name, info->format) &&
+	       str_equal(d->ffmpeg_options, info->ffmpeg_options) && d->force_range == info->force_range &&
+	       d->hw == info->hardware_decoding && d->speed == info->speed && d->mtime == mtime &&
+	       d->file_size == size;
+}
+
+/* registry_mutex must be held */
+static struct mp_cache_data *mp_cache_data_find(const struct mp_media_info *info, time_t mtime, int64_t size)
+{
+	for (struct mp_cache_data *d = registry; d; d = d->next) {
+		if (mp_cache_data_matches(d, info, mtime, size)) {
+			d->refs++;
+			return d;
+		}
+	}
+
+	return NULL;
+}
+
+/* registry_mutex must be held */
+static struct mp_cache_data *mp_cache_data_create(const struct mp_media_info *info, mp_media_t *m, time_t mtime,
+						  int64_t size)
+{
+	struct mp_cache_data *d = bzalloc(sizeof(*d));
+
+	if (pthread_mutex_init(&d->disk_mutex, NULL) != 0) {
+		blog(LOG_WARNING, "MP: Failed to init mutex");
+		bfree(d);
+		return NULL;
+	}
+
+	d->path = bstrdup(info->path);
+	d->format_name = bstrdup(info->format);
+	d->ffmpeg_options = bstrdup(info->ffmpeg_options);
+	d->force_range = info->force_range;
+	d->hw = info->hardware_decoding;
+	d->speed = info->speed;
+	d->mtime = mtime;
+	d->file_size = size;
+
+	d->has_video = m->has_video;
+	d->has_audio = m->has_audio;
+	d->media_duration = m->fmt->duration;
+
+	d->refs = 1;
+	d->registered = true;
+	d->next = registry;
+	registry = d;
+	return d;
+}
+
+/* registry_mutex must be held */
+static void mp_cache_data_unlink(struct mp_cache_data *d)
+{
+	if (!d->registered)
+		return;
+
+	for (struct mp_cache_data **p = &registry; *p; p = &(*p)->next) {
+		if (*p == d) {
+			*p = d->next;
+			break;
+		}
+	}
+
+	d->registered = false;
+}
+
+/* frees the decoded frames, only called while nothing can be playing them */
+static void mp_cache_data_clear(struct mp_cache_data *d)
+{
+	for (size_t i = 0; i < d->video_frames.num; i++) {
+		struct obs_source_frame *f = &d->video_frames.array[i];
+		obs_source_frame_free(f);
+	}
+	for (size_t i = 0; i < d->audio_segments.num; i++) {
+		struct obs_source_audio *a = &d->audio_segments.array[i];
+		bfree((void *)a->data[0]);
+	}
+	da_free(d->video_frames);
+	da_free(d->audio_segments);
+	da_free(d->disk_pos);
+
+	if (d->disk_file) {
+		fclose(d->disk_file);
+		d->disk_file = NULL;
+	}
+	d->disk_failed = false;
+	release_memory(d);
+}
+
+static void mp_cache_data_release(struct mp_cache_data *d)
+{
+	bool destroy;
+
+	if (!d)
+		return;
+
+	pthread_mutex_lock(&registry_mutex);
+	destroy = --d->refs == 0;
+	if (destroy)
+		mp_cache_data_unlink(d);
+	pthread_mutex_unlock(&registry_mutex);
+
+	if (!destroy)
+		return;
+
+	mp_cache_data_clear(d);
+	da_free(d->waiters);
+	pthread_mutex_destroy(&d->disk_mutex);
+	bfree(d->path);
+	bfree(d->format_name);
+	bfree(d->ffmpeg_options);
+	bfree(d);
+}
+
+static bool mp_cache_killed(mp_cache_t *c)
+{
+	bool kill;
+
+	pthread_mutex_lock(&c->mutex);
+	kill = c->kill;
+	pthread_mutex_unlock(&c->mutex);
+
+	return kill;
+}
+
+/* decodes the whole file into the shared data.  stops early if the cache is
+ * being destroyed, so another cache sharing the data can take over. */
+static bool mp_cache_decode(mp_cache_t *c)
+{
+	struct mp_cache_data *d = c->data;
 	mp_media_t *m = &c->m;
 	bool success = false;
 
@@ -120,6 +473,9 @@ bool mp_cache_decode(mp_cache_t *c)
 	mp_media_reset(m);
 
 	while (!mp_media_eof(m)) {
+		if (mp_cache_killed(c))
+			goto fail;
+
 		if (m->has_video)
 			mp_media_next_video(m, false);
 		if (m->has_audio)
@@ -131,15 +487,110 @@ bool mp_cache_decode(mp_cache_t *c)
 
 	success = true;
 
-	c->start_time = c->m.fmt->start_time;
-	if (c->start_time == AV_NOPTS_VALUE)
-		c->start_time = 0;
+	if (d->disk_size)
+		blog(LOG_INFO,
+		     "MP: Memory limit reached while caching '%s', "
+		     "%" PRIu64 " MB in memory, %" PRIu64 " MB on disk",
+		     c->path, d->resident_bytes / (1024 * 1024), d->disk_size / (1024 * 1024));
+
+	d->start_time = c->m.fmt->start_time;
+	if (d->start_time == AV_NOPTS_VALUE)
+		d->start_time = 0;
 
 fail:
 	mp_media_free(m);
 	return success;
 }
 
+/* registry_mutex must be held */
+static void remove_waiter(struct mp_cache_data *d, mp_cache_t *c)
+{
+	da_erase_item(d->waiters, &c->sem);
+}
+
+static void finish_decoding(mp_cache_t *c, bool success)
+{
+	struct mp_cache_data *d = c->data;
+
+	/* nobody else touches the frames until decoding is cleared */
+	if (!success)
+		mp_cache_data_clear(d);
+
+	pthread_mutex_lock(&registry_mutex);
+	d->decoding = false;
+	d->ready = success;
+	for (size_t i = 0; i < d->waiters.num; i++)
+		os_sem_post(d->waiters.array[i]);
+	pthread_mutex_unlock(&registry_mutex);
+}
+
+/* Waits for the data to be decoded.  The first cache to find nobody decoding
+ * it decodes it with the media it opened, so if that cache fails or is
+ * destroyed halfway, a cache that is still waiting starts over.  Commands
+ * posted to the semaphore while waiting are handled once the data is ready. */
+static bool mp_cache_wait_for_data(mp_cache_t *c)
+{
+	struct mp_cache_data *d = c->data;
+	bool waited = false;
+	bool success = false;
+
+	for (;;) {
+		bool ready, decode, failed;
+
+		pthread_mutex_lock(&registry_mutex);
+		ready = d->ready;
+		decode = !ready && !d->decoding && c->m.fmt;
+		failed = !ready && !d->decoding && !c->m.fmt;
+		if (decode)
+			d->decoding = true;
+		if (ready || decode || failed)
+			remove_waiter(d, c);
+		else if (da_find(d->waiters, &c->sem, 0) == DARRAY_INVALID)
+			da_push_back(d->waiters, &c->sem);
+		pthread_mutex_unlock(&registry_mutex);
+
+		if (ready) {
+			success = true;
+			break;
+		}
+		if (failed)
+			break;
+
+		if (decode) {
+			bool decoded = mp_cache_decode(c);
+			finish_decoding(c, decoded);
+			if (decoded) {
+				success = true;
+				break;
+			}
+		} else {
+			os_sem_wait(c->sem);
+			waited = true;
+		}
+
+		if (mp_cache_killed(c)) {
+			pthread_mutex_lock(&registry_mutex);
+			remove_waiter(d, c);
+			pthread_mutex_unlock(&registry_mutex);
+			break;
+		}
+	}
+
+	/* only needed to take over decoding */
+	if (c->m.fmt)
+		mp_media_free(&c->m);
+	if (waited)
+		os_sem_post(c->sem);
+
+	if (!success)
+		return false;
+
+	c->start_time = d->start_time;
+	c->final_v_duration = d->final_v_duration;
+	c->final_a_duration = d->final_a_duration;
+	return true;
+}
+
 static void seek_to(mp_cache_t *c, int64_t pos)
 {
 	size_t new_v_idx = 0;
@@ -153,8 +604,8 @@ static void seek_to(mp_cache_t *c, int64_t pos)
 	if (c->has_video) {
 		struct obs_source_frame *v;
 
-		for (size_t i = 0; i < c->video_frames.num; i++) {
-			v = &c->video_frames.array[i];
+		for (size_t i = 0; i < c->data->video_frames.num; i++) {
+			v = &c->data->video_frames.array[i];
 			new_v_idx = i;
 			if ((int64_t)v->timestamp >= pos) {
 				break;
@@ -162,17 +613,17 @@ static void seek_to(mp_cache_t *c, int64_t pos)
 		}
 
 		size_t next_idx = new_v_idx + 1;
-		if (next_idx == c->video_frames.num) {
+		if (next_idx == c->data->video_frames.num) {
 			c->next_v_ts = (int64_t)v->timestamp + c->final_v_duration;
 		} else {
-			struct obs_source_frame *next = &c->video_frames.array[next_idx];
+			struct obs_source_frame *next = &c->data->video_frames.array[next_idx];
 			c->next_v_ts = (int64_t)next->timestamp;
 		}
 	}
 	if (c->has_audio) {
 		struct obs_source_audio *a;
-		for (size_t i = 0; i < c->audio_segments.num; i++) {
-			a = &c->audio_segments.array[i];
+		for (size_t i = 0; i < c->data->audio_segments.num; i++) {
+			a = &c->data->audio_segments.array[i];
 			new_a_idx = i;
 			if ((int64_t)a->timestamp >= pos) {
 				break;
@@ -180,10 +631,10 @@ static void seek_to(mp_cache_t *c, int64_t pos)
 		}
 
 		size_t next_idx = new_a_idx + 1;
-		if (next_idx == c->audio_segments.num) {
+		if (next_idx == c->data->audio_segments.num) {
 			c->next_a_ts = (int64_t)a->timestamp + c->final_a_duration;
 		} else {
-			struct obs_source_audio *next = &c->audio_segments.array[next_idx];
+			struct obs_source_audio *next = &c->data->audio_segments.array[next_idx];
 			c->next_a_ts = (int64_t)next->timestamp;
 		}
 	}
@@ -208,8 +659,8 @@ static inline bool mp_media_can_play_audio(mp_cache_t *c)
 static inline void calc_next_v_ts(mp_cache_t *c, struct obs_source_frame *frame)
 {
 	int64_t offset;
-	if (c->next_v_idx < c->video_frames.num) {
-		struct obs_source_frame *next = &c->video_frames.array[c->next_v_idx];
+	if (c->next_v_idx < c->data->video_frames.num) {
+		struct obs_source_frame *next = &c->data->video_frames.array[c->next_v_idx];
 		offset = (int64_t)(next->timestamp - frame->timestamp);
 	} else {
 		offset = c->final_v_duration;
@@ -221,8 +672,8 @@ static inline void calc_next_v_ts(mp_cache_t *c, struct obs_source_frame *frame)
 static inline void calc_next_a_ts(mp_cache_t *c, struct obs_source_audio *audio)
 {
 	int64_t offset;
-	if (c->next_a_idx < c->audio_segments.num) {
-		struct obs_source_audio *next = &c->audio_segments.array[c->next_a_idx];
+	if (c->next_a_idx < c->data->audio_segments.num) {
+		struct obs_source_audio *next = &c->data->audio_segments.array[c->next_a_idx];
 		offset = (int64_t)(next->timestamp - audio->timestamp);
 	} else {
 		offset = c->final_a_duration;
@@ -234,29 +685,30 @@ static inline void calc_next_a_ts(mp_cache_t *c, struct obs_source_audio *audio)
 static void mp_cache_next_video(mp_cache_t *c, bool preload)
 {
 	/* eof check */
-	if (c->next_v_idx == c->video_frames.num) {
+	if (c->next_v_idx == c->data->video_frames.num) {
 		if (mp_media_can_play_video(c))
 			c->cur_v_idx = c->next_v_idx;
 		return;
 	}
 
-	struct obs_source_frame *frame = &c->video_frames.array[c->next_v_idx];
-	struct obs_source_frame dup = *frame;
+	if (!preload && !mp_media_can_play_video(c))
+		return;
+
+	struct obs_source_frame *frame = &c->data->video_frames.array[c->next_v_idx];
+	struct obs_source_frame dup;
+	bool loaded = load_frame(c, c->next_v_idx, &dup);
 
 	dup.timestamp = c->base_ts + dup.timestamp - c->start_ts + c->play_sys_ts - base_sys_ts;
 
 	if (!preload) {
-		if (!mp_media_can_play_video(c))
-			return;
-
-		if (c->v_cb)
+		if (loaded && c->v_cb)
 			c->v_cb(c->opaque, &dup);
 
 		if (c->cur_v_idx < c->next_v_idx)
 			++c->cur_v_idx;
 		++c->next_v_idx;
 		calc_next_v_ts(c, frame);
-	} else {
+	} else if (loaded) {
 		if (c->seek_next_ts && c->v_seek_cb) {
 			c->v_seek_cb(c->opaque, &dup);
 		} else if (!c->request_preload) {
@@ -268,7 +720,7 @@ static void mp_cache_next_video(mp_cache_t *c, bool preload)
 static void mp_cache_next_audio(mp_cache_t *c)
 {
 	/* eof check */
-	if (c->next_a_idx == c->audio_segments.num) {
+	if (c->next_a_idx == c->data->audio_segments.num) {
 		if (mp_media_can_play_audio(c))
 			c->cur_a_idx = c->next_a_idx;
 		return;
@@ -277,7 +729,7 @@ static void mp_cache_next_audio(mp_cache_t *c)
 	if (!mp_media_can_play_audio(c))
 		return;
 
-	struct obs_source_audio *audio = &c->audio_segments.array[c->next_a_idx];
+	struct obs_source_audio *audio = &c->data->audio_segments.array[c->next_a_idx];
 	struct obs_source_audio dup = *audio;
 
 	dup.timestamp = c->base_ts + dup.timestamp - c->start_ts + c->play_sys_ts - base_sys_ts;
@@ -312,14 +764,14 @@ static bool mp_cache_reset(mp_cache_t *c)
 	pthread_mutex_unlock(&c->mutex);
 
 	if (c->has_video) {
-		size_t next_idx = c->video_frames.num > 1 ? 1 : 0;
+		size_t next_idx = c->data->video_frames.num > 1 ? 1 : 0;
 		c->cur_v_idx = c->next_v_idx = 0;
-		c->next_v_ts = c->video_frames.array[next_idx].timestamp;
+		c->next_v_ts = c->data->video_frames.array[next_idx].timestamp;
 	}
 	if (c->has_audio) {
-		size_t next_idx = c->audio_segments.num > 1 ? 1 : 0;
+		size_t next_idx = c->data->audio_segments.num > 1 ? 1 : 0;
 		c->cur_a_idx = c->next_a_idx = 0;
-		c->next_a_ts = c->audio_segments.array[next_idx].timestamp;
+		c->next_a_ts = c->data->audio_segments.array[next_idx].timestamp;
 	}
 
 	if (active) {
@@ -369,8 +821,9 @@ static inline bool mp_cache_thread(mp_cache_t *c)
 {
 	os_set_thread_name("mp_cache_thread");
 
-	if (!mp_cache_decode(c)) {
-		return false;
+	if (!mp_cache_wait_for_data(c)) {
+		/* not a failure if the cache is being destroyed */
+		return mp_cache_killed(c);
 	}
 
 	for (;;) {
@@ -432,8 +885,11 @@ static inline bool mp_cache_thread(mp_cache_t *c)
 		if (pause)
 			continue;
 
-		if (preload_frame)
-			c->v_preload_cb(c->opaque, &c->video_frames.array[0]);
+		if (preload_frame) {
+			struct obs_source_frame frame;
+			if (load_frame(c, 0, &frame))
+				c->v_preload_cb(c->opaque, &frame);
+		}
 
 		/* frames are ready */
 		if (is_active && !timeout) {
@@ -468,16 +924,32 @@ static void *mp_cache_thread_start(void *opaque)
 static void fill_video(void *data, struct obs_source_frame *frame)
 {
 	mp_cache_t *c = data;
+	struct mp_cache_data *d = c->data;
 	struct obs_source_frame dup;
+	size_t sizes[MAX_AV_PLANES];
+	int64_t pos = -1;
+
+	size_t size = get_plane_sizes(frame, sizes);
+	if (!reserve_memory(d, size, false)) {
+		pos = write_frame_to_disk(d, frame, sizes);
+		if (pos < 0)
+			reserve_memory(d, size, true);
+	}
 
-	obs_source_frame_init(&dup, frame->format, frame->width, frame->height);
-	obs_source_frame_copy(&dup, frame);
+	if (pos < 0) {
+		obs_source_frame_init(&dup, frame->format, frame->width, frame->height);
+		obs_source_frame_copy(&dup, frame);
+	} else {
+		dup = *frame;
+		memset(dup.data, 0, sizeof(dup.data));
+	}
 
 	dup.timestamp = frame->timestamp;
 
-	c->final_v_duration = c->m.v.last_duration;
+	d->final_v_duration = c->m.v.last_duration;
 
-	da_push_back(c->video_frames, &dup);
+	da_push_back(d->video_frames, &dup);
+	da_push_back(d->disk_pos, &pos);
 }
 
 static void fill_audio(void *data, struct obs_source_audio *audio)
@@ -485,8 +957,10 @@ static void fill_audio(void *data, struct obs_source_audio *audio)
 	mp_cache_t *c = data;
 	struct obs_source_audio dup = *audio;
 
+	/* audio is small next to video, so it is always kept in memory */
 	size_t size = get_total_audio_size(dup.format, dup.speakers, dup.frames);
 	dup.data[0] = bmalloc(size);
+	reserve_memory(c->data, size, true);
 
 	size_t planes = get_audio_planes(dup.format, dup.speakers);
 	if (planes > 1) {
@@ -504,9 +978,9 @@ static void fill_audio(void *data, struct obs_source_audio *audio)
 		memcpy((uint8_t *)dup.data[0], audio->data[0], size);
 	}
 
-	c->final_a_duration = c->m.a.last_duration;
+	c->data->final_a_duration = c->m.a.last_duration;
 
-	da_push_back(c->audio_segments, &dup);
+	da_push_back(c->data->audio_segments, &dup);
 }
 
 static inline bool mp_cache_init_internal(mp_cache_t *c, const struct mp_media_info *info)
@@ -545,14 +1019,29 @@ bool mp_cache_init(mp_cache_t *c, const struct mp_media_info *info)
 	info2.full_decode = true;
 
 	mp_media_t *m = &c->m;
+	time_t mtime;
+	int64_t size;
 
 	pthread_mutex_init_value(&c->mutex);
 
-	if (!mp_media_init(m, &info2)) {
+	/* every cache opens the file itself, outside of the registry lock, so
+	 * that it can take over decoding if the cache decoding it goes away */
+	if (!mp_media_init(m, &info2) || !mp_media_init2(m)) {
 		mp_cache_free(c);
 		return false;
 	}
-	if (!mp_media_init2(m)) {
+
+	get_file_info(info, &mtime, &size);
+
+	pthread_mutex_lock(&registry_mutex);
+	c->data = mp_cache_data_find(info, mtime, size);
+	if (!c->data)
+		c->data = mp_cache_data_create(info, m, mtime, size);
+	else
+		blog(LOG_DEBUG, "MP: Sharing decoded frames of '%s'", info->path);
+	pthread_mutex_unlock(&registry_mutex);
+
+	if (!c->data) {
 		mp_cache_free(c);
 		return false;
 	}
@@ -565,11 +1054,12 @@ bool mp_cache_init(mp_cache_t *c, const struct mp_media_info *info)
 	c->v_seek_cb = info->v_seek_cb;
 	c->v_preload_cb = info->v_preload_cb;
 	c->request_preload = info->request_preload;
+	c->is_linear_alpha = info->is_linear_alpha;
 	c->speed = info->speed;
-	c->media_duration = m->fmt->duration;
+	c->media_duration = c->data->media_duration;
 
-	c->has_video = m->has_video;
-	c->has_audio = m->has_audio;
+	c->has_video = c->data->has_video;
+	c->has_audio = c->data->has_audio;
 
 	if (!base_sys_ts)
 		base_sys_ts = (int64_t)os_gettime_ns();
@@ -605,16 +1095,8 @@ void mp_cache_free(mp_cache_t *c)
 	if (c->m.fmt)
 		mp_media_free(&c->m);
 
-	for (size_t i = 0; i < c->video_frames.num; i++) {
-		struct obs_source_frame *f = &c->video_frames.array[i];
-		obs_source_frame_free(f);
-	}
-	for (size_t i = 0; i < c->audio_segments.num; i++) {
-		struct obs_source_audio *a = &c->audio_segments.array[i];
-		bfree((void *)a->data[0]);
-	}
-	da_free(c->video_frames);
-	da_free(c->audio_segments);
+	mp_cache_data_release(c->data);
+	bfree(c->staging);
 
 	bfree(c->path);
 	bfree(c->format_name);
@@ -692,7 +1174,7 @@ void mp_cache_seek(mp_cache_t *c, int64_t pos)
 
 int64_t mp_cache_get_frames(mp_cache_t *c)
 {
-	return c->video_frames.num;
+	return c->data->video_frames.num;
 }
 
 int64_t mp_cache_get_duration(mp_cache_t *c)
@@ -22,6 +22,56 @@
 
 #include "media.h"
 
+struct mp_cache_stats {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t resident_bytes;
+	uint64_t disk_bytes;
+};
+
+/* Decoded frames of one file.  Caches opening the same file with the same
+ * decode settings share one instance, each with its own playback position. */
+struct mp_cache_data {
+	char *path;
+	char *format_name;
+	char *ffmpeg_options;
+	enum video_range_type force_range;
+	bool hw;
+	int speed;
+	time_t mtime;
+	int64_t file_size;
+
+	long refs;
+	bool registered;
+	struct mp_cache_data *next;
+
+	/* protected by the registry mutex.  whichever cache finds nobody
+	 * decoding the data decodes it, the others wait on their semaphore */
+	bool decoding;
+	bool ready;
+	DARRAY(os_sem_t *) waiters;
+
+	bool has_video;
+	bool has_audio;
+	int64_t start_time;
+	int64_t media_duration;
+	int64_t final_v_duration;
+	int64_t final_a_duration;
+
+	DARRAY(struct obs_source_frame) video_frames;
+	DARRAY(struct obs_source_audio) audio_segments;
+
+	/* frames past the memory limit are written to disk; their entry in
+	 * video_frames has no data and disk_pos holds the file offset */
+	DARRAY(int64_t) disk_pos;
+	pthread_mutex_t disk_mutex;
+	FILE *disk_file;
+	uint64_t disk_size;
+	bool disk_failed;
+
+	uint64_t resident_bytes;
+};
+
 struct mp_cache {
 	mp_video_cb v_preload_cb;
 	mp_video_cb v_seek_cb;
@@ -30,6 +80,7 @@ struct mp_cache {
 	mp_audio_cb a_cb;
 	void *opaque;
 	bool request_preload;
+	bool is_linear_alpha;
 	bool has_video;
 	bool has_audio;
 
@@ -51,8 +102,12 @@ struct mp_cache {
 	bool thread_valid;
 	pthread_t thread;
 
-	DARRAY(struct obs_source_frame) video_frames;
-	DARRAY(struct obs_source_audio) audio_segments;
+	struct mp_cache_data *data;
+
+	uint8_t *staging;
+	size_t staging_size;
+	uint64_t hits;
+	uint64_t misses;
 
 	size_t cur_v_idx;
 	size_t cur_a_idx;
@@ -95,3 +150,9 @@ extern int64_t mp_cache_get_current_time(mp_cache_t *c);
 extern void mp_cache_seek(mp_cache_t *c, int64_t pos);
 extern int64_t mp_cache_get_frames(mp_cache_t *c);
 extern int64_t mp_cache_get_duration(mp_cache_t *c);
+extern void mp_cache_get_stats(mp_cache_t *c, struct mp_cache_stats *stats);
+
+/* the memory limit is shared by every cache in the process */
+extern void mp_cache_set_memory_limit(uint64_t bytes);
+extern uint64_t mp_cache_get_memory_limit(void);
+extern void mp_cache_get_global_stats(struct mp_cache_stats *stats);
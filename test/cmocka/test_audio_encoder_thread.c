@@ -0,0 +1,225 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <obs.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#define SAMPLE_RATE 48000
+
+/* AUDIO_QUEUE_SIZE in obs-encoder.c, one slot of the ring is kept empty */
+#define QUEUE_CHUNKS 63
+
+/* how long the first encode call is held up */
+#define HOLD_MS 200
+
+static os_event_t *encode_gate;
+static volatile long encoded;
+static volatile long mix_callbacks;
+static volatile bool encoded_on_audio_thread;
+
+static pthread_t audio_thread;
+static volatile bool audio_thread_known;
+
+static const char *test_getname(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Audio encoder thread test";
+}
+
+static void *enc_create(obs_data_t *settings, obs_encoder_t *encoder)
+{
+	UNUSED_PARAMETER(settings);
+	return encoder;
+}
+
+static void enc_destroy(void *data)
+{
+	UNUSED_PARAMETER(data);
+}
+
+/* the first call waits until the test opens the gate, so the queue fills up
+ * behind it */
+static bool enc_encode(void *data, struct encoder_frame *frame, struct encoder_packet *packet, bool *received_packet)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(frame);
+	UNUSED_PARAMETER(packet);
+
+	os_event_wait(encode_gate);
+
+	if (os_atomic_load_bool(&audio_thread_known) && pthread_equal(pthread_self(), audio_thread))
+		encoded_on_audio_thread = true;
+
+	os_atomic_inc_long(&encoded);
+	*received_packet = false;
+	return true;
+}
+
+static size_t enc_frame_size(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return AUDIO_OUTPUT_FRAMES;
+}
+
+static struct obs_encoder_info test_encoder = {
+	.id = "test_audio_thread_encoder",
+	.type = OBS_ENCODER_AUDIO,
+	.codec = "pcm",
+	.get_name = test_getname,
+	.create = enc_create,
+	.destroy = enc_destroy,
+	.encode = enc_encode,
+	.get_frame_size = enc_frame_size,
+};
+
+static void *out_create(obs_data_t *settings, obs_output_t *output)
+{
+	UNUSED_PARAMETER(settings);
+	return output;
+}
+
+static void out_destroy(void *data)
+{
+	UNUSED_PARAMETER(data);
+}
+
+static bool out_start(void *data)
+{
+	obs_output_t *output = data;
+
+	if (!obs_output_can_begin_data_capture(output, 0))
+		return false;
+	if (!obs_output_initialize_encoders(output, 0))
+		return false;
+	return obs_output_begin_data_capture(output, 0);
+}
+
+static void out_stop(void *data, uint64_t ts)
+{
+	UNUSED_PARAMETER(ts);
+	obs_output_end_data_capture(data);
+}
+
+static void out_packet(void *data, struct encoder_packet *packet)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(packet);
+}
+
+static struct obs_output_info test_output = {
+	.id = "test_audio_thread_output",
+	.flags = OBS_OUTPUT_AUDIO | OBS_OUTPUT_ENCODED,
+	.encoded_audio_codecs = "pcm",
+	.get_name = test_getname,
+	.create = out_create,
+	.destroy = out_destroy,
+	.start = out_start,
+	.stop = out_stop,
+	.encoded_packet = out_packet,
+};
+
+/* connected to the same mix, runs on the audio thread */
+static void mix_callback(void *param, size_t mix_idx, struct audio_data *data)
+{
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(mix_idx);
+	UNUSED_PARAMETER(data);
+
+	if (!audio_thread_known) {
+		audio_thread = pthread_self();
+		os_atomic_set_bool(&audio_thread_known, true);
+	}
+	os_atomic_inc_long(&mix_callbacks);
+}
+
+static struct obs_encoder_thread_stats get_stats(obs_encoder_t *encoder)
+{
+	struct obs_encoder_thread_stats stats;
+	assert_true(obs_encoder_get_thread_stats(encoder, &stats));
+	return stats;
+}
+
+static void queue_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct obs_audio_info oai = {SAMPLE_RATE, SPEAKERS_STEREO};
+	struct obs_encoder_thread_stats stats;
+	obs_encoder_t *encoder;
+	obs_output_t *output;
+
+	assert_true(obs_startup("en-US", NULL, NULL));
+	assert_true(obs_reset_audio(&oai));
+	assert_int_equal(os_event_init(&encode_gate, OS_EVENT_TYPE_MANUAL), 0);
+
+	obs_register_encoder(&test_encoder);
+	obs_register_output(&test_output);
+	obs_set_threaded_audio_encoders(true);
+
+	encoder = obs_audio_encoder_create("test_audio_thread_encoder", "enc", NULL, 0, NULL);
+	assert_non_null(encoder);
+	obs_encoder_set_audio(encoder, obs_get_audio());
+
+	output = obs_output_create("test_audio_thread_output", "out", NULL, NULL);
+	assert_non_null(output);
+	obs_output_set_audio_encoder(output, encoder, 0);
+
+	assert_true(audio_output_connect(obs_get_audio(), 0, NULL, mix_callback, NULL));
+	assert_true(obs_output_start(output));
+
+	/* the queue fills up behind the held encode call */
+	for (size_t i = 0; i < 500; i++) {
+		stats = get_stats(encoder);
+		if (stats.queue_depth == QUEUE_CHUNKS)
+			break;
+		os_sleep_ms(10);
+	}
+
+	assert_int_equal(stats.queue_depth, QUEUE_CHUNKS);
+	assert_int_equal(stats.stalls, 0);
+
+	/* after that the audio thread waits for the encoder instead of
+	 * dropping audio, so nothing else on the mix advances */
+	os_sleep_ms(HOLD_MS / 2);
+	long callbacks = os_atomic_load_long(&mix_callbacks);
+	os_sleep_ms(HOLD_MS / 2);
+	assert_int_equal(os_atomic_load_long(&mix_callbacks), callbacks);
+
+	os_event_signal(encode_gate);
+
+	while (os_atomic_load_long(&encoded) < QUEUE_CHUNKS * 2)
+		os_sleep_ms(10);
+
+	stats = get_stats(encoder);
+	assert_true(stats.stalls >= 1);
+	assert_int_equal(stats.max_queue_depth, QUEUE_CHUNKS);
+	assert_true(stats.chunks_encoded >= QUEUE_CHUNKS * 2);
+	assert_true(stats.max_encode_time_ns >= HOLD_MS * 1000000ULL);
+	assert_true(stats.encode_time_ns >= stats.max_encode_time_ns);
+	assert_true(stats.queue_depth < QUEUE_CHUNKS);
+	assert_true(os_atomic_load_long(&mix_callbacks) > callbacks);
+	assert_false(encoded_on_audio_thread);
+
+	obs_output_stop(output);
+	while (obs_output_active(output))
+		os_sleep_ms(10);
+
+	audio_output_disconnect(obs_get_audio(), 0, mix_callback, NULL);
+
+	obs_output_release(output);
+	obs_encoder_release(encoder);
+	os_event_destroy(encode_gate);
+	obs_shutdown();
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(queue_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
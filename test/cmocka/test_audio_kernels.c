@@ -0,0 +1,127 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <cmocka.h>
+
+#include <media-io/audio-kernels.h>
+#include <util/platform.h>
+
+/* 8 channels of one audio tick, with an odd tail to exercise the remainder
+ * handling of the vectorized kernels */
+#define NUM_FLOATS (1024 * 8 + 3)
+#define BENCH_ITERATIONS 20000
+
+static float src[NUM_FLOATS];
+static float ramp[NUM_FLOATS];
+static float expected[NUM_FLOATS];
+static float actual[NUM_FLOATS];
+
+static const struct audio_kernels *get_kernels(size_t idx)
+{
+	switch (idx) {
+	case 0:
+		return &audio_kernels_scalar;
+	case 1:
+		return &audio_kernels_sse2;
+#ifdef AUDIO_KERNELS_AVX2
+	case 2:
+		audio_kernels_init();
+		return audio_kernels == &audio_kernels_avx2 ? &audio_kernels_avx2 : NULL;
+#endif
+	default:
+		return NULL;
+	}
+}
+
+static void fill_data(void)
+{
+	for (size_t i = 0; i < NUM_FLOATS; i++) {
+		src[i] = sinf((float)i * 0.01f) * 1.5f;
+		ramp[i] = 1.0f - (float)i / (float)NUM_FLOATS * 0.001f;
+		expected[i] = cosf((float)i * 0.02f) * 1.5f;
+	}
+}
+
+static void kernels_match_scalar_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	const struct audio_kernels *ref = &audio_kernels_scalar;
+	const struct audio_kernels *k;
+
+	for (size_t idx = 1; (k = get_kernels(idx)) != NULL; idx++) {
+		fill_data();
+		memcpy(actual, expected, sizeof(actual));
+		ref->mix(expected, src, NUM_FLOATS);
+		k->mix(actual, src, NUM_FLOATS);
+		assert_memory_equal(expected, actual, sizeof(actual));
+
+		ref->gain(expected, 0.5f, NUM_FLOATS);
+		k->gain(actual, 0.5f, NUM_FLOATS);
+		assert_memory_equal(expected, actual, sizeof(actual));
+
+		ref->gain_ramp(expected, ramp, NUM_FLOATS);
+		k->gain_ramp(actual, ramp, NUM_FLOATS);
+		assert_memory_equal(expected, actual, sizeof(actual));
+
+		expected[7] = actual[7] = NAN;
+		ref->clamp(expected, NUM_FLOATS);
+		k->clamp(actual, NUM_FLOATS);
+		assert_memory_equal(expected, actual, sizeof(actual));
+		assert_true(actual[7] == 0.0f);
+	}
+}
+
+/* only run when OBS_TEST_BENCHMARK is set, the timings are meant to be read
+ * by hand and would only be noise in a regular test run */
+static void kernels_benchmark_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	if (!getenv("OBS_TEST_BENCHMARK"))
+		skip();
+
+	const struct audio_kernels *k;
+	fill_data();
+
+	for (size_t idx = 0; (k = get_kernels(idx)) != NULL; idx++) {
+		uint64_t mix_ns, gain_ns, ramp_ns, clamp_ns;
+		uint64_t start = os_gettime_ns();
+
+		for (size_t i = 0; i < BENCH_ITERATIONS; i++)
+			k->mix(actual, src, NUM_FLOATS);
+		mix_ns = os_gettime_ns() - start;
+		start = os_gettime_ns();
+
+		for (size_t i = 0; i < BENCH_ITERATIONS; i++)
+			k->gain(actual, 0.999f, NUM_FLOATS);
+		gain_ns = os_gettime_ns() - start;
+		start = os_gettime_ns();
+
+		for (size_t i = 0; i < BENCH_ITERATIONS; i++)
+			k->gain_ramp(actual, ramp, NUM_FLOATS);
+		ramp_ns = os_gettime_ns() - start;
+		start = os_gettime_ns();
+
+		for (size_t i = 0; i < BENCH_ITERATIONS; i++)
+			k->clamp(actual, NUM_FLOATS);
+		clamp_ns = os_gettime_ns() - start;
+
+		printf("%-6s mix %6.1f ns  gain %6.1f ns  gain_ramp %6.1f ns  clamp %6.1f ns (per %d floats)\n",
+		       k->name, (double)mix_ns / BENCH_ITERATIONS, (double)gain_ns / BENCH_ITERATIONS,
+		       (double)ramp_ns / BENCH_ITERATIONS, (double)clamp_ns / BENCH_ITERATIONS, NUM_FLOATS);
+	}
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(kernels_match_scalar_test),
+		cmocka_unit_test(kernels_benchmark_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,142 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <obs.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <util/util_uint64.h>
+
+#define SAMPLE_RATE 48000
+#define CHUNK_FRAMES 480
+
+/* routed to tracks 1 and 2, only mix 0 has an output connected */
+#define SOURCE_MIXERS ((1 << 0) | (1 << 1))
+
+static obs_source_t *test_source;
+static volatile bool saw_audio;
+static volatile bool saw_stale_mix;
+
+static const char *tone_getname(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Audio mix test source";
+}
+
+static void *tone_create(obs_data_t *settings, obs_source_t *source)
+{
+	UNUSED_PARAMETER(settings);
+	return source;
+}
+
+static void tone_destroy(void *data)
+{
+	UNUSED_PARAMETER(data);
+}
+
+static struct obs_source_info tone_source = {
+	.id = "test_audio_mix_source",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_AUDIO,
+	.get_name = tone_getname,
+	.create = tone_create,
+	.destroy = tone_destroy,
+};
+
+static bool is_silent(const float *data)
+{
+	for (size_t i = 0; i < AUDIO_OUTPUT_FRAMES; i++) {
+		if (data[i] != 0.0f)
+			return false;
+	}
+	return true;
+}
+
+/* runs on the audio thread right after the sources were rendered */
+static void mix_callback(void *param, size_t mix_idx, struct audio_data *data)
+{
+	struct obs_source_audio_mix mix;
+
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(mix_idx);
+
+	if (!is_silent((const float *)data->data[0]))
+		saw_audio = true;
+
+	obs_source_get_audio_mix(test_source, &mix);
+	for (size_t i = 1; i < MAX_AUDIO_MIXES; i++) {
+		if (!is_silent(mix.output[i].data[0]))
+			saw_stale_mix = true;
+	}
+}
+
+static void output_audio(uint64_t ts)
+{
+	static float samples[CHUNK_FRAMES];
+	struct obs_source_audio audio = {
+		.data = {(const uint8_t *)samples, (const uint8_t *)samples},
+		.frames = CHUNK_FRAMES,
+		.speakers = SPEAKERS_STEREO,
+		.format = AUDIO_FORMAT_FLOAT_PLANAR,
+		.samples_per_sec = SAMPLE_RATE,
+		.timestamp = ts,
+	};
+
+	for (size_t i = 0; i < CHUNK_FRAMES; i++)
+		samples[i] = 0.25f;
+
+	obs_source_output_audio(test_source, &audio);
+}
+
+static void unconnected_mixes_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct obs_audio_info oai = {SAMPLE_RATE, SPEAKERS_STEREO};
+	uint64_t processed_before, skipped_before;
+	uint64_t processed, skipped;
+
+	assert_true(obs_startup("en-US", NULL, NULL));
+	assert_true(obs_reset_audio(&oai));
+	obs_register_source(&tone_source);
+
+	test_source = obs_source_create("test_audio_mix_source", "tone", NULL, NULL);
+	assert_non_null(test_source);
+	obs_source_set_audio_mixers(test_source, SOURCE_MIXERS);
+
+	obs_get_audio_mix_counts(&processed_before, &skipped_before);
+	assert_true(audio_output_connect(obs_get_audio(), 0, NULL, mix_callback, NULL));
+
+	/* feed audio in real time until it has made it through the mix */
+	uint64_t ts = os_gettime_ns();
+	for (size_t i = 0; i < 300 && !saw_audio; i++) {
+		output_audio(ts);
+		ts += util_mul_div64(CHUNK_FRAMES, 1000000000ULL, SAMPLE_RATE);
+		os_sleepto_ns(ts);
+	}
+
+	audio_output_disconnect(obs_get_audio(), 0, mix_callback, NULL);
+	obs_get_audio_mix_counts(&processed, &skipped);
+
+	/* track 2 is routed but nothing is connected to it, and the other
+	 * tracks aren't routed, so only mix 0 carries the audio */
+	assert_true(saw_audio);
+	assert_false(saw_stale_mix);
+	assert_true(processed > processed_before);
+	assert_true(skipped > skipped_before);
+	assert_true(skipped - skipped_before >= (processed - processed_before) * (MAX_AUDIO_MIXES - 1));
+
+	obs_source_release(test_source);
+	test_source = NULL;
+	obs_shutdown();
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(unconnected_mixes_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
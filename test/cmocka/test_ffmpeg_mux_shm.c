@@ -0,0 +1,246 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <util/bmem.h>
+
+#include "ffmpeg-mux-shm.h"
+
+#define CAPACITY (1024 * 1024)
+
+/* doesn't divide the capacity, so the ring skips its end when wrapping */
+#define PACKET_SIZE (CAPACITY / 8 + 1000)
+
+/* always skips the rest of the ring after the first one, so positions move
+ * a whole capacity per packet */
+#define SKIP_SIZE (CAPACITY / 2 + 1)
+
+struct ring {
+	struct ffm_shm *writer;
+	struct ffm_shm *reader;
+
+	/* where the next packet is expected to go, and what's been released */
+	uint32_t next_pos;
+	uint32_t read_pos;
+};
+
+static uint8_t *packet_data;
+
+static void open_ring(struct ring *ring)
+{
+	ring->writer = ffm_shm_create(CAPACITY);
+	assert_non_null(ring->writer);
+
+	/* the muxer opens the ring by name in the other process */
+	ring->reader = ffm_shm_open(ffm_shm_name(ring->writer));
+	assert_non_null(ring->reader);
+
+	ring->next_pos = 0;
+	ring->read_pos = 0;
+}
+
+static void close_ring(struct ring *ring)
+{
+	ffm_shm_close(ring->reader);
+	ffm_shm_close(ring->writer);
+}
+
+/* where a packet goes if it fits: it's kept contiguous, so it starts over at
+ * the beginning of the ring rather than at its end */
+static uint32_t expected_pos(struct ring *ring, uint32_t size)
+{
+	uint32_t offset = ring->next_pos % CAPACITY;
+	return offset + size > CAPACITY ? ring->next_pos + (CAPACITY - offset) : ring->next_pos;
+}
+
+/* only the first and last bytes are marked with n, which is enough to catch
+ * a misplaced or overwritten packet without filling gigabytes of data */
+static bool write_packet(struct ring *ring, uint8_t n, uint32_t size, uint32_t *pos)
+{
+	packet_data[0] = n;
+	packet_data[size - 1] = n;
+
+	if (!ffm_shm_write(ring->writer, packet_data, size, pos))
+		return false;
+
+	assert_int_equal(*pos, expected_pos(ring, size));
+	ring->next_pos = *pos + size;
+	return true;
+}
+
+static void check_packet(struct ring *ring, uint8_t n, uint32_t pos, uint32_t size)
+{
+	const uint8_t *data = ffm_shm_read(ring->reader, pos, size);
+
+	assert_non_null(data);
+	if (data[0] != n || data[size - 1] != n)
+		fail_msg("packet %u at position %u has bad data", (unsigned)n, pos);
+}
+
+static void release_packet(struct ring *ring, uint32_t pos, uint32_t size)
+{
+	ffm_shm_release(ring->reader, pos, size);
+	ring->read_pos = pos + size;
+}
+
+/* writes packets without releasing them until the ring is full, checks
+ * that each one that fit is intact, then releases them all */
+static void fill_ring(struct ring *ring, uint32_t size)
+{
+	uint32_t pos[CAPACITY / PACKET_SIZE + 1];
+	size_t count = 0;
+
+	assert_true(size >= PACKET_SIZE);
+
+	while (write_packet(ring, (uint8_t)count, size, &pos[count])) {
+		count++;
+		assert_true(count < sizeof(pos) / sizeof(pos[0]));
+	}
+
+	/* the packet that didn't fit would have overwritten unreleased data,
+	 * so it goes through the pipe instead */
+	assert_true(count > 0);
+	assert_true(ring->next_pos - ring->read_pos <= CAPACITY);
+	assert_true(expected_pos(ring, size) + size - ring->read_pos > CAPACITY);
+
+	for (size_t i = 0; i < count; i++)
+		check_packet(ring, (uint8_t)i, pos[i], size);
+
+	release_packet(ring, pos[count - 1], size);
+}
+
+static void round_trip_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct ring ring;
+	uint32_t pos;
+
+	open_ring(&ring);
+
+	/* packets that don't fit in the ring at all, or are empty, go through
+	 * the pipe */
+	assert_false(ffm_shm_write(ring.writer, packet_data, CAPACITY, &pos));
+	assert_false(ffm_shm_write(ring.writer, packet_data, 0, &pos));
+
+	/* three times around the ring, skipping its end each time */
+	for (size_t i = 0; i < 24; i++) {
+		assert_true(write_packet(&ring, (uint8_t)i, PACKET_SIZE, &pos));
+		check_packet(&ring, (uint8_t)i, pos, PACKET_SIZE);
+		release_packet(&ring, pos, PACKET_SIZE);
+	}
+
+	assert_true(ring.next_pos > 2 * CAPACITY);
+
+	close_ring(&ring);
+}
+
+static void full_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct ring ring;
+	uint32_t first, pos;
+
+	open_ring(&ring);
+
+	assert_true(write_packet(&ring, 1, PACKET_SIZE, &first));
+	fill_ring(&ring, PACKET_SIZE);
+
+	/* once the muxer catches up, the ring is used again */
+	assert_true(write_packet(&ring, 2, PACKET_SIZE, &pos));
+	check_packet(&ring, 2, pos, PACKET_SIZE);
+
+	close_ring(&ring);
+
+	/* a packet that skips the end of the ring needs the start of it to be
+	 * released too */
+	open_ring(&ring);
+	assert_true(write_packet(&ring, 3, CAPACITY / 4, &first));
+	assert_true(write_packet(&ring, 4, SKIP_SIZE, &pos));
+	assert_false(write_packet(&ring, 5, SKIP_SIZE, &pos));
+
+	release_packet(&ring, first, CAPACITY / 4);
+	assert_false(write_packet(&ring, 5, SKIP_SIZE, &pos));
+
+	release_packet(&ring, ring.next_pos - SKIP_SIZE, SKIP_SIZE);
+	assert_true(write_packet(&ring, 5, SKIP_SIZE, &pos));
+	assert_int_equal(pos % CAPACITY, 0);
+	check_packet(&ring, 5, pos, SKIP_SIZE);
+
+	close_ring(&ring);
+}
+
+static void wrap_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct ring ring;
+	uint32_t pos = 0;
+	uint32_t last_pos;
+	bool wrapped = false;
+	bool filled = false;
+	uint8_t n = 0;
+
+	open_ring(&ring);
+
+	/* positions are 32 bits, so they wrap around after 4 GiB of data, go
+	 * a few times around the ring past that */
+	for (;;) {
+		uint32_t size = (n % 4) ? PACKET_SIZE : SKIP_SIZE;
+
+		/* fill the ring right as its positions wrap around */
+		if (!filled && ring.next_pos > UINT32_MAX - CAPACITY / 2) {
+			fill_ring(&ring, PACKET_SIZE);
+			filled = true;
+		}
+
+		last_pos = pos;
+		assert_true(write_packet(&ring, n, size, &pos));
+		check_packet(&ring, n, pos, size);
+		release_packet(&ring, pos, size);
+		n++;
+
+		if (pos < last_pos)
+			wrapped = true;
+		if (wrapped && pos > 4 * CAPACITY)
+			break;
+	}
+
+	assert_true(filled);
+
+	/* and works the same after the wrap */
+	fill_ring(&ring, PACKET_SIZE);
+	assert_true(write_packet(&ring, n, PACKET_SIZE, &pos));
+	check_packet(&ring, n, pos, PACKET_SIZE);
+
+	close_ring(&ring);
+}
+
+static int setup(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	packet_data = bmalloc(CAPACITY);
+	return 0;
+}
+
+static int teardown(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	bfree(packet_data);
+	return 0;
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(round_trip_test),
+		cmocka_unit_test(full_test),
+		cmocka_unit_test(wrap_test),
+	};
+
+	return cmocka_run_group_tests(tests, setup, teardown);
+}
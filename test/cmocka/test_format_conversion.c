@@ -0,0 +1,200 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <cmocka.h>
+
+#include <media-io/format-conversion.h>
+#include <media-io/format-conversion-kernels.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+
+/* a width that isn't a multiple of 8 exercises the remainder handling of the
+ * AVX2 kernels */
+#define TEST_WIDTH 1924
+#define TEST_HEIGHT 270
+#define BENCH_WIDTH 3840
+#define BENCH_HEIGHT 2160
+#define BENCH_ITERATIONS 20
+
+struct frame {
+	uint32_t width;
+	uint32_t height;
+
+	uint8_t *packed;
+	uint32_t packed_linesize;
+
+	uint8_t *planes[3];
+	uint32_t linesizes[3];
+};
+
+static void frame_init(struct frame *f, uint32_t width, uint32_t height)
+{
+	f->width = width;
+	f->height = height;
+	f->packed_linesize = width * 4;
+	f->packed = bmalloc(f->packed_linesize * height);
+
+	/* large enough for I444, both 4:2:0 layouts and packed 4:2:2 */
+	for (size_t i = 0; i < 3; i++) {
+		f->linesizes[i] = width;
+		f->planes[i] = bmalloc(width * height * 2);
+	}
+}
+
+static void frame_fill(struct frame *f, uint32_t seed)
+{
+	for (uint32_t i = 0; i < f->packed_linesize * f->height; i++) {
+		seed = seed * 1103515245 + 12345;
+		f->packed[i] = (uint8_t)(seed >> 16);
+	}
+
+	for (size_t p = 0; p < 3; p++) {
+		for (uint32_t i = 0; i < f->width * f->height * 2; i++) {
+			seed = seed * 1103515245 + 12345;
+			f->planes[p][i] = (uint8_t)(seed >> 16);
+		}
+	}
+}
+
+static void frame_free(struct frame *f)
+{
+	bfree(f->packed);
+	for (size_t i = 0; i < 3; i++)
+		bfree(f->planes[i]);
+}
+
+static void assert_planes_equal(const struct frame *a, const struct frame *b)
+{
+	for (size_t i = 0; i < 3; i++)
+		assert_memory_equal(a->planes[i], b->planes[i], a->width * a->height);
+}
+
+static const struct format_conversion_kernels *get_kernels(size_t idx)
+{
+	switch (idx) {
+	case 0:
+		return &format_conversion_kernels_sse2;
+#ifdef FORMAT_CONVERSION_AVX2
+	case 1:
+		return format_conversion_get_kernels() == &format_conversion_kernels_avx2
+			       ? &format_conversion_kernels_avx2
+			       : NULL;
+#endif
+	default:
+		return NULL;
+	}
+}
+
+static void kernels_match_sse2_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	const struct format_conversion_kernels *ref = &format_conversion_kernels_sse2;
+	const struct format_conversion_kernels *k;
+	struct frame expected, actual;
+
+	frame_init(&expected, TEST_WIDTH, TEST_HEIGHT);
+	frame_init(&actual, TEST_WIDTH, TEST_HEIGHT);
+
+	for (size_t idx = 1; (k = get_kernels(idx)) != NULL; idx++) {
+		frame_fill(&expected, 1);
+		frame_fill(&actual, 1);
+		ref->compress_uyvx_to_i420(expected.packed, expected.packed_linesize, 0, TEST_HEIGHT, expected.planes,
+					   expected.linesizes);
+		k->compress_uyvx_to_i420(actual.packed, actual.packed_linesize, 0, TEST_HEIGHT, actual.planes,
+					 actual.linesizes);
+		assert_planes_equal(&expected, &actual);
+
+		frame_fill(&expected, 2);
+		frame_fill(&actual, 2);
+		ref->compress_uyvx_to_nv12(expected.packed, expected.packed_linesize, 0, TEST_HEIGHT, expected.planes,
+					   expected.linesizes);
+		k->compress_uyvx_to_nv12(actual.packed, actual.packed_linesize, 0, TEST_HEIGHT, actual.planes,
+					 actual.linesizes);
+		assert_planes_equal(&expected, &actual);
+
+		frame_fill(&expected, 3);
+		frame_fill(&actual, 3);
+		ref->convert_uyvx_to_i444(expected.packed, expected.packed_linesize, 0, TEST_HEIGHT, expected.planes,
+					  expected.linesizes);
+		k->convert_uyvx_to_i444(actual.packed, actual.packed_linesize, 0, TEST_HEIGHT, actual.planes,
+					actual.linesizes);
+		assert_planes_equal(&expected, &actual);
+	}
+
+	frame_free(&expected);
+	frame_free(&actual);
+}
+
+/* converts a frame with one of the format pairs */
+static void convert(struct frame *f, size_t pair)
+{
+	const uint8_t *const in_planes[3] = {f->planes[0], f->planes[1], f->planes[2]};
+	const uint32_t h = f->height;
+
+	switch (pair) {
+	case 0:
+		compress_uyvx_to_i420(f->packed, f->packed_linesize, 0, h, f->planes, f->linesizes);
+		break;
+	case 1:
+		compress_uyvx_to_nv12(f->packed, f->packed_linesize, 0, h, f->planes, f->linesizes);
+		break;
+	case 2:
+		convert_uyvx_to_i444(f->packed, f->packed_linesize, 0, h, f->planes, f->linesizes);
+		break;
+	case 3:
+		decompress_nv12(in_planes, f->linesizes, 0, h, f->packed, f->packed_linesize);
+		break;
+	case 4:
+		decompress_420(in_planes, f->linesizes, 0, h, f->packed, f->packed_linesize);
+		break;
+	case 5:
+		decompress_422(f->planes[0], f->width, 0, h, f->packed, f->packed_linesize, true);
+		break;
+	}
+}
+
+static const char *pair_names[] = {
+	"UYVX -> I420", "UYVX -> NV12", "UYVX -> I444", "NV12 -> UYVX", "I420 -> UYVX", "YUY2 -> UYVX",
+};
+
+#define NUM_PAIRS (sizeof(pair_names) / sizeof(pair_names[0]))
+
+/* converts 4K frames for a while, so it only runs with OBS_TEST_BENCHMARK */
+static void conversion_benchmark_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	if (!getenv("OBS_TEST_BENCHMARK"))
+		skip();
+
+	struct frame f;
+	frame_init(&f, BENCH_WIDTH, BENCH_HEIGHT);
+	frame_fill(&f, 0);
+
+	printf("%s kernels, %dx%d:\n", format_conversion_get_kernels()->name, BENCH_WIDTH, BENCH_HEIGHT);
+
+	for (size_t pair = 0; pair < NUM_PAIRS; pair++) {
+		uint64_t start = os_gettime_ns();
+
+		for (size_t i = 0; i < BENCH_ITERATIONS; i++)
+			convert(&f, pair);
+
+		printf("%s  %7.3f ms\n", pair_names[pair],
+		       (double)(os_gettime_ns() - start) / BENCH_ITERATIONS / 1000000.0);
+	}
+
+	frame_free(&f);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(kernels_match_sse2_test),
+		cmocka_unit_test(conversion_benchmark_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
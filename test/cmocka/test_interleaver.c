@@ -0,0 +1,173 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <cmocka.h>
+
+#include <obs-output-interleaver.h>
+#include <util/darray.h>
+#include <util/platform.h>
+
+#define VIDEO_TRACKS 2
+#define AUDIO_TRACKS 6
+
+struct stream {
+	enum obs_encoder_type type;
+	size_t track_idx;
+	int64_t interval_usec;
+	int64_t next_dts_usec;
+};
+
+static void init_streams(struct stream *streams)
+{
+	for (size_t i = 0; i < VIDEO_TRACKS; i++)
+		streams[i] = (struct stream){OBS_ENCODER_VIDEO, i, 16667, 0};
+	for (size_t i = 0; i < AUDIO_TRACKS; i++)
+		streams[VIDEO_TRACKS + i] = (struct stream){OBS_ENCODER_AUDIO, i, 21333, (int64_t)i * 7};
+}
+
+/* packets of each track are in DTS order, but tracks arrive in random order
+ * relative to each other, like they do from separate encoder threads */
+static struct encoder_packet next_packet(struct stream *streams)
+{
+	struct stream *stream = &streams[rand() % (VIDEO_TRACKS + AUDIO_TRACKS)];
+	struct encoder_packet packet = {0};
+
+	packet.type = stream->type;
+	packet.track_idx = stream->track_idx;
+	packet.dts_usec = stream->next_dts_usec;
+	stream->next_dts_usec += stream->interval_usec;
+	return packet;
+}
+
+/* the sorted insertion the interleaver replaces */
+static void reference_insert(struct encoder_packet **array, size_t *num, struct encoder_packet *out)
+{
+	size_t idx;
+	for (idx = 0; idx < *num; idx++) {
+		struct encoder_packet *cur_packet = &(*array)[idx];
+
+		if (out->dts_usec == cur_packet->dts_usec && out->type == OBS_ENCODER_VIDEO &&
+		    cur_packet->type == OBS_ENCODER_VIDEO && out->track_idx > cur_packet->track_idx)
+			continue;
+
+		if (out->dts_usec == cur_packet->dts_usec && out->type == OBS_ENCODER_VIDEO)
+			break;
+		else if (out->dts_usec < cur_packet->dts_usec)
+			break;
+	}
+
+	*array = brealloc(*array, sizeof(struct encoder_packet) * (*num + 1));
+	memmove(&(*array)[idx + 1], &(*array)[idx], sizeof(struct encoder_packet) * (*num - idx));
+	(*array)[idx] = *out;
+	(*num)++;
+}
+
+static void interleaver_order_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct stream streams[VIDEO_TRACKS + AUDIO_TRACKS];
+	struct packet_interleaver pi = {0};
+	struct encoder_packet *ref = NULL;
+	size_t ref_num = 0;
+
+	srand(1234);
+	init_streams(streams);
+
+	for (size_t i = 0; i < 5000; i++) {
+		struct encoder_packet packet = next_packet(streams);
+		packet_interleaver_push(&pi, &packet);
+		reference_insert(&ref, &ref_num, &packet);
+	}
+
+	/* ready count has to match a linear scan against the same thresholds */
+	int64_t thresholds[INTERLEAVER_MAX_TRACKS];
+	for (size_t i = 0; i < INTERLEAVER_MAX_TRACKS; i++)
+		thresholds[i] = 20000000;
+	thresholds[packet_interleaver_track(OBS_ENCODER_AUDIO, 3)] = 15000000;
+
+	size_t expected_ready = 0;
+	while (expected_ready < ref_num) {
+		struct encoder_packet *p = &ref[expected_ready];
+		if (p->dts_usec >= thresholds[packet_interleaver_track(p->type, p->track_idx)])
+			break;
+		expected_ready++;
+	}
+	assert_int_equal(packet_interleaver_count_ready(&pi, thresholds), expected_ready);
+
+	for (size_t i = 0; i < ref_num; i++) {
+		struct encoder_packet packet;
+		assert_true(packet_interleaver_pop(&pi, &packet));
+		assert_int_equal(packet.dts_usec, ref[i].dts_usec);
+		assert_int_equal(packet.type, ref[i].type);
+		assert_int_equal(packet.track_idx, ref[i].track_idx);
+	}
+
+	assert_false(packet_interleaver_pop(&pi, NULL));
+	packet_interleaver_free(&pi);
+	bfree(ref);
+}
+
+/* compares against the sorted array, set OBS_TEST_BENCHMARK to run it */
+static void interleaver_benchmark_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	if (!getenv("OBS_TEST_BENCHMARK"))
+		skip();
+
+	const size_t backlogs[] = {64, 1024, 8192};
+
+	for (size_t b = 0; b < sizeof(backlogs) / sizeof(backlogs[0]); b++) {
+		struct stream streams[VIDEO_TRACKS + AUDIO_TRACKS];
+		struct packet_interleaver pi = {0};
+		struct encoder_packet *ref = NULL;
+		struct encoder_packet packet;
+		size_t ref_num = 0;
+		size_t total = backlogs[b] * 8;
+		uint64_t start;
+
+		srand(5678);
+		init_streams(streams);
+
+		/* keep a steady backlog, sending one packet per packet received */
+		start = os_gettime_ns();
+		for (size_t i = 0; i < total; i++) {
+			packet = next_packet(streams);
+			reference_insert(&ref, &ref_num, &packet);
+			if (ref_num > backlogs[b])
+				memmove(ref, ref + 1, sizeof(*ref) * --ref_num);
+		}
+		uint64_t array_ns = os_gettime_ns() - start;
+
+		srand(5678);
+		init_streams(streams);
+
+		start = os_gettime_ns();
+		for (size_t i = 0; i < total; i++) {
+			packet = next_packet(streams);
+			packet_interleaver_push(&pi, &packet);
+			if (pi.num > backlogs[b])
+				packet_interleaver_pop(&pi, &packet);
+		}
+		uint64_t heap_ns = os_gettime_ns() - start;
+
+		printf("backlog %5zu: sorted array %8.1f ns/packet, interleaver %6.1f ns/packet\n", backlogs[b],
+		       (double)array_ns / (double)total, (double)heap_ns / (double)total);
+
+		packet_interleaver_free(&pi);
+		bfree(ref);
+	}
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(interleaver_order_test),
+		cmocka_unit_test(interleaver_benchmark_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
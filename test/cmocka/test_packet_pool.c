@@ -0,0 +1,127 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <obs-packet-pool.h>
+#include <util/bmem.h>
+
+/* mirrors obs_encoder_packet_release */
+static void release_data(struct packet_pool *pool, uint8_t *data)
+{
+	long *p_refs = ((long *)data) - 1;
+	long refs = --(*p_refs);
+	if ((refs & PACKET_REFS_MASK) == 0)
+		packet_pool_release(pool, p_refs, refs);
+}
+
+static void pool_reuse_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct packet_pool pool;
+	struct obs_packet_pool_stats stats;
+
+	assert_true(packet_pool_init(&pool));
+
+	uint8_t *a = packet_pool_alloc(&pool, 1000);
+	memset(a, 0xAA, 1000);
+	release_data(&pool, a);
+
+	/* same size class */
+	uint8_t *b = packet_pool_alloc(&pool, 600);
+	assert_ptr_equal(a, b);
+
+	/* references keep the buffer alive */
+	long *p_refs = ((long *)b) - 1;
+	++(*p_refs);
+	release_data(&pool, b);
+	packet_pool_get_stats(&pool, &stats);
+	assert_int_equal(stats.bytes_in_use, 1024);
+	release_data(&pool, b);
+
+	packet_pool_get_stats(&pool, &stats);
+	assert_int_equal(stats.allocations, 2);
+	assert_int_equal(stats.hits, 1);
+	assert_int_equal(stats.bytes_in_use, 0);
+	assert_int_equal(stats.bytes_retained, 1024);
+	assert_int_equal(stats.high_water_mark, 1024);
+
+	packet_pool_free(&pool);
+}
+
+static void pool_limits_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct packet_pool pool;
+	struct obs_packet_pool_stats stats;
+	uint8_t *bufs[64];
+
+	assert_true(packet_pool_init(&pool));
+
+	/* large classes only keep a few buffers around */
+	for (size_t i = 0; i < 8; i++)
+		bufs[i] = packet_pool_alloc(&pool, 1024 * 1024);
+	for (size_t i = 0; i < 8; i++)
+		release_data(&pool, bufs[i]);
+
+	packet_pool_get_stats(&pool, &stats);
+	assert_int_equal(stats.bytes_retained, PACKET_POOL_MIN_CLASS_BLOCKS * 1024 * 1024);
+	assert_int_equal(stats.high_water_mark, 8 * 1024 * 1024);
+
+	/* buffers above the largest class are not pooled */
+	uint8_t *huge = packet_pool_alloc(&pool, 4 * 1024 * 1024);
+	release_data(&pool, huge);
+	packet_pool_get_stats(&pool, &stats);
+	assert_int_equal(stats.allocations, 8);
+
+	/* plain reference counted data, as built by muxers, is freed with bfree */
+	long *plain = bmalloc(sizeof(long) + 16);
+	*plain = 1;
+	release_data(&pool, (uint8_t *)(plain + 1));
+
+	packet_pool_free(&pool);
+	assert_int_equal(bnum_allocs(), 0);
+}
+
+static void pool_total_limit_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct packet_pool pool;
+	struct obs_packet_pool_stats stats;
+	uint8_t *bufs[PACKET_POOL_NUM_CLASSES][8];
+
+	assert_true(packet_pool_init(&pool));
+
+	/* every class would keep up to a MiB, but all of them together don't
+	 * keep more than the total limit */
+	for (size_t i = 0; i < PACKET_POOL_NUM_CLASSES; i++) {
+		for (size_t j = 0; j < 8; j++)
+			bufs[i][j] = packet_pool_alloc(&pool, (size_t)1 << (i + PACKET_POOL_MIN_SHIFT));
+	}
+	for (size_t i = PACKET_POOL_NUM_CLASSES; i > 0; i--) {
+		for (size_t j = 0; j < 8; j++)
+			release_data(&pool, bufs[i - 1][j]);
+	}
+
+	packet_pool_get_stats(&pool, &stats);
+	assert_int_equal(stats.bytes_in_use, 0);
+	assert_true(stats.bytes_retained <= PACKET_POOL_MAX_RETAINED_BYTES);
+	assert_true(stats.bytes_retained > PACKET_POOL_MAX_RETAINED_BYTES / 2);
+
+	packet_pool_free(&pool);
+	assert_int_equal(bnum_allocs(), 0);
+}
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(pool_reuse_test),
+		cmocka_unit_test(pool_limits_test),
+		cmocka_unit_test(pool_total_limit_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
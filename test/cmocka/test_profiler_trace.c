@@ -0,0 +1,196 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/profiler.h>
+#include <util/threading.h>
+
+#define TRACE_FILE "test_profiler_trace.json"
+
+static const char *outer_name = "outer";
+static const char *inner_name = "inner \"quoted\"";
+static const char *instant_name = "instant";
+
+static size_t count_occurrences(const char *str, const char *find)
+{
+	size_t count = 0;
+	size_t len = strlen(find);
+
+	while ((str = strstr(str, find)) != NULL) {
+		count++;
+		str += len;
+	}
+
+	return count;
+}
+
+static char *dump_trace(void)
+{
+	assert_true(profiler_trace_dump_json(TRACE_FILE));
+
+	char *json = os_quick_read_utf8_file(TRACE_FILE);
+	assert_non_null(json);
+	os_unlink(TRACE_FILE);
+	return json;
+}
+
+static void trace_events_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	profiler_trace_start(64);
+	assert_true(profiler_trace_active());
+
+	profile_start(outer_name);
+	profile_start(inner_name);
+	profile_trace_instant(instant_name);
+	profile_end(inner_name);
+	profile_end(outer_name);
+
+	profiler_trace_stop();
+	assert_false(profiler_trace_active());
+
+	/* not recorded */
+	profile_start(outer_name);
+	profile_end(outer_name);
+
+	char *json = dump_trace();
+	assert_int_equal(count_occurrences(json, "\"ph\":\"B\""), 2);
+	assert_int_equal(count_occurrences(json, "\"ph\":\"E\""), 2);
+	assert_int_equal(count_occurrences(json, "\"ph\":\"i\""), 1);
+	assert_non_null(strstr(json, "\"args\":{\"name\":\"outer\"}"));
+	assert_non_null(strstr(json, "\"name\":\"inner \\\"quoted\\\"\""));
+	bfree(json);
+}
+
+static void trace_wrap_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	profiler_trace_start(16);
+
+	profile_start(outer_name);
+	for (size_t i = 0; i < 100; i++) {
+		profile_start(inner_name);
+		profile_end(inner_name);
+	}
+	profile_end(outer_name);
+
+	/* only the last 16 events are kept, and end events whose begin event
+	 * was overwritten are dropped */
+	char *json = dump_trace();
+	assert_int_equal(count_occurrences(json, "\"ph\":\"B\""), 7);
+	assert_int_equal(count_occurrences(json, "\"ph\":\"E\""), 7);
+	bfree(json);
+
+	/* restarting discards the old events */
+	profiler_trace_start(16);
+	json = dump_trace();
+	assert_int_equal(count_occurrences(json, "\"ph\":"), 0);
+	bfree(json);
+
+	profiler_trace_stop();
+}
+
+#define NUM_THREADS 2
+#define NUM_CALLS 20000
+
+static void *trace_thread(void *param)
+{
+	UNUSED_PARAMETER(param);
+
+	for (size_t i = 0; i < NUM_CALLS; i++) {
+		profile_start(outer_name);
+		profile_start(inner_name);
+		profile_end(inner_name);
+		profile_end(outer_name);
+	}
+
+	return NULL;
+}
+
+static void trace_threads_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	pthread_t threads[NUM_THREADS];
+
+	profiler_trace_start(256);
+
+	for (size_t i = 0; i < NUM_THREADS; i++)
+		assert_int_equal(pthread_create(&threads[i], NULL, trace_thread, NULL), 0);
+
+	/* dumping while the threads are recording must always produce
+	 * balanced begin/end pairs */
+	for (size_t i = 0; i < 10; i++) {
+		char *json = dump_trace();
+		assert_true(count_occurrences(json, "\"ph\":\"B\"") >= count_occurrences(json, "\"ph\":\"E\""));
+		bfree(json);
+		os_sleep_ms(0);
+	}
+
+	for (size_t i = 0; i < NUM_THREADS; i++)
+		pthread_join(threads[i], NULL);
+
+	char *json = dump_trace();
+	assert_int_equal(count_occurrences(json, "\"name\":\"thread_name\""), NUM_THREADS);
+	assert_int_equal(count_occurrences(json, "\"ph\":\"B\""), count_occurrences(json, "\"ph\":\"E\""));
+	bfree(json);
+
+	profiler_trace_stop();
+}
+
+static void *trace_once_thread(void *param)
+{
+	UNUSED_PARAMETER(param);
+
+	profile_start(outer_name);
+	profile_end(outer_name);
+	return NULL;
+}
+
+static void trace_recycle_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	long allocs = 0;
+
+	/* buffers of exited threads are reused by the next trace, also when
+	 * the trace size changes */
+	for (size_t i = 0; i < 10; i++) {
+		pthread_t thread;
+
+		profiler_trace_start(i & 1 ? 64 : 128);
+		assert_int_equal(pthread_create(&thread, NULL, trace_once_thread, NULL), 0);
+		pthread_join(thread, NULL);
+
+		if (i == 0)
+			allocs = bnum_allocs();
+		else
+			assert_int_equal(bnum_allocs(), allocs);
+	}
+
+	char *json = dump_trace();
+	assert_int_equal(count_occurrences(json, "\"ph\":\"B\""), 1);
+	bfree(json);
+
+	profiler_trace_stop();
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(trace_events_test),
+		cmocka_unit_test(trace_wrap_test),
+		cmocka_unit_test(trace_threads_test),
+		cmocka_unit_test(trace_recycle_test),
+	};
+
+	int ret = cmocka_run_group_tests(tests, NULL, NULL);
+	profiler_free();
+	return ret;
+}
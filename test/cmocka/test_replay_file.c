@@ -0,0 +1,285 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <obs.h>
+#include <util/platform.h>
+
+#include "obs-ffmpeg-mux.h"
+
+/* the smallest buffer file replay_file_create makes */
+#define CAPACITY_MB 16
+#define CAPACITY ((size_t)CAPACITY_MB * 1024 * 1024)
+
+/* doesn't divide the capacity, so the ring skips its end when wrapping */
+#define PACKET_SIZE (CAPACITY / 10 + 4096)
+
+#define FRAME_USEC 100000
+#define GOP_SIZE 4
+
+static uint8_t *packet_data;
+static obs_output_t *output;
+
+static const char *test_getname(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Replay file test output";
+}
+
+static void *test_create(obs_data_t *settings, obs_output_t *output)
+{
+	UNUSED_PARAMETER(settings);
+	return output;
+}
+
+static void test_destroy(void *data)
+{
+	UNUSED_PARAMETER(data);
+}
+
+static bool test_start(void *data)
+{
+	UNUSED_PARAMETER(data);
+	return false;
+}
+
+static void test_stop(void *data, uint64_t ts)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(ts);
+}
+
+static struct obs_output_info test_output = {
+	.id = "test_replay_file_output",
+	.flags = OBS_OUTPUT_AV | OBS_OUTPUT_ENCODED,
+	.get_name = test_getname,
+	.create = test_create,
+	.destroy = test_destroy,
+	.start = test_start,
+	.stop = test_stop,
+};
+
+static void create_stream(struct ffmpeg_muxer *stream, int64_t max_time_sec)
+{
+	obs_data_t *settings = obs_data_create();
+
+	memset(stream, 0, sizeof(*stream));
+	stream->output = output;
+	stream->max_time = max_time_sec * 1000000;
+
+	obs_data_set_int(settings, "disk_buffer_mb", CAPACITY_MB);
+	obs_data_set_string(settings, "disk_buffer_dir", ".");
+	assert_true(replay_file_create(stream, settings));
+
+	obs_data_release(settings);
+}
+
+/* the keyframe index is freed along with the output */
+static void destroy_stream(struct ffmpeg_muxer *stream)
+{
+	replay_file_destroy(stream);
+	deque_free(&stream->keyframe_index);
+}
+
+/* the data of packet n is filled with n, so it can be checked later */
+static void push(struct ffmpeg_muxer *stream, enum obs_encoder_type type, size_t n, size_t size, bool keyframe)
+{
+	struct encoder_packet pkt = {
+		.type = type,
+		.data = packet_data,
+		.size = size,
+		.pts = (int64_t)n,
+		.dts = (int64_t)n,
+		.dts_usec = (int64_t)n * FRAME_USEC,
+		.timebase_num = 1,
+		.timebase_den = 1000000 / FRAME_USEC,
+		.keyframe = keyframe,
+	};
+
+	memset(packet_data, (uint8_t)n, size);
+	replay_file_push(stream, &pkt);
+}
+
+static void push_video(struct ffmpeg_muxer *stream, size_t n, size_t size)
+{
+	push(stream, OBS_ENCODER_VIDEO, n, size, n % GOP_SIZE == 0);
+}
+
+static void get_packet(struct ffmpeg_muxer *stream, size_t idx, struct encoder_packet *pkt)
+{
+	replay_file_get_packet(stream, idx, pkt);
+
+	for (size_t i = 0; i < pkt->size; i++) {
+		if (pkt->data[i] != (uint8_t)pkt->pts)
+			fail_msg("packet %zu has bad data at byte %zu", idx, i);
+	}
+}
+
+static void wraparound_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct ffmpeg_muxer stream;
+	struct encoder_packet pkt;
+	size_t total = 0;
+
+	create_stream(&stream, 3600);
+
+	/* three times around the ring */
+	for (size_t i = 0; i < 30; i++)
+		push_video(&stream, i, PACKET_SIZE);
+
+	/* what's left is the newest data, starting with a keyframe, in order
+	 * and intact, and never more than the ring holds */
+	size_t num = replay_file_num_packets(&stream);
+	assert_true(num > 0);
+	assert_true(num < 10);
+
+	for (size_t i = 0; i < num; i++) {
+		get_packet(&stream, i, &pkt);
+		assert_int_equal(pkt.pts, 30 - num + i);
+		assert_int_equal(pkt.size, PACKET_SIZE);
+		total += pkt.size;
+	}
+
+	get_packet(&stream, 0, &pkt);
+	assert_true(pkt.keyframe);
+	assert_true(total <= CAPACITY);
+	assert_int_equal(stream.cur_size, (int64_t)total);
+	assert_int_equal(stream.cur_time, pkt.dts_usec);
+
+	destroy_stream(&stream);
+}
+
+static void purge_by_time_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct ffmpeg_muxer stream;
+	struct encoder_packet first, last;
+
+	create_stream(&stream, 1);
+
+	for (size_t i = 0; i < 100; i++)
+		push_video(&stream, i, 1000);
+
+	size_t num = replay_file_num_packets(&stream);
+	get_packet(&stream, 0, &first);
+	get_packet(&stream, num - 1, &last);
+
+	/* whole GOPs are dropped from the front to stay within max_time */
+	assert_true(first.keyframe);
+	assert_int_equal(last.pts, 99);
+	assert_true(last.dts_usec - first.dts_usec <= stream.max_time);
+	assert_true(last.dts_usec - first.dts_usec > stream.max_time - GOP_SIZE * FRAME_USEC);
+	assert_int_equal(stream.keyframes, (num + GOP_SIZE - 1) / GOP_SIZE);
+
+	destroy_stream(&stream);
+}
+
+static void oversized_keyframe_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct ffmpeg_muxer stream;
+	struct encoder_packet pkt;
+
+	create_stream(&stream, 3600);
+
+	for (size_t i = 0; i < GOP_SIZE; i++)
+		push_video(&stream, i, 1000);
+
+	/* the keyframe doesn't fit, so its GOP is dropped, but not the audio */
+	push_video(&stream, GOP_SIZE, CAPACITY / 2 + 1);
+	for (size_t i = GOP_SIZE + 1; i < GOP_SIZE * 2; i++) {
+		push_video(&stream, i, 1000);
+		push(&stream, OBS_ENCODER_AUDIO, i, 100, false);
+	}
+	push_video(&stream, GOP_SIZE * 2, 1000);
+
+	assert_int_equal(replay_file_num_packets(&stream), GOP_SIZE + (GOP_SIZE - 1) + 1);
+
+	for (size_t i = GOP_SIZE; i < GOP_SIZE * 2 - 1; i++) {
+		get_packet(&stream, i, &pkt);
+		assert_int_equal(pkt.type, OBS_ENCODER_AUDIO);
+	}
+
+	get_packet(&stream, GOP_SIZE * 2 - 1, &pkt);
+	assert_int_equal(pkt.type, OBS_ENCODER_VIDEO);
+	assert_true(pkt.keyframe);
+	assert_int_equal(pkt.pts, GOP_SIZE * 2);
+
+	destroy_stream(&stream);
+}
+
+static void save_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct ffmpeg_muxer stream;
+	struct encoder_packet saved[GOP_SIZE * 2];
+
+	create_stream(&stream, 3600);
+
+	for (size_t i = 0; i < GOP_SIZE * 3; i++)
+		push_video(&stream, i, PACKET_SIZE / 4);
+
+	/* a save of the last two GOPs reads the right packets */
+	size_t start = GOP_SIZE;
+	replay_file_begin_save(&stream, start);
+
+	for (size_t i = 0; i < GOP_SIZE * 2; i++) {
+		get_packet(&stream, start + i, &saved[i]);
+		assert_int_equal(saved[i].pts, start + i);
+		assert_true(replay_file_packet_intact(&stream, &saved[i]));
+	}
+
+	/* packets keep coming in without waiting for the save, and once they
+	 * wrap around onto the save it finds out */
+	size_t n = GOP_SIZE * 3;
+	while (replay_file_packet_intact(&stream, &saved[GOP_SIZE * 2 - 1])) {
+		push_video(&stream, n++, PACKET_SIZE / 4);
+		assert_true(n < GOP_SIZE * 3 + 50);
+	}
+
+	assert_false(replay_file_packet_intact(&stream, &saved[0]));
+
+	destroy_stream(&stream);
+}
+
+static int setup(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	if (!obs_startup("en-US", NULL, NULL))
+		return -1;
+
+	obs_register_output(&test_output);
+	output = obs_output_create("test_replay_file_output", "replay", NULL, NULL);
+	packet_data = bmalloc(CAPACITY);
+	return output ? 0 : -1;
+}
+
+static int teardown(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	bfree(packet_data);
+	obs_output_release(output);
+	obs_shutdown();
+	return 0;
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(wraparound_test),
+		cmocka_unit_test(purge_by_time_test),
+		cmocka_unit_test(oversized_keyframe_test),
+		cmocka_unit_test(save_test),
+	};
+
+	return cmocka_run_group_tests(tests, setup, teardown);
+}
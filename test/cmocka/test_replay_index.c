@@ -0,0 +1,135 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include "obs-ffmpeg-mux.h"
+
+#define FRAME_USEC 10000
+#define GOP_SIZE 10
+
+/* indexes num_packets video packets, with a keyframe every GOP_SIZE packets
+ * starting at first_keyframe, as the replay buffer does when pushing them */
+static void fill_index(struct ffmpeg_muxer *stream, size_t first_keyframe, size_t num_packets)
+{
+	memset(stream, 0, sizeof(*stream));
+
+	for (size_t i = first_keyframe; i < num_packets; i += GOP_SIZE)
+		replay_index_push(stream, (int64_t)i * FRAME_USEC, i);
+}
+
+/* purges packets from the front as the replay buffer does */
+static void purge_packets(struct ffmpeg_muxer *stream, size_t first_keyframe, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		bool keyframe = i >= first_keyframe && (i - first_keyframe) % GOP_SIZE == 0;
+		replay_index_pop(stream, keyframe);
+	}
+}
+
+static void find_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct ffmpeg_muxer stream;
+
+	/* no keyframes, start with the first packet */
+	memset(&stream, 0, sizeof(stream));
+	assert_int_equal(replay_index_find(&stream, 0), 0);
+
+	/* packets 0 to 4 are from before the first keyframe */
+	fill_index(&stream, 5, 100);
+
+	/* before the first keyframe */
+	assert_int_equal(replay_index_find(&stream, -1000000), 5);
+	assert_int_equal(replay_index_find(&stream, 0), 5);
+	assert_int_equal(replay_index_find(&stream, 4 * FRAME_USEC), 5);
+
+	/* exactly on a keyframe, and just before and after it */
+	assert_int_equal(replay_index_find(&stream, 5 * FRAME_USEC), 5);
+	assert_int_equal(replay_index_find(&stream, 35 * FRAME_USEC), 35);
+	assert_int_equal(replay_index_find(&stream, 35 * FRAME_USEC - 1), 25);
+	assert_int_equal(replay_index_find(&stream, 35 * FRAME_USEC + 1), 35);
+
+	/* within a GOP */
+	assert_int_equal(replay_index_find(&stream, 41 * FRAME_USEC), 35);
+
+	/* after the last keyframe */
+	assert_int_equal(replay_index_find(&stream, 95 * FRAME_USEC), 95);
+	assert_int_equal(replay_index_find(&stream, 200 * FRAME_USEC), 95);
+
+	deque_free(&stream.keyframe_index);
+}
+
+static void find_after_purge_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct ffmpeg_muxer stream;
+
+	/* indices are relative to the packets still in the buffer */
+	fill_index(&stream, 5, 100);
+	purge_packets(&stream, 5, 25);
+
+	assert_int_equal(stream.first_packet_seq, 25);
+	assert_int_equal(replay_index_find(&stream, 0), 0);
+	assert_int_equal(replay_index_find(&stream, 41 * FRAME_USEC), 10);
+	assert_int_equal(replay_index_find(&stream, 200 * FRAME_USEC), 70);
+
+	deque_free(&stream.keyframe_index);
+}
+
+static void window_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct ffmpeg_muxer stream;
+	const size_t num_packets = 100;
+	const int64_t last_dts_usec = (int64_t)(num_packets - 1) * FRAME_USEC;
+	size_t start_idx;
+	int64_t end_usec;
+
+	fill_index(&stream, 5, num_packets);
+
+	/* the last 30 to 10 frames, starting at the keyframe before them */
+	stream.save_start_usec = 30 * FRAME_USEC;
+	stream.save_end_usec = 10 * FRAME_USEC;
+	replay_index_get_window(&stream, num_packets, last_dts_usec, &start_idx, &end_usec);
+	assert_int_equal(start_idx, 65);
+	assert_int_equal(end_usec, 89 * FRAME_USEC);
+
+	/* a window starting exactly on a keyframe */
+	stream.save_start_usec = 24 * FRAME_USEC;
+	stream.save_end_usec = 0;
+	replay_index_get_window(&stream, num_packets, last_dts_usec, &start_idx, &end_usec);
+	assert_int_equal(start_idx, 75);
+	assert_int_equal(end_usec, last_dts_usec);
+
+	/* a window longer than the buffer starts at its first keyframe */
+	stream.save_start_usec = 1000 * FRAME_USEC;
+	replay_index_get_window(&stream, num_packets, last_dts_usec, &start_idx, &end_usec);
+	assert_int_equal(start_idx, 5);
+
+	/* a window shorter than the last GOP starts at the last keyframe */
+	stream.save_start_usec = FRAME_USEC;
+	replay_index_get_window(&stream, num_packets, last_dts_usec, &start_idx, &end_usec);
+	assert_int_equal(start_idx, 95);
+
+	/* an index that's ahead of the packets falls back to the first one */
+	replay_index_get_window(&stream, 50, last_dts_usec, &start_idx, &end_usec);
+	assert_int_equal(start_idx, 0);
+
+	deque_free(&stream.keyframe_index);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(find_test),
+		cmocka_unit_test(find_after_purge_test),
+		cmocka_unit_test(window_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,198 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "rtmp-bitrate.h"
+
+/*
+ * Replays bandwidth traces through a simulated bottleneck link: the stream
+ * sends at the current bitrate into a queue that drains at the capacity of
+ * the trace, and the estimators get the samples TCP_INFO would report.  The
+ * simulation is deterministic, so the results can be compared run to run.
+ */
+
+#define STEP_MS 10
+#define SAMPLE_MS 100
+#define BASE_RTT_USEC 40000
+
+#define VIDEO_BITRATE 6000
+#define AUDIO_BITRATE 160
+
+struct trace_point {
+	int start_sec;
+	long kbps;
+};
+
+struct trace {
+	const char *name;
+	int duration_sec;
+	const struct trace_point *points;
+	size_t num_points;
+};
+
+static const struct trace_point step_down_points[] = {
+	{0, 8000},
+	{10, 3000},
+	{40, 6000},
+};
+
+/* a lossy uplink whose capacity keeps swinging */
+static const struct trace_point unstable_points[] = {
+	{0, 4500}, {2, 3000}, {4, 4500}, {6, 3000}, {8, 4500}, {10, 3000}, {12, 4500}, {14, 3000},
+	{16, 4500}, {18, 3000}, {20, 4500}, {22, 3000}, {24, 4500}, {26, 3000}, {28, 4500},
+};
+
+#define TRACE(name, duration, points) {name, duration, points, sizeof(points) / sizeof(points[0])}
+
+static const struct trace traces[] = {
+	TRACE("step down", 60, step_down_points),
+	TRACE("unstable", 30, unstable_points),
+};
+
+struct sim_result {
+	double utilization;   /* delivered / min(capacity, max bitrate) */
+	double max_delay_sec; /* queuing delay, after the first drop */
+	double settle_sec;    /* after the drop until the queue is back under 300 ms */
+	long min_bitrate;
+};
+
+static long trace_kbps(const struct trace *trace, double t)
+{
+	long kbps = trace->points[0].kbps;
+
+	for (size_t i = 0; i < trace->num_points; i++) {
+		if (t >= trace->points[i].start_sec)
+			kbps = trace->points[i].kbps;
+	}
+
+	return kbps;
+}
+
+static struct sim_result simulate(const struct bitrate_estimator_info *info, const struct trace *trace)
+{
+	struct bitrate_control ctrl;
+	struct sim_result result = {0};
+	double queue = 0.0;
+	double delivered_window = 0.0;
+	double delivered = 0.0;
+	double usable = 0.0;
+	uint64_t acked = 0;
+	double drop_sec = trace->num_points > 1 ? trace->points[1].start_sec : 0.0;
+	bool settled = false;
+
+	assert_true(bitrate_control_init(&ctrl, info, VIDEO_BITRATE, AUDIO_BITRATE));
+	result.min_bitrate = ctrl.cur_bitrate;
+
+	for (int ms = 0; ms < trace->duration_sec * 1000; ms += STEP_MS) {
+		double t = ms / 1000.0;
+		double dt = STEP_MS / 1000.0;
+		double cap = trace_kbps(trace, t) * 1000.0 / 8.0;
+		double send = (ctrl.cur_bitrate + AUDIO_BITRATE) * 1000.0 / 8.0 * dt;
+
+		queue += send;
+		double served = queue < cap * dt ? queue : cap * dt;
+		queue -= served;
+		acked += (uint64_t)served;
+		delivered += served;
+		delivered_window += served;
+
+		double max_rate = (VIDEO_BITRATE + AUDIO_BITRATE) * 1000.0 / 8.0;
+		usable += (cap < max_rate ? cap : max_rate) * dt;
+
+		double delay = queue / cap;
+		if (t >= drop_sec) {
+			if (delay > result.max_delay_sec)
+				result.max_delay_sec = delay;
+			if (!settled && delay < 0.3 && t > drop_sec + 0.5) {
+				result.settle_sec = t - drop_sec;
+				settled = true;
+			}
+		}
+
+		if ((ms + STEP_MS) % SAMPLE_MS == 0) {
+			struct bitrate_sample sample = {
+				.ts = (uint64_t)(ms + STEP_MS) * 1000000ULL,
+				.rtt_usec = (uint32_t)(BASE_RTT_USEC + delay * 1000000.0),
+				.min_rtt_usec = BASE_RTT_USEC,
+				.delivery_rate = (uint64_t)(delivered_window * 1000.0 / SAMPLE_MS),
+				.bytes_acked = acked,
+				.app_limited = queue < cap * dt,
+			};
+
+			bitrate_control_add_sample(&ctrl, &sample);
+			bitrate_control_update(&ctrl, sample.ts);
+			delivered_window = 0.0;
+
+			if (ctrl.cur_bitrate < result.min_bitrate)
+				result.min_bitrate = ctrl.cur_bitrate;
+		}
+	}
+
+	if (!settled)
+		result.settle_sec = trace->duration_sec - drop_sec;
+
+	result.utilization = delivered / usable;
+	bitrate_control_free(&ctrl);
+	return result;
+}
+
+static void check_estimator(const struct bitrate_estimator_info *info)
+{
+	/* the results can be printed to compare estimators */
+	bool print = getenv("OBS_TEST_BENCHMARK") != NULL;
+
+	for (size_t i = 0; i < sizeof(traces) / sizeof(traces[0]); i++) {
+		struct sim_result r = simulate(info, &traces[i]);
+
+		if (print)
+			printf("%-6s %-10s utilization %5.1f%%  max delay %6.2fs  settled in %5.2fs  min bitrate %ld\n",
+			       info->id, traces[i].name, r.utilization * 100.0, r.max_delay_sec, r.settle_sec,
+			       r.min_bitrate);
+
+		/* reacts to the drop within a few seconds, without giving up
+		 * most of the bandwidth */
+		assert_true(r.settle_sec < 5.0);
+		assert_true(r.max_delay_sec < 2.0);
+		assert_true(r.utilization > 0.6);
+		assert_true(r.min_bitrate >= 1000);
+	}
+}
+
+static void bbr_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	check_estimator(&bbr_estimator);
+}
+
+static void delay_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+	check_estimator(&delay_estimator);
+}
+
+static void deterministic_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct sim_result a = simulate(&bbr_estimator, &traces[0]);
+	struct sim_result b = simulate(&bbr_estimator, &traces[0]);
+
+	assert_memory_equal(&a, &b, sizeof(a));
+	assert_ptr_equal(bitrate_estimator_find("bbr"), &bbr_estimator);
+	assert_ptr_equal(bitrate_estimator_find("delay"), &delay_estimator);
+	assert_null(bitrate_estimator_find("unknown"));
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(bbr_test),
+		cmocka_unit_test(delay_test),
+		cmocka_unit_test(deterministic_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
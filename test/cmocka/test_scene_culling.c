@@ -0,0 +1,237 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <obs.h>
+#include <util/platform.h>
+
+#define CANVAS_SIZE 64
+
+static bool have_video;
+
+struct rect_source {
+	uint32_t width;
+	uint32_t height;
+};
+
+static const char *rect_getname(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Scene culling test source";
+}
+
+static void *rect_create(obs_data_t *settings, obs_source_t *source)
+{
+	struct rect_source *rs = bzalloc(sizeof(struct rect_source));
+	rs->width = (uint32_t)obs_data_get_int(settings, "width");
+	rs->height = (uint32_t)obs_data_get_int(settings, "height");
+
+	UNUSED_PARAMETER(source);
+	return rs;
+}
+
+static void rect_destroy(void *data)
+{
+	bfree(data);
+}
+
+static uint32_t rect_getwidth(void *data)
+{
+	struct rect_source *rs = data;
+	return rs->width;
+}
+
+static uint32_t rect_getheight(void *data)
+{
+	struct rect_source *rs = data;
+	return rs->height;
+}
+
+static void rect_render(void *data, gs_effect_t *effect)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(effect);
+}
+
+static struct obs_source_info rect_source_info = {
+	.id = "test_cull_rect_source",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CUSTOM_DRAW,
+	.get_name = rect_getname,
+	.create = rect_create,
+	.destroy = rect_destroy,
+	.get_width = rect_getwidth,
+	.get_height = rect_getheight,
+	.video_render = rect_render,
+};
+
+static obs_source_t *create_rect(uint32_t width, uint32_t height, bool opaque)
+{
+	obs_data_t *settings = obs_data_create();
+	obs_data_set_int(settings, "width", width);
+	obs_data_set_int(settings, "height", height);
+
+	obs_source_t *source = obs_source_create("test_cull_rect_source", "rect", settings, NULL);
+	obs_data_release(settings);
+
+	obs_source_set_video_opaque(source, opaque);
+	return source;
+}
+
+static obs_sceneitem_t *add_rect(obs_scene_t *scene, uint32_t width, uint32_t height, float x, float y,
+				 bool opaque)
+{
+	obs_source_t *source = create_rect(width, height, opaque);
+	obs_sceneitem_t *item = obs_scene_add(scene, source);
+	struct vec2 pos;
+
+	vec2_set(&pos, x, y);
+	obs_sceneitem_set_pos(item, &pos);
+
+	obs_source_release(source);
+	return item;
+}
+
+/* lets the graphics thread update the transforms and render the scene */
+static uint32_t get_culled_items(obs_scene_t *scene)
+{
+	os_sleep_ms(100);
+	return obs_scene_get_culled_item_count(scene);
+}
+
+static obs_scene_t *create_output_scene(void)
+{
+	obs_scene_t *scene = obs_scene_create("culling");
+	obs_set_output_source(0, obs_scene_get_source(scene));
+	return scene;
+}
+
+static void release_output_scene(obs_scene_t *scene)
+{
+	obs_set_output_source(0, NULL);
+	obs_scene_release(scene);
+}
+
+static void off_canvas_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	if (!have_video)
+		skip();
+
+	obs_scene_t *scene = create_output_scene();
+
+	add_rect(scene, 16, 16, 8.0f, 8.0f, false);
+	add_rect(scene, 16, 16, CANVAS_SIZE + 10.0f, 8.0f, false);
+	add_rect(scene, 16, 16, 8.0f, -20.0f, false);
+
+	/* partly on the canvas */
+	add_rect(scene, 16, 16, -8.0f, -8.0f, false);
+
+	assert_int_equal(get_culled_items(scene), 2);
+
+	obs_set_scene_item_culling(false);
+	assert_int_equal(get_culled_items(scene), 0);
+	obs_set_scene_item_culling(true);
+
+	release_output_scene(scene);
+}
+
+static void covered_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	if (!have_video)
+		skip();
+
+	obs_scene_t *scene = create_output_scene();
+
+	/* added first, so drawn below the item added after it */
+	add_rect(scene, 16, 16, 8.0f, 8.0f, false);
+	add_rect(scene, 32, 32, 24.0f, 24.0f, false);
+	obs_sceneitem_t *cover = add_rect(scene, CANVAS_SIZE, 48, 0.0f, 0.0f, true);
+
+	/* the second item sticks out below the cover */
+	assert_int_equal(get_culled_items(scene), 1);
+
+	/* a cover that isn't opaque doesn't hide anything */
+	obs_source_set_video_opaque(obs_sceneitem_get_source(cover), false);
+	assert_int_equal(get_culled_items(scene), 0);
+
+	obs_source_set_video_opaque(obs_sceneitem_get_source(cover), true);
+	obs_sceneitem_set_visible(cover, false);
+	assert_int_equal(get_culled_items(scene), 0);
+
+	release_output_scene(scene);
+}
+
+static void rotated_occluder_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	if (!have_video)
+		skip();
+
+	obs_scene_t *scene = create_output_scene();
+
+	/* inside the bounding box of the rotated cover, but not covered */
+	add_rect(scene, 8, 8, 30.0f, 2.0f, false);
+	obs_sceneitem_t *cover = add_rect(scene, CANVAS_SIZE, CANVAS_SIZE, 0.0f, 0.0f, true);
+
+	assert_int_equal(get_culled_items(scene), 1);
+
+	obs_sceneitem_set_rot(cover, 45.0f);
+	assert_int_equal(get_culled_items(scene), 0);
+
+	release_output_scene(scene);
+}
+
+static int setup(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct obs_video_info ovi = {
+		.graphics_module = "libobs-opengl",
+		.fps_num = 60,
+		.fps_den = 1,
+		.base_width = CANVAS_SIZE,
+		.base_height = CANVAS_SIZE,
+		.output_width = CANVAS_SIZE,
+		.output_height = CANVAS_SIZE,
+		.output_format = VIDEO_FORMAT_NV12,
+		.gpu_conversion = true,
+		.colorspace = VIDEO_CS_709,
+		.range = VIDEO_RANGE_PARTIAL,
+		.scale_type = OBS_SCALE_BICUBIC,
+	};
+
+	if (!obs_startup("en-US", NULL, NULL))
+		return -1;
+
+	/* needs a graphics device for scenes to be rendered */
+	have_video = obs_reset_video(&ovi) == OBS_VIDEO_SUCCESS;
+
+	obs_register_source(&rect_source_info);
+	obs_set_scene_item_culling(true);
+	return 0;
+}
+
+static int teardown(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	obs_shutdown();
+	return 0;
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(off_canvas_test),
+		cmocka_unit_test(covered_test),
+		cmocka_unit_test(rotated_occluder_test),
+	};
+
+	return cmocka_run_group_tests(tests, setup, teardown);
+}
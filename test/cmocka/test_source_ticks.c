@@ -0,0 +1,180 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <obs.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <util/source-profiler.h>
+
+#define NUM_POOLED_SOURCES 4
+#define TICK_SLEEP_MS 2
+
+static pthread_t graphics_thread;
+static volatile bool graphics_thread_known;
+
+static volatile long running;
+static volatile long max_running;
+static volatile long pooled_ticks;
+static volatile long off_thread_ticks;
+static volatile bool serial_overlapped;
+
+static const char *tick_getname(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Source tick test source";
+}
+
+static void *tick_create(obs_data_t *settings, obs_source_t *source)
+{
+	UNUSED_PARAMETER(settings);
+	return source;
+}
+
+static void tick_destroy(void *data)
+{
+	UNUSED_PARAMETER(data);
+}
+
+static void pooled_tick(void *data, float seconds)
+{
+	long cur = os_atomic_inc_long(&running);
+
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(seconds);
+
+	if (cur > os_atomic_load_long(&max_running))
+		os_atomic_set_long(&max_running, cur);
+	if (os_atomic_load_bool(&graphics_thread_known) && !pthread_equal(pthread_self(), graphics_thread))
+		os_atomic_inc_long(&off_thread_ticks);
+
+	os_sleep_ms(TICK_SLEEP_MS);
+
+	os_atomic_inc_long(&pooled_ticks);
+	os_atomic_dec_long(&running);
+}
+
+/* not flagged, so always ticked on the graphics thread after the pool */
+static void serial_tick(void *data, float seconds)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(seconds);
+
+	if (os_atomic_load_long(&running) != 0)
+		serial_overlapped = true;
+
+	if (!graphics_thread_known) {
+		graphics_thread = pthread_self();
+		os_atomic_set_bool(&graphics_thread_known, true);
+	}
+}
+
+static struct obs_source_info pooled_source = {
+	.id = "test_pooled_tick_source",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_TICK_THREAD_SAFE,
+	.get_name = tick_getname,
+	.create = tick_create,
+	.destroy = tick_destroy,
+	.video_tick = pooled_tick,
+};
+
+static struct obs_source_info serial_source = {
+	.id = "test_serial_tick_source",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_VIDEO,
+	.get_name = tick_getname,
+	.create = tick_create,
+	.destroy = tick_destroy,
+	.video_tick = serial_tick,
+};
+
+static bool reset_video(void)
+{
+	struct obs_video_info ovi = {
+		.graphics_module = "libobs-opengl",
+		.fps_num = 60,
+		.fps_den = 1,
+		.base_width = 64,
+		.base_height = 64,
+		.output_width = 64,
+		.output_height = 64,
+		.output_format = VIDEO_FORMAT_NV12,
+		.gpu_conversion = true,
+		.colorspace = VIDEO_CS_709,
+		.range = VIDEO_RANGE_PARTIAL,
+		.scale_type = OBS_SCALE_BICUBIC,
+	};
+
+	return obs_reset_video(&ovi) == OBS_VIDEO_SUCCESS;
+}
+
+static void pooled_ticks_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	obs_source_t *pooled[NUM_POOLED_SOURCES];
+	obs_source_t *serial;
+
+	assert_true(obs_startup("en-US", NULL, NULL));
+
+	/* needs a graphics device for the graphics thread to run */
+	if (!reset_video()) {
+		obs_shutdown();
+		skip();
+	}
+
+	obs_register_source(&pooled_source);
+	obs_register_source(&serial_source);
+
+	for (size_t i = 0; i < NUM_POOLED_SOURCES; i++) {
+		pooled[i] = obs_source_create("test_pooled_tick_source", "pooled", NULL, NULL);
+		assert_non_null(pooled[i]);
+	}
+	serial = obs_source_create("test_serial_tick_source", "serial", NULL, NULL);
+	assert_non_null(serial);
+
+	source_profiler_enable(true);
+	obs_set_parallel_source_ticks(true);
+	os_sleep_ms(500);
+
+	assert_true(obs_parallel_source_ticks_enabled());
+	assert_true(os_atomic_load_long(&pooled_ticks) > 0);
+	assert_true(os_atomic_load_long(&off_thread_ticks) > 0);
+	assert_true(os_atomic_load_long(&max_running) > 1);
+	assert_false(serial_overlapped);
+
+	/* the tick time measured on the worker reaches the profiler */
+	for (size_t i = 0; i < NUM_POOLED_SOURCES; i++) {
+		profiler_result_t *result = source_profiler_get_result(pooled[i]);
+		assert_non_null(result);
+		assert_true(result->tick_avg >= TICK_SLEEP_MS * 1000000ULL);
+		assert_true(result->tick_max >= result->tick_avg);
+		bfree(result);
+	}
+
+	/* turning it off ticks everything on the graphics thread again */
+	obs_set_parallel_source_ticks(false);
+	os_sleep_ms(100);
+	os_atomic_set_long(&off_thread_ticks, 0);
+	os_sleep_ms(200);
+
+	assert_int_equal(os_atomic_load_long(&off_thread_ticks), 0);
+
+	source_profiler_enable(false);
+
+	for (size_t i = 0; i < NUM_POOLED_SOURCES; i++)
+		obs_source_release(pooled[i]);
+	obs_source_release(serial);
+	obs_shutdown();
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(pooled_ticks_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
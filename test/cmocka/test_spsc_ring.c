@@ -0,0 +1,89 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <obs-spsc-ring.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#define RING_SIZE 8
+#define NUM_ITEMS 100000
+
+static void ring_basic_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct spsc_ring ring;
+	uintptr_t i;
+
+	spsc_ring_init(&ring, RING_SIZE);
+	assert_null(spsc_ring_pop(&ring));
+
+	for (i = 1; i < RING_SIZE; i++)
+		assert_true(spsc_ring_push(&ring, (void *)i));
+
+	assert_int_equal(spsc_ring_count(&ring), RING_SIZE - 1);
+	assert_false(spsc_ring_push(&ring, (void *)i));
+
+	/* wrap around */
+	for (i = 1; i < 4; i++)
+		assert_ptr_equal(spsc_ring_pop(&ring), (void *)i);
+	for (i = RING_SIZE; i < RING_SIZE + 3; i++)
+		assert_true(spsc_ring_push(&ring, (void *)i));
+
+	for (i = 4; i < RING_SIZE + 3; i++)
+		assert_ptr_equal(spsc_ring_pop(&ring), (void *)i);
+
+	assert_int_equal(spsc_ring_count(&ring), 0);
+	assert_null(spsc_ring_pop(&ring));
+
+	spsc_ring_free(&ring);
+}
+
+static void *producer_thread(void *data)
+{
+	struct spsc_ring *ring = data;
+
+	for (uintptr_t i = 1; i <= NUM_ITEMS; i++) {
+		while (!spsc_ring_push(ring, (void *)i))
+			os_sleep_ms(0);
+	}
+
+	return NULL;
+}
+
+static void ring_thread_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct spsc_ring ring;
+	pthread_t thread;
+	uintptr_t expected = 1;
+
+	spsc_ring_init(&ring, RING_SIZE);
+	assert_int_equal(pthread_create(&thread, NULL, producer_thread, &ring), 0);
+
+	while (expected <= NUM_ITEMS) {
+		void *item = spsc_ring_pop(&ring);
+		if (item)
+			assert_ptr_equal(item, (void *)expected++);
+		else
+			os_sleep_ms(0);
+	}
+
+	pthread_join(thread, NULL);
+	assert_null(spsc_ring_pop(&ring));
+
+	spsc_ring_free(&ring);
+}
+
+int main(void)
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(ring_basic_test),
+		cmocka_unit_test(ring_thread_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,196 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <util/task.h>
+#include <util/threading.h>
+
+#define NUM_TASKS 2000
+
+struct task_state {
+	os_task_queue_t *queue;
+	volatile long running;
+	volatile long max_running;
+	volatile long count;
+	bool out_of_order;
+	bool inside;
+};
+
+struct ordered_task {
+	struct task_state *ts;
+	long idx;
+};
+
+static void ordered_task(void *param)
+{
+	struct ordered_task *ot = param;
+	struct task_state *ts = ot->ts;
+	long running = os_atomic_inc_long(&ts->running);
+
+	if (running > ts->max_running)
+		ts->max_running = running;
+	if (os_atomic_load_long(&ts->count) != ot->idx)
+		ts->out_of_order = true;
+	ts->inside = os_task_queue_inside(ts->queue);
+
+	os_atomic_inc_long(&ts->count);
+	os_atomic_dec_long(&ts->running);
+}
+
+static void serial_queue_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	os_task_pool_t *pool = os_task_pool_create(4);
+	static struct ordered_task tasks[NUM_TASKS];
+	struct task_state ts = {0};
+	struct os_task_queue_stats stats;
+
+	assert_non_null(pool);
+	assert_int_equal(os_task_pool_get_thread_count(pool), 4);
+
+	ts.queue = os_task_queue_create_pooled(pool, true);
+	assert_non_null(ts.queue);
+
+	for (long i = 0; i < NUM_TASKS; i++) {
+		tasks[i].ts = &ts;
+		tasks[i].idx = i;
+		assert_true(os_task_queue_queue_task(ts.queue, ordered_task, &tasks[i]));
+	}
+
+	os_task_queue_wait(ts.queue);
+
+	assert_int_equal(ts.count, NUM_TASKS);
+	assert_int_equal(ts.max_running, 1);
+	assert_false(ts.out_of_order);
+	assert_true(ts.inside);
+	assert_false(os_task_queue_inside(ts.queue));
+
+	os_task_queue_get_stats(ts.queue, &stats);
+	assert_int_equal(stats.tasks_queued, NUM_TASKS);
+	assert_int_equal(stats.tasks_completed, NUM_TASKS);
+	assert_true(stats.max_latency_ns <= stats.total_latency_ns);
+
+	os_task_queue_destroy(ts.queue);
+	os_task_pool_destroy(pool);
+}
+
+static void counting_task(void *param)
+{
+	struct task_state *ts = param;
+	os_atomic_inc_long(&ts->count);
+}
+
+static void concurrent_queue_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	os_task_pool_t *pool = os_task_pool_create(4);
+	struct task_state a = {0};
+	struct task_state b = {0};
+	struct os_task_queue_stats stats;
+
+	a.queue = os_task_queue_create_pooled(pool, false);
+	b.queue = os_task_queue_create_pooled(pool, false);
+
+	for (long i = 0; i < NUM_TASKS; i++) {
+		os_task_queue_queue_task(a.queue, counting_task, &a);
+		os_task_queue_queue_task_priority(b.queue, counting_task, &b, OS_TASK_PRIORITY_LOW);
+	}
+
+	os_task_queue_wait(a.queue);
+	assert_int_equal(os_atomic_load_long(&a.count), NUM_TASKS);
+
+	/* destroying a queue waits for its remaining tasks */
+	os_task_queue_destroy(b.queue);
+	assert_int_equal(os_atomic_load_long(&b.count), NUM_TASKS);
+
+	os_task_queue_get_stats(a.queue, &stats);
+	assert_int_equal(stats.tasks_completed, NUM_TASKS);
+	assert_false(os_task_queue_wait(a.queue));
+
+	os_task_queue_destroy(a.queue);
+	os_task_pool_destroy(pool);
+}
+
+struct priority_state {
+	os_event_t *started;
+	os_event_t *release;
+	int order[3];
+	int count;
+};
+
+struct priority_task {
+	struct priority_state *ps;
+	int id;
+};
+
+static void blocking_task(void *param)
+{
+	struct priority_state *ps = param;
+	os_event_signal(ps->started);
+	os_event_wait(ps->release);
+}
+
+static void priority_task(void *param)
+{
+	struct priority_task *pt = param;
+	pt->ps->order[pt->ps->count++] = pt->id;
+}
+
+static void check_priorities(os_task_queue_t *queue)
+{
+	struct priority_state ps = {0};
+	struct priority_task low = {&ps, 0};
+	struct priority_task normal = {&ps, 1};
+	struct priority_task high = {&ps, 2};
+
+	os_event_init(&ps.started, OS_EVENT_TYPE_MANUAL);
+	os_event_init(&ps.release, OS_EVENT_TYPE_MANUAL);
+
+	/* hold the queue so the next tasks are all waiting together */
+	os_task_queue_queue_task(queue, blocking_task, &ps);
+	os_event_wait(ps.started);
+
+	os_task_queue_queue_task_priority(queue, priority_task, &low, OS_TASK_PRIORITY_LOW);
+	os_task_queue_queue_task_priority(queue, priority_task, &normal, OS_TASK_PRIORITY_NORMAL);
+	os_task_queue_queue_task_priority(queue, priority_task, &high, OS_TASK_PRIORITY_HIGH);
+	os_event_signal(ps.release);
+
+	os_task_queue_wait(queue);
+	assert_int_equal(ps.count, 3);
+	assert_int_equal(ps.order[0], 2);
+	assert_int_equal(ps.order[1], 1);
+	assert_int_equal(ps.order[2], 0);
+
+	os_event_destroy(ps.started);
+	os_event_destroy(ps.release);
+}
+
+static void priority_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	os_task_pool_t *pool = os_task_pool_create(2);
+	os_task_queue_t *pooled = os_task_queue_create_pooled(pool, true);
+	os_task_queue_t *dedicated = os_task_queue_create();
+
+	check_priorities(pooled);
+	check_priorities(dedicated);
+
+	os_task_queue_destroy(pooled);
+	os_task_queue_destroy(dedicated);
+	os_task_pool_destroy(pool);
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(serial_queue_test),
+		cmocka_unit_test(concurrent_queue_test),
+		cmocka_unit_test(priority_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,195 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <string.h>
+#include <cmocka.h>
+
+#include <obs.h>
+#include <media-io/video-io.h>
+#include <media-io/video-frame.h>
+#include <util/platform.h>
+
+#define WIDTH 320
+#define HEIGHT 180
+#define FPS 100
+#define NUM_FRAMES 60
+#define MAX_RECEIVED (NUM_FRAMES * 4)
+#define NUM_INPUTS 3
+
+/* sleeps longer than a frame interval so the video thread has to wait */
+#define SLOW_INPUT_MS 15
+
+struct test_input {
+	struct video_scale_info conversion;
+	uint32_t sleep_ms;
+
+	uint64_t timestamps[MAX_RECEIVED];
+	uint8_t values[MAX_RECEIVED];
+	size_t received;
+	bool out_of_order;
+};
+
+static uint64_t frame_time;
+
+static void input_callback(void *param, struct video_data *frame)
+{
+	struct test_input *ti = param;
+
+	if (ti->received) {
+		uint64_t prev = ti->timestamps[ti->received - 1];
+		if (frame->timestamp != prev + frame_time)
+			ti->out_of_order = true;
+	}
+
+	if (ti->received < MAX_RECEIVED) {
+		ti->timestamps[ti->received] = frame->timestamp;
+		ti->values[ti->received] = frame->data[0][0];
+		ti->received++;
+	}
+
+	if (ti->sleep_ms)
+		os_sleep_ms(ti->sleep_ms);
+}
+
+static void fill_frame(struct video_frame *frame, uint8_t value)
+{
+	for (size_t y = 0; y < HEIGHT; y++)
+		memset(frame->data[0] + y * frame->linesize[0], value, WIDTH);
+	for (size_t y = 0; y < HEIGHT / 2; y++) {
+		memset(frame->data[1] + y * frame->linesize[1], 128, WIDTH / 2);
+		memset(frame->data[2] + y * frame->linesize[2], 128, WIDTH / 2);
+	}
+}
+
+static void init_input(struct test_input *ti, uint32_t width, uint32_t height, uint32_t sleep_ms)
+{
+	memset(ti, 0, sizeof(*ti));
+	ti->conversion.format = VIDEO_FORMAT_I420;
+	ti->conversion.width = width;
+	ti->conversion.height = height;
+	ti->conversion.range = VIDEO_RANGE_PARTIAL;
+	ti->conversion.colorspace = VIDEO_CS_709;
+	ti->sleep_ms = sleep_ms;
+}
+
+/* finds the value an input received for a timestamp */
+static bool find_value(const struct test_input *ti, uint64_t ts, uint8_t *value)
+{
+	for (size_t i = 0; i < ti->received; i++) {
+		if (ti->timestamps[i] == ts) {
+			*value = ti->values[i];
+			return true;
+		}
+	}
+	return false;
+}
+
+/* waits until the video thread has stopped outputting frames and the last
+ * one made it through the slow input */
+static void wait_for_frames(video_t *video)
+{
+	uint32_t last;
+
+	do {
+		last = video_output_get_total_frames(video);
+		os_sleep_ms(SLOW_INPUT_MS * 4);
+	} while (video_output_get_total_frames(video) != last);
+}
+
+static void parallel_inputs_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	static struct test_input inputs[NUM_INPUTS];
+	struct video_output_info voi = {
+		.name = "test",
+		.format = VIDEO_FORMAT_I420,
+		.fps_num = FPS,
+		.fps_den = 1,
+		.width = WIDTH,
+		.height = HEIGHT,
+		.range = VIDEO_RANGE_PARTIAL,
+		.colorspace = VIDEO_CS_709,
+		.cache_size = 4,
+	};
+	video_t *video;
+
+	assert_true(obs_startup("en-US", NULL, NULL));
+	assert_int_equal(video_output_open(&video, &voi), VIDEO_OUTPUT_SUCCESS);
+	frame_time = video_output_get_frame_time(video);
+
+	video_output_set_parallel_inputs(video, true);
+	assert_true(video_output_parallel_inputs(video));
+
+	init_input(&inputs[0], WIDTH, HEIGHT, 0);
+	init_input(&inputs[1], WIDTH / 2, HEIGHT / 2, 0);
+	init_input(&inputs[2], WIDTH / 4, HEIGHT / 4, SLOW_INPUT_MS);
+
+	for (size_t i = 0; i < NUM_INPUTS; i++)
+		assert_true(video_output_connect(video, &inputs[i].conversion, input_callback, &inputs[i]));
+
+	uint64_t ts = os_gettime_ns();
+	uint64_t start_ts = ts;
+
+	for (size_t i = 0; i < NUM_FRAMES; i++) {
+		struct video_frame frame;
+
+		if (video_output_lock_frame(video, &frame, 1, ts)) {
+			fill_frame(&frame, (uint8_t)(16 + i));
+			video_output_unlock_frame(video);
+		}
+
+		ts += frame_time;
+		os_sleepto_ns(ts);
+	}
+
+	wait_for_frames(video);
+
+	uint32_t total[NUM_INPUTS];
+	uint32_t lagged[NUM_INPUTS];
+
+	for (size_t i = 0; i < NUM_INPUTS; i++)
+		assert_true(video_output_get_input_stats(video, input_callback, &inputs[i], &total[i], &lagged[i]));
+
+	for (size_t i = 0; i < NUM_INPUTS; i++)
+		video_output_disconnect(video, input_callback, &inputs[i]);
+
+	for (size_t i = 0; i < NUM_INPUTS; i++) {
+		/* every input gets every frame, in order, with the frame data
+		 * that was output for that timestamp */
+		assert_false(inputs[i].out_of_order);
+		assert_true(inputs[i].received > 0);
+		assert_int_equal(inputs[i].timestamps[0], start_ts);
+		assert_int_equal(total[i], inputs[i].received);
+
+		for (size_t j = 1; j < inputs[i].received; j++)
+			assert_true(inputs[i].values[j] >= inputs[i].values[j - 1]);
+	}
+
+	/* the scaled inputs saw the same frames as the full size input */
+	for (size_t j = 0; j < inputs[0].received; j++) {
+		for (size_t i = 1; i < NUM_INPUTS; i++) {
+			uint8_t value;
+			assert_true(find_value(&inputs[i], inputs[0].timestamps[j], &value));
+			assert_int_equal(value, inputs[0].values[j]);
+		}
+	}
+
+	/* only the slow input held up the video thread */
+	assert_int_equal(lagged[0], 0);
+	assert_int_equal(lagged[1], 0);
+	assert_true(lagged[2] > 0);
+	assert_true(lagged[2] < total[2]);
+
+	video_output_close(video);
+	obs_shutdown();
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(parallel_inputs_test),
+	};
+
+	return cmocka_run_group_tests(tests, NULL, NULL);
+}
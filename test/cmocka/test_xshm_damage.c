@@ -0,0 +1,166 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <cmocka.h>
+
+#include <X11/Xlib.h>
+#include <xcb/xcb.h>
+
+#include <obs.h>
+#include <obs-nix-platform.h>
+#include <util/platform.h>
+
+#define RECT_SIZE 16
+
+struct xshm_stats {
+	long long frames_captured;
+	long long frames_skipped;
+	long long bytes_copied;
+	long long last_bytes_copied;
+};
+
+static Display *display;
+
+static struct xshm_stats get_stats(obs_source_t *source)
+{
+	proc_handler_t *ph = obs_source_get_proc_handler(source);
+	struct xshm_stats stats;
+	calldata_t cd = {0};
+
+	assert_true(proc_handler_call(ph, "get_stats", &cd));
+	stats.frames_captured = calldata_int(&cd, "frames_captured");
+	stats.frames_skipped = calldata_int(&cd, "frames_skipped");
+	stats.bytes_copied = calldata_int(&cd, "bytes_copied");
+	stats.last_bytes_copied = calldata_int(&cd, "last_bytes_copied");
+	calldata_free(&cd);
+	return stats;
+}
+
+/* draws on the root window, which damages just that rectangle */
+static void draw_rect(int16_t x, int16_t y, uint32_t color)
+{
+	xcb_connection_t *xcb = xcb_connect(NULL, NULL);
+	xcb_screen_t *screen = xcb_setup_roots_iterator(xcb_get_setup(xcb)).data;
+	xcb_gcontext_t gc = xcb_generate_id(xcb);
+	xcb_rectangle_t rect = {x, y, RECT_SIZE, RECT_SIZE};
+
+	xcb_create_gc(xcb, gc, screen->root, XCB_GC_FOREGROUND, &color);
+	xcb_poly_fill_rectangle(xcb, screen->root, gc, 1, &rect);
+	xcb_free_gc(xcb, gc);
+	free(xcb_get_input_focus_reply(xcb, xcb_get_input_focus(xcb), NULL));
+	xcb_disconnect(xcb);
+}
+
+static void damage_test(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	obs_module_t *module;
+	obs_source_t *source;
+	struct xshm_stats start, idle, damaged;
+
+	if (!display)
+		skip();
+
+	assert_int_equal(obs_open_module(&module, LINUX_CAPTURE_PATH, LINUX_CAPTURE_DATA_PATH), MODULE_SUCCESS);
+	assert_true(obs_init_module(module));
+
+	obs_data_t *settings = obs_data_create();
+	obs_data_set_int(settings, "screen", 0);
+	obs_data_set_bool(settings, "show_cursor", false);
+	source = obs_source_create("xshm_input_v2", "screen", settings, NULL);
+	obs_data_release(settings);
+	assert_non_null(source);
+
+	/* only captures while shown */
+	obs_set_output_source(0, source);
+	os_sleep_ms(500);
+
+	/* the first frame is captured in full */
+	start = get_stats(source);
+	uint32_t width = obs_source_get_width(source);
+	uint32_t height = obs_source_get_height(source);
+	long long full_size = (long long)width * height * 4;
+
+	assert_true(width > RECT_SIZE && height > RECT_SIZE);
+	assert_true(start.frames_captured >= 1);
+	assert_true(start.bytes_copied >= full_size);
+
+	/* nothing changes on screen, so every frame is skipped */
+	os_sleep_ms(300);
+	idle = get_stats(source);
+	assert_int_equal(idle.frames_captured, start.frames_captured);
+	assert_int_equal(idle.bytes_copied, start.bytes_copied);
+	assert_true(idle.frames_skipped > start.frames_skipped);
+
+	/* only the damaged rectangle is copied */
+	draw_rect(8, 8, 0xFF0000);
+	os_sleep_ms(300);
+	damaged = get_stats(source);
+	assert_int_equal(damaged.frames_captured, idle.frames_captured + 1);
+	assert_int_equal(damaged.last_bytes_copied, RECT_SIZE * RECT_SIZE * 4);
+	assert_int_equal(damaged.bytes_copied - idle.bytes_copied, RECT_SIZE * RECT_SIZE * 4);
+	assert_true(damaged.last_bytes_copied < full_size);
+
+	obs_set_output_source(0, NULL);
+	obs_source_release(source);
+}
+
+static int setup(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	struct obs_video_info ovi = {
+		.graphics_module = "libobs-opengl",
+		.fps_num = 60,
+		.fps_den = 1,
+		.base_width = 640,
+		.base_height = 480,
+		.output_width = 640,
+		.output_height = 480,
+		.output_format = VIDEO_FORMAT_NV12,
+		.gpu_conversion = true,
+		.colorspace = VIDEO_CS_709,
+		.range = VIDEO_RANGE_PARTIAL,
+		.scale_type = OBS_SCALE_BICUBIC,
+	};
+
+	/* run under Xvfb (xvfb-run), skipped without an X server */
+	display = XOpenDisplay(NULL);
+	if (!display)
+		return 0;
+
+	obs_set_nix_platform(OBS_NIX_PLATFORM_X11_EGL);
+	obs_set_nix_platform_display(display);
+
+	if (!obs_startup("en-US", NULL, NULL))
+		return -1;
+
+	if (obs_reset_video(&ovi) != OBS_VIDEO_SUCCESS) {
+		obs_shutdown();
+		XCloseDisplay(display);
+		display = NULL;
+	}
+	return 0;
+}
+
+static int teardown(void **state)
+{
+	UNUSED_PARAMETER(state);
+
+	if (display) {
+		obs_shutdown();
+		XCloseDisplay(display);
+	}
+	return 0;
+}
+
+int main()
+{
+	const struct CMUnitTest tests[] = {
+		cmocka_unit_test(damage_test),
+	};
+
+	return cmocka_run_group_tests(tests, setup, teardown);
+}
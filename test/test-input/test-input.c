@@ -3,6 +3,7 @@
 OBS_DECLARE_MODULE()
 
 extern struct obs_source_info test_random;
+extern struct obs_source_info test_random_borrowed;
 extern struct obs_source_info test_sinewave;
 extern struct obs_source_info test_filter;
 extern struct obs_source_info async_sync_test;
@@ -13,6 +14,7 @@ extern struct obs_source_info sync_audio;
 bool obs_module_load(void)
 {
 	obs_register_source(&test_random);
+	obs_register_source(&test_random_borrowed);
 	obs_register_source(&test_sinewave);
 	obs_register_source(&test_filter);
 	obs_register_source(&async_sync_test);
@@ -0,0 +1,106 @@
+#include <stdlib.h>
+#include <util/threading.h>
+#include <util/platform.h>
+#include <obs.h>
+
+/* same as the random source, but fills frames borrowed from the source's
+ * frame cache instead of having them copied */
+
+struct random_borrowed_tex {
+	obs_source_t *source;
+	os_event_t *stop_signal;
+	pthread_t thread;
+	bool initialized;
+};
+
+static const char *random_borrowed_getname(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "20x20 Random Pixel Borrowed Frame Source (Test)";
+}
+
+static void random_borrowed_destroy(void *data)
+{
+	struct random_borrowed_tex *rt = data;
+
+	if (rt) {
+		if (rt->initialized) {
+			os_event_signal(rt->stop_signal);
+			pthread_join(rt->thread, NULL);
+		}
+
+		os_event_destroy(rt->stop_signal);
+		bfree(rt);
+	}
+}
+
+static inline void fill_frame(uint8_t *data, uint32_t linesize)
+{
+	size_t x, y;
+
+	for (y = 0; y < 20; y++) {
+		uint32_t *pixels = (uint32_t *)(data + y * linesize);
+
+		for (x = 0; x < 20; x++) {
+			uint32_t pixel = 0;
+			pixel |= (rand() % 256);
+			pixel |= (rand() % 256) << 8;
+			pixel |= (rand() % 256) << 16;
+			pixels[x] = pixel;
+		}
+	}
+}
+
+static void *video_thread(void *data)
+{
+	struct random_borrowed_tex *rt = data;
+	uint64_t cur_time = os_gettime_ns();
+
+	while (os_event_try(rt->stop_signal) == EAGAIN) {
+		struct obs_source_frame *frame = obs_source_borrow_frame(rt->source, VIDEO_FORMAT_BGRX, 20, 20);
+
+		if (frame) {
+			fill_frame(frame->data[0], frame->linesize[0]);
+
+			frame->timestamp = cur_time;
+			frame->full_range = false;
+			frame->trc = VIDEO_TRC_DEFAULT;
+
+			obs_source_output_borrowed_frame(rt->source, frame);
+		}
+
+		os_sleepto_ns(cur_time += 250000000);
+	}
+
+	return NULL;
+}
+
+static void *random_borrowed_create(obs_data_t *settings, obs_source_t *source)
+{
+	struct random_borrowed_tex *rt = bzalloc(sizeof(struct random_borrowed_tex));
+	rt->source = source;
+
+	if (os_event_init(&rt->stop_signal, OS_EVENT_TYPE_MANUAL) != 0) {
+		random_borrowed_destroy(rt);
+		return NULL;
+	}
+
+	if (pthread_create(&rt->thread, NULL, video_thread, rt) != 0) {
+		random_borrowed_destroy(rt);
+		return NULL;
+	}
+
+	rt->initialized = true;
+
+	UNUSED_PARAMETER(settings);
+	return rt;
+}
+
+struct obs_source_info test_random_borrowed = {
+	.id = "random_borrowed",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_ASYNC_VIDEO,
+	.get_name = random_borrowed_getname,
+	.create = random_borrowed_create,
+	.destroy = random_borrowed_destroy,
+};